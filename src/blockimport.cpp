@@ -0,0 +1,204 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockimport.h"
+
+#include "init.h"
+#include "main.h"
+#include "net.h"
+#include "sigverify.h"
+#include "tx/tx.h"
+
+struct CBlockImportPipeline::CImportItem {
+    CBlock block;
+    bool hasPos = false;
+    CDiskBlockPos pos;
+    CNode *pFrom = nullptr;
+    bool valid   = false;  // decoded and checked
+    bool ready   = false;  // the workers are done with it, guarded by mtx
+};
+
+CBlockImportStats &GetBlockImportStats() {
+    static CBlockImportStats stats;
+    return stats;
+}
+
+CBlockImportPipeline::CBlockImportPipeline(uint32_t maxQueueSizeIn) : maxQueueSize(std::max<uint32_t>(1, maxQueueSizeIn)) {
+    // as many workers as the signature verification threads, the calling thread of which is the connect thread here
+    CWorkerPool *pSigPool = GetSigVerifyPool();
+    uint32_t workerCount  = pSigPool ? pSigPool->GetThreadCount() : 1;
+    pPool.reset(new CWorkerPool(workerCount, "blkimport"));
+    connectThread = std::thread(&CBlockImportPipeline::ConnectThread, this);
+}
+
+CBlockImportPipeline::~CBlockImportPipeline() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopping = true;
+    }
+    readyCond.notify_all();
+    if (connectThread.joinable())
+        connectThread.join();
+
+    // no more tasks have been submitted since the items are all connected
+    pPool.reset();
+}
+
+bool CBlockImportPipeline::SubmitRaw(const std::vector<char> &vchBlock, const CDiskBlockPos *pPos) {
+    CBlockImportStats &stats = GetBlockImportStats();
+    auto pItem               = std::make_shared<CImportItem>();
+
+    int64_t beginTime = GetTimeMicros();
+    try {
+        CDataStream ss(vchBlock, SER_DISK, CLIENT_VERSION);
+        ss >> pItem->block;
+    } catch (std::exception &e) {
+        stats.decode.Add(false, GetTimeMicros() - beginTime);
+        LogPrint(BCLog::INFO, "%s : Deserialize or I/O error - %s\n", __func__, e.what());
+        return false;
+    }
+    stats.decode.Add(true, GetTimeMicros() - beginTime);
+
+    if (pPos) {
+        pItem->hasPos = true;
+        pItem->pos    = *pPos;
+    }
+    Push(pItem, true);
+    return true;
+}
+
+void CBlockImportPipeline::Submit(const CBlock &block, CNode *pFrom) { Push(MakeItem(block, pFrom), true); }
+
+bool CBlockImportPipeline::TrySubmit(const CBlock &block, CNode *pFrom) {
+    auto pItem = MakeItem(block, pFrom);
+    if (Push(pItem, false))
+        return true;
+
+    if (pItem->pFrom)
+        pItem->pFrom->Release();
+    return false;
+}
+
+std::shared_ptr<CBlockImportPipeline::CImportItem> CBlockImportPipeline::MakeItem(const CBlock &block, CNode *pFrom) {
+    auto pItem   = std::make_shared<CImportItem>();
+    pItem->block = block;
+    if (pFrom)
+        pItem->pFrom = pFrom->AddRef();
+    return pItem;
+}
+
+bool CBlockImportPipeline::Push(std::shared_ptr<CImportItem> pItem, bool fWait) {
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        if (items.size() >= maxQueueSize) {
+            if (!fWait) {
+                GetBlockImportStats().queueFullDrops++;
+                return false;
+            }
+            GetBlockImportStats().queueFullWaits++;
+            spaceCond.wait(lock, [this] { return items.size() < maxQueueSize; });
+        }
+        items.push_back(pItem);
+        GetBlockImportStats().queued++;
+    }
+
+    pPool->Submit([this, pItem]() {
+        PrepareItem(*pItem);
+
+        std::lock_guard<std::mutex> lock(mtx);
+        pItem->ready = true;
+        readyCond.notify_all();
+    });
+    return true;
+}
+
+void CBlockImportPipeline::Flush() {
+    std::unique_lock<std::mutex> lock(mtx);
+    spaceCond.wait(lock, [this] { return items.empty(); });
+}
+
+void CBlockImportPipeline::PrepareItem(CImportItem &item) {
+    CBlockImportStats &stats = GetBlockImportStats();
+
+    // the checks without the tx checks need no chain state
+    int64_t beginTime = GetTimeMicros();
+    CCacheWrapper cw;
+    CValidationState state;
+    if (!CheckBlock(item.block, state, cw, false)) {
+        stats.check.Add(false, GetTimeMicros() - beginTime);
+        LogPrint(BCLog::INFO, "CheckBlock() : block[%u]: %s failed in import pipeline\n", item.block.GetHeight(),
+                 item.block.GetHash().GetHex());
+        return;
+    }
+
+    // warm signatureCache with the signatures of the pubkey uid txs, the others need the accounts to be verified
+    // the pipeline runs in the workers already, so the batch is verified in this thread
+    vector<CSigVerifyItem> sigItems;
+    for (const auto &pTx : item.block.vptx) {
+        if (!pTx->signature.empty() && pTx->txUid.is<CPubKey>())
+            sigItems.emplace_back(pTx->GetHash(), pTx->signature, pTx->txUid.get<CPubKey>());
+    }
+    ::VerifySignatureBatch(sigItems);
+    stats.check.Add(true, GetTimeMicros() - beginTime);
+    item.valid = true;
+}
+
+void CBlockImportPipeline::ConnectItem(CImportItem &item) {
+    // a block of a peer failed the checks is passed to ProcessBlock() unchecked, which rejects it and punishes
+    // the peer by the DoS score of the state, the same as the blocks not received by the pipeline
+    if ((!item.valid && item.pFrom == nullptr) || ShutdownRequested())
+        return;
+
+    int64_t beginTime = GetTimeMicros();
+    bool success;
+    {
+        LOCK(cs_main);
+        CValidationState state;
+        success = ProcessBlock(state, item.pFrom, &item.block, item.hasPos ? &item.pos : nullptr, item.valid);
+        if (state.IsError())
+            fError = true;
+    }
+    GetBlockImportStats().connect.Add(success, GetTimeMicros() - beginTime);
+    if (success)
+        connectedCount++;
+}
+
+void CBlockImportPipeline::ConnectThread() {
+    RenameThread("coin-blkconnect");
+
+    while (true) {
+        std::shared_ptr<CImportItem> pItem;
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            readyCond.wait(lock, [this] { return (!items.empty() && items.front()->ready) || (stopping && items.empty()); });
+            if (items.empty())
+                return;  // stopping
+
+            pItem = items.front();
+        }
+
+        ConnectItem(*pItem);
+        if (pItem->pFrom)
+            pItem->pFrom->Release();
+
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            items.pop_front();
+            GetBlockImportStats().queued--;
+        }
+        spaceCond.notify_all();
+    }
+}
+
+static std::unique_ptr<CBlockImportPipeline> pNetBlockImporter;
+
+CBlockImportPipeline *GetNetBlockImportPipeline() { return pNetBlockImporter.get(); }
+
+void StartNetBlockImportPipeline() {
+    int64_t nQueueSize = SysCfg().GetArg("-importqueue", DEFAULT_BLOCK_IMPORT_QUEUE);
+    if (nQueueSize > 0)
+        pNetBlockImporter.reset(new CBlockImportPipeline(nQueueSize));
+}
+
+void StopNetBlockImportPipeline() { pNetBlockImporter.reset(); }
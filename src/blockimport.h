@@ -0,0 +1,102 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef COIN_BLOCKIMPORT_H
+#define COIN_BLOCKIMPORT_H
+
+#include "commons/workerpool.h"
+#include "persistence/disk.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class CBlock;
+class CNode;
+
+struct CBlockImportStageStats {
+    std::atomic<uint64_t> count{0};     // count of the blocks passed the stage
+    std::atomic<uint64_t> failures{0};  // count of the blocks failed in the stage
+    std::atomic<uint64_t> micros{0};    // total time spent in the stage
+
+    void Add(bool success, int64_t elapsed) {
+        (success ? count : failures)++;
+        micros += elapsed;
+    }
+};
+
+struct CBlockImportStats {
+    CBlockImportStageStats decode;
+    CBlockImportStageStats check;
+    CBlockImportStageStats connect;
+    std::atomic<uint64_t> queueFullWaits{0};  // count of the submits waiting for the queue to have room
+    std::atomic<uint64_t> queueFullDrops{0};  // count of the blocks not submitted since the queue was full
+    std::atomic<uint64_t> queued{0};          // count of the blocks in the queues now
+};
+
+// the stats of all of the import pipelines
+CBlockImportStats &GetBlockImportStats();
+
+/**
+ * Staged block import. The blocks are checked by CheckBlock() without tx checks in the workers,
+ * and the signatures of the txs signed by a pubkey uid are verified into signatureCache. Meanwhile one connect
+ * thread passes the checked blocks to ProcessBlock() in submit order, so that a block is being connected while
+ * the next ones are being prepared. The count of the blocks submitted but not connected is bounded, a submit
+ * waits for the queue to have room, and a try submit returns false at once.
+ */
+class CBlockImportPipeline {
+public:
+    CBlockImportPipeline(uint32_t maxQueueSizeIn);
+    // the submitted blocks are connected before it returns, unless shutdown is requested
+    ~CBlockImportPipeline();
+
+    // submit a block serialized in SER_DISK, e.g. read from a block file, return false if it fails to be decoded.
+    // it is decoded by the caller, so that a block file loader can rescan the bytes of a bad block at once
+    bool SubmitRaw(const std::vector<char> &vchBlock, const CDiskBlockPos *pPos);
+    // submit a block decoded by the caller, e.g. received from pFrom
+    void Submit(const CBlock &block, CNode *pFrom);
+    // submit a block without waiting, return false if the queue is full, e.g. in the message handler thread
+    bool TrySubmit(const CBlock &block, CNode *pFrom);
+
+    // wait for all of the submitted blocks to be connected
+    void Flush();
+
+    // ProcessBlock() has failed with an error state, e.g. a disk failure, no more blocks should be submitted
+    bool HasError() const { return fError; }
+    uint32_t GetConnectedCount() const { return connectedCount; }
+
+private:
+    struct CImportItem;
+
+    std::shared_ptr<CImportItem> MakeItem(const CBlock &block, CNode *pFrom);
+    bool Push(std::shared_ptr<CImportItem> pItem, bool fWait);
+    void PrepareItem(CImportItem &item);
+    void ConnectItem(CImportItem &item);
+    void ConnectThread();
+
+private:
+    uint32_t maxQueueSize;
+    std::unique_ptr<CWorkerPool> pPool;
+    std::thread connectThread;
+
+    std::mutex mtx;
+    std::condition_variable readyCond;  // the front item is ready to be connected, or stopping
+    std::condition_variable spaceCond;  // an item has been connected
+    std::deque<std::shared_ptr<CImportItem>> items;  // in submit order, including the one being connected
+    bool stopping = false;
+
+    std::atomic<bool> fError{false};
+    std::atomic<uint32_t> connectedCount{0};
+};
+
+// the pipeline of the blocks received during the initial block download, nullptr if -importqueue=0
+CBlockImportPipeline *GetNetBlockImportPipeline();
+void StartNetBlockImportPipeline();
+void StopNetBlockImportPipeline();
+
+#endif  // COIN_BLOCKIMPORT_H
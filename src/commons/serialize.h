@@ -1258,6 +1258,103 @@ public:
 
 
 
+/**
+ * Read only stream over a borrowed buffer, deserializes without copying the buffer like CDataStream does.
+ * The buffer must outlive the stream.
+ */
+class CBufferReader
+{
+private:
+    const char* pCur;
+    const char* pEnd;
+public:
+    int nType;
+    int nVersion;
+
+    CBufferReader(const char* pbegin, const char* pend, int nTypeIn, int nVersionIn) :
+        pCur(pbegin), pEnd(pend), nType(nTypeIn), nVersion(nVersionIn) {}
+
+    size_t size() const          { return pEnd - pCur; }
+    bool empty() const           { return pCur == pEnd; }
+    bool eof() const             { return pCur == pEnd; }
+    const char* data() const     { return pCur; }
+
+    int GetType()                { return nType; }
+    int GetVersion()             { return nVersion; }
+
+    CBufferReader& read(char* pch, size_t nSize)
+    {
+        if (nSize > size())
+            throw ios_base::failure("CBufferReader::read() : end of data");
+        memcpy(pch, pCur, nSize);
+        pCur += nSize;
+        return (*this);
+    }
+
+    CBufferReader& ignore(size_t nSize)
+    {
+        if (nSize > size())
+            throw ios_base::failure("CBufferReader::ignore() : end of data");
+        pCur += nSize;
+        return (*this);
+    }
+
+    template<typename T>
+    CBufferReader& operator>>(T& obj)
+    {
+        ::Unserialize(*this, obj, nType, nVersion);
+        return (*this);
+    }
+};
+
+/**
+ * Write only stream with an inline buffer of N bytes, which spills to the heap only if the written data
+ * exceeds N. Used to encode small and short-lived data (e.g. db keys) without heap allocation.
+ */
+template<size_t N>
+class CInlineBufferWriter
+{
+private:
+    char buf[N];
+    size_t nSize = 0;
+    std::string heapBuf;  // all of the data once spilled
+public:
+    int nType;
+    int nVersion;
+
+    CInlineBufferWriter(int nTypeIn, int nVersionIn) : nType(nTypeIn), nVersion(nVersionIn) {}
+
+    CInlineBufferWriter(const CInlineBufferWriter&) = delete;
+    CInlineBufferWriter& operator=(const CInlineBufferWriter&) = delete;
+
+    const char* data() const     { return nSize > N ? heapBuf.data() : buf; }
+    size_t size() const          { return nSize; }
+    std::string str() const      { return std::string(data(), nSize); }
+
+    int GetType()                { return nType; }
+    int GetVersion()             { return nVersion; }
+
+    CInlineBufferWriter& write(const char* pch, size_t nWriteSize)
+    {
+        if (nSize + nWriteSize > N) {
+            if (nSize <= N)
+                heapBuf.assign(buf, nSize);
+            heapBuf.append(pch, nWriteSize);
+        } else {
+            memcpy(buf + nSize, pch, nWriteSize);
+        }
+        nSize += nWriteSize;
+        return (*this);
+    }
+
+    template<typename T>
+    CInlineBufferWriter& operator<<(const T& obj)
+    {
+        ::Serialize(*this, obj, nType, nVersion);
+        return (*this);
+    }
+};
+
 /** RAII wrapper for FILE*.
  *
  * Will automatically close the file when it goes out of scope if not null.
@@ -0,0 +1,50 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "workerpool.h"
+
+#include "commons/util/util.h"
+
+CWorkerPool::CWorkerPool(uint32_t threadCountIn, const std::string &nameIn) : name(nameIn) {
+    for (uint32_t i = 0; i < threadCountIn; i++)
+        workers.emplace_back(&CWorkerPool::WorkerThread, this, i);
+}
+
+CWorkerPool::~CWorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopped = true;
+    }
+    taskCond.notify_all();
+    for (auto &worker : workers) {
+        if (worker.joinable())
+            worker.join();
+    }
+}
+
+void CWorkerPool::Submit(Task &&task) {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        tasks.push_back(std::move(task));
+    }
+    taskCond.notify_one();
+}
+
+void CWorkerPool::WorkerThread(uint32_t index) {
+    RenameThread(strprintf("coin-%s.%u", name, index).c_str());
+
+    while (true) {
+        Task task;
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            taskCond.wait(lock, [this] { return stopped || !tasks.empty(); });
+            if (tasks.empty())
+                return;  // stopped, the queued tasks are drained before
+
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        task();
+    }
+}
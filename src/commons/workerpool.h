@@ -0,0 +1,43 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef COIN_WORKERPOOL_H
+#define COIN_WORKERPOOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Fixed size pool of worker threads, which run the submitted tasks in submit order.
+ * The queued tasks are still run on destruction before the threads exit.
+ * The tasks must not throw, and the owner of a task must wait for it before releasing the data it uses.
+ */
+class CWorkerPool {
+public:
+    typedef std::function<void()> Task;
+
+    CWorkerPool(uint32_t threadCountIn, const std::string &nameIn);
+    ~CWorkerPool();
+
+    uint32_t GetThreadCount() const { return workers.size(); }
+
+    void Submit(Task &&task);
+
+private:
+    void WorkerThread(uint32_t index);
+
+    std::string name;
+    std::vector<std::thread> workers;
+    std::deque<Task> tasks;
+    std::mutex mtx;
+    std::condition_variable taskCond;
+    bool stopped = false;
+};
+
+#endif  // COIN_WORKERPOOL_H
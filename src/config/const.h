@@ -128,6 +128,34 @@ static const int64_t DEFAULT_DB_CACHE = 100;
 static const int64_t MAX_DB_CACHE = sizeof(void *) > 4 ? 4096 : 1024;
 /** min. -dbcache in (MiB) */
 static const int64_t MIN_DB_CACHE = 4;
+/** -asyncflush default, max count of the chain state snapshots pending to be written, 0 is synchronous */
+static const int32_t DEFAULT_ASYNC_FLUSH = 0;
+/** -dbblockcache default (MiB), the budget of LevelDB block caches shared by all of the dbs */
+static const int64_t DEFAULT_DB_BLOCK_CACHE = 128;
+/** -par default, the count of signature verification threads, 0 is the count of cores */
+static const int32_t DEFAULT_SIG_VERIFY_THREADS = 0;
+/** max. -par */
+static const int32_t MAX_SIG_VERIFY_THREADS = 16;
+/** -parallelexec default, the min count of the txs in a block to be executed in parallel, 0 is disabled */
+static const int32_t DEFAULT_PARALLEL_EXEC_MIN_TXS = 64;
+/** -incrementalrescan default, re-validate only the mempool txs depending on the keys written by the new blocks */
+static const bool DEFAULT_INCREMENTAL_RESCAN = true;
+/** -importqueue default, max count of the blocks decoded and checked ahead of the one being connected, 0 is disabled */
+static const int32_t DEFAULT_BLOCK_IMPORT_QUEUE = 32;
+/** -sigcachemaxmb default (MiB), the memory budget of the valid signature cache */
+static const int64_t DEFAULT_MAX_SIG_CACHE_SIZE = 32;
+/** max. -sigcachemaxmb (MiB) */
+static const int64_t MAX_MAX_SIG_CACHE_SIZE = 16384;
+/** -blockreadcache default (MiB), the max serialized size of the decoded blocks cached for reading */
+static const int64_t DEFAULT_BLOCK_READ_CACHE = 64;
+/** -wasmcachesize default (MiB), the max total code size of the instantiated wasm modules kept in memory */
+static const int64_t DEFAULT_WASM_CACHE_SIZE = 64;
+/** -wasmwarmup default, count of the wasm contracts called most by the last run to be instantiated on startup */
+static const int64_t DEFAULT_WASM_WARM_UP_COUNT = 32;
+/** -luastatepool default, count of the pre-initialised lua states kept for the lua contract calls */
+static const int64_t DEFAULT_LUA_STATE_POOL_SIZE = 16;
+/** max. -luastatepool */
+static const int64_t MAX_LUA_STATE_POOL_SIZE = 1024;
 
 /** Coinbase transaction outputs can only be spent after this number of new blocks (network rule) */
 static const int32_t BLOCK_REWARD_MATURITY = 100;
@@ -135,7 +135,9 @@ public:
     )
 
     friend bool operator<(const CCdpCoinPair& a, const CCdpCoinPair& b) {
-        return a.bcoin_symbol < b.bcoin_symbol || a.scoin_symbol < b.scoin_symbol;
+        if (a.bcoin_symbol != b.bcoin_symbol)
+            return a.bcoin_symbol < b.bcoin_symbol;
+        return a.scoin_symbol < b.scoin_symbol;
     }
 
     friend bool operator==(const CCdpCoinPair& a , const CCdpCoinPair& b) {
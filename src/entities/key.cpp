@@ -11,10 +11,15 @@
 #include "commons/base58.h"
 #include "commons/common.h"
 #include "commons/random.h"
+#include "commons/workerpool.h"
 #include "crypto/hash.h"
 #include "lax_der_parsing.h"
 #include "lax_der_privatekey_parsing.h"
 
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
 static secp256k1_context *secp256k1_context_verify = nullptr;
 static secp256k1_context *secp256k1_context_sign   = nullptr;
 
@@ -191,13 +196,63 @@ CKeyID CPubKey::GetKeyId() const { return CKeyID(Hash160(vch, vch + size())); }
 
 uint256 CPubKey::GetHash() const { return Hash(vch, vch + size()); }
 
+namespace {
+/**
+ * The parsed pubkeys of the recent signers, the miners and the price feeders sign again in every block.
+ * The cache is direct-mapped by the pubkey bytes, the pubkey in a slot is replaced by the next one mapped to it.
+ */
+class CParsedPubKeyCache {
+public:
+    bool Parse(const CPubKey &pubKey, secp256k1_pubkey &parsed) {
+        uint32_t len = pubKey.size();
+        uint32_t index = ReadLE32(pubKey.begin() + 1) % SLOT_COUNT;
+        CSlot &slot    = slots[index];
+        std::mutex &mtx = locks[index % LOCK_COUNT];
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (slot.len == len && memcmp(slot.vch, pubKey.begin(), len) == 0) {
+                parsed = slot.parsed;
+                return true;
+            }
+        }
+
+        if (!secp256k1_ec_pubkey_parse(secp256k1_context_verify, &parsed, pubKey.begin(), len))
+            return false;
+
+        std::lock_guard<std::mutex> lock(mtx);
+        slot.len = len;
+        memcpy(slot.vch, pubKey.begin(), len);
+        slot.parsed = parsed;
+        return true;
+    }
+
+private:
+    static const uint32_t SLOT_COUNT = 256;
+    static const uint32_t LOCK_COUNT = 16;
+
+    struct CSlot {
+        uint32_t len = 0;
+        uint8_t vch[CPubKey::COMPRESSED_PUBLIC_KEY_SIZE];
+        secp256k1_pubkey parsed;
+    };
+
+    CSlot slots[SLOT_COUNT];
+    std::mutex locks[LOCK_COUNT];
+};
+
+CParsedPubKeyCache parsedPubKeyCache;
+
+// the min count of items in a batch to be verified by the workers
+const size_t MIN_PARALLEL_VERIFY_ITEMS = 4;
+}  // namespace
+
 bool CPubKey::Verify(const uint256 &hash, const vector<uint8_t> &vchSig) const {
     if (!IsValid())
         return false;
 
     secp256k1_pubkey pubkey;
     secp256k1_ecdsa_signature sig;
-    if (!secp256k1_ec_pubkey_parse(secp256k1_context_verify, &pubkey, vch, size())) {
+    if (!parsedPubKeyCache.Parse(*this, pubkey)) {
         return false;
     }
     if (!ecdsa_signature_parse_der_lax(secp256k1_context_verify, &sig, vchSig.data(), vchSig.size())) {
@@ -209,6 +264,69 @@ bool CPubKey::Verify(const uint256 &hash, const vector<uint8_t> &vchSig) const {
     return secp256k1_ecdsa_verify(secp256k1_context_verify, &sig, hash.begin(), &pubkey);
 }
 
+bool CPubKey::VerifyBatch(const CSigVerifyItem *pItems, size_t count, vector<bool> *pResults, CWorkerPool *pPool) {
+    if (pResults)
+        pResults->assign(count, false);
+
+    if (pPool == nullptr || pPool->GetThreadCount() == 0 || count < MIN_PARALLEL_VERIFY_ITEMS) {
+        bool allValid = true;
+        for (size_t i = 0; i < count; i++) {
+            const CSigVerifyItem &item = pItems[i];
+            if (!item.pubkey.Verify(item.hash, item.signature)) {
+                if (pResults == nullptr)
+                    return false;
+                allValid = false;
+            } else if (pResults) {
+                (*pResults)[i] = true;
+            }
+        }
+        return allValid;
+    }
+
+    // every item is verified by one thread, the results are written as bytes to be safe among the threads
+    vector<uint8_t> results(count, 0);
+    std::atomic<size_t> nextItem{0};
+    std::atomic<bool> failed{false};
+    std::mutex mtx;
+    std::condition_variable doneCond;
+    uint32_t activeWorkers = std::min<size_t>(pPool->GetThreadCount(), count - 1);
+
+    auto verifyItems = [&]() {
+        while (pResults != nullptr || !failed) {
+            size_t index = nextItem++;
+            if (index >= count)
+                break;
+
+            const CSigVerifyItem &item = pItems[index];
+            results[index]             = item.pubkey.Verify(item.hash, item.signature);
+            if (!results[index])
+                failed = true;
+        }
+    };
+
+    for (uint32_t i = activeWorkers; i > 0; i--) {
+        pPool->Submit([&]() {
+            verifyItems();
+
+            std::lock_guard<std::mutex> lock(mtx);
+            activeWorkers--;
+            doneCond.notify_all();
+        });
+    }
+    verifyItems();
+    {
+        // the workers are using the locals, wait for them
+        std::unique_lock<std::mutex> lock(mtx);
+        doneCond.wait(lock, [&activeWorkers] { return activeWorkers == 0; });
+    }
+
+    if (pResults) {
+        for (size_t i = 0; i < count; i++)
+            (*pResults)[i] = results[i] != 0;
+    }
+    return !failed;
+}
+
 bool CPubKey::RecoverCompact(const uint256 &hash, const vector<uint8_t> &vchSig) {
     if (vchSig.size() != COMPACT_SIGNATURE_SIZE) return false;
 
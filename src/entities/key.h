@@ -19,9 +19,12 @@
 #include <stdexcept>
 #include <vector>
 
+class CWorkerPool;
+
 using namespace std;
 
 class CRegID;
+struct CSigVerifyItem;
 
 /** A reference to a CKey: the Hash160 of its serialized public key */
 class CKeyID : public uint160 {
@@ -206,6 +209,16 @@ public:
     // If this public key is not fully valid, the return value will be false.
     bool Verify(const uint256 &hash, const vector<uint8_t> &vchSig) const;
 
+    /**
+     * Verify the DER signatures of count items, split among the workers of pPool and the calling thread, or only
+     * in the calling thread if pPool is nullptr or there are too few items. Return true if all of them are valid.
+     * If pResults is nullptr, the verification stops at the first invalid signature, otherwise all of the items
+     * are verified and the result of every item is set in pResults.
+     * The caller must not be one of the workers of pPool, which may wait for the calling thread.
+     */
+    static bool VerifyBatch(const CSigVerifyItem *pItems, size_t count, vector<bool> *pResults = nullptr,
+                            CWorkerPool *pPool = nullptr);
+
     // Recover a public key from a compact signature.
     bool RecoverCompact(const uint256 &hash, const vector<uint8_t> &vchSig);
 
@@ -216,6 +229,17 @@ public:
     bool Derive(CPubKey &pubkeyChild, uint8_t ccChild[32], uint32_t nChild, const uint8_t cc[32]) const;
 };
 
+/** A signature to be verified by CPubKey::VerifyBatch(). */
+struct CSigVerifyItem {
+    uint256 hash;
+    vector<uint8_t> signature;
+    CPubKey pubkey;
+
+    CSigVerifyItem() {}
+    CSigVerifyItem(const uint256 &hashIn, const vector<uint8_t> &signatureIn, const CPubKey &pubkeyIn)
+        : hash(hashIn), signature(signatureIn), pubkey(pubkeyIn) {}
+};
+
 // secure_allocator is defined in allocators.h
 // CPrivKey is a serialized private key, with all parameters included (279 bytes)
 typedef vector<uint8_t, secure_allocator<uint8_t> > CPrivKey;
@@ -18,9 +18,11 @@
 #include "wallet/wallet.h"
 #include "wallet/walletdb.h"
 #include "main.h"
+#include "blockimport.h"
 #include "miner/miner.h"
 #include "net.h"
 #include "persistence/blockdb.h"
+#include "persistence/blockfilestore.h"
 #include "persistence/accountdb.h"
 #include "persistence/txdb.h"
 #include "persistence/contractdb.h"
@@ -69,6 +71,9 @@ CWallet *pWalletMain;
 static std::unique_ptr<ECCVerifyHandle> globalVerifyHandle;
 
 extern void wasm_code_cache_free();
+extern bool wasm_code_cache_dump();
+extern void wasm_code_cache_warm_up(uint32_t count,
+                                    const std::function<bool(uint64_t, uint256&, vector<uint8_t>&)>& loadCode);
 
 #ifdef WIN32
 // Win32 LevelDB doesn't use filedescriptors, and the ones used for
@@ -141,6 +146,7 @@ void Shutdown() {
 
     StopNode();
     UnregisterNodeSignals(GetNodeSignals());
+    StopNetBlockImportPipeline();
 
     {
         LOCK(cs_main);
@@ -166,6 +172,7 @@ void Shutdown() {
     globalVerifyHandle.reset();
     ECC_Stop();
 
+    wasm_code_cache_dump();
     wasm_code_cache_free();
 
     LogPrint(BCLog::INFO, "Shutdown() : done\n");
@@ -199,6 +206,41 @@ bool static Bind(const CService &addr, uint32_t flags) {
     return true;
 }
 
+// -dbtune=<db>.<option>=<n>, override one option of the db tuning profile
+bool static ParseDbTuneOption(const string &strTune, string &strError) {
+    size_t dotPos = strTune.find('.');
+    size_t eqPos  = strTune.find('=');
+    int32_t value = 0;
+    DBNameType dbNameType;
+    if (dotPos == string::npos || eqPos == string::npos || eqPos < dotPos ||
+        !ParseInt32(strTune.substr(eqPos + 1), &value) || value < 0) {
+        strError = strprintf(_("Invalid -dbtune option: '%s'"), strTune);
+        return false;
+    }
+    if (!GetDbNameEnumByName(strTune.substr(0, dotPos), dbNameType)) {
+        strError = strprintf(_("Unknown db in -dbtune option: '%s'"), strTune);
+        return false;
+    }
+
+    CDBTuningProfile &profile = GetDbTuningProfile(dbNameType);
+    string option = strTune.substr(dotPos + 1, eqPos - dotPos - 1);
+    if (option == "cacheshare" && value <= 100)
+        profile.block_cache_share = value;
+    else if (option == "bloombits")
+        profile.bloom_bits = value;
+    else if (option == "writebuffer" && value > 0)
+        profile.write_buffer_size = (uint32_t)value << 10;
+    else if (option == "compression")
+        profile.compression = value != 0;
+    else if (option == "maxopenfiles" && value > 0)
+        profile.max_open_files = value;
+    else {
+        strError = strprintf(_("Invalid -dbtune option: '%s'"), strTune);
+        return false;
+    }
+    return true;
+}
+
 // Core-specific options shared between UI, daemon and RPC client
 string HelpMessage() {
     string strUsage = _("Options:") + "\n";
@@ -213,6 +255,17 @@ string HelpMessage() {
 #endif
     strUsage += "  -datadir=<dir>         " + _("Specify data directory") + "\n";
     strUsage += "  -dbcache=<n>           " + strprintf(_("Set database cache size in megabytes (%d to %d, default: %d)"), MIN_DB_CACHE, MAX_DB_CACHE, DEFAULT_DB_CACHE) + "\n";
+    strUsage += "  -dbblockcache=<n>      " + strprintf(_("Set the budget of the LevelDB block caches shared by all of the databases in megabytes (default: %d)"), DEFAULT_DB_BLOCK_CACHE) + "\n";
+    strUsage += "  -dbtune=<db>.<opt>=<n> " + _("Override one LevelDB option of a database, e.g. accounts.bloombits=12. <opt> is one of cacheshare (percent of -dbblockcache, 0 = common block cache), bloombits (0 = no bloom filter), writebuffer (KiB), compression (0 or 1), maxopenfiles. Can be specified multiple times") + "\n";
+    strUsage += "  -par=<n>               " + strprintf(_("Set the number of signature verification and tx execution threads, including the validation thread (0 = number of cores, 1 = no parallel verification, max: %d, default: %d)"), MAX_SIG_VERIFY_THREADS, DEFAULT_SIG_VERIFY_THREADS) + "\n";
+    strUsage += "  -parallelexec=<n>      " + strprintf(_("Execute the transfer and dex order txs of a block in parallel if there are at least <n> of them (0 = disabled, default: %d)"), DEFAULT_PARALLEL_EXEC_MIN_TXS) + "\n";
+    strUsage += "  -incrementalrescan     " + strprintf(_("Re-validate only the mempool transactions depending on the data changed by the new blocks, instead of all of them (default: %u)"), DEFAULT_INCREMENTAL_RESCAN) + "\n";
+    strUsage += "  -importqueue=<n>       " + strprintf(_("Decode and check up to <n> blocks ahead of the one being connected on importing and initial block download (0 = disabled, default: %d)"), DEFAULT_BLOCK_IMPORT_QUEUE) + "\n";
+    strUsage += "  -blockreadcache=<n>    " + strprintf(_("Set the size of the cache of the recently read or written blocks in megabytes (0 = disabled, default: %d)"), DEFAULT_BLOCK_READ_CACHE) + "\n";
+    strUsage += "  -asyncflush=<n>        " + strprintf(_("Write chain state to disk in background, with at most <n> pending snapshots (0 = synchronous, default: %d)"), DEFAULT_ASYNC_FLUSH) + "\n";
+    strUsage += "  -wasmcachesize=<n>     " + strprintf(_("Keep the instantiated wasm contracts of up to <n> megabytes of code in memory, the least recently used ones are evicted (default: %d)"), DEFAULT_WASM_CACHE_SIZE) + "\n";
+    strUsage += "  -wasmwarmup=<n>        " + strprintf(_("Instantiate the <n> wasm contracts called most by the last run in the background on startup, 0 = disable (default: %d)"), DEFAULT_WASM_WARM_UP_COUNT) + "\n";
+    strUsage += "  -luastatepool=<n>      " + strprintf(_("Keep <n> lua states with the libs opened ready for the lua contract calls, 0 = disable (max: %d, default: %d)"), MAX_LUA_STATE_POOL_SIZE, DEFAULT_LUA_STATE_POOL_SIZE) + "\n";
     strUsage += "  -loadblock=<file>      " + _("Imports blocks from external blk000??.dat file") + " " + _("on startup") + "\n";
     strUsage += "  -pid=<file>            " + _("Specify pid file (default: coin.pid)") + "\n";
     strUsage += "  -reindex               " + _("Rebuild block chain index from current blk000??.dat files") + " " + _("on startup") + "\n";
@@ -284,7 +337,8 @@ string HelpMessage() {
     strUsage += "  -logtimestamps         " + _("Prepend debug output with timestamp (default: 1)") + "\n";
     if (SysCfg().GetBoolArg("-help-debug", false)) {
         strUsage += "  -limitfreerelay=<n>    " + _("Continuously rate-limit free transactions to <n>*1000 bytes per minute (default:15)") + "\n";
-        strUsage += "  -maxsigcachesize=<n>   " + _("Limit size of signature cache to <n> entries (default: 50000)") + "\n";
+        strUsage += "  -sigcachemaxmb=<n>     " + strprintf(_("Limit the memory of the signature cache to <n> megabytes (0 = disabled, max: %d, default: %d)"), MAX_MAX_SIG_CACHE_SIZE, DEFAULT_MAX_SIG_CACHE_SIZE) + "\n";
+        strUsage += "  -maxsigcachesize=<n>   " + _("Deprecated, limit size of signature cache to <n> entries, overridden by -sigcachemaxmb") + "\n";
     }
     strUsage += "  -logprinttoconsole     " + _("Send trace/debug info to console instead of debug.log file") + "\n";
     if (SysCfg().GetBoolArg("-help-debug", false)) {
@@ -333,6 +387,27 @@ struct CImportingNow {
     }
 };
 
+// instantiate the wasm contracts called most by the last run, so that their first calls need no instantiation
+void ThreadWasmWarmUp(uint32_t count) {
+    RenameThread("coin-wasmwarmup");
+
+    wasm_code_cache_warm_up(count, [](uint64_t account, uint256 &codeHash, vector<uint8_t> &code) {
+        LOCK(cs_main);
+        if (pCdMan == nullptr)
+            return false;
+
+        CAccount contractAccount;
+        CUniversalContract contract;
+        if (!pCdMan->pAccountCache->GetAccount(CNickID(account), contractAccount) ||
+            !pCdMan->pContractCache->GetContractCodeHash(contractAccount.regid, codeHash) ||
+            !pCdMan->pContractCache->GetContract(contractAccount.regid, contract))
+            return false;
+
+        code.assign(contract.code.begin(), contract.code.end());
+        return true;
+    });
+}
+
 void ThreadImport(vector<boost::filesystem::path> vImportFiles) {
     RenameThread("coin-loadblk");
 
@@ -669,6 +744,29 @@ bool AppInit(boost::thread_group &threadGroup) {
 
     SysCfg().SetGenReceipt(SysCfg().GetBoolArg("-genreceipt", false));
 
+    SetDbBlockCacheBudget(std::max<int64_t>(1, SysCfg().GetArg("-dbblockcache", DEFAULT_DB_BLOCK_CACHE)) << 20);
+    GetBlockFileStore().SetCacheBudget(std::max<int64_t>(0, SysCfg().GetArg("-blockreadcache", DEFAULT_BLOCK_READ_CACHE)) << 20);
+    uint64_t nSigCacheBytes = DEFAULT_MAX_SIG_CACHE_SIZE << 20;
+    if (SysCfg().IsArgCount("-sigcachemaxmb")) {
+        int64_t nSigCacheSize = SysCfg().GetArg("-sigcachemaxmb", DEFAULT_MAX_SIG_CACHE_SIZE);
+        nSigCacheBytes = std::min(std::max<int64_t>(0, nSigCacheSize), MAX_MAX_SIG_CACHE_SIZE) << 20;
+    } else if (SysCfg().IsArgCount("-maxsigcachesize")) {
+        // the legacy option counts the entries
+        int64_t nSigCacheEntries = std::max<int64_t>(0, SysCfg().GetArg("-maxsigcachesize", 0));
+        nSigCacheBytes = std::min<uint64_t>(CSignatureCache::GetBytesOfEntries(nSigCacheEntries),
+                                            MAX_MAX_SIG_CACHE_SIZE << 20);
+        LogPrint(BCLog::INFO, "-maxsigcachesize is deprecated, use -sigcachemaxmb=%d instead\n",
+                 (nSigCacheBytes + (1 << 20) - 1) >> 20);
+    }
+    signatureCache.SetMaxSize(nSigCacheBytes);
+    if (SysCfg().IsArgCount("-dbtune")) {
+        for (const auto &strTune : SysCfg().GetMultiArgs("-dbtune")) {
+            string strError;
+            if (!ParseDbTuneOption(strTune, strError))
+                return InitError(strError);
+        }
+    }
+
     filesystem::path blocksDir = GetDataDir() / "blocks";
     if (!filesystem::exists(blocksDir)) {
         filesystem::create_directories(blocksDir);
@@ -695,9 +793,26 @@ bool AppInit(boost::thread_group &threadGroup) {
 
                 bool fReIndex = SysCfg().IsReindex();
                 pCdMan = new CCacheDBManager(fReIndex, false);
+                if (pCdMan->IsFlushIncomplete()) {
+                    strLoadError = _("The last flush of the chain state was interrupted");
+                    break;
+                }
                 if (fReIndex)
                     pCdMan->pBlockCache->WriteReindexing(true);
 
+                // the contracts saved before the code hashes, so that the wasm code cache never hashes their code
+                uint32_t filledCount = 0;
+                if (!pCdMan->pContractCache->FillContractCodeHashes(filledCount) || !pCdMan->pContractCache->Flush()) {
+                    strLoadError = _("Error filling the code hashes of the contracts");
+                    break;
+                }
+                if (filledCount > 0)
+                    LogPrint(BCLog::INFO, "filled the code hashes of %u contracts\n", filledCount);
+
+                int32_t nAsyncFlush = SysCfg().GetArg("-asyncflush", DEFAULT_ASYNC_FLUSH);
+                if (nAsyncFlush > 0)
+                    pCdMan->StartAsyncFlusher(nAsyncFlush);
+
                 mempool.SetMemPoolCache();
 
                 if (!LoadBlockIndex()) {
@@ -766,7 +881,7 @@ bool AppInit(boost::thread_group &threadGroup) {
     if (SysCfg().IsArgCount("-printblock")) {
         string strMatch = SysCfg().GetArg("-printblock", "");
         int32_t nFound      = 0;
-        for (map<uint256, CBlockIndex *>::iterator mi = mapBlockIndex.begin(); mi != mapBlockIndex.end(); ++mi) {
+        for (BlockMap::iterator mi = mapBlockIndex.begin(); mi != mapBlockIndex.end(); ++mi) {
             uint256 hash = (*mi).first;
             if (strncmp(hash.ToString().c_str(), strMatch.c_str(), strMatch.size()) == 0) {
                 CBlockIndex *pIndex = (*mi).second;
@@ -838,6 +953,10 @@ bool AppInit(boost::thread_group &threadGroup) {
     }
     threadGroup.create_thread(boost::bind(&ThreadImport, vImportFiles));
 
+    int64_t nWasmWarmUp = SysCfg().GetArg("-wasmwarmup", DEFAULT_WASM_WARM_UP_COUNT);
+    if (nWasmWarmUp > 0)
+        threadGroup.create_thread(boost::bind(&ThreadWasmWarmUp, (uint32_t)nWasmWarmUp));
+
 
     nStart = GetTimeMillis();
     {
@@ -854,6 +973,7 @@ bool AppInit(boost::thread_group &threadGroup) {
 
     RandAddSeedPerfmon();
 
+    StartNetBlockImportPipeline();
     StartNode(threadGroup);
 
     if (SysCfg().IsServer()) {
@@ -17,6 +17,9 @@
 #include "miner/miner.h"
 #include "net.h"
 #include "tx/merkletx.h"
+#include "blockimport.h"
+#include "sigverify.h"
+#include "txexecutor.h"
 #include "commons/util/util.h"
 
 #include "commons/json/json_spirit_utils.h"
@@ -53,7 +56,8 @@ using namespace boost;
 CCacheDBManager *pCdMan = nullptr;
 CCriticalSection cs_main;
 CTxMemPool mempool;
-map<uint256, CBlockIndex *> mapBlockIndex;
+CBlockIndexArena blockIndexArena;
+BlockMap mapBlockIndex;
 int32_t nSyncTipHeight = 0;
 string publicIp;
 map<uint256/* blockhash */, std::shared_ptr<CCacheWrapper>> mapForkCache;
@@ -220,7 +224,6 @@ void UnregisterNodeSignals(CNodeSignals &nodeSignals) {
 }
 
 bool IsStandardTx(CBaseTx *pBaseTx, string &reason) {
-    AssertLockHeld(cs_main);
     if (pBaseTx->nVersion > CBaseTx::CURRENT_VERSION || pBaseTx->nVersion < 1) {
         reason = "version";
         return false;
@@ -250,10 +253,41 @@ bool VerifySignature(const uint256 &sigHash, const std::vector<uint8_t> &signatu
     return true;
 }
 
-bool AcceptToMemoryPool(CTxMemPool &pool, CValidationState &state, CBaseTx *pBaseTx,
-                        bool fLimitFree, bool fRejectInsaneFee) {
-    AssertLockHeld(cs_main);
+bool VerifySignatureBatch(const vector<CSigVerifyItem> &items, vector<bool> *pResults, CWorkerPool *pPool) {
+    vector<CSignatureCache::CEntry> entries;
+    entries.reserve(items.size());
+    for (const auto &item : items) {
+        entries.push_back(signatureCache.ComputeEntry(item.hash, item.signature, item.pubkey));
+    }
+    vector<bool> cached;
+    signatureCache.GetBatch(entries, cached);
+
+    vector<size_t> missIndexes;
+    vector<CSigVerifyItem> missItems;
+    for (size_t i = 0; i < items.size(); i++) {
+        if (!cached[i]) {
+            missIndexes.push_back(i);
+            missItems.push_back(items[i]);
+        }
+    }
 
+    vector<bool> missResults;
+    bool allValid = CPubKey::VerifyBatch(missItems.data(), missItems.size(), &missResults, pPool);
+    for (size_t i = 0; i < missIndexes.size(); i++) {
+        if (missResults[i])
+            signatureCache.Set(entries[missIndexes[i]]);
+    }
+
+    if (pResults) {
+        *pResults = cached;
+        for (size_t i = 0; i < missIndexes.size(); i++)
+            (*pResults)[missIndexes[i]] = missResults[i];
+    }
+    return allValid;
+}
+
+// the checks of a tx to be accepted to mempool which need no chain state
+static bool CheckTxForMemPool(CTxMemPool &pool, CValidationState &state, CBaseTx *pBaseTx) {
     // is it already in the memory pool?
     uint256 hash = pBaseTx->GetHash();
     if (pool.Exists(hash))
@@ -272,6 +306,101 @@ bool AcceptToMemoryPool(CTxMemPool &pool, CValidationState &state, CBaseTx *pBas
         return state.DoS(0, ERRORMSG("AcceptToMemoryPool() : txid: %s is nonstandard transaction due to %s",
                         hash.GetHex(), reason), REJECT_NONSTANDARD, reason);
 
+    return true;
+}
+
+namespace {
+/**
+ * The owner pubkeys of the regids of the recent tx senders, to verify their signatures without cs_main.
+ * The pubkey of a regid only changes by a reorg, and a stale one only makes the signature to be verified again
+ * by CheckTx().
+ */
+class CSignerPubKeyCache {
+public:
+    bool Get(const CRegID &regid, CPubKey &pubKey) {
+        std::lock_guard<std::mutex> lock(mtx);
+        auto it = pubKeys.find(regid);
+        if (it == pubKeys.end())
+            return false;
+        pubKey = it->second;
+        return true;
+    }
+
+    void Set(const CRegID &regid, const CPubKey &pubKey) {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (pubKeys.size() >= MAX_SIZE)
+            pubKeys.clear();
+        pubKeys[regid] = pubKey;
+    }
+
+private:
+    static const size_t MAX_SIZE = 50000;
+
+    std::mutex mtx;
+    map<CRegID, CPubKey> pubKeys;
+};
+
+CSignerPubKeyCache signerPubKeyCache;
+}  // namespace
+
+// get the pubkey signing the tx in common, the account of a regid is read only if cs_main is free
+static bool GetTxSignerPubKey(const CBaseTx &tx, CPubKey &pubKey) {
+    if (tx.txUid.is<CPubKey>()) {
+        pubKey = tx.txUid.get<CPubKey>();
+        return pubKey.IsValid();
+    }
+    if (!tx.txUid.is<CRegID>())
+        return false;
+
+    const CRegID &regid = tx.txUid.get<CRegID>();
+    if (signerPubKeyCache.Get(regid, pubKey))
+        return true;
+
+    TRY_LOCK(cs_main, lockMain);
+    if (!lockMain)
+        return false;
+
+    CAccount account;
+    {
+        LOCK(mempool.cs);
+        if (!mempool.cw || !mempool.cw->accountCache.GetAccount(regid, account) || !account.owner_pubkey.IsValid())
+            return false;
+    }
+    pubKey = account.owner_pubkey;
+    signerPubKeyCache.Set(regid, pubKey);
+    return true;
+}
+
+bool PreAcceptToMemoryPool(CTxMemPool &pool, CValidationState &state, CBaseTx *pBaseTx) {
+    if (!CheckTxForMemPool(pool, state, pBaseTx))
+        return false;
+
+    // the checks of CheckTx() which need no chain state, e.g. the pubkey of the tx uid is fully validated here
+    if (!pBaseTx->CheckTxStateless(state))
+        return ERRORMSG("PreAcceptToMemoryPool() : CheckTxStateless failed, txid: %s", pBaseTx->GetHash().GetHex());
+
+    // the signature is only pre-verified, it is checked by CheckTx() with the signer of the tx type
+    CPubKey pubKey;
+    if (!pBaseTx->signature.empty() && GetTxSignerPubKey(*pBaseTx, pubKey))
+        ::VerifySignature(pBaseTx->GetHash(), pBaseTx->signature, pubKey);
+
+    return true;
+}
+
+bool AcceptToMemoryPool(CTxMemPool &pool, CValidationState &state, CBaseTx *pBaseTx,
+                        bool fLimitFree, bool fRejectInsaneFee, bool fPreAccepted) {
+    AssertLockHeld(cs_main);
+
+    uint256 hash = pBaseTx->GetHash();
+    if (fPreAccepted) {
+        // the tx may have been added since PreAcceptToMemoryPool()
+        if (pool.Exists(hash))
+            return state.Invalid(ERRORMSG("AcceptToMemoryPool() : txid: %s already in mempool", hash.GetHex()),
+                                REJECT_INVALID, "tx-already-in-mempool");
+    } else if (!CheckTxForMemPool(pool, state, pBaseTx)) {
+        return false;
+    }
+
     auto spCW = std::make_shared<CCacheWrapper>(mempool.cw.get());
 
     CBlockIndex *pTip =  chainActive.Tip();
@@ -322,7 +451,7 @@ int32_t CMerkleTx::GetDepthInMainChainINTERNAL(CBlockIndex *&pindexRet) const {
     AssertLockHeld(cs_main);
 
     // Find the block it claims to be in
-    map<uint256, CBlockIndex *>::iterator mi = mapBlockIndex.find(blockHash);
+    BlockMap::iterator mi = mapBlockIndex.find(blockHash);
     if (mi == mapBlockIndex.end())
         return 0;
 
@@ -644,7 +773,7 @@ bool ReconsiderBlock(CValidationState &state, CBlockIndex *pIndex) {
     AssertLockHeld(cs_main);
 
     // Remove the invalidity flag from this block and all its descendants.
-    map<uint256, CBlockIndex *>::const_iterator it = mapBlockIndex.begin();
+    BlockMap::const_iterator it = mapBlockIndex.begin();
     int32_t height                                    = pIndex->height;
     while (it != mapBlockIndex.end()) {
         if (it->second->nStatus & BLOCK_FAILED_MASK && it->second->GetAncestor(height) == pIndex) {
@@ -1009,7 +1138,8 @@ static bool ComputeVoteStakingInterestAndRevokeVotes(const int32_t currHeight, c
     return true;
 }
 
-bool ConnectBlock(CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CValidationState &state, bool fJustCheck) {
+bool ConnectBlock(CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CValidationState &state, bool fJustCheck,
+                  CBlockUndo *pBlockUndoOut) {
     AssertLockHeld(cs_main);
 
     bool isGensisBlock = block.GetHeight() == 0 && block.GetHash() == SysCfg().GetGenesisBlockHash();
@@ -1080,6 +1210,10 @@ bool ConnectBlock(CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CValida
         uint32_t fuelRate     = block.GetFuelRate();
         uint64_t totalRunStep = 0;
 
+        // the results of the txs executed in parallel are committed in order, or the txs are executed again below
+        std::unique_ptr<CParallelTxExecutor> pParallelExecutor =
+            CParallelTxExecutor::Execute(block, pIndex, cw, blockUndo);
+
         for (int32_t index = 1; index < (int32_t)block.vptx.size(); ++index) {
             std::shared_ptr<CBaseTx> &pBaseTx = block.vptx[index];
             if (cw.txCache.HaveTx((pBaseTx->GetHash())))
@@ -1091,11 +1225,7 @@ bool ConnectBlock(CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CValida
                                  pBaseTx->GetHash().GetHex()), REJECT_INVALID, "tx-invalid-height");
 
             pBaseTx->nFuelRate = fuelRate;
-            CTxUndoOpLogger opLogger(cw, pBaseTx->GetHash(), blockUndo);
-
-            uint32_t prevBlockTime = pIndex->pprev != nullptr ? pIndex->pprev->GetBlockTime() : pIndex->GetBlockTime();
-            CTxExecuteContext context(pIndex->height, index, fuelRate, pIndex->nTime, prevBlockTime, &cw, &state);
-            if (!pBaseTx->ExecuteTx(context)) {
+            if (!ExecuteBlockTx(pParallelExecutor.get(), block, pIndex, index, cw, blockUndo, state)) {
                 pCdMan->pLogCache->SetExecuteFail(pIndex->height, pBaseTx->GetHash(), state.GetRejectCode(),
                                                   state.GetRejectReason());
                 return state.DoS(100, ERRORMSG("ConnectBlock() : txid=%s execute failed, in detail: %s",
@@ -1230,11 +1360,14 @@ bool ConnectBlock(CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CValida
     // Write undo information to disk
     if (pIndex->GetUndoPos().IsNull() || (pIndex->nStatus & BLOCK_VALID_MASK) < BLOCK_VALID_SCRIPTS) {
         if (pIndex->GetUndoPos().IsNull()) {
+            CDataStream ssUndo(SER_DISK, CLIENT_VERSION);
+            blockUndo.Encode(ssUndo);
+
             CDiskBlockPos pos;
-            if (!FindUndoPos(state, pIndex->nFile, pos, ::GetSerializeSize(blockUndo, SER_DISK, CLIENT_VERSION) + 40))
+            if (!FindUndoPos(state, pIndex->nFile, pos, ssUndo.size() + 40))
                 return state.Abort(_("ConnectBlock() : failed to find undo data's position"));
 
-            if (!blockUndo.WriteToDisk(pos, pIndex->pprev->GetBlockHash()))
+            if (!CBlockUndo::WriteToDisk(ssUndo, pos, pIndex->pprev->GetBlockHash()))
                 return state.Abort(_("ConnectBlock() : failed to write undo data"));
 
             // Update nUndoPos in block index
@@ -1294,6 +1427,9 @@ bool ConnectBlock(CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CValida
     // Set best block to current account cache.
     cw.blockCache.SetBestBlock(pIndex->GetBlockHash());
 
+    if (pBlockUndoOut != nullptr)
+        *pBlockUndoOut = std::move(blockUndo);
+
     return true;
 }
 
@@ -1325,7 +1461,8 @@ bool static WriteChainState(CValidationState &state) {
 
         FlushBlockFile();
         // pCdMan->pBlockCache->Sync();
-        pCdMan->Flush();
+        if (!pCdMan->FlushAsync())
+            return state.Abort(_("Failed to write to chain state database"));
         mapForkCache.clear();
         nLastWrite = GetTimeMicros();
     }
@@ -1428,11 +1565,12 @@ bool static ConnectTip(CValidationState &state, CBlockIndex *pIndexNew) {
 
     // Apply the block automatically to the chain state.
     int64_t nStart = GetTimeMicros();
+    CBlockUndo blockUndo;
     {
         CInv inv(MSG_BLOCK, pIndexNew->GetBlockHash());
 
         auto spCW = std::make_shared<CCacheWrapper>(pCdMan);
-        if (!ConnectBlock(block, *spCW, pIndexNew, state)) {
+        if (!ConnectBlock(block, *spCW, pIndexNew, state, false, &blockUndo)) {
             if (state.IsInvalid()) {
                 InvalidBlockFound(pIndexNew, state);
             }
@@ -1459,8 +1597,9 @@ bool static ConnectTip(CValidationState &state, CBlockIndex *pIndexNew) {
     UpdateTip(pIndexNew, block);
 
     for (auto &pTxItem : block.vptx) {
-        mempool.memPoolTxs.erase(pTxItem->GetHash());
+        mempool.RemoveConfirmed(pTxItem->GetHash());
     }
+    mempool.AddConnectedBlock(pIndexNew, blockUndo);
     return true;
 }
 
@@ -1634,17 +1773,16 @@ bool AddToBlockIndex(CBlock &block, CValidationState &state, const CDiskBlockPos
         return state.Invalid(ERRORMSG("AddToBlockIndex() : %s already exists", hash.ToString()), 0, "duplicate");
 
     // Construct new block index object
-    CBlockIndex *pIndexNew = new CBlockIndex(block);
+    CBlockIndex *pIndexNew = blockIndexArena.New(block);
 
-    assert(pIndexNew);
     {
         LOCK(cs_nBlockSequenceId);
         pIndexNew->nSequenceId = nBlockSequenceId++;
     }
-    map<uint256, CBlockIndex *>::iterator mi = mapBlockIndex.insert(make_pair(hash, pIndexNew)).first;
+    BlockMap::iterator mi = mapBlockIndex.insert(make_pair(hash, pIndexNew)).first;
     // LogPrint(BCLog::INFO, "in map hash:%s map size:%d\n", hash.GetHex(), mapBlockIndex.size());
-    pIndexNew->pBlockHash                        = &((*mi).first);
-    map<uint256, CBlockIndex *>::iterator miPrev = mapBlockIndex.find(block.GetPrevBlockHash());
+    pIndexNew->pBlockHash = &((*mi).first);
+    BlockMap::iterator miPrev = mapBlockIndex.find(block.GetPrevBlockHash());
     if (miPrev != mapBlockIndex.end()) {
         pIndexNew->pprev  = (*miPrev).second;
         pIndexNew->height = pIndexNew->pprev->height + 1;
@@ -1915,13 +2053,27 @@ bool CheckBlock(const CBlock &block, CValidationState &state, CCacheWrapper &cw,
     // but catching it earlier avoids a potential DoS attack:
     set<uint256> uniqueTx;
     uint32_t priceMedianTxCount = 0;
+
+    // Verify the tx signatures in the workers, before the txs are checked in order
+    std::unique_ptr<CBlockSigPreVerifier> pSigVerifier;
+    if (fCheckTx)
+        pSigVerifier = CBlockSigPreVerifier::Verify(block.vptx, cw.accountCache);
+
     for (uint32_t i = 0; i < block.vptx.size(); i++) {
         uniqueTx.insert(block.GetTxid(i));
 
         uint32_t prevBlockTime = block.GetTime(); // the prev block maybe unkown when checking block
         CTxExecuteContext context(block.GetHeight(), i + 1, block.GetFuelRate(), block.GetTime(), prevBlockTime, &cw, &state);
-        if (fCheckTx && !block.vptx[i]->CheckTx(context))
-            return ERRORMSG("CheckBlock() : CheckTx failed, txid: %s", block.vptx[i]->GetHash().GetHex());
+        if (fCheckTx) {
+            // a valid signature has been added to signatureCache. An invalid one is rejected by CheckTx() below,
+            // unless the tx is signed by another key
+            if (pSigVerifier && !pSigVerifier->IsValid(i)) {
+                LogPrint(BCLog::INFO, "CheckBlock() : invalid signature of tx %s found ahead, height=%u\n",
+                         block.vptx[i]->GetHash().GetHex(), block.GetHeight());
+            }
+            if (!block.vptx[i]->CheckTx(context))
+                return ERRORMSG("CheckBlock() : CheckTx failed, txid: %s", block.vptx[i]->GetHash().GetHex());
+        }
 
         if (block.GetHeight() != 0 || block.GetHash() != SysCfg().GetGenesisBlockHash()) {
             if (0 != i && block.vptx[i]->IsBlockRewardTx())
@@ -1980,7 +2132,7 @@ bool AcceptBlock(CBlock &block, CValidationState &state, CDiskBlockPos *dbp, boo
     CBlockIndex *pPrevBlockIndex = nullptr;
     int32_t height = 0;
     if (block.GetHeight() != 0 || blockHash != SysCfg().GetGenesisBlockHash()) {
-        map<uint256, CBlockIndex *>::iterator mi = mapBlockIndex.find(block.GetPrevBlockHash());
+        BlockMap::iterator mi = mapBlockIndex.find(block.GetPrevBlockHash());
         if (mi == mapBlockIndex.end())
             return state.DoS(10, ERRORMSG("AcceptBlock() : prev block not found"), 0, "bad-prevblk");
 
@@ -2185,7 +2337,7 @@ void PushGetBlocksOnCondition(CNode *pNode, CBlockIndex *pIndexBegin, uint256 ha
     }
 }
 
-bool ProcessBlock(CValidationState &state, CNode *pFrom, CBlock *pBlock, CDiskBlockPos *dbp) {
+bool ProcessBlock(CValidationState &state, CNode *pFrom, CBlock *pBlock, CDiskBlockPos *dbp, bool fChecked) {
     int64_t llBeginTime = GetTimeMillis();
     // LogPrint(BCLog::INFO, "ProcessBlock() enter:%lld\n", llBeginTime);
     AssertLockHeld(cs_main);
@@ -2206,10 +2358,14 @@ bool ProcessBlock(CValidationState &state, CNode *pFrom, CBlock *pBlock, CDiskBl
     auto spCW = std::make_shared<CCacheWrapper>(pCdMan);
 
     // Preliminary checks
-    if (!CheckBlock(*pBlock, state, *spCW, false)) {
+    if (!fChecked && !CheckBlock(*pBlock, state, *spCW, false)) {
         LogPrint(BCLog::INFO, "CheckBlock() height: %d elapse time:%lld ms\n", chainActive.Height(),
                  GetTimeMillis() - llBeginCheckBlockTime);
 
+        int32_t nDoS = 0;
+        if (pFrom && state.IsInvalid(nDoS) && nDoS > 0)
+            Misbehaving(pFrom->GetId(), nDoS);
+
         return ERRORMSG("ProcessBlock() : block hash:%s CheckBlock FAILED", pBlock->GetHash().GetHex());
     }
 
@@ -2315,6 +2471,7 @@ bool static LoadBlockIndexDB() {
     boost::this_thread::interruption_point();
 
     // Calculate nChainWork
+    int64_t nStart = GetTimeMillis();
     vector<pair<int32_t, CBlockIndex *> > vSortedByHeight;
     vSortedByHeight.reserve(mapBlockIndex.size());
     for (const auto &item : mapBlockIndex) {
@@ -2334,6 +2491,8 @@ bool static LoadBlockIndexDB() {
         if (pIndex->pprev)
             pIndex->BuildSkip();
     }
+    LogPrint(BCLog::INFO, "LoadBlockIndexDB(): calculated chain work of %u block indexes (%dms)\n",
+             vSortedByHeight.size(), GetTimeMillis() - nStart);
 
     // Load block file info
     pCdMan->pBlockCache->ReadLastBlockFile(nLastBlockFile);
@@ -2517,7 +2676,7 @@ void PrintBlockTree() {
     AssertLockHeld(cs_main);
     // pre-compute tree structure
     map<CBlockIndex *, vector<CBlockIndex *> > mapNext;
-    for (map<uint256, CBlockIndex *>::iterator mi = mapBlockIndex.begin(); mi != mapBlockIndex.end(); ++mi) {
+    for (BlockMap::iterator mi = mapBlockIndex.begin(); mi != mapBlockIndex.end(); ++mi) {
         CBlockIndex *pIndex = (*mi).second;
         mapNext[pIndex->pprev].push_back(pIndex);
     }
@@ -2585,6 +2744,12 @@ bool LoadExternalBlockFile(FILE *fileIn, CDiskBlockPos *dbp) {
                 blkdat.Seek(info.nSize);
             }
         }
+        // decode and check the blocks ahead of the one being connected
+        std::unique_ptr<CBlockImportPipeline> pPipeline;
+        int64_t nQueueSize = SysCfg().GetArg("-importqueue", DEFAULT_BLOCK_IMPORT_QUEUE);
+        if (nQueueSize > 0)
+            pPipeline.reset(new CBlockImportPipeline(nQueueSize));
+
         uint64_t nRewind = blkdat.GetPos();
         while (blkdat.good() && !blkdat.eof()) {
             boost::this_thread::interruption_point();
@@ -2613,6 +2778,23 @@ bool LoadExternalBlockFile(FILE *fileIn, CDiskBlockPos *dbp) {
                 // read block
                 uint64_t nBlockPos = blkdat.GetPos();
                 blkdat.SetLimit(nBlockPos + nSize);
+                if (pPipeline) {
+                    if (pPipeline->HasError())
+                        break;
+
+                    std::vector<char> vchBlock(nSize);
+                    blkdat.read(vchBlock.data(), nSize);
+                    if (nBlockPos >= nStartByte) {
+                        if (dbp)
+                            dbp->nPos = nBlockPos;
+                        // a block failed to be decoded is rescanned from the byte after its header
+                        if (!pPipeline->SubmitRaw(vchBlock, dbp))
+                            continue;
+                    }
+                    nRewind = blkdat.GetPos();
+                    continue;
+                }
+
                 CBlock block;
                 blkdat >> block;
                 nRewind = blkdat.GetPos();
@@ -2632,6 +2814,10 @@ bool LoadExternalBlockFile(FILE *fileIn, CDiskBlockPos *dbp) {
                 LogPrint(BCLog::INFO, "%s : Deserialize or I/O error - %s\n", __func__, e.what());
             }
         }
+        if (pPipeline) {
+            pPipeline->Flush();
+            nLoaded += pPipeline->GetConnectedCount();
+        }
         fclose(fileIn);
     } catch (runtime_error &e) {
         AbortNode(_("Error: system error: ") + e.what());
@@ -2696,10 +2882,7 @@ class CMainCleanup {
    public:
     CMainCleanup() {}
     ~CMainCleanup() {
-        // block headers
-        map<uint256, CBlockIndex *>::iterator it1 = mapBlockIndex.begin();
-        for (; it1 != mapBlockIndex.end(); it1++)
-            delete (*it1).second;
+        // block headers, owned by blockIndexArena
         mapBlockIndex.clear();
 
         // orphan blocks
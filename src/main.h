@@ -45,7 +45,8 @@ extern CChain chainActive;
 extern CSignatureCache signatureCache;
 
 extern CTxMemPool mempool;
-extern map<uint256, CBlockIndex *> mapBlockIndex;
+extern BlockMap mapBlockIndex;
+extern CBlockIndexArena blockIndexArena;
 extern uint64_t nLastBlockTx;
 extern uint64_t nLastBlockSize;
 extern const string strMessageMagic;
@@ -114,10 +115,24 @@ bool GetNodeStateStats(NodeId nodeid, CNodeStateStats &stats);
 void Misbehaving(NodeId nodeid, int32_t howmuch);
 
 bool VerifySignature(const uint256 &sigHash, const std::vector<uint8_t> &signature, const CPubKey &pubKey);
-
-/** (try to) add transaction to memory pool **/
+/**
+ * Verify the signatures of items by CPubKey::VerifyBatch(), the ones in signatureCache are not verified again,
+ * and the valid ones are added to it. Return true if all of them are valid, the result of every item is set in
+ * pResults if it is not nullptr.
+ */
+bool VerifySignatureBatch(const vector<CSigVerifyItem> &items, vector<bool> *pResults = nullptr,
+                          CWorkerPool *pPool = nullptr);
+
+/**
+ * The pre-admission stage of a tx to be added to memory pool, without cs_main: the checks which need no chain
+ * state, and the signature of the tx sender is verified and added to signatureCache, so that the signature check
+ * of AcceptToMemoryPool() under cs_main is a cache hit. Many threads may run it at the same time.
+ */
+bool PreAcceptToMemoryPool(CTxMemPool &pool, CValidationState &state, CBaseTx *pBaseTx);
+
+/** (try to) add transaction to memory pool, fPreAccepted if PreAcceptToMemoryPool() has passed **/
 bool AcceptToMemoryPool(CTxMemPool &pool, CValidationState &state, CBaseTx *pBaseTx,
-                        bool fLimitFree, bool fRejectInsaneFee = false);
+                        bool fLimitFree, bool fRejectInsaneFee = false, bool fPreAccepted = false);
 
 struct CNodeStateStats {
     int32_t nMisbehavior;
@@ -217,7 +232,8 @@ protected:
  *  of problems. Note that in any case, coins may be modified. */
 bool DisconnectBlock(CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CValidationState &state, bool *pfClean = nullptr);
 // Apply the effects of this block (with given index) on the UTXO set represented by coins
-bool ConnectBlock   (CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CValidationState &state, bool fJustCheck = false);
+bool ConnectBlock   (CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CValidationState &state, bool fJustCheck = false,
+                     CBlockUndo *pBlockUndoOut = nullptr);
 
 // Add this block to the block index, and if necessary, switch the active block chain to this
 bool AddToBlockIndex(CBlock &block, CValidationState &state, const CDiskBlockPos &pos);
@@ -250,8 +266,9 @@ void UnloadBlockIndex();
 void PushGetBlocks(CNode *pNode, CBlockIndex *pindexBegin, uint256 hashEnd);
 /** Push getblocks request with different filtering strategies */
 void PushGetBlocksOnCondition(CNode *pNode, CBlockIndex *pindexBegin, uint256 hashEnd);
-/** Process an incoming block */
-bool ProcessBlock(CValidationState &state, CNode *pFrom, CBlock *pBlock, CDiskBlockPos *dbp = nullptr);
+/** Process an incoming block, fChecked if it has passed CheckBlock() without tx checks, e.g. in the import pipeline */
+bool ProcessBlock(CValidationState &state, CNode *pFrom, CBlock *pBlock, CDiskBlockPos *dbp = nullptr,
+                  bool fChecked = false);
 /** Print the loaded block tree */
 void PrintBlockTree();
 
@@ -82,28 +82,44 @@ uint32_t GetElementForBurn(CBlockIndex *pIndex) {
     return newFuelRate;
 }
 
-// Sort transactions by priority and fee to decide priority orders to process transactions.
-void GetPriorityTx(int32_t height, set<TxPriority> &txPriorities, const int32_t nFuelRate) {
-    static TokenSymbol feeSymbol;
-    static uint64_t fee    = 0;
-    static uint32_t txSize = 0;
-    static double feePerKb = 0;
-    static double priority = 0;
-
-    for (map<uint256, CTxMemPoolEntry>::iterator mi = mempool.memPoolTxs.begin(); mi != mempool.memPoolTxs.end(); ++mi) {
-        CBaseTx *pBaseTx = mi->second.GetTransaction().get();
-        if (!pBaseTx->IsBlockRewardTx() && !pCdMan->pTxCache->HaveTx(pBaseTx->GetHash())) {
-            feeSymbol = std::get<0>(mi->second.GetFees());
-            fee       = std::get<1>(mi->second.GetFees());
-            txSize    = mi->second.GetTxSize();
-            feePerKb  = double(fee - pBaseTx->GetFuel(height, nFuelRate)) / txSize * 1000.0;
-            priority  = mi->second.GetPriority();
-
-            txPriorities.emplace(TxPriority(priority, feePerKb, mi->second.GetTransaction()));
+/**
+ * Walk the mempool txs from the best one by the priority index of the mempool, with the extra txs of the block,
+ * e.g. the price median tx, merged in by priority. The txs confirmed already are skipped. mempool.cs must be held.
+ */
+class CPriorityTxWalker {
+public:
+    CPriorityTxWalker(uint32_t fuelRate) : index(mempool.GetPriorityIndex(fuelRate)), it(index.rbegin()) {}
+
+    // add the extra txs before walking
+    void AddExtraTx(const TxPriority &txPriority) {
+        extraTxs.insert(txPriority);
+        extraIt = extraTxs.rbegin();
+    }
+
+    size_t GetTxCount() const { return index.size() + extraTxs.size(); }
+
+    // return nullptr at the end
+    const TxPriority *Next() {
+        while (true) {
+            bool hasIndexTx = it != index.rend();
+            bool hasExtraTx = extraIt != extraTxs.rend();
+            if (hasExtraTx && (!hasIndexTx || *it < *extraIt))
+                return &*extraIt++;
+            if (!hasIndexTx)
+                return nullptr;
+
+            const TxPriority &txPriority = *it++;
+            if (!pCdMan->pTxCache->HaveTx(txPriority.baseTx->GetHash()))
+                return &txPriority;
         }
     }
-}
 
+private:
+    const CTxMemPool::PriorityIndex &index;
+    CTxMemPool::PriorityIndex::const_reverse_iterator it;
+    std::set<TxPriority> extraTxs;
+    std::set<TxPriority>::const_reverse_iterator extraIt = extraTxs.rbegin();
+};
 
 bool GetCurrentDelegate(const int64_t currentTime, const int32_t currHeight, const VoteDelegateVector &delegates,
                                VoteDelegate &delegate) {
@@ -313,16 +329,15 @@ static bool CreateNewBlockPreStableCoinRelease(CCacheWrapper &cwIn, std::unique_
         uint64_t totalFuel      = 0;
         uint64_t reward         = 0;
 
-        // Calculate && sort transactions from memory pool.
-        set<TxPriority> txPriorities;
-        GetPriorityTx(height, txPriorities, fuelRate);
+        // Walk the transactions of memory pool by priority.
+        CPriorityTxWalker txWalker(fuelRate);
 
         LogPrint(BCLog::MINER, "CreateNewBlockPreStableCoinRelease() : got %lu transaction(s) sorted by priority rules\n",
-                 txPriorities.size());
+                 txWalker.GetTxCount());
 
         // Collect transactions into the block.
-        for (auto itor = txPriorities.rbegin(); itor != txPriorities.rend(); ++itor) {
-            CBaseTx *pBaseTx = itor->baseTx.get();
+        for (const TxPriority *pTxPriority = txWalker.Next(); pTxPriority != nullptr; pTxPriority = txWalker.Next()) {
+            CBaseTx *pBaseTx = pTxPriority->baseTx.get();
 
             uint32_t txSize = pBaseTx->GetSerializeSize(SER_NETWORK, PROTOCOL_VERSION);
             if (totalBlockSize + txSize >= nBlockMaxSize) {
@@ -331,13 +346,21 @@ static bool CreateNewBlockPreStableCoinRelease(CCacheWrapper &cwIn, std::unique_
                 continue;
             }
 
-            auto spCW = std::make_shared<CCacheWrapper>(&cwIn);
+            // execute the tx on cwIn in place, its writes are rolled back unless it is packed. The price feed txs
+            // write ppCache, which is not covered by the savepoint, so they are executed on a child cache
+            std::shared_ptr<CCacheWrapper> spCW;
+            std::unique_ptr<CCacheSavepoint> pSavepoint;
+            if (pBaseTx->IsPriceFeedTx())
+                spCW = std::make_shared<CCacheWrapper>(&cwIn);
+            else
+                pSavepoint.reset(new CCacheSavepoint(cwIn));
+            CCacheWrapper &cw = spCW ? *spCW : cwIn;
 
             try {
                 CValidationState state;
                 pBaseTx->nFuelRate = fuelRate;
                 uint32_t prevBlockTime = pIndexPrev->GetBlockTime();
-                CTxExecuteContext context(height, index + 1, fuelRate, blockTime, prevBlockTime, spCW.get(), &state, transaction_status_type::mining);
+                CTxExecuteContext context(height, index + 1, fuelRate, blockTime, prevBlockTime, &cw, &state, transaction_status_type::mining);
                 if (!pBaseTx->CheckTx(context) || !pBaseTx->ExecuteTx(context)) {
                     LogPrint(BCLog::MINER, "CreateNewBlockPreStableCoinRelease() : failed to pack transaction, txid: %s\n",
                             pBaseTx->GetHash().GetHex());
@@ -358,7 +381,10 @@ static bool CreateNewBlockPreStableCoinRelease(CCacheWrapper &cwIn, std::unique_
                 continue;
             }
 
-            spCW->Flush();
+            if (pSavepoint)
+                pSavepoint->Commit();
+            else
+                spCW->Flush();
 
             auto fuel        = pBaseTx->GetFuel(height, fuelRate);
             auto fees_symbol = std::get<0>(pBaseTx->GetFees());
@@ -374,7 +400,7 @@ static bool CreateNewBlockPreStableCoinRelease(CCacheWrapper &cwIn, std::unique_
 
             ++index;
 
-            pBlock->vptx.push_back(itor->baseTx);
+            pBlock->vptx.push_back(pTxPriority->baseTx);
 
             LogPrint(BCLog::DEBUG, "miner total fuel fee:%d, tx fuel fee:%d, fuel:%d, fuelRate:%d, txid:%s\n", totalFuel,
                      pBaseTx->GetFuel(height, fuelRate), pBaseTx->nRunStep, fuelRate, pBaseTx->GetHash().GetHex());
@@ -445,18 +471,17 @@ static bool CreateNewBlockStableCoinRelease(int64_t startMiningMs, CCacheWrapper
         uint64_t totalFuel                 = 0;
         map<TokenSymbol, uint64_t> rewards = {{SYMB::WICC, 0}, {SYMB::WUSD, 0}};
 
-        // Calculate && sort transactions from memory pool.
-        set<TxPriority> txPriorities;
-        GetPriorityTx(height, txPriorities, fuelRate);
+        // Walk the transactions of memory pool by priority.
+        CPriorityTxWalker txWalker(fuelRate);
 
         // Push block price median transaction into queue.
-        txPriorities.emplace(TxPriority(PRICE_MEDIAN_TRANSACTION_PRIORITY, 0, std::make_shared<CBlockPriceMedianTx>(height)));
+        txWalker.AddExtraTx(TxPriority(PRICE_MEDIAN_TRANSACTION_PRIORITY, 0, std::make_shared<CBlockPriceMedianTx>(height)));
 
         LogPrint(BCLog::MINER, "CreateNewBlockStableCoinRelease() : got %lu transaction(s) sorted by priority rules\n",
-                 txPriorities.size());
+                 txWalker.GetTxCount());
 
         // Collect transactions into the block.
-        for (auto itor = txPriorities.rbegin(); itor != txPriorities.rend(); ++itor) {
+        for (const TxPriority *pTxPriority = txWalker.Next(); pTxPriority != nullptr; pTxPriority = txWalker.Next()) {
 
             if (!CheckPackBlockTime(startMiningMs, height)) {
                 LogPrint(BCLog::MINER, "%s() : no time left to pack more tx, ignore! height=%d, start_ms=%lld, tx_count=%u\n",
@@ -464,7 +489,7 @@ static bool CreateNewBlockStableCoinRelease(int64_t startMiningMs, CCacheWrapper
                 break;
             }
 
-            CBaseTx *pBaseTx = itor->baseTx.get();
+            CBaseTx *pBaseTx = pTxPriority->baseTx.get();
 
             uint32_t txSize = pBaseTx->GetSerializeSize(SER_NETWORK, PROTOCOL_VERSION);
             if (totalBlockSize + txSize >= nBlockMaxSize) {
@@ -473,7 +498,15 @@ static bool CreateNewBlockStableCoinRelease(int64_t startMiningMs, CCacheWrapper
                 continue;
             }
 
-            auto spCW = std::make_shared<CCacheWrapper>(&cwIn);
+            // execute the tx on cwIn in place, its writes are rolled back unless it is packed. The price feed txs
+            // write ppCache, which is not covered by the savepoint, so they are executed on a child cache
+            std::shared_ptr<CCacheWrapper> spCW;
+            std::unique_ptr<CCacheSavepoint> pSavepoint;
+            if (pBaseTx->IsPriceFeedTx())
+                spCW = std::make_shared<CCacheWrapper>(&cwIn);
+            else
+                pSavepoint.reset(new CCacheSavepoint(cwIn));
+            CCacheWrapper &cw = spCW ? *spCW : cwIn;
 
             try {
                 CValidationState state;
@@ -482,23 +515,23 @@ static bool CreateNewBlockStableCoinRelease(int64_t startMiningMs, CCacheWrapper
 
                 // Special case for price median tx,
                 if (pBaseTx->IsPriceMedianTx()) {
-                    CBlockPriceMedianTx *pPriceMedianTx = (CBlockPriceMedianTx *)itor->baseTx.get();
+                    CBlockPriceMedianTx *pPriceMedianTx = (CBlockPriceMedianTx *)pTxPriority->baseTx.get();
 
                     PriceMap medianPrices;
-                    if (!spCW->ppCache.CalcBlockMedianPrices(*spCW, height, medianPrices))
+                    if (!cw.ppCache.CalcBlockMedianPrices(cw, height, medianPrices))
                         return ERRORMSG("%s(), calculate block median prices error", __func__);
 
                     pPriceMedianTx->SetMedianPrices(medianPrices);
                 }
 
                 LogPrint(BCLog::MINER, "CreateNewBlockStableCoinRelease() : begin to pack transaction: %s\n",
-                         pBaseTx->ToString(spCW->accountCache));
+                         pBaseTx->ToString(cw.accountCache));
 
                 uint32_t prevBlockTime = pIndexPrev->GetBlockTime();
-                CTxExecuteContext context(height, index + 1, fuelRate, blockTime, prevBlockTime, spCW.get(), &state, transaction_status_type::mining);
+                CTxExecuteContext context(height, index + 1, fuelRate, blockTime, prevBlockTime, &cw, &state, transaction_status_type::mining);
                 if (!pBaseTx->CheckTx(context) || !pBaseTx->ExecuteTx(context)) {
                     LogPrint(BCLog::MINER, "CreateNewBlockStableCoinRelease() : failed to pack transaction: %s\n",
-                             pBaseTx->ToString(spCW->accountCache));
+                             pBaseTx->ToString(cw.accountCache));
 
                     pCdMan->pLogCache->SetExecuteFail(height, pBaseTx->GetHash(), state.GetRejectCode(),
                                                       state.GetRejectReason());
@@ -517,7 +550,10 @@ static bool CreateNewBlockStableCoinRelease(int64_t startMiningMs, CCacheWrapper
                 continue;
             }
 
-            spCW->Flush();
+            if (pSavepoint)
+                pSavepoint->Commit();
+            else
+                spCW->Flush();
 
             auto fuel        = pBaseTx->GetFuel(height, fuelRate);
             auto fees_symbol = std::get<0>(pBaseTx->GetFees());
@@ -533,7 +569,7 @@ static bool CreateNewBlockStableCoinRelease(int64_t startMiningMs, CCacheWrapper
 
             ++index;
 
-            pBlock->vptx.push_back(itor->baseTx);
+            pBlock->vptx.push_back(pTxPriority->baseTx);
 
             LogPrint(BCLog::DEBUG, "miner total fuel fee:%d, tx fuel fee:%d, fuel:%d, fuelRate:%d, txid:%s\n", totalFuel,
                      pBaseTx->GetFuel(height, fuelRate), pBaseTx->nRunStep, fuelRate, pBaseTx->GetHash().GetHex());
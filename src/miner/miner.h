@@ -16,6 +16,7 @@
 #include "entities/key.h"
 #include "commons/uint256.h"
 #include "tx/tx.h"
+#include "tx/txmempool.h"
 
 class CBlock;
 class CBlockIndex;
@@ -39,27 +40,6 @@ struct Miner {
     CKey key;
 };
 
-struct TxPriority {
-    double priority;
-    double feePerKb;
-    std::shared_ptr<CBaseTx> baseTx;
-
-    TxPriority(const double priorityIn, const double feePerKbIn, const std::shared_ptr<CBaseTx> &baseTxIn)
-        : priority(priorityIn), feePerKb(feePerKbIn), baseTx(baseTxIn) {}
-
-    bool operator<(const TxPriority &other) const {
-        if (fabs(this->priority - other.priority) <= 1000) {
-            if (fabs(this->feePerKb < other.feePerKb) <= 1e-8) {
-                return this->baseTx->GetHash() < other.baseTx->GetHash();
-            } else {
-                return this->feePerKb < other.feePerKb;
-            }
-        } else {
-            return this->priority < other.priority;
-        }
-    }
-};
-
 // mined block info
 class MinedBlockInfo {
 public:
@@ -93,8 +73,6 @@ bool CheckWork(CBlock *pBlock);
 /** Get burn element */
 uint32_t GetElementForBurn(CBlockIndex *pIndex);
 
-void GetPriorityTx(vector<TxPriority> &vecPriority, int32_t nFuelRate);
-
 void ShuffleDelegates(const int32_t nCurHeight, const int64_t blockTime,
         VoteDelegateVector &delegates);
 
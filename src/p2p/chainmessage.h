@@ -7,6 +7,7 @@
 #define CHAINMESSAGE_H
 
 #include "alert.h"
+#include "blockimport.h"
 #include "commons/uint256.h"
 #include "commons/util/util.h"
 #include "main.h"
@@ -103,7 +104,7 @@ inline void ProcessGetData(CNode *pFrom) {
 
             if (inv.type == MSG_BLOCK || inv.type == MSG_FILTERED_BLOCK) {
                 bool send                                = false;
-                map<uint256, CBlockIndex *>::iterator mi = mapBlockIndex.find(inv.hash);
+                BlockMap::iterator mi = mapBlockIndex.find(inv.hash);
                 if (mi != mapBlockIndex.end()) {
                     send = true;
                 } else {
@@ -503,9 +504,12 @@ inline bool ProcessTxMessage(CNode *pFrom, string strCommand, CDataStream &vRecv
 
 
 
-    LOCK(cs_main);
+    // the checks without chain state and the signature verification do not hold cs_main
     CValidationState state;
-    if (AcceptToMemoryPool(mempool, state, pBaseTx.get(), true)) {
+    bool fAccepted = PreAcceptToMemoryPool(mempool, state, pBaseTx.get());
+
+    LOCK(cs_main);
+    if (fAccepted && AcceptToMemoryPool(mempool, state, pBaseTx.get(), true, false, true)) {
         RelayTransaction(pBaseTx.get(), inv.hash);
         mapAlreadyAskedFor.erase(inv);
 
@@ -539,7 +543,7 @@ inline bool ProcessGetHeadersMessage(CNode *pFrom, CDataStream &vRecv) {
     CBlockIndex *pIndex = nullptr;
     if (locator.IsNull()) {
         // If locator is null, return the hashStop block
-        map<uint256, CBlockIndex *>::iterator mi = mapBlockIndex.find(hashStop);
+        BlockMap::iterator mi = mapBlockIndex.find(hashStop);
         if (mi == mapBlockIndex.end())
             return true;
 
@@ -723,18 +727,33 @@ inline void ProcessBlockMessage(CNode *pFrom, CDataStream &vRecv) {
         MarkBlockAsReceived(inv.hash, pFrom->GetId());
     }
 
-    LOCK(cs_main);
-    CValidationState state;
+    CBlockImportPipeline *pPipeline = GetNetBlockImportPipeline();
+    {
+        LOCK(cs_main);
+        CValidationState state;
+
+        std::pair<int32_t ,uint256> globalfinblock = std::make_pair(0,uint256());
+        pCdMan->pBlockCache->ReadGlobalFinBlock(globalfinblock);
+        if (  block.GetHeight() < (uint32_t)globalfinblock.first){
+            LogPrint(BCLog::NET,"ProcessBlock() : this inbound block's height(%d) is irrreversible(%d)",
+                                          block.GetHeight(), globalfinblock.first);
+            return;
+        }
 
-    std::pair<int32_t ,uint256> globalfinblock = std::make_pair(0,uint256());
-    pCdMan->pBlockCache->ReadGlobalFinBlock(globalfinblock);
-    if (  block.GetHeight() < (uint32_t)globalfinblock.first){
-        LogPrint(BCLog::NET,"ProcessBlock() : this inbound block's height(%d) is irrreversible(%d)",
-                                      block.GetHeight(), globalfinblock.first);
-    } else {
-        ProcessBlock(state, pFrom, &block);
+        if (pPipeline == nullptr || !IsInitialBlockDownload()) {
+            ProcessBlock(state, pFrom, &block);
+            return;
+        }
     }
 
+    // never wait for the blocks being connected under cs_main in the message handler thread. A block dropped
+    // since the queue is full is not known by AlreadyHave(), so it is requested again by the sync
+    if (!pPipeline->TrySubmit(block, pFrom)) {
+        LogPrint(BCLog::NET, "import queue is full, drop block! height=%d, hash=%s, peer=%s\n", block.GetHeight(),
+                 block.GetHash().ToString(), pFrom->addr.ToString());
+        LOCK(cs_mapNodeState);
+        mapBlockSource.erase(inv.hash);
+    }
 }
 
 inline void ProcessMempoolMessage(CNode *pFrom, CDataStream &vRecv) {
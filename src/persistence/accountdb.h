@@ -103,6 +103,12 @@ public:
         nickId2KeyIdCache.SetDbOpLogMap(pDbOpLogMapIn);
     }
 
+    void SetReadTracker(CDBReadTracker *pReadTrackerIn) {
+        accountCache.SetReadTracker(pReadTrackerIn);
+        regId2KeyIdCache.SetReadTracker(pReadTrackerIn);
+        nickId2KeyIdCache.SetReadTracker(pReadTrackerIn);
+    }
+
     void RegisterUndoFunc(UndoDataFuncMap &undoDataFuncMap) {
         regId2KeyIdCache.RegisterUndoFunc(undoDataFuncMap);
         nickId2KeyIdCache.RegisterUndoFunc(undoDataFuncMap);
@@ -115,8 +121,8 @@ public:
     CCompositeKVCache< dbk::REGID_KEYID,          CRegIDKey,       CKeyID >         regId2KeyIdCache;
     // <prefix$NickID -> KeyID>
     CCompositeKVCache< dbk::NICKID_KEYID,         CVarIntValue<uint64_t>,      std::pair<CVarIntValue<uint32_t>,CKeyID>>   nickId2KeyIdCache;
-    // <prefix$KeyID -> Account>
-    CCompositeKVCache< dbk::KEYID_ACCOUNT,        CKeyID,       CAccount>        accountCache;
+    // <prefix$KeyID -> Account>, point lookups only, kept in a flat hash storage
+    CCompositeKVCache< dbk::KEYID_ACCOUNT,        CKeyID,       CAccount, CFlatHashCacheStorage> accountCache;
 
 };
 
@@ -5,6 +5,7 @@
 
 #include "block.h"
 
+#include "blockfilestore.h"
 #include "entities/account.h"
 #include "tx/blockpricemediantx.h"
 #include "main.h"
@@ -154,10 +155,18 @@ bool WriteBlockToDisk(CBlock &block, CDiskBlockPos &pos) {
     if (!IsInitialBlockDownload())
         FileCommit(fileout);
 
+    // the block will be read soon by ConnectTip()
+    auto pCachedBlock = std::make_shared<CBlock>();
+    CBlockFileStore::CopyBlock(block, *pCachedBlock);
+    GetBlockFileStore().AddBlock(block.GetHash(), pCachedBlock, nSize);
+
     return true;
 }
 
-bool ReadBlockFromDisk(const CDiskBlockPos &pos, CBlock &block) {
+static bool ReadBlockFromDisk(const CDiskBlockPos &pos, CBlock &block, uint32_t &nSizeOut) {
+    if (GetBlockFileStore().ReadMappedBlock(pos, block, nSizeOut))
+        return true;
+
     block.SetNull();
 
     // Open history file to read
@@ -172,26 +181,51 @@ bool ReadBlockFromDisk(const CDiskBlockPos &pos, CBlock &block) {
         return ERRORMSG("%s : Deserialize or I/O error - %s", __func__, e.what());
     }
 
+    nSizeOut = filein.GetSerializeSize(block);
     return true;
 }
 
+bool ReadBlockFromDisk(const CDiskBlockPos &pos, CBlock &block) {
+    uint32_t nSize;
+    return ReadBlockFromDisk(pos, block, nSize);
+}
+
+// read the block from the block cache, or from disk and add it to the cache
+static std::shared_ptr<const CBlock> ReadSharedBlock(const CBlockIndex *pIndex) {
+    std::shared_ptr<const CBlock> pCachedBlock = GetBlockFileStore().GetCachedBlock(pIndex->GetBlockHash());
+    if (pCachedBlock)
+        return pCachedBlock;
+
+    auto pBlock = std::make_shared<CBlock>();
+    uint32_t nSize;
+    if (!ReadBlockFromDisk(pIndex->GetBlockPos(), *pBlock, nSize))
+        return nullptr;
+
+    if (pBlock->GetHash() != pIndex->GetBlockHash()) {
+        LogPrint(BCLog::ERROR, "ReadBlockFromDisk(CBlock&, CBlockIndex*) : GetHash() doesn't match\n");
+        return nullptr;
+    }
+
+    GetBlockFileStore().AddBlock(pIndex->GetBlockHash(), pBlock, nSize);
+    return pBlock;
+}
+
 bool ReadBlockFromDisk(const CBlockIndex *pIndex, CBlock &block) {
-    if (!ReadBlockFromDisk(pIndex->GetBlockPos(), block))
+    std::shared_ptr<const CBlock> pBlock = ReadSharedBlock(pIndex);
+    if (!pBlock)
         return false;
 
-    if (block.GetHash() != pIndex->GetBlockHash())
-        return ERRORMSG("ReadBlockFromDisk(CBlock&, CBlockIndex*) : GetHash() doesn't match");
-
+    CBlockFileStore::CopyBlock(*pBlock, block);
     return true;
 }
 
 bool ReadBaseTxFromDisk(const CTxCord txCord, std::shared_ptr<CBaseTx> &pTx) {
-    auto pBlock = std::make_shared<CBlock>();
     const CBlockIndex* pBlockIndex = chainActive[ txCord.GetHeight() ];
     if (pBlockIndex == nullptr) {
         return ERRORMSG("ReadBaseTxFromDisk error, the height(%d) is exceed current best block height", txCord.GetHeight());
     }
-    if (!ReadBlockFromDisk(pBlockIndex, *pBlock)) {
+    std::shared_ptr<const CBlock> pBlock = ReadSharedBlock(pBlockIndex);
+    if (!pBlock) {
         return ERRORMSG("ReadBaseTxFromDisk error, read the block at height(%d) failed!", txCord.GetHeight());
     }
     if (txCord.GetIndex() >= pBlock->vptx.size()) {
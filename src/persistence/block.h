@@ -21,7 +21,9 @@
 
 
 #include <stdint.h>
+#include <deque>
 #include <memory>
+#include <unordered_map>
 
 class CBlockDBCache;
 class CDiskBlockPos;
@@ -377,6 +379,41 @@ public:
     const CBlockIndex *GetAncestor(int32_t heightIn) const;
 };
 
+typedef std::unordered_map<uint256, CBlockIndex *, CUint256Hasher> BlockMap;
+
+/**
+ * Owner of the block indexes, which are allocated in contiguous chunks rather than one by one.
+ * The block indexes are never freed until the arena is destroyed, so the pointers to them are always valid.
+ */
+class CBlockIndexArena {
+public:
+    static const size_t DEFAULT_CHUNK_SIZE = 4096;
+
+    // make sure the next count block indexes are allocated in the same chunk
+    void Reserve(size_t count) {
+        if (chunks.empty() || chunks.back().capacity() - chunks.back().size() < count)
+            NewChunk(std::max(count, DEFAULT_CHUNK_SIZE));
+    }
+
+    template <typename... Args>
+    CBlockIndex *New(Args &&... args) {
+        if (chunks.empty() || chunks.back().size() == chunks.back().capacity())
+            NewChunk(DEFAULT_CHUNK_SIZE);
+
+        // never grow over the capacity, so the elements are never moved
+        chunks.back().emplace_back(std::forward<Args>(args)...);
+        return &chunks.back().back();
+    }
+
+private:
+    void NewChunk(size_t capacity) {
+        chunks.emplace_back();
+        chunks.back().reserve(capacity);
+    }
+
+    std::deque<std::vector<CBlockIndex>> chunks;
+};
+
 
 /** Used to marshal pointers into hashes for db storage. */
 class CDiskBlockIndex : public CBlockIndex {
@@ -10,6 +10,7 @@
 #include "main.h"
 
 #include <stdint.h>
+#include <thread>
 
 using namespace std;
 
@@ -22,55 +23,122 @@ bool CBlockIndexDB::EraseBlockIndex(const uint256 &blockHash) {
     return Erase(dbk::GenDbKey(dbk::BLOCK_INDEX, blockHash));
 }
 
+// count of the block indexes decoded by one thread in a loading batch
+static const size_t BLOCK_INDEX_LOAD_BATCH_PER_THREAD = 8192;
+
+// decode the block indexes with their hashes in [begin, end) of the batch
+static bool DecodeBlockIndexes(const vector<pair<string, string>> &entries, size_t begin, size_t end,
+                               vector<uint256> &hashes, vector<CDiskBlockIndex> &diskIndexes, string &strError) {
+    for (size_t i = begin; i < end; i++) {
+        try {
+            // the block hash is the key of the block index, no need to rebuild the header and hash it
+            if (!dbk::ParseDbKey(entries[i].first, dbk::BLOCK_INDEX, hashes[i])) {
+                strError = strprintf("invalid block index key: %s", HexStr(entries[i].first));
+                return false;
+            }
+            const string &value = entries[i].second;
+            CBufferReader reader(value.data(), value.data() + value.size(), SER_DISK, CLIENT_VERSION);
+            reader >> diskIndexes[i];
+        } catch (std::exception &e) {
+            strError = strprintf("Deserialize or I/O error - %s", e.what());
+            return false;
+        }
+    }
+    return true;
+}
+
 bool CBlockIndexDB::LoadBlockIndexes() {
-    leveldb::Iterator *pCursor = NewIterator();
     const std::string &prefix = dbk::GetKeyPrefix(dbk::BLOCK_INDEX);
+    const size_t nThreads   = std::max<size_t>(1, std::thread::hardware_concurrency());
+    const size_t nBatchSize = nThreads * BLOCK_INDEX_LOAD_BATCH_PER_THREAD;
+
+    vector<pair<string, string>> entries;
+    vector<uint256> hashes;
+    vector<CDiskBlockIndex> diskIndexes;
+    entries.reserve(nBatchSize);
+    int64_t nReadTime = 0, nDecodeTime = 0, nLinkTime = 0;
+    size_t nCount = 0;
 
+    std::unique_ptr<leveldb::Iterator> pCursor(NewIterator());
     pCursor->Seek(prefix);
 
-    // Load mapBlockIndex
-    while (pCursor->Valid()) {
+    // Load mapBlockIndex by batches: read the raw entries, decode them in parallel, then link them in order
+    while (true) {
         boost::this_thread::interruption_point();
-        try {
+
+        int64_t nStart = GetTimeMillis();
+        entries.clear();
+        for (; pCursor->Valid() && entries.size() < nBatchSize; pCursor->Next()) {
             leveldb::Slice slKey = pCursor->key();
-            if (slKey.starts_with(prefix)) {
-                leveldb::Slice slValue = pCursor->value();
-                CDataStream ssValue(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
-                CDiskBlockIndex diskIndex;
-                ssValue >> diskIndex;
-
-                // Construct block index object
-                CBlockIndex *pIndexNew    = InsertBlockIndex(diskIndex.GetBlockHash());
-                pIndexNew->pprev          = InsertBlockIndex(diskIndex.hashPrev);
-                pIndexNew->height         = diskIndex.height;
-                pIndexNew->nFile          = diskIndex.nFile;
-                pIndexNew->nDataPos       = diskIndex.nDataPos;
-                pIndexNew->nUndoPos       = diskIndex.nUndoPos;
-                pIndexNew->nVersion       = diskIndex.nVersion;
-                pIndexNew->merkleRootHash = diskIndex.merkleRootHash;
-                pIndexNew->hashPos        = diskIndex.hashPos;
-                pIndexNew->nTime          = diskIndex.nTime;
-                pIndexNew->nBits          = diskIndex.nBits;
-                pIndexNew->nNonce         = diskIndex.nNonce;
-                pIndexNew->nStatus        = diskIndex.nStatus;
-                pIndexNew->nTx            = diskIndex.nTx;
-                pIndexNew->nFuel          = diskIndex.nFuel;
-                pIndexNew->nFuelRate      = diskIndex.nFuelRate;
-                pIndexNew->vSignature     = diskIndex.vSignature;
-                pIndexNew->miner          = diskIndex.miner ;
-
-                if (!pIndexNew->CheckIndex())
-                    return ERRORMSG("LoadBlockIndex() : CheckIndex failed: %s", pIndexNew->ToString());
-
-                pCursor->Next();
-            } else {
-                break;  // if shutdown requested or finished loading block index
-            }
-        } catch (std::exception &e) {
-            return ERRORMSG("%s : Deserialize or I/O error - %s", __func__, e.what());
+            if (!slKey.starts_with(prefix))
+                break;  // finished loading block index
+
+            leveldb::Slice slValue = pCursor->value();
+            entries.emplace_back(slKey.ToString(), slValue.ToString());
+        }
+        if (!pCursor->status().ok())
+            return ERRORMSG("%s : I/O error - %s", __func__, pCursor->status().ToString());
+        if (entries.empty())
+            break;
+
+        int64_t nDecodeStart = GetTimeMillis();
+        nReadTime += nDecodeStart - nStart;
+
+        hashes.assign(entries.size(), uint256());
+        diskIndexes.assign(entries.size(), CDiskBlockIndex());
+        size_t nPerThread = (entries.size() + nThreads - 1) / nThreads;
+        vector<string> errors(nThreads);
+        vector<std::thread> threads;
+        for (size_t t = 1; t < nThreads && t * nPerThread < entries.size(); t++) {
+            size_t end = std::min(entries.size(), (t + 1) * nPerThread);
+            threads.emplace_back(DecodeBlockIndexes, std::cref(entries), t * nPerThread, end, std::ref(hashes),
+                                 std::ref(diskIndexes), std::ref(errors[t]));
         }
+        DecodeBlockIndexes(entries, 0, std::min(entries.size(), nPerThread), hashes, diskIndexes, errors[0]);
+        for (auto &thread : threads)
+            thread.join();
+
+        for (const auto &strError : errors) {
+            if (!strError.empty())
+                return ERRORMSG("%s : %s", __func__, strError);
+        }
+
+        int64_t nLinkStart = GetTimeMillis();
+        nDecodeTime += nLinkStart - nDecodeStart;
+
+        // Construct block index objects
+        blockIndexArena.Reserve(entries.size());
+        for (size_t i = 0; i < entries.size(); i++) {
+            CDiskBlockIndex &diskIndex = diskIndexes[i];
+
+            CBlockIndex *pIndexNew    = InsertBlockIndex(hashes[i]);
+            pIndexNew->pprev          = InsertBlockIndex(diskIndex.hashPrev);
+            pIndexNew->height         = diskIndex.height;
+            pIndexNew->nFile          = diskIndex.nFile;
+            pIndexNew->nDataPos       = diskIndex.nDataPos;
+            pIndexNew->nUndoPos       = diskIndex.nUndoPos;
+            pIndexNew->nVersion       = diskIndex.nVersion;
+            pIndexNew->merkleRootHash = diskIndex.merkleRootHash;
+            pIndexNew->hashPos        = diskIndex.hashPos;
+            pIndexNew->nTime          = diskIndex.nTime;
+            pIndexNew->nBits          = diskIndex.nBits;
+            pIndexNew->nNonce         = diskIndex.nNonce;
+            pIndexNew->nStatus        = diskIndex.nStatus;
+            pIndexNew->nTx            = diskIndex.nTx;
+            pIndexNew->nFuel          = diskIndex.nFuel;
+            pIndexNew->nFuelRate      = diskIndex.nFuelRate;
+            pIndexNew->vSignature     = std::move(diskIndex.vSignature);
+            pIndexNew->miner          = diskIndex.miner;
+
+            if (!pIndexNew->CheckIndex())
+                return ERRORMSG("LoadBlockIndex() : CheckIndex failed: %s", pIndexNew->ToString());
+        }
+        nCount += entries.size();
+        nLinkTime += GetTimeMillis() - nLinkStart;
     }
-    delete pCursor;
+
+    LogPrint(BCLog::INFO, "LoadBlockIndexes(): loaded %u block indexes, read %dms, decode %dms (%u threads), link %dms\n",
+             nCount, nReadTime, nDecodeTime, nThreads, nLinkTime);
 
     return true;
 }
@@ -87,14 +155,12 @@ CBlockIndex *InsertBlockIndex(uint256 hash) {
         return nullptr;
 
     // Return existing
-    map<uint256, CBlockIndex *>::iterator mi = mapBlockIndex.find(hash);
+    BlockMap::iterator mi = mapBlockIndex.find(hash);
     if (mi != mapBlockIndex.end())
         return (*mi).second;
 
     // Create new
-    CBlockIndex *pIndexNew = new CBlockIndex();
-    if (!pIndexNew)
-        throw runtime_error("LoadBlockIndex() : new CBlockIndex failed");
+    CBlockIndex *pIndexNew = blockIndexArena.New();
     mi                    = mapBlockIndex.insert(make_pair(hash, pIndexNew)).first;
     pIndexNew->pBlockHash = &((*mi).first);
 
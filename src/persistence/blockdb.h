@@ -91,6 +91,16 @@ public:
         finalityBlockCache.SetDbOpLogMap(pDbOpLogMapIn);
     }
 
+    void SetReadTracker(CDBReadTracker *pReadTrackerIn) {
+        txDiskPosCache.SetReadTracker(pReadTrackerIn);
+        flagCache.SetReadTracker(pReadTrackerIn);
+        bestBlockHashCache.SetReadTracker(pReadTrackerIn);
+        lastBlockFileCache.SetReadTracker(pReadTrackerIn);
+        medianPricesCache.SetReadTracker(pReadTrackerIn);
+        reindexCache.SetReadTracker(pReadTrackerIn);
+        finalityBlockCache.SetReadTracker(pReadTrackerIn);
+    }
+
     void RegisterUndoFunc(UndoDataFuncMap &undoDataFuncMap) {
         txDiskPosCache.RegisterUndoFunc(undoDataFuncMap);
         flagCache.RegisterUndoFunc(undoDataFuncMap);
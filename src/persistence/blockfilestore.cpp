@@ -0,0 +1,191 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockfilestore.h"
+
+#include "block.h"
+#include "logging.h"
+#include "boost/filesystem.hpp"
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// max count of the block files mapped at the same time, each file is no more than MAX_BLOCKFILE_SIZE
+static const uint32_t MAX_MAPPED_BLOCK_FILES = sizeof(void *) > 4 ? 16 : 0;
+// the block header in the block files: message start + block size
+static const uint32_t BLOCK_HEADER_SIZE = MESSAGE_START_SIZE + sizeof(uint32_t);
+
+////////////////////////////////////////////////////////////////////////////////
+// class CBlockFileStore::CMappedFile
+
+class CBlockFileStore::CMappedFile {
+public:
+    const char *pData = nullptr;
+    uint64_t nSize    = 0;
+
+    // map the whole file read only, the pre-allocated tail of the file is mapped too
+    static std::shared_ptr<CMappedFile> Open(int32_t nFile) {
+#ifndef WIN32
+        boost::filesystem::path path = GetDataDir() / "blocks" / strprintf("blk%05u.dat", nFile);
+        int fd = open(path.string().c_str(), O_RDONLY);
+        if (fd < 0)
+            return nullptr;
+
+        std::shared_ptr<CMappedFile> pFile;
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            void *pMap = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+            if (pMap != MAP_FAILED) {
+                pFile        = std::make_shared<CMappedFile>();
+                pFile->pData = (const char *)pMap;
+                pFile->nSize = st.st_size;
+            } else {
+                LogPrint(BCLog::ERROR, "Unable to map file %s, errno=%d\n", path.string(), errno);
+            }
+        }
+        close(fd);  // the map keeps the file open
+        return pFile;
+#else
+        return nullptr;
+#endif
+    }
+
+    ~CMappedFile() {
+#ifndef WIN32
+        if (pData != nullptr)
+            munmap((void *)pData, nSize);
+#endif
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// class CBlockFileStore
+
+CBlockFileStore::CBlockFileStore() : nCacheBudget(DEFAULT_BLOCK_READ_CACHE << 20), nCachedBytes(0) {}
+
+CBlockFileStore::~CBlockFileStore() {}
+
+void CBlockFileStore::SetCacheBudget(uint64_t nBytes) {
+    std::lock_guard<std::mutex> lock(cs_blocks);
+    nCacheBudget = nBytes;
+    EvictBlocks();
+}
+
+std::shared_ptr<const CBlock> CBlockFileStore::GetCachedBlock(const uint256 &blockHash) {
+    std::lock_guard<std::mutex> lock(cs_blocks);
+    auto it = mapBlocks.find(blockHash);
+    if (it == mapBlocks.end())
+        return nullptr;
+
+    lruBlocks.splice(lruBlocks.begin(), lruBlocks, it->second.it);
+    return it->second.it->second;
+}
+
+void CBlockFileStore::AddBlock(const uint256 &blockHash, const std::shared_ptr<const CBlock> &pBlock,
+                               uint32_t nSize) {
+    std::lock_guard<std::mutex> lock(cs_blocks);
+    if (nSize > nCacheBudget || mapBlocks.count(blockHash))
+        return;
+
+    lruBlocks.emplace_front(blockHash, pBlock);
+    mapBlocks[blockHash] = {lruBlocks.begin(), nSize};
+    nCachedBytes += nSize;
+    EvictBlocks();
+}
+
+void CBlockFileStore::EvictBlocks() {
+    while (nCachedBytes > nCacheBudget && !lruBlocks.empty()) {
+        auto it = mapBlocks.find(lruBlocks.back().first);
+        nCachedBytes -= it->second.size;
+        mapBlocks.erase(it);
+        lruBlocks.pop_back();
+    }
+}
+
+std::shared_ptr<CBlockFileStore::CMappedFile> CBlockFileStore::GetMappedFile(int32_t nFile, uint64_t nMinSize) {
+    if (MAX_MAPPED_BLOCK_FILES == 0)
+        return nullptr;
+
+    std::lock_guard<std::mutex> lock(cs_files);
+    auto it = mapFiles.find(nFile);
+    if (it != mapFiles.end()) {
+        lruFiles.remove(nFile);
+        lruFiles.push_front(nFile);
+        if (it->second->nSize >= nMinSize)
+            return it->second;
+
+        // the file has grown since mapped, remap it. The readers of the old map still hold it
+        mapFiles.erase(it);
+    } else {
+        lruFiles.push_front(nFile);
+    }
+
+    std::shared_ptr<CMappedFile> pFile = CMappedFile::Open(nFile);
+    if (!pFile || pFile->nSize < nMinSize) {
+        lruFiles.remove(nFile);
+        return nullptr;
+    }
+
+    mapFiles[nFile] = pFile;
+    while (lruFiles.size() > MAX_MAPPED_BLOCK_FILES) {
+        mapFiles.erase(lruFiles.back());
+        lruFiles.pop_back();
+    }
+    return pFile;
+}
+
+bool CBlockFileStore::ReadMappedBlock(const CDiskBlockPos &pos, CBlock &block, uint32_t &nSizeOut) {
+    if (pos.IsNull() || pos.nPos < BLOCK_HEADER_SIZE)
+        return false;
+
+    std::shared_ptr<CMappedFile> pFile = GetMappedFile(pos.nFile, pos.nPos);
+    if (!pFile)
+        return false;
+
+    const char *pHeader = pFile->pData + pos.nPos - BLOCK_HEADER_SIZE;
+    if (memcmp(pHeader, SysCfg().MessageStart(), MESSAGE_START_SIZE) != 0)
+        return ERRORMSG("ReadMappedBlock : invalid message start of block at %s", pos.ToString());
+
+    uint32_t nSize;
+    memcpy(&nSize, pHeader + MESSAGE_START_SIZE, sizeof(nSize));
+    if (nSize > MAX_BLOCK_SIZE)
+        return ERRORMSG("ReadMappedBlock : invalid size(%u) of block at %s", nSize, pos.ToString());
+
+    if (pos.nPos + (uint64_t)nSize > pFile->nSize) {
+        pFile = GetMappedFile(pos.nFile, pos.nPos + (uint64_t)nSize);
+        if (!pFile)
+            return false;
+    }
+
+    block.SetNull();
+    try {
+        const char *pBegin = pFile->pData + pos.nPos;
+        CBufferReader reader(pBegin, pBegin + nSize, SER_DISK, CLIENT_VERSION);
+        reader >> block;
+    } catch (std::exception &e) {
+        return ERRORMSG("ReadMappedBlock : Deserialize error of block at %s - %s", pos.ToString(), e.what());
+    }
+
+    nSizeOut = nSize;
+    return true;
+}
+
+void CBlockFileStore::CopyBlock(const CBlock &from, CBlock &to) {
+    to.SetNull();
+    static_cast<CBlockHeader &>(to) = from;
+    to.vptx.reserve(from.vptx.size());
+    for (const auto &pTx : from.vptx) {
+        to.vptx.push_back(pTx->GetNewInstance());
+    }
+    to.vMerkleTree = from.vMerkleTree;
+}
+
+CBlockFileStore &GetBlockFileStore() {
+    static CBlockFileStore blockFileStore;
+    return blockFileStore;
+}
@@ -0,0 +1,77 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef PERSIST_BLOCKFILESTORE_H
+#define PERSIST_BLOCKFILESTORE_H
+
+#include "disk.h"
+#include "commons/uint256.h"
+
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+class CBlock;
+
+/**
+ * Block reader of the block files (blk?????.dat). The files are append only, so they are read through
+ * read only memory maps, and the recently read or written blocks are kept decoded in a LRU bounded by
+ * their serialized sizes, keyed by block hash.
+ * ConnectBlock() reads the same blocks again and again (the mature block, the blocks leaving the tx cache
+ * and price windows), which are served by the LRU without any syscall or decoding.
+ */
+class CBlockFileStore {
+public:
+    CBlockFileStore();
+    ~CBlockFileStore();
+
+    // set the max serialized size of the cached blocks, 0 disables the cache
+    void SetCacheBudget(uint64_t nBytes);
+
+    /**
+     * Get the cached block, which is shared with the cache and must not be modified.
+     * NOTE: BuildMerkleTree() modifies the block too, copy it by CopyBlock() if needed.
+     */
+    std::shared_ptr<const CBlock> GetCachedBlock(const uint256 &blockHash);
+    // add the block which has been read from or written to the block files, nSize is its serialized size
+    void AddBlock(const uint256 &blockHash, const std::shared_ptr<const CBlock> &pBlock, uint32_t nSize);
+
+    /**
+     * Decode the block at pos (the position after the block header) from the memory map of the file.
+     * Return false if the file can not be mapped or the header is invalid, the caller should read it by stdio.
+     */
+    bool ReadMappedBlock(const CDiskBlockPos &pos, CBlock &block, uint32_t &nSizeOut);
+
+    // deep copy the block, the txs are copied too because they can be modified on execution
+    static void CopyBlock(const CBlock &from, CBlock &to);
+
+private:
+    class CMappedFile;
+
+    std::shared_ptr<CMappedFile> GetMappedFile(int32_t nFile, uint64_t nMinSize);
+    void EvictBlocks();
+
+private:
+    typedef std::list<std::pair<uint256, std::shared_ptr<const CBlock>>> BlockList;
+    struct CCachedBlock {
+        BlockList::iterator it;
+        uint32_t size;
+    };
+
+    std::mutex cs_blocks;
+    uint64_t nCacheBudget;
+    uint64_t nCachedBytes;
+    BlockList lruBlocks;  // most recently used at front
+    std::unordered_map<uint256, CCachedBlock, CUint256Hasher> mapBlocks;
+
+    std::mutex cs_files;
+    std::list<int32_t> lruFiles;  // most recently used at front
+    std::map<int32_t, std::shared_ptr<CMappedFile>> mapFiles;
+};
+
+CBlockFileStore &GetBlockFileStore();
+
+#endif  // PERSIST_BLOCKFILESTORE_H
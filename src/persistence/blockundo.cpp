@@ -24,14 +24,112 @@ string CTxUndo::ToString() const {
 ////////////////////////////////////////////////////////////////////////////////
 // class CBlockUndo
 
-bool CBlockUndo::WriteToDisk(CDiskBlockPos &pos, const uint256 &blockHash) {
+// the first byte of the compact undo data, the legacy undo data starts with the compact size of vtxundo,
+// which is never 0xff (2^32 txs or more)
+static const uint8_t UNDO_COMPACT_MARKER  = 0xff;
+static const uint8_t UNDO_COMPACT_VERSION = 1;
+
+template<typename Stream>
+static void WriteUndoBytes(Stream &s, const string &bytes) {
+    uint64_t size = bytes.size();
+    s << VARINT(size);
+    s.write(bytes.data(), bytes.size());
+}
+
+static string ReadUndoBytes(CBufferReader &s) {
+    uint64_t size;
+    s >> VARINT(size);
+    if (size > s.size())
+        throw ios_base::failure("ReadUndoBytes() : end of data");
+
+    string bytes(s.data(), size);
+    s.ignore(size);
+    return bytes;
+}
+
+void CBlockUndo::Encode(CDataStream &ssUndo) const {
+    ssUndo << UNDO_COMPACT_MARKER << UNDO_COMPACT_VERSION;
+    uint64_t txCount = vtxundo.size();
+    ssUndo << VARINT(txCount);
+    for (const auto &txUndo : vtxundo) {
+        ssUndo << txUndo.txid;
+        const auto &logMap = txUndo.dbOpLogMap.GetMap();
+        uint64_t prefixCount = logMap.size();
+        ssUndo << VARINT(prefixCount);
+        for (const auto &item : logMap) {
+            // the prefixes are written by the type, an unknown prefix by EMPTY and the string
+            uint32_t prefixType = dbk::ParseKeyPrefixType(item.first);
+            ssUndo << VARINT(prefixType);
+            if (prefixType == dbk::EMPTY)
+                WriteUndoBytes(ssUndo, item.first);
+
+            uint64_t logCount = item.second.size();
+            ssUndo << VARINT(logCount);
+            for (const auto &log : item.second) {
+                WriteUndoBytes(ssUndo, log.GetKey());
+                WriteUndoBytes(ssUndo, log.GetValue());
+            }
+        }
+    }
+}
+
+bool CBlockUndo::Decode(const char *pBegin, const char *pEnd) {
+    vtxundo.clear();
+    CBufferReader reader(pBegin, pEnd, SER_DISK, CLIENT_VERSION);
+    try {
+        if (pBegin == pEnd || (uint8_t)*pBegin != UNDO_COMPACT_MARKER) {
+            reader >> vtxundo;
+            return true;
+        }
+
+        uint8_t marker, version;
+        reader >> marker >> version;
+        if (version != UNDO_COMPACT_VERSION)
+            return ERRORMSG("CBlockUndo::Decode : unknown version %u", version);
+
+        uint64_t txCount;
+        reader >> VARINT(txCount);
+        vtxundo.reserve(std::min<uint64_t>(txCount, reader.size() / sizeof(uint256)));
+        for (uint64_t i = 0; i < txCount; i++) {
+            vtxundo.emplace_back();
+            CTxUndo &txUndo = vtxundo.back();
+            reader >> txUndo.txid;
+
+            auto &logMap = txUndo.dbOpLogMap.GetMap();
+            uint64_t prefixCount;
+            reader >> VARINT(prefixCount);
+            for (uint64_t j = 0; j < prefixCount; j++) {
+                uint32_t prefixType;
+                reader >> VARINT(prefixType);
+                if (prefixType >= dbk::PREFIX_COUNT)
+                    return ERRORMSG("CBlockUndo::Decode : invalid prefix type %u", prefixType);
+
+                CDbOpLogs &logs = prefixType == dbk::EMPTY
+                                      ? logMap[ReadUndoBytes(reader)]
+                                      : logMap[dbk::GetKeyPrefix((dbk::PrefixType)prefixType)];
+                uint64_t logCount;
+                reader >> VARINT(logCount);
+                for (uint64_t k = 0; k < logCount; k++) {
+                    string key   = ReadUndoBytes(reader);
+                    string value = ReadUndoBytes(reader);
+                    logs.emplace_back(std::move(key), std::move(value));
+                }
+            }
+        }
+    } catch (std::exception &e) {
+        return ERRORMSG("CBlockUndo::Decode : deserialize error - %s", e.what());
+    }
+    return true;
+}
+
+bool CBlockUndo::WriteToDisk(const CDataStream &ssUndo, CDiskBlockPos &pos, const uint256 &blockHash) {
     // Open history file to append
     CAutoFile fileout = CAutoFile(OpenUndoFile(pos), SER_DISK, CLIENT_VERSION);
     if (!fileout)
         return ERRORMSG("CBlockUndo::WriteToDisk : OpenUndoFile failed");
 
     // Write index header
-    uint32_t nSize = fileout.GetSerializeSize(*this);
+    uint32_t nSize = ssUndo.size();
     fileout << FLATDATA(SysCfg().MessageStart()) << nSize;
 
     // Write undo data
@@ -39,12 +137,12 @@ bool CBlockUndo::WriteToDisk(CDiskBlockPos &pos, const uint256 &blockHash) {
     if (fileOutPos < 0)
         return ERRORMSG("CBlockUndo::WriteToDisk : ftell failed");
     pos.nPos = (uint32_t)fileOutPos;
-    fileout << *this;
+    fileout.write(&ssUndo[0], nSize);
 
     // calculate & write checksum
     CHashWriter hasher(SER_GETHASH, PROTOCOL_VERSION);
     hasher << blockHash;
-    hasher << *this;
+    hasher.write(&ssUndo[0], nSize);
 
     fileout << hasher.GetHash();
 
@@ -57,28 +155,43 @@ bool CBlockUndo::WriteToDisk(CDiskBlockPos &pos, const uint256 &blockHash) {
 }
 
 bool CBlockUndo::ReadFromDisk(const CDiskBlockPos &pos, const uint256 &blockHash) {
+    // the size of the undo data is in the index header before pos
+    if (pos.nPos < sizeof(uint32_t))
+        return ERRORMSG("CBlockUndo::ReadFromDisk : invalid position %u", pos.nPos);
+    CDiskBlockPos headerPos(pos.nFile, pos.nPos - sizeof(uint32_t));
+
     // Open history file to read
-    CAutoFile filein = CAutoFile(OpenUndoFile(pos, true), SER_DISK, CLIENT_VERSION);
+    CAutoFile filein = CAutoFile(OpenUndoFile(headerPos, true), SER_DISK, CLIENT_VERSION);
     if (!filein)
         return ERRORMSG("CBlockUndo::ReadFromDisk : OpenBlockFile failed");
 
-    // Read block
+    // Read undo data in one read, it is decoded in memory
+    vector<char> undoData;
     uint256 hashChecksum;
     try {
-        filein >> *this;
+        uint32_t nSize;
+        filein >> nSize;
+        if (fseek(filein, 0, SEEK_END) != 0 || ftell(filein) < (long)pos.nPos + nSize + (long)sizeof(uint256) ||
+            fseek(filein, pos.nPos, SEEK_SET) != 0)
+            return ERRORMSG("CBlockUndo::ReadFromDisk : invalid undo data size %u", nSize);
+
+        undoData.resize(nSize);
+        if (nSize > 0)
+            filein.read(&undoData[0], nSize);
         filein >> hashChecksum;
     } catch (std::exception &e) {
         return ERRORMSG("%s : Deserialize or I/O error - %s", __func__, e.what());
     }
 
-    // Verify checksum
+    // Verify checksum, of the data as written in any format
     CHashWriter hasher(SER_GETHASH, PROTOCOL_VERSION);
     hasher << blockHash;
-    hasher << *this;
+    hasher.write(undoData.data(), undoData.size());
 
     if (hashChecksum != hasher.GetHash())
         return ERRORMSG("CBlockUndo::ReadFromDisk : Checksum mismatch");
-    return true;
+
+    return Decode(undoData.data(), undoData.data() + undoData.size());
 }
 
 string CBlockUndo::ToString() const {
@@ -100,18 +213,8 @@ bool CBlockUndoExecutor::Execute() {
     const UndoDataFuncMap &undoDataFuncMap = cw.GetUndoDataFuncMap();
 
     for (auto it = block_undo.vtxundo.rbegin(); it != block_undo.vtxundo.rend(); it++) {
-        for (const auto &opLogPair : it->dbOpLogMap.GetMap()) {
-            dbk::PrefixType prefixType = dbk::ParseKeyPrefixType(opLogPair.first);
-            if (prefixType == dbk::EMPTY)
-                return ERRORMSG("%s(), unkown prefix! prefix_type=%s", __FUNCTION__,
-                                opLogPair.first);
-            auto funcMapIt = undoDataFuncMap.find(prefixType);
-            if (funcMapIt == undoDataFuncMap.end()) {
-                return ERRORMSG("%s(), unfound prefix in db! prefix_type=%s", __FUNCTION__,
-                                opLogPair.first);
-            }
-            funcMapIt->second(opLogPair.second);
-        }
+        if (!UndoDbOpLogMap(undoDataFuncMap, it->dbOpLogMap))
+            return false;
     }
     return true;
 }
\ No newline at end of file
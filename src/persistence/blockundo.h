@@ -40,7 +40,13 @@ public:
     string ToString() const;
 };
 
-/** Undo information for a CBlock */
+/**
+ * Undo information for a CBlock
+ *
+ * The undo data is written to disk in the compact format: a marker byte and the version, then the txs with the
+ * prefix types of the op logs instead of the prefix strings, and the varint lengths of the keys and values.
+ * The legacy format, which is the serialization of vtxundo, is still read from the undo files written before.
+ */
 class CBlockUndo {
 public:
     vector<CTxUndo> vtxundo;
@@ -49,7 +55,13 @@ public:
         READWRITE(vtxundo);
     )
 
-    bool WriteToDisk(CDiskBlockPos &pos, const uint256 &blockHash);
+    // encode the undo data in the compact format to be written to disk
+    void Encode(CDataStream &ssUndo) const;
+    // decode the undo data of the compact or legacy format
+    bool Decode(const char *pBegin, const char *pEnd);
+
+    // write the undo data encoded by Encode(), pos is set to the position of it
+    static bool WriteToDisk(const CDataStream &ssUndo, CDiskBlockPos &pos, const uint256 &blockHash);
 
     bool ReadFromDisk(const CDiskBlockPos &pos, const uint256 &blockHash);
 
@@ -69,8 +81,8 @@ public:
         cw.SetDbOpLogMap(&tx_undo.dbOpLogMap);
     }
     ~CTxUndoOpLogger() {
-        block_undo.vtxundo.push_back(tx_undo);
         cw.SetDbOpLogMap(nullptr);
+        block_undo.vtxundo.push_back(std::move(tx_undo));
     }
 };
 
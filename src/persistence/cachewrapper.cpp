@@ -127,6 +127,21 @@ void CCacheWrapper::SetDbOpLogMap(CDBOpLogMap *pDbOpLogMap) {
     sysGovernCache.SetDbOpLogMap(pDbOpLogMap) ;
 }
 
+void CCacheWrapper::SetReadTracker(CDBReadTracker *pReadTracker) {
+    sysParamCache.SetReadTracker(pReadTracker);
+    blockCache.SetReadTracker(pReadTracker);
+    accountCache.SetReadTracker(pReadTracker);
+    assetCache.SetReadTracker(pReadTracker);
+    contractCache.SetReadTracker(pReadTracker);
+    delegateCache.SetReadTracker(pReadTracker);
+    cdpCache.SetReadTracker(pReadTracker);
+    closedCdpCache.SetReadTracker(pReadTracker);
+    dexCache.SetReadTracker(pReadTracker);
+    txReceiptCache.SetReadTracker(pReadTracker);
+    txUtxoCache.SetReadTracker(pReadTracker);
+    sysGovernCache.SetReadTracker(pReadTracker);
+}
+
 UndoDataFuncMap CCacheWrapper::GetUndoDataFuncMap() {
     UndoDataFuncMap undoDataFuncMap;
     sysParamCache.RegisterUndoFunc(undoDataFuncMap);
@@ -144,6 +159,59 @@ UndoDataFuncMap CCacheWrapper::GetUndoDataFuncMap() {
     return undoDataFuncMap;
 }
 
+void CCacheWrapper::SetSavepoint() {
+    savepointOpLogMaps.emplace_back();
+    SetDbOpLogMap(&savepointOpLogMaps.back());
+}
+
+void CCacheWrapper::ReleaseSavepoint() {
+    assert(!savepointOpLogMaps.empty());
+    CDBOpLogMap opLogMap = std::move(savepointOpLogMaps.back());
+    savepointOpLogMaps.pop_back();
+    if (savepointOpLogMaps.empty()) {
+        SetDbOpLogMap(nullptr);
+        return;
+    }
+
+    // the kept writes are logged by the outer savepoint, after its own ones
+    CDBOpLogMap &outerOpLogMap = savepointOpLogMaps.back();
+    for (auto &opLogPair : opLogMap.GetMap()) {
+        CDbOpLogs &outerOpLogs = outerOpLogMap.GetMap()[opLogPair.first];
+        outerOpLogs.insert(outerOpLogs.end(), opLogPair.second.begin(), opLogPair.second.end());
+    }
+    SetDbOpLogMap(&outerOpLogMap);
+}
+
+bool CCacheWrapper::RollbackToSavepoint() {
+    assert(!savepointOpLogMaps.empty());
+    SetDbOpLogMap(nullptr);
+    bool ret = UndoDbOpLogMap(GetUndoDataFuncMap(), savepointOpLogMaps.back());
+    savepointOpLogMaps.pop_back();
+    SetDbOpLogMap(savepointOpLogMaps.empty() ? nullptr : &savepointOpLogMaps.back());
+    return ret;
+}
+
+CCacheSavepoint::~CCacheSavepoint() {
+    if (!committed && !cw.RollbackToSavepoint())
+        LogPrint(BCLog::ERROR, "CCacheSavepoint : failed to roll back the cache writes\n");
+}
+
+bool UndoDbOpLogMap(const UndoDataFuncMap &undoDataFuncMap, const CDBOpLogMap &dbOpLogMap) {
+    for (const auto &opLogPair : dbOpLogMap.GetMap()) {
+        dbk::PrefixType prefixType = dbk::ParseKeyPrefixType(opLogPair.first);
+        if (prefixType == dbk::EMPTY)
+            return ERRORMSG("%s(), unkown prefix! prefix_type=%s", __FUNCTION__,
+                            opLogPair.first);
+        auto funcMapIt = undoDataFuncMap.find(prefixType);
+        if (funcMapIt == undoDataFuncMap.end()) {
+            return ERRORMSG("%s(), unfound prefix in db! prefix_type=%s", __FUNCTION__,
+                            opLogPair.first);
+        }
+        funcMapIt->second(opLogPair.second);
+    }
+    return true;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // class CCacheDBManager
 
@@ -193,9 +261,23 @@ CCacheDBManager::CCacheDBManager(bool fReIndex, bool fMemory) {
     // memory-only cache
     pTxCache        = new CTxMemCache();
     pPpCache        = new CPricePointMemCache();
+
+    // a flush began but not finished means that only a part of the dbs have been written
+    uint64_t beginSeq = 0;
+    pBlockDb->GetData(dbk::FLUSH_MARKER, flushSeq);
+    pBlockDb->GetData(dbk::FLUSH_BEGIN, beginSeq);
+    if (beginSeq > flushSeq) {
+        fFlushIncomplete = true;
+        LogPrint(BCLog::ERROR, "the flush of seq=%llu was interrupted, the last finished one is seq=%llu\n",
+                 beginSeq, flushSeq);
+        flushSeq = beginSeq;
+    }
 }
 
 CCacheDBManager::~CCacheDBManager() {
+    // wait for the pending snapshots to be written
+    pFlusher = nullptr;
+
     delete pSysParamCache;  pSysParamCache = nullptr;
     delete pAccountCache;   pAccountCache = nullptr;
     delete pAssetCache;     pAssetCache = nullptr;
@@ -230,7 +312,23 @@ CCacheDBManager::~CCacheDBManager() {
     delete pPpCache;        pPpCache = nullptr;
 }
 
-bool CCacheDBManager::Flush() {
+void CCacheDBManager::StartAsyncFlusher(uint32_t maxPending) {
+    assert(!pFlusher && "async flusher has been started");
+    // the chain state can not be written any more, stop the node
+    pFlusher = std::make_unique<CDBFlusher>(pBlockDb, maxPending, [](const string &error) { AbortNode(error); });
+    LogPrint(BCLog::INFO, "started async db flusher, max pending snapshots=%u\n", maxPending);
+}
+
+vector<CDBAccess*> CCacheDBManager::GetDbAccessList() const {
+    // the block db must be the last one to be committed, its best block hash and flush marker
+    // must not be written before the other dbs have been written successfully.
+    return {
+        pSysParamDb, pAccountDb, pAssetDb, pContractDb, pDelegateDb, pCdpDb, pClosedCdpDb,
+        pDexDb, pLogDb, pReceiptDb, pSysGovernDb, pUtxoDb, pBlockDb
+    };
+}
+
+void CCacheDBManager::FlushCaches() {
     if (pSysParamCache) pSysParamCache->Flush();
 
     if (pAccountCache) pAccountCache->Flush();
@@ -264,6 +362,142 @@ bool CCacheDBManager::Flush() {
     //     pTxCache->Flush();
     // if (pPpCache)
     //     pPpCache->Flush();
+}
+
+namespace {
+// Abort the flush batches of dbs not committed or detached on leaving the scope, e.g. a db write has thrown,
+// so that no db is left in the flush batch mode.
+class CFlushBatchGuard {
+public:
+    CFlushBatchGuard(const vector<CDBAccess*> &dbAccessListIn): dbAccessList(dbAccessListIn) {}
+    ~CFlushBatchGuard() {
+        for (auto pDbAccess : dbAccessList) {
+            if (pDbAccess && pDbAccess->IsInFlushBatch())
+                pDbAccess->AbortFlushBatch();
+        }
+    }
+private:
+    const vector<CDBAccess*> &dbAccessList;
+};
+}  // namespace
+
+bool CCacheDBManager::Flush() {
+    int64_t beginTime = GetTimeMicros();
+
+    // the pending snapshots are older than current caches, must be written first
+    if (pFlusher) {
+        pFlusher->WaitForFlushed();
+        if (pFlusher->HasFailed())
+            return ERRORMSG("%s, the async db flusher has failed", __func__);
+    }
+
+    vector<CDBAccess*> dbAccessList = GetDbAccessList();
+
+    // gather all of the dirty prefixes into one batch per db
+    CFlushBatchGuard batchGuard(dbAccessList);
+    for (auto pDbAccess : dbAccessList) {
+        if (pDbAccess) pDbAccess->BeginFlushBatch();
+    }
+
+    FlushCaches();
+
+    bool fHasData = false;
+    for (auto pDbAccess : dbAccessList) {
+        if (pDbAccess && pDbAccess->HasFlushData())
+            fHasData = true;
+    }
+
+    // The begin marker is written before any db, and the commit marker is written in the batch of the block db,
+    // which is the last one to be committed. A crash between them is found by IsFlushIncomplete() on startup.
+    uint64_t seq = flushSeq + 1;
+    if (fHasData && pBlockDb) {
+        pBlockDb->WriteData(dbk::FLUSH_BEGIN, seq, true);
+        pBlockDb->BatchWrite(dbk::FLUSH_MARKER, seq);
+    }
+
+    uint64_t totalBytes = 0;
+    uint32_t dbCount    = 0;
+    for (auto pDbAccess : dbAccessList) {
+        if (!pDbAccess) continue;
+
+        uint64_t flushCount = pDbAccess->GetFlushStats().flush_count;
+        if (!pDbAccess->CommitFlushBatch())
+            return ERRORMSG("%s, commit flush batch of db %s failed", __func__,
+                            ::GetDbName(pDbAccess->GetDbNameType()));
+
+        CDBFlushStats stats = pDbAccess->GetFlushStats();
+        if (stats.flush_count != flushCount) {
+            totalBytes += stats.last_bytes;
+            dbCount++;
+        }
+    }
+    if (fHasData)
+        flushSeq = seq;
+
+    LogPrint(BCLog::LDB, "flushed cache db manager: seq=%llu, dbs=%u, bytes=%llu, time=%.2fms\n", flushSeq,
+             dbCount, totalBytes, (GetTimeMicros() - beginTime) * 0.001);
+
+    return true;
+}
+
+bool CCacheDBManager::FlushAsync() {
+    if (!pFlusher)
+        return Flush();
+
+    if (pFlusher->HasFailed())
+        return ERRORMSG("%s, the async db flusher has failed", __func__);
+
+    int64_t beginTime = GetTimeMicros();
+    vector<CDBAccess*> dbAccessList = GetDbAccessList();
+
+    // The block db is written in place: its top cache is flushed directly after every block anyway,
+    // so it must never have a pending snapshot.
+    CFlushBatchGuard batchGuard(dbAccessList);
+    for (auto pDbAccess : dbAccessList) {
+        if (pDbAccess) pDbAccess->BeginFlushBatch(pDbAccess != pBlockDb);
+    }
+
+    FlushCaches();
+
+    CDBFlushTask task;
+    uint64_t totalBytes = 0;
+    for (auto pDbAccess : dbAccessList) {
+        if (!pDbAccess || pDbAccess == pBlockDb) continue;
+
+        auto pBatch = pDbAccess->DetachFlushBatch();
+        if (pBatch) {
+            totalBytes += pBatch->GetDataSize();
+            task.batches.emplace_back(pDbAccess, pBatch);
+        }
+    }
+
+    // the begin marker is committed with the block db, the flusher writes the commit marker after the task
+    uint32_t dbCount = task.batches.size();
+    if (dbCount > 0) {
+        task.flush_seq = flushSeq + 1;
+        pBlockDb->BatchWrite(dbk::FLUSH_BEGIN, task.flush_seq);
+    }
+
+    try {
+        if (pBlockDb && !pBlockDb->CommitFlushBatch()) {
+            task.DropBatches();
+            return ERRORMSG("%s, commit flush batch of db %s failed", __func__, ::GetDbName(DBNameType::BLOCK));
+        }
+    } catch (std::exception &e) {
+        // the detached batches will never be written
+        task.DropBatches();
+        throw;
+    }
+
+    if (dbCount > 0) {
+        flushSeq = task.flush_seq;
+        // block here if too many snapshots are pending
+        pFlusher->Push(std::move(task));
+    }
+
+    LogPrint(BCLog::LDB, "pushed cache snapshot to async flusher: seq=%llu, dbs=%u, bytes=%llu, pending=%u, "
+             "time=%.2fms\n", flushSeq, dbCount, totalBytes, pFlusher->GetPendingCount(),
+             (GetTimeMicros() - beginTime) * 0.001);
 
     return true;
 }
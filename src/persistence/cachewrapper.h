@@ -12,6 +12,7 @@
 #include "cdpdb.h"
 #include "commons/uint256.h"
 #include "contractdb.h"
+#include "dbflusher.h"
 #include "delegatedb.h"
 #include "dexdb.h"
 #include "pricefeeddb.h"
@@ -22,6 +23,8 @@
 #include "sysgoverndb.h"
 #include "logdb.h"
 
+#include <list>
+
 class CCacheDBManager;
 
 class CCacheWrapper {
@@ -58,12 +61,48 @@ public:
     UndoDataFuncMap GetUndoDataFuncMap();
 
     void SetDbOpLogMap(CDBOpLogMap *pDbOpLogMap);
+
+    /**
+     * Track the reads of the base caches, see CDBReadTracker. The mem caches (txCache, ppCache) are not tracked,
+     * the execution with a read tracker must not use them.
+     */
+    void SetReadTracker(CDBReadTracker *pReadTracker);
+
+    /**
+     * Savepoint in place of a child CCacheWrapper, e.g. for executing a tx tentatively. The writes of the db caches
+     * after it are logged to be either kept by ReleaseSavepoint() or undone by RollbackToSavepoint().
+     * The savepoints can be nested, the release and the rollback apply to the latest one, and the writes kept by
+     * a release are undone by a rollback of the outer savepoint.
+     * The mem caches (txCache, ppCache) are not covered, and no other op log map must be set meanwhile.
+     */
+    void SetSavepoint();
+    void ReleaseSavepoint();
+    bool RollbackToSavepoint();
 private:
     CCacheWrapper(const CCacheWrapper&) = delete;
     CCacheWrapper& operator=(const CCacheWrapper&) = delete;
 
+    std::list<CDBOpLogMap> savepointOpLogMaps;  // from the outermost savepoint to the latest one
+};
+
+/** Savepoint of a CCacheWrapper, the writes after it are rolled back on destruction unless it is committed */
+class CCacheSavepoint {
+public:
+    CCacheSavepoint(CCacheWrapper &cwIn) : cw(cwIn) { cw.SetSavepoint(); }
+    ~CCacheSavepoint();
+
+    void Commit() {
+        cw.ReleaseSavepoint();
+        committed = true;
+    }
+private:
+    CCacheWrapper &cw;
+    bool committed = false;
 };
 
+// undo the op logs of the prefixes, in reverse order of every prefix
+bool UndoDbOpLogMap(const UndoDataFuncMap &undoDataFuncMap, const CDBOpLogMap &dbOpLogMap);
+
 class CCacheDBManager {
 public:
     CDBAccess           *pSysParamDb;
@@ -116,7 +155,37 @@ public:
 
     ~CCacheDBManager();
 
+    /**
+     * Flush all caches to dbs, with at most one synced write per db plus the begin marker.
+     * The begin marker is written before any db and the commit marker is written with the block db at last.
+     */
     bool Flush();
+
+    /**
+     * Flush all caches by the async flusher if it is started, otherwise same as Flush().
+     * The dirty data of caches is detached as a frozen snapshot and written to dbs in background,
+     * the caches are cleared and can be used at once.
+     */
+    bool FlushAsync();
+
+    // Start the async flusher, pushing more than maxPending snapshots will block FlushAsync()
+    void StartAsyncFlusher(uint32_t maxPending);
+
+    uint32_t GetPendingFlushCount() const { return pFlusher ? pFlusher->GetPendingCount() : 0; }
+
+    uint64_t GetFlushSeq() const { return flushSeq; }
+
+    // whether the last flush before startup began but has not been committed, the dbs are inconsistent
+    bool IsFlushIncomplete() const { return fFlushIncomplete; }
+
+    // all of the db access objects, the block db is the last one
+    vector<CDBAccess*> GetDbAccessList() const;
+private:
+    void FlushCaches();
+
+    uint64_t flushSeq = 0; // sequence of the last committed flush
+    bool fFlushIncomplete = false;
+    std::unique_ptr<CDBFlusher> pFlusher = nullptr;
 };  // CCacheDBManager
 
 #endif //PERSIST_CACHEWRAPPER_H
\ No newline at end of file
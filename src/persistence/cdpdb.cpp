@@ -109,7 +109,11 @@ bool CCdpDBCache::GetCdpListByCollateralRatio(const CCdpCoinPair &cdpCoinPair,
     uint64_t ratioBoost = uint64_t(ratio * CDP_BASE_RATIO_BOOST) + 1;
     CdpRatioSortedCache::KeyType endKey(cdpCoinPair, ratioBoost, 0, uint256());
 
-    return cdpRatioSortedCache.GetAllElements(endKey, userCdps);
+    CDBRangeIterator<CdpRatioSortedCache> dbIt(cdpRatioSortedCache, nullptr, &endKey);
+    for (dbIt.First(); dbIt.IsValid(); dbIt.Next()) {
+        userCdps.emplace_hint(userCdps.end(), dbIt.GetKey(), dbIt.GetValue());
+    }
+    return true;
 }
 
 CCdpGlobalData CCdpDBCache::GetCdpGlobalData(const CCdpCoinPair &cdpCoinPair) const {
@@ -165,6 +169,14 @@ void CCdpDBCache::SetDbOpLogMap(CDBOpLogMap *pDbOpLogMapIn) {
     cdpRatioSortedCache.SetDbOpLogMap(pDbOpLogMapIn);
 }
 
+void CCdpDBCache::SetReadTracker(CDBReadTracker *pReadTrackerIn) {
+    cdpGlobalDataCache.SetReadTracker(pReadTrackerIn);
+    cdpCache.SetReadTracker(pReadTrackerIn);
+    userCdpCache.SetReadTracker(pReadTrackerIn);
+    cdpCoinPairsCache.SetReadTracker(pReadTrackerIn);
+    cdpRatioSortedCache.SetReadTracker(pReadTrackerIn);
+}
+
 uint32_t CCdpDBCache::GetCacheSize() const {
     return cdpGlobalDataCache.GetCacheSize() + cdpCache.GetCacheSize() + userCdpCache.GetCacheSize() +
             cdpCoinPairsCache.GetCacheSize() + cdpRatioSortedCache.GetCacheSize();
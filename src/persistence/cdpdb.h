@@ -23,7 +23,9 @@ using namespace std;
 /*  ----------------   --------------      -----------------    --------------   -----------*/
 // cdpr{$Ratio}{$height}{$cdpid} -> CUserCDP
 // height: allows data of the same ratio to be sorted by height
-typedef CCompositeKVCache<dbk::CDP_RATIO, tuple<CCdpCoinPair, CFixedUInt64, CFixedUInt64, uint256>, CUserCDP>      CdpRatioSortedCache;
+// the coin pair is not in db order, the layers are stored in db key order to be positioned by the range iterator
+typedef CCompositeKVCache<dbk::CDP_RATIO, tuple<CCdpCoinPair, CFixedUInt64, CFixedUInt64, uint256>, CUserCDP,
+                          CDbKeyMapCacheStorage>                                                                  CdpRatioSortedCache;
 
 class CCdpDBCache {
 public:
@@ -53,6 +55,7 @@ public:
 
     void SetBaseViewPtr(CCdpDBCache *pBaseIn);
     void SetDbOpLogMap(CDBOpLogMap * pDbOpLogMapIn);
+    void SetReadTracker(CDBReadTracker *pReadTrackerIn);
 
     void RegisterUndoFunc(UndoDataFuncMap &undoDataFuncMap) {
         cdpGlobalDataCache.RegisterUndoFunc(undoDataFuncMap);
@@ -139,6 +142,11 @@ public:
         closedTxCdpCache.SetDbOpLogMap(pDbOpLogMapIn);
     }
 
+    void SetReadTracker(CDBReadTracker *pReadTrackerIn) {
+        closedCdpTxCache.SetReadTracker(pReadTrackerIn);
+        closedTxCdpCache.SetReadTracker(pReadTrackerIn);
+    }
+
     void RegisterUndoFunc(UndoDataFuncMap &undoDataFuncMap) {
         closedCdpTxCache.RegisterUndoFunc(undoDataFuncMap);
         closedTxCdpCache.RegisterUndoFunc(undoDataFuncMap);
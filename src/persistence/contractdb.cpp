@@ -12,6 +12,7 @@
 #include "entities/key.h"
 #include "commons/uint256.h"
 #include "commons/util/util.h"
+#include "crypto/hash.h"
 #include "vm/luavm/luavmrunenv.h"
 
 #include <stdint.h>
@@ -38,12 +39,47 @@ bool CContractDBCache::GetContract(const CRegID &contractRegId, CUniversalContra
     return contractCache.GetData(contractRegId, contract);
 }
 
+bool CContractDBCache::GetContractCodeHash(const CRegID &contractRegId, uint256 &codeHash) {
+    if (contractCodeHashCache.GetData(contractRegId, codeHash))
+        return true;
+
+    CUniversalContract contract;
+    if (!contractCache.GetData(contractRegId, contract))
+        return false;
+
+    codeHash = Hash(contract.code.begin(), contract.code.end());
+    return true;
+}
+
+bool CContractDBCache::FillContractCodeHashes(uint32_t &filledCount) {
+    filledCount = 0;
+    bool filled = false;
+    if (contractCodeHashFilledCache.GetData(filled) && filled)
+        return true;
+
+    map<CRegIDKey, CUniversalContract> contracts;
+    if (!contractCache.GetAllElements(contracts))
+        return false;
+
+    for (const auto &item : contracts) {
+        if (contractCodeHashCache.HaveData(item.first))
+            continue;
+
+        const string &code = item.second.code;
+        if (!contractCodeHashCache.SetData(item.first, Hash(code.begin(), code.end())))
+            return false;
+        filledCount++;
+    }
+    return contractCodeHashFilledCache.SetData(true);
+}
+
 bool CContractDBCache::GetContracts(map<CRegIDKey, CUniversalContract> &contracts) {
     return contractCache.GetAllElements(contracts);
 }
 
 bool CContractDBCache::SaveContract(const CRegID &contractRegId, const CUniversalContract &contract) {
-    return contractCache.SetData(contractRegId, contract);
+    return contractCache.SetData(contractRegId, contract) &&
+           contractCodeHashCache.SetData(contractRegId, Hash(contract.code.begin(), contract.code.end()));
 }
 
 bool CContractDBCache::HaveContract(const CRegID &contractRegId) {
@@ -51,6 +87,7 @@ bool CContractDBCache::HaveContract(const CRegID &contractRegId) {
 }
 
 bool CContractDBCache::EraseContract(const CRegID &contractRegId) {
+    contractCodeHashCache.EraseData(contractRegId);
     return contractCache.EraseData(contractRegId);
 }
 
@@ -66,6 +103,42 @@ bool CContractDBCache::SetContractData(const CRegID &contractRegId, const string
     return contractDataCache.SetData(key, contractData);
 }
 
+bool CContractDBCache::GetNextContractDataKey(const CRegID &contractRegId, const string &contractKey,
+                                              bool fInclusive, string &nextKey, uint32_t *pSteps) {
+    if (contractKey.size() > CDBContractKey::MAX_KEY_SIZE)
+        return false;
+
+    DBContractDataCache::KeyType beginKey(CRegIDKey(contractRegId), contractKey);
+    CDBRangeIterator<DBContractDataCache> dbIt(contractDataCache, &beginKey);
+    bool found = dbIt.First();
+    if (found && !fInclusive && dbIt.GetKey().second.GetKey() == contractKey)
+        found = dbIt.Next();
+    if (pSteps != nullptr)
+        *pSteps += dbIt.GetSteps();
+    if (!found || dbIt.GetKey().first != beginKey.first)
+        return false;
+
+    nextKey = dbIt.GetKey().second.GetKey();
+    return true;
+}
+
+bool CContractDBCache::GetPrevContractDataKey(const CRegID &contractRegId, const string *pContractKey,
+                                              string &prevKey, uint32_t *pSteps) {
+    if (pContractKey != nullptr && pContractKey->size() > CDBContractKey::MAX_KEY_SIZE)
+        return false;
+
+    // all of the keys of the contract are not greater than the key of max size filled with 0xff
+    DBContractDataCache::KeyType beginKey{CRegIDKey(contractRegId), CDBContractKey()};
+    DBContractDataCache::KeyType upperKey(CRegIDKey(contractRegId),
+        pContractKey ? *pContractKey : string(CDBContractKey::MAX_KEY_SIZE, '\xff'));
+    DBContractDataCache::KeyType key;
+    if (!FindPrevKey(contractDataCache, beginKey, upperKey, pContractKey == nullptr, key, pSteps))
+        return false;
+
+    prevKey = key.second.GetKey();
+    return true;
+}
+
 bool CContractDBCache::HaveContractData(const CRegID &contractRegId, const string &contractKey) {
     auto key = std::make_pair(CRegIDKey(contractRegId), contractKey);
     return contractDataCache.HaveData(key);
@@ -89,6 +162,8 @@ bool CContractDBCache::Flush() {
     contractDataCache.Flush();
     contractAccountCache.Flush();
     contractTracesCache.Flush();
+    contractCodeHashCache.Flush();
+    contractCodeHashFilledCache.Flush();
 
     return true;
 }
@@ -96,7 +171,9 @@ bool CContractDBCache::Flush() {
 uint32_t CContractDBCache::GetCacheSize() const {
     return contractCache.GetCacheSize() +
         contractDataCache.GetCacheSize() +
-        contractTracesCache.GetCacheSize();
+        contractTracesCache.GetCacheSize() +
+        contractCodeHashCache.GetCacheSize() +
+        contractCodeHashFilledCache.GetCacheSize();
 }
 
 
@@ -68,7 +68,9 @@ public:
         contractCache(pDbAccess),
         contractDataCache(pDbAccess),
         contractAccountCache(pDbAccess),
-        contractTracesCache(pDbAccess) {
+        contractTracesCache(pDbAccess),
+        contractCodeHashCache(pDbAccess),
+        contractCodeHashFilledCache(pDbAccess) {
         assert(pDbAccess->GetDbNameType() == DBNameType::CONTRACT);
     };
 
@@ -76,12 +78,18 @@ public:
         contractCache(pBaseIn->contractCache),
         contractDataCache(pBaseIn->contractDataCache),
         contractAccountCache(pBaseIn->contractAccountCache),
-        contractTracesCache(pBaseIn->contractTracesCache) {};
+        contractTracesCache(pBaseIn->contractTracesCache),
+        contractCodeHashCache(pBaseIn->contractCodeHashCache),
+        contractCodeHashFilledCache(pBaseIn->contractCodeHashFilledCache) {};
 
     bool GetContractAccount(const CRegID &contractRegId, const string &accountKey, CAppUserAccount &appAccOut);
     bool SetContractAccount(const CRegID &contractRegId, const CAppUserAccount &appAccIn);
 
     bool GetContract(const CRegID &contractRegId, CUniversalContract &contract);
+    // the hash of the contract code, saved with the contract, or computed for the contract saved without it
+    bool GetContractCodeHash(const CRegID &contractRegId, uint256 &codeHash);
+    // save the code hashes of the contracts saved without them, once for a db, filledCount is the count of them
+    bool FillContractCodeHashes(uint32_t &filledCount);
     bool GetContracts(map<CRegIDKey, CUniversalContract> &contracts);
     bool SaveContract(const CRegID &contractRegId, const CUniversalContract &contract);
     bool HaveContract(const CRegID &contractRegId);
@@ -91,6 +99,13 @@ public:
     bool SetContractData(const CRegID &contractRegId, const string &contractKey, const string &contractData);
     bool HaveContractData(const CRegID &contractRegId, const string &contractKey);
     bool EraseContractData(const CRegID &contractRegId, const string &contractKey);
+    // the least key of the contract data not less than contractKey, or greater than it if !fInclusive.
+    // the count of the keys visited, the erased ones included, is added to *pSteps if it is not nullptr
+    bool GetNextContractDataKey(const CRegID &contractRegId, const string &contractKey, bool fInclusive,
+                                string &nextKey, uint32_t *pSteps = nullptr);
+    // the greatest key of the contract data less than *pContractKey, the last key if pContractKey is nullptr
+    bool GetPrevContractDataKey(const CRegID &contractRegId, const string *pContractKey, string &prevKey,
+                                uint32_t *pSteps = nullptr);
 
     bool GetContractTraces(const uint256 &txid, string &contractTraces);
     bool SetContractTraces(const uint256 &txid, const string &contractTraces);
@@ -103,6 +118,8 @@ public:
         contractDataCache.SetBase(&pBaseIn->contractDataCache);
         contractAccountCache.SetBase(&pBaseIn->contractAccountCache);
         contractTracesCache.SetBase(&pBaseIn->contractTracesCache);
+        contractCodeHashCache.SetBase(&pBaseIn->contractCodeHashCache);
+        contractCodeHashFilledCache.SetBase(&pBaseIn->contractCodeHashFilledCache);
     };
 
     void SetDbOpLogMap(CDBOpLogMap *pDbOpLogMapIn) {
@@ -110,6 +127,17 @@ public:
         contractDataCache.SetDbOpLogMap(pDbOpLogMapIn);
         contractAccountCache.SetDbOpLogMap(pDbOpLogMapIn);
         contractTracesCache.SetDbOpLogMap(pDbOpLogMapIn);
+        contractCodeHashCache.SetDbOpLogMap(pDbOpLogMapIn);
+        contractCodeHashFilledCache.SetDbOpLogMap(pDbOpLogMapIn);
+    }
+
+    void SetReadTracker(CDBReadTracker *pReadTrackerIn) {
+        contractCache.SetReadTracker(pReadTrackerIn);
+        contractDataCache.SetReadTracker(pReadTrackerIn);
+        contractAccountCache.SetReadTracker(pReadTrackerIn);
+        contractTracesCache.SetReadTracker(pReadTrackerIn);
+        contractCodeHashCache.SetReadTracker(pReadTrackerIn);
+        contractCodeHashFilledCache.SetReadTracker(pReadTrackerIn);
     }
 
     void RegisterUndoFunc(UndoDataFuncMap &undoDataFuncMap) {
@@ -117,6 +145,8 @@ public:
         contractDataCache.RegisterUndoFunc(undoDataFuncMap);
         contractAccountCache.RegisterUndoFunc(undoDataFuncMap);
         contractTracesCache.RegisterUndoFunc(undoDataFuncMap);
+        contractCodeHashCache.RegisterUndoFunc(undoDataFuncMap);
+        contractCodeHashFilledCache.RegisterUndoFunc(undoDataFuncMap);
     }
 
     shared_ptr<CDBContractDataIterator> CreateContractDataIterator(const CRegID &contractRegid,
@@ -126,8 +156,8 @@ public:
 /*       type               prefixType               key                     value                 variable               */
 /*  ----------------   -------------------------   -----------------------  ------------------   ------------------------ */
     /////////// ContractDB
-    // contract $RegIdKey -> Contract
-    CCompositeKVCache< dbk::CONTRACT_DEF,         CRegIDKey,                   CUniversalContract >   contractCache;
+    // contract $RegIdKey -> Contract, point lookups only, kept in a flat hash storage
+    CCompositeKVCache< dbk::CONTRACT_DEF,         CRegIDKey,                   CUniversalContract, CFlatHashCacheStorage > contractCache;
 
     // pair<contractRegId, contractKey> -> contractData
     DBContractDataCache contractDataCache;
@@ -135,6 +165,49 @@ public:
     CCompositeKVCache< dbk::CONTRACT_ACCOUNT,     pair<CRegIDKey, string>,     CAppUserAccount >      contractAccountCache;
     // txid -> contract_traces
     CCompositeKVCache< dbk::CONTRACT_TRACES,     uint256,                  string >      contractTracesCache;
+    // contract $RegIdKey -> hash of contract code, to look up the compiled code without hashing the code
+    CCompositeKVCache< dbk::CONTRACT_CODE_HASH,  CRegIDKey,                uint256,      CFlatHashCacheStorage > contractCodeHashCache;
+    // true after the code hashes of the contracts saved before contractCodeHashCache are filled
+    CSimpleKVCache< dbk::CONTRACT_CODE_HASH_FILLED, bool >                                                     contractCodeHashFilledCache;
+};
+
+/**
+ * Handle of the data of one contract, the regid of which is resolved once by the holder of the handle, so that every
+ * access is a lookup of contractDataCache only.
+ */
+class CContractDataHandle {
+public:
+    CContractDataHandle(CContractDBCache &contractCacheIn, const CRegID &contractRegIdIn)
+        : contractCache(contractCacheIn), contractRegId(contractRegIdIn), regIdKey(contractRegIdIn) {}
+
+    const CRegID& GetRegId() const { return contractRegId; }
+
+    bool Get(const string &contractKey, string &contractData) const {
+        return contractCache.contractDataCache.GetData(DBContractDataCache::KeyType(regIdKey, contractKey),
+                                                       contractData);
+    }
+
+    bool Set(const string &contractKey, const string &contractData) {
+        return contractCache.contractDataCache.SetData(DBContractDataCache::KeyType(regIdKey, contractKey),
+                                                       contractData);
+    }
+
+    bool Erase(const string &contractKey) {
+        return contractCache.contractDataCache.EraseData(DBContractDataCache::KeyType(regIdKey, contractKey));
+    }
+
+    bool GetNextKey(const string &contractKey, bool fInclusive, string &nextKey, uint32_t *pSteps = nullptr) {
+        return contractCache.GetNextContractDataKey(contractRegId, contractKey, fInclusive, nextKey, pSteps);
+    }
+
+    bool GetPrevKey(const string *pContractKey, string &prevKey, uint32_t *pSteps = nullptr) {
+        return contractCache.GetPrevContractDataKey(contractRegId, pContractKey, prevKey, pSteps);
+    }
+
+private:
+    CContractDBCache &contractCache;
+    CRegID contractRegId;
+    CRegIDKey regIdKey;
 };
 
 #endif  // PERSIST_CONTRACTDB_H
\ No newline at end of file
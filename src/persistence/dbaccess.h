@@ -7,6 +7,7 @@
 #define PERSIST_DB_ACCESS_H
 
 #include "commons/uint256.h"
+#include "dbcachestorage.h"
 #include "dbconf.h"
 #include "leveldbwrapper.h"
 
@@ -14,6 +15,12 @@
 #include <tuple>
 #include <vector>
 #include <optional>
+#include <memory>
+#include <list>
+#include <set>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
 
 using namespace std;
 
@@ -264,23 +271,156 @@ namespace db_util {
 typedef void(UndoDataFunc)(const CDbOpLogs &pDbOpLogs);
 typedef std::map<dbk::PrefixType, std::function<UndoDataFunc>> UndoDataFuncMap;
 
+// statistics of the flush batches committed to one db
+struct CDBFlushStats {
+    uint64_t flush_count    = 0;
+    uint32_t last_op_count  = 0;
+    uint64_t last_bytes     = 0;
+    int64_t  last_time_us   = 0;
+    uint64_t total_bytes    = 0;
+    int64_t  total_time_us  = 0;
+};
+
+/**
+ * The mapped value of the cache storage. The serialized size of the value is kept with it by the caches which
+ * calculate their size, so an update only serializes the new value.
+ */
+template<typename ValueType>
+struct CCacheValue {
+    ValueType value;
+    uint32_t size = 0;
+
+    CCacheValue() {}
+    explicit CCacheValue(const ValueType &valueIn): value(valueIn) {}
+};
+
 class CDBAccess {
 public:
     CDBAccess(const boost::filesystem::path& dir, DBNameType dbNameTypeIn, bool fMemory, bool fWipe) :
               dbNameType(dbNameTypeIn),
-              db( dir / ::GetDbName(dbNameTypeIn), DBCacheSize[dbNameTypeIn], fMemory, fWipe ) {}
+              db( dir / ::GetDbName(dbNameTypeIn), GetDbTuningProfile(dbNameTypeIn), fMemory, fWipe ) {}
+
+    /**
+     * Begin a flush batch. Until CommitFlushBatch() or DetachFlushBatch() is called, all BatchWrite() calls
+     * of every prefix in this db are gathered into one batch instead of being written to db one by one.
+     * fRecord: keep the ops of batch readable, must be set if the batch will be detached.
+     */
+    void BeginFlushBatch(bool fRecord = false) {
+        assert(!pFlushBatch && "flush batch has been began");
+        pFlushBatch = std::make_shared<CLevelDBBatch>(fRecord);
+    }
+
+    /**
+     * Write the gathered flush batch to db with at most one synced write, and end the flush batch.
+     */
+    bool CommitFlushBatch(bool fSync = true) {
+        assert(pFlushBatch && "flush batch has not been began");
+        std::shared_ptr<CLevelDBBatch> pBatch = std::move(pFlushBatch);
+        if (pBatch->IsEmpty())
+            return true;
+
+        WaitForPendingBatches();
+        return WriteFlushBatch(*pBatch, fSync);
+    }
+
+    /**
+     * End the flush batch without writing it to db, and return it for async writing by WritePendingBatch().
+     * The batch keeps pending until it has been written, all reads of this db will see the pending data.
+     * return nullptr if the batch is empty
+     */
+    std::shared_ptr<CLevelDBBatch> DetachFlushBatch() {
+        assert(pFlushBatch && "flush batch has not been began");
+        assert(pFlushBatch->GetRecords() != nullptr && "flush batch must be recorded to be detached");
+        std::shared_ptr<CLevelDBBatch> pBatch = std::move(pFlushBatch);
+        if (pBatch->IsEmpty())
+            return nullptr;
+
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        pendingBatches.push_back(pBatch);
+        pendingCount = pendingBatches.size();
+        return pBatch;
+    }
+
+    /**
+     * Write the oldest pending batch to db, called by the async flusher.
+     */
+    bool WritePendingBatch(const std::shared_ptr<CLevelDBBatch> &pBatch) {
+        WriteFlushBatch(*pBatch, true);
+
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        assert(!pendingBatches.empty() && pendingBatches.front() == pBatch);
+        pendingBatches.pop_front();
+        pendingCount = pendingBatches.size();
+        pendingCond.notify_all();
+        return true;
+    }
+
+    /**
+     * End the flush batch without writing it, e.g. a write of the flush has failed.
+     */
+    void AbortFlushBatch() {
+        if (pFlushBatch && !pFlushBatch->IsEmpty())
+            LogPrint(BCLog::ERROR, "aborted flush batch of db %s, ops=%u\n", ::GetDbName(dbNameType),
+                     pFlushBatch->GetCount());
+        pFlushBatch = nullptr;
+    }
+
+    /**
+     * Drop a pending batch without writing it, e.g. the async flusher has failed. The direct writes waiting for
+     * the pending batches are woken up.
+     */
+    void DropPendingBatch(const std::shared_ptr<CLevelDBBatch> &pBatch) {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        auto it = std::find(pendingBatches.begin(), pendingBatches.end(), pBatch);
+        if (it == pendingBatches.end())
+            return;  // has been written
+        pendingBatches.erase(it);
+        pendingCount = pendingBatches.size();
+        pendingCond.notify_all();
+    }
+
+    uint32_t GetPendingBatchCount() const { return pendingCount; }
+
+    bool IsInFlushBatch() const { return pFlushBatch != nullptr; }
+
+    bool HasFlushData() const { return pFlushBatch != nullptr && !pFlushBatch->IsEmpty(); }
+
+    CDBFlushStats GetFlushStats() const {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        return flushStats;
+    }
 
     int64_t GetDbCount() const { return db.GetDbCount(); }
+
+    bool GetProperty(const string &name, string &value) const { return db.GetProperty(name, value); }
+
+    // approximate disk size of all the data of prefix in db, the pending batches are not counted
+    uint64_t GetApproximateSize(const dbk::PrefixType prefixType) const {
+        string begin = dbk::GetKeyPrefix(prefixType);
+        string end   = begin;
+        end.back()++;
+        return db.GetApproximateSize(begin, end);
+    }
+
+    uint64_t GetApproximateSize() const { return db.GetApproximateSize(string(), string(1, '\xff')); }
     template<typename KeyType, typename ValueType>
     bool GetData(const dbk::PrefixType prefixType, const KeyType &key, ValueType &value) const {
-        string keyStr = dbk::GenDbKey(prefixType, key);
-        return db.Read(keyStr, value);
+        dbk::CDbKeyWriter keyWriter(SER_DISK, CLIENT_VERSION);
+        dbk::EncodeDbKey(prefixType, key, keyWriter);
+        return ReadData(Slice(keyWriter.data(), keyWriter.size()), value);
     }
 
     template<typename ValueType>
     bool GetData(const dbk::PrefixType prefixType, ValueType &value) const {
-        const string prefix = dbk::GetKeyPrefix(prefixType);
-        return db.Read(prefix, value);
+        const string &prefix = dbk::GetKeyPrefix(prefixType);
+        return ReadData(prefix, value);
+    }
+
+    template<typename ValueType>
+    bool WriteData(const dbk::PrefixType prefixType, const ValueType &value, bool fSync = false) {
+        const string &prefix = dbk::GetKeyPrefix(prefixType);
+        WaitForPendingBatches();
+        return db.Write(prefix, value, fSync);
     }
 
     template <typename KeyType>
@@ -347,7 +487,7 @@ public:
 
                 // Got an valid element.
                 const auto &slValue = pCursor->value();
-                CDataStream ds(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
+                CBufferReader ds(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
                 ds >> value;
                 auto ret = elements.emplace(key, value);
                 if (!ret.second)
@@ -388,7 +528,7 @@ public:
 
                 // Got an valid element.
                 leveldb::Slice slValue = pCursor->value();
-                CDataStream ds(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
+                CBufferReader ds(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
                 ds >> value;
                 auto ret = elements.emplace(key, value);
                 if (!ret.second)
@@ -430,7 +570,7 @@ public:
                 } else {
                     // Got an valid element.
                     leveldb::Slice slValue = pCursor->value();
-                    CDataStream ds(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
+                    CBufferReader ds(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
                     ds >> value;
                     auto ret = elements.emplace(key, value);
                     if (!ret.second)
@@ -446,27 +586,38 @@ public:
 
     template<typename KeyType, typename ValueType>
     bool HaveData(const dbk::PrefixType prefixType, const KeyType &key) const {
-        string keyStr = dbk::GenDbKey(prefixType, key);
-        return db.Exists(keyStr);
-    }
-
-    template<typename KeyType, typename ValueType>
-    void BatchWrite(const dbk::PrefixType prefixType, const map<KeyType, ValueType> &mapData) {
-        CLevelDBBatch batch;
-        for (auto item : mapData) {
+        dbk::CDbKeyWriter keyWriter(SER_DISK, CLIENT_VERSION);
+        dbk::EncodeDbKey(prefixType, key, keyWriter);
+        Slice slKey(keyWriter.data(), keyWriter.size());
+        std::optional<string> pendingValue;
+        if (FindPendingValue(slKey, pendingValue))
+            return pendingValue.has_value();
+        return db.Exists(slKey);
+    }
+
+    template<typename KeyType, typename ValueType, typename MapType = map<KeyType, ValueType>>
+    void BatchWrite(const dbk::PrefixType prefixType, const MapType &mapData) {
+        CLevelDBBatch localBatch;
+        CLevelDBBatch &batch = pFlushBatch ? *pFlushBatch : localBatch;
+        for (const auto &item : mapData) {
             string key = dbk::GenDbKey(prefixType, item.first);
-            if (db_util::IsEmpty(item.second)) {
+            const ValueType &value = GetMappedValue(item.second);
+            if (db_util::IsEmpty(value)) {
                 batch.Erase(key);
             } else {
-                batch.Write(key, item.second);
+                batch.Write(key, value);
             }
         }
-        db.WriteBatch(batch, true);
+        if (!pFlushBatch) {
+            WaitForPendingBatches();
+            db.WriteBatch(localBatch, true);
+        }
     }
 
     template<typename ValueType>
     void BatchWrite(const dbk::PrefixType prefixType, ValueType &value) {
-        CLevelDBBatch batch;
+        CLevelDBBatch localBatch;
+        CLevelDBBatch &batch = pFlushBatch ? *pFlushBatch : localBatch;
         const string prefix = dbk::GetKeyPrefix(prefixType);
 
         if (db_util::IsEmpty(value)) {
@@ -474,28 +625,160 @@ public:
         } else {
             batch.Write(prefix, value);
         }
-        db.WriteBatch(batch, true);
+        if (!pFlushBatch) {
+            WaitForPendingBatches();
+            db.WriteBatch(localBatch, true);
+        }
     }
 
     DBNameType GetDbNameType() const { return dbNameType; }
 
+    // the iterator will see the pending batches if exist
     std::shared_ptr<leveldb::Iterator> NewIterator() {
+        if (pendingCount > 0) {
+            vector<std::shared_ptr<CLevelDBBatch>> layers;
+            {
+                std::lock_guard<std::mutex> lock(pendingMutex);
+                layers.assign(pendingBatches.begin(), pendingBatches.end());
+            }
+            // the db iterator must be created after the layers are got, the batch written to db
+            // during this time will be seen by both of them
+            return std::make_shared<CLevelDBOverlayIterator>(db.NewIterator(), layers);
+        }
         return std::shared_ptr<leveldb::Iterator>(db.NewIterator());
     }
+private:
+    // the value of an item of a std::map or of a cache storage
+    template<typename ValueType>
+    static const ValueType& GetMappedValue(const ValueType &value) { return value; }
+
+    template<typename ValueType>
+    static const ValueType& GetMappedValue(const CCacheValue<ValueType> &value) { return value.value; }
+
+    template<typename ValueType>
+    bool ReadData(const Slice &key, ValueType &value) const {
+        std::optional<string> pendingValue;
+        if (FindPendingValue(key, pendingValue)) {
+            if (!pendingValue)
+                return false;  // erased
+            try {
+                CBufferReader valueReader(pendingValue->data(), pendingValue->data() + pendingValue->size(),
+                                          SER_DISK, CLIENT_VERSION);
+                valueReader >> value;
+            } catch(std::exception &e) {
+                return false;
+            }
+            return true;
+        }
+        return db.Read(key, value);
+    }
+
+    // find the value of key in pending batches, the newest first.
+    // return false if not found, the found value is nullopt if the key has been erased.
+    bool FindPendingValue(const Slice &key, std::optional<string> &valueOut) const {
+        if (pendingCount == 0)
+            return false;
+
+        string keyStr = key.ToString();
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        for (auto it = pendingBatches.rbegin(); it != pendingBatches.rend(); it++) {
+            auto recordIt = (*it)->GetRecords()->find(keyStr);
+            if (recordIt != (*it)->GetRecords()->end()) {
+                valueOut = recordIt->second;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // the direct write must wait for the pending batches, otherwise the older pending data will
+    // overwrite it
+    void WaitForPendingBatches() {
+        if (pendingCount == 0)
+            return;
+
+        std::unique_lock<std::mutex> lock(pendingMutex);
+        pendingCond.wait(lock, [this] { return pendingBatches.empty(); });
+    }
+
+    bool WriteFlushBatch(CLevelDBBatch &batch, bool fSync) {
+        int64_t beginTime = GetTimeMicros();
+        db.WriteBatch(batch, fSync);
+        int64_t elapsed = GetTimeMicros() - beginTime;
+
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        flushStats.flush_count++;
+        flushStats.last_op_count = batch.GetCount();
+        flushStats.last_bytes    = batch.GetDataSize();
+        flushStats.last_time_us  = elapsed;
+        flushStats.total_bytes   += batch.GetDataSize();
+        flushStats.total_time_us += elapsed;
+
+        LogPrint(BCLog::LDB, "flushed db %s: ops=%u, bytes=%llu, time=%.2fms\n", ::GetDbName(dbNameType),
+                 flushStats.last_op_count, flushStats.last_bytes, elapsed * 0.001);
+        return true;
+    }
+
 private:
     DBNameType dbNameType;
     mutable CLevelDBWrapper db; // // TODO: remove the mutable declare
+    std::shared_ptr<CLevelDBBatch> pFlushBatch = nullptr;
+    CDBFlushStats flushStats;
+
+    // batches detached for async writing but not written yet, ordered from old to new
+    mutable std::mutex pendingMutex;
+    std::condition_variable pendingCond;
+    std::list<std::shared_ptr<CLevelDBBatch>> pendingBatches;
+    std::atomic<uint32_t> pendingCount{0};
+};
+
+/**
+ * Read tracker of the cache layers executing a tx speculatively against shared base caches, see txexecutor.h.
+ * The reads of the base caches are serialized by the shared mutex, because the db caches fill themselves on
+ * reading. The keys read from the base caches are recorded, so the result can be validated later against the
+ * keys written by the txs executed before it. The reads which can not be tracked by key (range reads, single
+ * value caches) mark the execution unsafe.
+ */
+class CDBReadTracker {
+public:
+    std::mutex &baseMutex;
+
+    CDBReadTracker(std::mutex &baseMutexIn): baseMutex(baseMutexIn) {}
+
+    // the key is serialized the same as the key of CDbOpLog
+    template<typename KeyType>
+    void AddReadKey(dbk::PrefixType prefixType, const KeyType &key) {
+        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+        ssKey << key;
+        readKeys[dbk::GetKeyPrefix(prefixType)].insert(ssKey.str());
+    }
+
+    void SetUnsafe() { unsafe = true; }
+    bool IsUnsafe() const { return unsafe; }
+
+    // prefix -> serialized keys
+    const map<string, set<string>>& GetReadKeys() const { return readKeys; }
+private:
+    map<string, set<string>> readKeys;
+    bool unsafe = false;
 };
 
-template<int32_t PREFIX_TYPE_VALUE, typename __KeyType, typename __ValueType>
+/**
+ * __StorageType is the storage policy of the cached data, see dbcachestorage.h
+ */
+template<int32_t PREFIX_TYPE_VALUE, typename __KeyType, typename __ValueType,
+         template<typename, typename> class __StorageType = CMapCacheStorage>
 class CCompositeKVCache {
 public:
     static const dbk::PrefixType PREFIX_TYPE = (dbk::PrefixType)PREFIX_TYPE_VALUE;
 public:
     typedef __KeyType   KeyType;
     typedef __ValueType ValueType;
+    typedef __StorageType<KeyType, CCacheValue<ValueType>> Storage;
+    typedef __StorageType<KeyType, ValueType> ReadStorage;
     typedef typename std::map<KeyType, ValueType> Map;
     typedef typename std::map<KeyType, ValueType>::iterator Iterator;
+    typedef typename Storage::iterator StorageIterator;
 
 public:
     /**
@@ -524,12 +807,22 @@ public:
         pDbOpLogMap = pDbOpLogMapIn;
     }
 
+    // track the reads of the base cache, the values read are kept apart from the data to be flushed
+    void SetReadTracker(CDBReadTracker *pReadTrackerIn) {
+        assert(pBase != nullptr);
+        pReadTracker = pReadTrackerIn;
+    }
+
     bool IsCalcSize() const { return is_calc_size; }
 
     uint32_t GetCacheSize() const {
         return size;
     }
 
+    size_t GetCacheItemCount() const {
+        return mapData.size();
+    }
+
     bool GetTopNElements(const uint32_t maxNum, set<KeyType> &keys) {
         // 1. Get all candidate elements.
         set<KeyType> expiredKeys;
@@ -576,9 +869,9 @@ public:
         if (db_util::IsEmpty(key)) {
             return false;
         }
-        auto it = GetDataIt(key);
-        if (it != mapData.end() && !db_util::IsEmpty(it->second)) {
-            value = it->second;
+        const ValueType *pValue = GetDataPtr(key);
+        if (pValue != nullptr && !db_util::IsEmpty(*pValue)) {
+            value = *pValue;
             return true;
         }
         return false;
@@ -594,9 +887,9 @@ public:
             AddOpLog(key, *pEmptyValue, &value);
             AddDataToMap(key, value);
         } else {
-            AddOpLog(key, it->second, &value);
-            UpdateDataSize(it->second, value);
-            it->second = value;
+            AddOpLog(key, it->second.value, &value);
+            it->second.value = value;
+            UpdateDataSize(it);
         }
         return true;
     }
@@ -605,26 +898,26 @@ public:
         if (db_util::IsEmpty(key)) {
             return false;
         }
-        auto it = GetDataIt(key);
-        return it != mapData.end() && !db_util::IsEmpty(it->second);
+        const ValueType *pValue = GetDataPtr(key);
+        return pValue != nullptr && !db_util::IsEmpty(*pValue);
     }
 
     bool EraseData(const KeyType &key) {
         if (db_util::IsEmpty(key)) {
             return false;
         }
-        Iterator it = GetDataIt(key);
-        if (it != mapData.end() && !db_util::IsEmpty(it->second)) {
-            DecDataSize(it->second);
-            AddOpLog(key, it->second, nullptr);
-            db_util::SetEmpty(it->second);
-            IncDataSize(it->second);
+        StorageIterator it = GetDataIt(key);
+        if (it != mapData.end() && !db_util::IsEmpty(it->second.value)) {
+            AddOpLog(key, it->second.value, nullptr);
+            db_util::SetEmpty(it->second.value);
+            UpdateDataSize(it);
         }
         return true;
     }
 
     void Clear() {
         mapData.clear();
+        readData.clear();
         size = 0;
     }
 
@@ -632,12 +925,12 @@ public:
         assert(pBase != nullptr || pDbAccess != nullptr);
         if (pBase != nullptr) {
             assert(pDbAccess == nullptr);
-            for (auto it : mapData) {
-                pBase->mapData[it.first] = it.second;
+            for (const auto &it : mapData) {
+                pBase->SetDataToMap(it.first, it.second.value);
             }
         } else if (pDbAccess != nullptr) {
             assert(pBase == nullptr);
-            pDbAccess->BatchWrite<KeyType, ValueType>(PREFIX_TYPE, mapData);
+            pDbAccess->BatchWrite<KeyType, ValueType, Storage>(PREFIX_TYPE, mapData);
         }
 
         Clear();
@@ -645,15 +938,16 @@ public:
 
     void UndoData(const CDbOpLog &dbOpLog) {
         KeyType key;
+        if (dbOpLog.IsLayerErase()) {
+            CDataStream ssKey(dbOpLog.GetKey(), SER_DISK, CLIENT_VERSION);
+            ssKey >> key;
+            EraseDataFromMap(key);
+            return;
+        }
+
         ValueType value;
         dbOpLog.Get(key, value);
-        auto it = mapData.find(key);
-        if (it != mapData.end()) {
-            UpdateDataSize(it->second, value);
-            it->second = value;
-        } else {
-            AddDataToMap(key, value);
-        }
+        SetDataToMap(key, value);
     }
 
     void UndoDataList(const CDbOpLogs &dbOpLogs) {
@@ -676,20 +970,66 @@ public:
         return pRet;
     }
 
-    CCompositeKVCache<PREFIX_TYPE, KeyType, ValueType>* GetBasePtr() { return pBase; }
+    CCompositeKVCache* GetBasePtr() {
+        // the iterators read the base caches directly, which can not be tracked
+        if (pReadTracker != nullptr)
+            pReadTracker->SetUnsafe();
+        return pBase;
+    }
 
-    map<KeyType, ValueType>& GetMapData() { return mapData; };
+    // a copy of the data of this layer in key order, for tests and debugging
+    Map GetMapData() const {
+        Map ret;
+        mapData.VisitOrdered([&](const typename Storage::value_type &item) {
+            ret.emplace_hint(ret.end(), item.first, item.second.value);
+            return true;
+        });
+        return ret;
+    }
+
+    // storage of this layer, for the range cursors
+    const Storage& GetStorage() const { return mapData; }
 private:
-    Iterator GetDataIt(const KeyType &key) const {
-        Iterator it = mapData.find(key);
+    /**
+     * Find the value for reading. A value found in the base caches is referenced in place instead of being
+     * copied to this cache, only the db cache keeps the values it read from db.
+     * The returned pointer is valid until the cache holding the value is changed or cleared.
+     */
+    const ValueType* GetDataPtr(const KeyType &key) const {
+        StorageIterator it = mapData.find(key);
+        if (it != mapData.end()) {
+            return &it->second.value;
+        } else if (pReadTracker != nullptr) {
+            return GetTrackedBaseDataPtr(key);
+        } else if (pBase != nullptr) {
+            return pBase->GetDataPtr(key);
+        } else if (pDbAccess != nullptr) {
+            auto pDbValue = db_util::MakeEmptyValue<ValueType>();
+            if (pDbAccess->GetData(PREFIX_TYPE, key, *pDbValue)) {
+                return &AddDataToMap(key, *pDbValue)->second.value;
+            }
+        }
+        return nullptr;
+    }
+
+    /**
+     * Find the value for writing, copy on write: a value found in the base caches is copied to this cache.
+     */
+    StorageIterator GetDataIt(const KeyType &key) const {
+        StorageIterator it = mapData.find(key);
         if (it != mapData.end()) {
             return it;
+        } else if (pReadTracker != nullptr) {
+            const ValueType *pBaseValue = GetTrackedBaseDataPtr(key);
+            if (pBaseValue != nullptr) {
+                return AddDataToMap(key, *pBaseValue);
+            }
         } else if (pBase != nullptr) {
             // find key-value at base cache
-            auto baseIt = pBase->GetDataIt(key);
-            if (baseIt != pBase->mapData.end()) {
+            const ValueType *pBaseValue = pBase->GetDataPtr(key);
+            if (pBaseValue != nullptr) {
                 // the found key-value add to current mapData
-                return AddDataToMap(key, baseIt->second);
+                return AddDataToMap(key, *pBaseValue);
             }
         } else if (pDbAccess != NULL) {
             // TODO: need to save the empty value to mapData for search performance?
@@ -702,39 +1042,65 @@ private:
         return mapData.end();
     }
 
-    inline Iterator AddDataToMap(const KeyType &keyIn, const ValueType &valueIn) const {
-        auto newRet = mapData.emplace(keyIn, valueIn);
+    /**
+     * Read the base cache under the lock of the read tracker and record the key, the value read is copied
+     * because the base caches may be changed by others once the lock is released.
+     */
+    const ValueType* GetTrackedBaseDataPtr(const KeyType &key) const {
+        auto it = readData.find(key);
+        if (it != readData.end()) {
+            return &it->second;
+        }
+
+        std::lock_guard<std::mutex> lock(pReadTracker->baseMutex);
+        pReadTracker->AddReadKey(PREFIX_TYPE, key);
+        const ValueType *pBaseValue = pBase->GetDataPtr(key);
+        if (pBaseValue == nullptr) {
+            return nullptr;
+        }
+        return &readData.emplace(key, *pBaseValue).first->second;
+    }
+
+    inline StorageIterator AddDataToMap(const KeyType &keyIn, const ValueType &valueIn) const {
+        auto newRet = mapData.emplace(keyIn, CCacheValue<ValueType>(valueIn));
         if (!newRet.second)
             throw runtime_error(strprintf("%s :  %s, alloc new cache item failed", __FUNCTION__, __LINE__));
-        IncDataSize(keyIn, valueIn);
+        if (is_calc_size)
+            size += CalcDataSize(keyIn);
+        UpdateDataSize(newRet.first);
         return newRet.first;
     }
 
-    inline void IncDataSize(const KeyType &keyIn, const ValueType &valueIn) const {
-        if (is_calc_size) {
-            size += CalcDataSize(keyIn);
-            size += CalcDataSize(valueIn);
+    inline void SetDataToMap(const KeyType &key, const ValueType &value) const {
+        StorageIterator it = mapData.find(key);
+        if (it != mapData.end()) {
+            it->second.value = value;
+            UpdateDataSize(it);
+        } else {
+            AddDataToMap(key, value);
         }
     }
 
-    inline void IncDataSize(const ValueType &valueIn) const {
+    inline void EraseDataFromMap(const KeyType &key) const {
+        StorageIterator it = mapData.find(key);
+        if (it == mapData.end())
+            return;
         if (is_calc_size)
-            size += CalcDataSize(valueIn);
+            size -= CalcDataSize(key) + it->second.size;
+        mapData.erase(key);
     }
 
-    inline void DecDataSize(const ValueType &valueIn) const {
-        if (is_calc_size) {
-            uint32_t sz = CalcDataSize(valueIn);
-            size = size > sz ? size - sz : 0;
-        }
-    }
+    /**
+     * Update the cache size with the new value of the item. The serialized size of the value is kept in the
+     * item, so only the new value is serialized to get its size.
+     */
+    inline void UpdateDataSize(StorageIterator it) const {
+        if (!is_calc_size)
+            return;
 
-    inline void UpdateDataSize(const ValueType &oldValue, const ValueType &newVvalue) const {
-        if (is_calc_size) {
-            size += CalcDataSize(newVvalue);
-            uint32_t oldSz = CalcDataSize(oldValue);
-            size = size > oldSz ? size - oldSz : 0;
-        }
+        uint32_t newSize = CalcDataSize(it->second.value);
+        size = size + newSize - it->second.size;
+        it->second.size = newSize;
     }
 
     template <typename Data>
@@ -743,26 +1109,28 @@ private:
     }
 
     bool GetTopNElements(const uint32_t maxNum, set<KeyType> &expiredKeys, set<KeyType> &keys) {
-        if (!mapData.empty()) {
+        if (!mapData.empty() && maxNum > 0) {
             uint32_t count = 0;
-            auto iter      = mapData.begin();
-
-            for (; (count < maxNum) && iter != mapData.end(); ++iter) {
-                if (db_util::IsEmpty(iter->second)) {
-                    expiredKeys.insert(iter->first);
-                } else if (expiredKeys.count(iter->first) || keys.count(iter->first)) {
+            mapData.VisitOrdered([&](const typename Storage::value_type &item) {
+                if (db_util::IsEmpty(item.second.value)) {
+                    expiredKeys.insert(item.first);
+                } else if (expiredKeys.count(item.first) || keys.count(item.first)) {
                     // TODO: log
-                    continue;
                 } else {
                     // Got a valid element.
-                    keys.insert(iter->first);
+                    keys.insert(item.first);
 
                     ++count;
                 }
-            }
+                return count < maxNum;
+            });
         }
 
-        if (pBase != nullptr) {
+        if (pReadTracker != nullptr) {
+            std::lock_guard<std::mutex> lock(pReadTracker->baseMutex);
+            pReadTracker->SetUnsafe();
+            return pBase->GetTopNElements(maxNum, expiredKeys, keys);
+        } else if (pBase != nullptr) {
             return pBase->GetTopNElements(maxNum, expiredKeys, keys);
         } else if (pDbAccess != nullptr) {
             return pDbAccess->GetTopNElements(maxNum, PREFIX_TYPE, expiredKeys, keys);
@@ -774,18 +1142,25 @@ private:
     // map<string, ValueType>
     bool GetAllElements(const KeyType &endKey, Map &mapDataOut, set<KeyType> &expiredKeys) {
         if (!mapData.empty()) {
-            for (auto iter = mapData.begin(); iter != mapData.end() && iter->first < endKey; iter++) {
-                if (!expiredKeys.count(iter->first) && !mapDataOut.count(iter->first)) { // check not got
-                    if (db_util::IsEmpty(iter->second)) { // empty, will be deleted
-                        expiredKeys.insert(iter->first);
+            mapData.VisitOrdered([&](const typename Storage::value_type &item) {
+                if (!(item.first < endKey))
+                    return false;
+                if (!expiredKeys.count(item.first) && !mapDataOut.count(item.first)) { // check not got
+                    if (db_util::IsEmpty(item.second.value)) { // empty, will be deleted
+                        expiredKeys.insert(item.first);
                     } else { // Got a valid element.
-                        mapDataOut.emplace(iter->first, iter->second);
+                        mapDataOut.emplace(item.first, item.second.value);
                     }
                 }
-            }
+                return true;
+            });
         }
 
-        if (pBase != nullptr) {
+        if (pReadTracker != nullptr) {
+            std::lock_guard<std::mutex> lock(pReadTracker->baseMutex);
+            pReadTracker->SetUnsafe();
+            return pBase->GetAllElements(endKey, mapDataOut, expiredKeys);
+        } else if (pBase != nullptr) {
             return pBase->GetAllElements(endKey, mapDataOut, expiredKeys);
         } else if (pDbAccess != nullptr) {
             return pDbAccess->GetAllElements(PREFIX_TYPE, endKey, mapDataOut, expiredKeys);
@@ -796,20 +1171,24 @@ private:
 
     bool GetAllElements(set<KeyType> &expiredKeys, map<KeyType, ValueType> &elements) {
         if (!mapData.empty()) {
-            for (auto iter : mapData) {
-                if (db_util::IsEmpty(iter.second)) {
+            for (const auto &iter : mapData) {
+                if (db_util::IsEmpty(iter.second.value)) {
                     expiredKeys.insert(iter.first);
                 } else if (expiredKeys.count(iter.first) || elements.count(iter.first)) {
                     // TODO: log
                     continue;
                 } else {
                     // Got a valid element.
-                    elements.insert(iter);
+                    elements.emplace(iter.first, iter.second.value);
                 }
             }
         }
 
-        if (pBase != nullptr) {
+        if (pReadTracker != nullptr) {
+            std::lock_guard<std::mutex> lock(pReadTracker->baseMutex);
+            pReadTracker->SetUnsafe();
+            return pBase->GetAllElements(expiredKeys, elements);
+        } else if (pBase != nullptr) {
             return pBase->GetAllElements(expiredKeys, elements);
         } else if (pDbAccess != nullptr) {
             return pDbAccess->GetAllElements(PREFIX_TYPE, expiredKeys, elements);
@@ -834,10 +1213,12 @@ private:
 
     }
 private:
-    mutable CCompositeKVCache<PREFIX_TYPE, KeyType, ValueType> *pBase = nullptr;
+    mutable CCompositeKVCache *pBase = nullptr;
     CDBAccess *pDbAccess = nullptr;
-    mutable map<KeyType, ValueType> mapData;
+    mutable Storage mapData;
+    mutable ReadStorage readData;  // values read from the base caches by the read tracker
     CDBOpLogMap *pDbOpLogMap = nullptr;
+    CDBReadTracker *pReadTracker = nullptr;
     bool is_calc_size = false;
     mutable uint32_t size = 0;
 };
@@ -891,6 +1272,12 @@ public:
         pDbOpLogMap = pDbOpLogMapIn;
     }
 
+    // the single value is not tracked by key, any access of it marks the tracked execution unsafe
+    void SetReadTracker(CDBReadTracker *pReadTrackerIn) {
+        assert(pBase != nullptr);
+        pReadTracker = pReadTrackerIn;
+    }
+
     uint32_t GetCacheSize() const {
         if (!ptrData) {
             return 0;
@@ -899,6 +1286,10 @@ public:
         return ::GetSerializeSize(*ptrData, SER_DISK, CLIENT_VERSION);
     }
 
+    size_t GetCacheItemCount() const {
+        return ptrData ? 1 : 0;
+    }
+
     bool GetData(ValueType &value) const {
         auto ptr = GetDataPtr();
         if (ptr && !db_util::IsEmpty(*ptr)) {
@@ -909,11 +1300,18 @@ public:
     }
 
     bool SetData(const ValueType &value) {
-        if (!ptrData) {
-            ptrData = db_util::MakeEmptyValue<ValueType>();
+        if (pReadTracker != nullptr) {
+            pReadTracker->SetUnsafe();
         }
-        AddOpLog(*ptrData);
-        *ptrData = value;
+        // the old value may be in the base cache, which is shared rather than copied to this cache
+        auto ptr = GetDataPtr();
+        if (ptr) {
+            AddOpLog(*ptr);
+        } else {
+            AddOpLog(*db_util::MakeEmptyValue<ValueType>());
+        }
+        // copy on write, the value may be shared with the base cache
+        ptrData = std::make_shared<ValueType>(value);
         return true;
     }
 
@@ -926,7 +1324,8 @@ public:
         auto ptr = GetDataPtr();
         if (ptr && !db_util::IsEmpty(*ptr)) {
             AddOpLog(*ptr);
-            db_util::SetEmpty(*ptr);
+            // copy on write, the value may be shared with the base cache
+            ptrData = db_util::MakeEmptyValue<ValueType>();
         }
         return true;
     }
@@ -950,6 +1349,10 @@ public:
     }
 
     void UndoData(const CDbOpLog &dbOpLog) {
+        if (dbOpLog.IsLayerErase()) {
+            ptrData = nullptr;
+            return;
+        }
         if (!ptrData) {
             ptrData = db_util::MakeEmptyValue<ValueType>();
         }
@@ -968,16 +1371,19 @@ public:
 
     dbk::PrefixType GetPrefixType() const { return PREFIX_TYPE; }
 
-    std::shared_ptr<ValueType> GetDataPtr() const {
+    /**
+     * Get the value for reading, a value of the base cache is shared instead of being copied to this cache.
+     */
+    std::shared_ptr<const ValueType> GetDataPtr() const {
 
         if (ptrData) {
             return ptrData;
+        } else if (pReadTracker != nullptr) {
+            std::lock_guard<std::mutex> lock(pReadTracker->baseMutex);
+            pReadTracker->SetUnsafe();
+            return pBase->GetDataPtr();
         } else if (pBase != nullptr){
-            auto ptr = pBase->GetDataPtr();
-            if (ptr) {
-                ptrData = std::make_shared<ValueType>(*ptr);
-                return ptrData;
-            }
+            return pBase->GetDataPtr();
         } else if (pDbAccess != NULL) {
             auto ptrDbData = db_util::MakeEmptyValue<ValueType>();
 
@@ -1004,6 +1410,7 @@ private:
     CDBAccess *pDbAccess;
     mutable std::shared_ptr<ValueType> ptrData = nullptr;
     CDBOpLogMap *pDbOpLogMap                   = nullptr;
+    CDBReadTracker *pReadTracker               = nullptr;
 };
 
 #endif  // PERSIST_DB_ACCESS_H
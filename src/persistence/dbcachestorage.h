@@ -0,0 +1,451 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef PERSIST_DB_CACHE_STORAGE_H
+#define PERSIST_DB_CACHE_STORAGE_H
+
+#include "commons/serialize.h"
+#include "config/version.h"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * Storage policies of CCompositeKVCache.
+ *
+ * A storage policy is a template<KeyType, ValueType> container which implements the map-like subset
+ * used by the cache: find/end/begin/emplace/operator[]/clear/empty/size, plus
+ *   void VisitOrdered(visitor)            visit the items in key order until the visitor returns false
+ *   const value_type* FindPrev(bound, fInclusive)
+ *                                         the item of the greatest key less than bound (or equal if fInclusive)
+ *   RangeCursor GetRangeCursor(pBegin, pEnd)
+ *                                         ordered cursor of the items in [*pBegin, *pEnd), nullptr is unbounded,
+ *                                         with Valid()/Item()/Next()/Seek(key)
+ *   static const bool DB_KEY_ORDERED      whether the ordered views are in the order of the serialized db keys
+ *                                         rather than KeyType::operator<
+ * Point lookups and updates are the hot path of every cache layer, range scans are rare.
+ */
+
+/**
+ * Ordered map storage, a std::map of Compare. Ordered views are the container itself.
+ */
+template<typename KeyType, typename ValueType, typename Compare>
+class COrderedMapCacheStorage: public std::map<KeyType, ValueType, Compare> {
+public:
+    typedef std::map<KeyType, ValueType, Compare> OrderedMap;
+
+    typedef typename OrderedMap::value_type value_type;
+    typedef typename OrderedMap::const_iterator const_iterator;
+
+    class RangeCursor {
+    public:
+        RangeCursor(const OrderedMap *pMapIn, const_iterator itIn, const_iterator itEndIn)
+            : pMap(pMapIn), it(itIn), itEnd(itEndIn) {}
+
+        bool Valid() const { return it != itEnd; }
+        const value_type& Item() const { return *it; }
+        void Next() { ++it; }
+
+        // move to the first item not less than key, key must not be less than the begin of range
+        void Seek(const KeyType &key) {
+            it = pMap->lower_bound(key);
+            if (it == pMap->end() || (itEnd != pMap->end() && !pMap->key_comp()(it->first, itEnd->first)))
+                it = itEnd;
+        }
+    private:
+        const OrderedMap *pMap;
+        const_iterator it;
+        const_iterator itEnd;
+    };
+
+    const value_type* FindPrev(const KeyType &bound, bool fInclusive) const {
+        const_iterator it = fInclusive ? this->upper_bound(bound) : this->lower_bound(bound);
+        if (it == this->begin())
+            return nullptr;
+        return &*(--it);
+    }
+
+    template<typename Visitor>
+    void VisitOrdered(Visitor visitor) const {
+        for (const auto &item : *this) {
+            if (!visitor(item))
+                break;
+        }
+    }
+
+    RangeCursor GetRangeCursor(const KeyType *pBegin, const KeyType *pEnd) const {
+        const_iterator itEnd = pEnd ? this->lower_bound(*pEnd) : this->end();
+        if (pBegin && pEnd && !this->key_comp()(*pBegin, *pEnd))
+            return RangeCursor(this, itEnd, itEnd);
+        return RangeCursor(this, pBegin ? this->lower_bound(*pBegin) : this->begin(), itEnd);
+    }
+};
+
+/**
+ * Default storage policy, a std::map of KeyType::operator<.
+ */
+template<typename KeyType, typename ValueType>
+class CMapCacheStorage: public COrderedMapCacheStorage<KeyType, ValueType, std::less<KeyType>> {
+public:
+    static const bool DB_KEY_ORDERED = false;
+};
+
+/**
+ * Compare the keys by their serialized bytes, which is the order of the db keys of a cache
+ */
+template<typename KeyType>
+struct CDbKeyLess {
+    bool operator()(const KeyType &a, const KeyType &b) const {
+        CInlineBufferWriter<64> writerA(SER_DISK, CLIENT_VERSION), writerB(SER_DISK, CLIENT_VERSION);
+        writerA << a;
+        writerB << b;
+        int cmp = memcmp(writerA.data(), writerB.data(), std::min(writerA.size(), writerB.size()));
+        return cmp < 0 || (cmp == 0 && writerA.size() < writerB.size());
+    }
+};
+
+/**
+ * Storage policy of the caches which are scanned by range in db order while the order of KeyType::operator< is not
+ * the db order, e.g. the keys with strings. Every comparison serializes both keys, so it is slower on lookups.
+ */
+template<typename KeyType, typename ValueType>
+class CDbKeyMapCacheStorage: public COrderedMapCacheStorage<KeyType, ValueType, CDbKeyLess<KeyType>> {
+public:
+    static const bool DB_KEY_ORDERED = true;
+};
+
+/**
+ * Serialize stream which hashes the written bytes of a key (64 bits FNV-1a with a final mix)
+ */
+class CCacheKeyHashWriter {
+public:
+    int32_t nType    = SER_DISK;
+    int32_t nVersion = CLIENT_VERSION;
+
+    CCacheKeyHashWriter &write(const char *pch, size_t size) {
+        for (size_t i = 0; i < size; i++) {
+            hash ^= (uint8_t)pch[i];
+            hash *= 0x100000001b3ULL;
+        }
+        return *this;
+    }
+
+    template <typename T>
+    CCacheKeyHashWriter &operator<<(const T &obj) {
+        ::Serialize(*this, obj, nType, nVersion);
+        return *this;
+    }
+
+    uint64_t GetHash() const {
+        uint64_t h = hash;
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb3fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+private:
+    uint64_t hash = 0xcbf29ce484222325ULL;
+};
+
+template<typename KeyType>
+struct CCacheKeyHasher {
+    uint64_t operator()(const KeyType &key) const {
+        CCacheKeyHashWriter writer;
+        writer << key;
+        return writer.GetHash();
+    }
+};
+
+/**
+ * Flat hash storage policy.
+ * The items are allocated in fixed size chunks of an arena and never move until cleared, the index is an
+ * open-addressing table (linear probing) of item numbers, so a lookup is one hash of the serialized key and
+ * a few probes of a contiguous array instead of a pointer-chasing tree walk.
+ * The cache erases a single item only when a key is dropped from a cache layer (an erased value is kept as
+ * the empty value), which is done by backward shift deletion, so the table has no tombstones, and the last item
+ * is moved into the erased one. Ordered views are sorted on demand. KeyType must have operator==.
+ */
+template<typename KeyType, typename ValueType, typename Hasher = CCacheKeyHasher<KeyType>>
+class CFlatHashCacheStorage {
+public:
+    typedef std::pair<const KeyType, ValueType> value_type;
+
+    static const bool DB_KEY_ORDERED = false;
+    static const uint32_t CHUNK_ITEMS = 256;
+    static const uint32_t MAX_RETAINED_CHUNKS = 16;
+    static const uint32_t MIN_SLOTS = 16;
+
+    template<typename ItemType>
+    class IteratorImpl {
+    public:
+        IteratorImpl(): pStorage(nullptr), index(NPOS) {}
+        IteratorImpl(const CFlatHashCacheStorage *pStorageIn, uint32_t indexIn): pStorage(pStorageIn), index(indexIn) {}
+
+        ItemType& operator*() const { return pStorage->At(index); }
+        ItemType* operator->() const { return &pStorage->At(index); }
+
+        IteratorImpl& operator++() {
+            if (++index >= pStorage->count)
+                index = NPOS;
+            return *this;
+        }
+
+        bool operator==(const IteratorImpl &other) const { return index == other.index; }
+        bool operator!=(const IteratorImpl &other) const { return index != other.index; }
+    private:
+        static const uint32_t NPOS = UINT32_MAX;
+        const CFlatHashCacheStorage *pStorage;
+        uint32_t index;
+    };
+
+    typedef IteratorImpl<value_type> iterator;
+    typedef IteratorImpl<const value_type> const_iterator;
+
+public:
+    CFlatHashCacheStorage() {}
+
+    CFlatHashCacheStorage(const CFlatHashCacheStorage &other) { *this = other; }
+
+    CFlatHashCacheStorage& operator=(const CFlatHashCacheStorage &other) {
+        if (this != &other) {
+            clear();
+            Reserve(other.count);
+            for (uint32_t i = 0; i < other.count; i++) {
+                const value_type &item = other.At(i);
+                emplace(item.first, item.second);
+            }
+        }
+        return *this;
+    }
+
+    ~CFlatHashCacheStorage() { clear(); }
+
+    iterator begin() { return count > 0 ? iterator(this, 0) : end(); }
+    iterator end() { return iterator(); }
+    const_iterator begin() const { return count > 0 ? const_iterator(this, 0) : end(); }
+    const_iterator end() const { return const_iterator(); }
+
+    bool empty() const { return count == 0; }
+    size_t size() const { return count; }
+
+    iterator find(const KeyType &key) {
+        if (count == 0)
+            return end();
+        uint64_t hash = Hasher()(key);
+        for (uint32_t pos = hash & mask; slots[pos].index != 0; pos = (pos + 1) & mask) {
+            const Slot &slot = slots[pos];
+            if (slot.hash == (uint32_t)hash && At(slot.index - 1).first == key)
+                return iterator(this, slot.index - 1);
+        }
+        return end();
+    }
+
+    std::pair<iterator, bool> emplace(const KeyType &key, const ValueType &value) {
+        if ((count + 1) * 4 > (uint64_t)slots.size() * 3)
+            Rehash(std::max<size_t>(MIN_SLOTS, slots.size() * 2));
+
+        uint64_t hash = Hasher()(key);
+        uint32_t pos = hash & mask;
+        for (; slots[pos].index != 0; pos = (pos + 1) & mask) {
+            const Slot &slot = slots[pos];
+            if (slot.hash == (uint32_t)hash && At(slot.index - 1).first == key)
+                return std::make_pair(iterator(this, slot.index - 1), false);
+        }
+
+        uint32_t index = count;
+        if (index / CHUNK_ITEMS >= chunks.size())
+            chunks.emplace_back(new Chunk);
+        new (&At(index)) value_type(key, value);
+        count++;
+        slots[pos] = {(uint32_t)hash, index + 1};
+        return std::make_pair(iterator(this, index), true);
+    }
+
+    size_t erase(const KeyType &key) {
+        if (count == 0)
+            return 0;
+        uint64_t hash = Hasher()(key);
+        uint32_t pos = hash & mask;
+        for (; slots[pos].index != 0; pos = (pos + 1) & mask) {
+            const Slot &slot = slots[pos];
+            if (slot.hash == (uint32_t)hash && At(slot.index - 1).first == key)
+                break;
+        }
+        if (slots[pos].index == 0)
+            return 0;
+
+        uint32_t index = slots[pos].index - 1;
+        RemoveSlot(pos);
+
+        uint32_t last = count - 1;
+        if (index != last) {
+            Slot &lastSlot = FindSlot(last);
+            At(index).~value_type();
+            new (&At(index)) value_type(std::move(At(last)));
+            lastSlot.index = index + 1;
+        }
+        At(last).~value_type();
+        count--;
+        return 1;
+    }
+
+    ValueType& operator[](const KeyType &key) {
+        iterator it = find(key);
+        if (it == end())
+            it = emplace(key, ValueType()).first;
+        return it->second;
+    }
+
+    void clear() {
+        for (uint32_t i = 0; i < count; i++)
+            At(i).~value_type();
+        count = 0;
+        if (chunks.size() > MAX_RETAINED_CHUNKS)
+            chunks.resize(MAX_RETAINED_CHUNKS);
+        if (slots.size() > MIN_SLOTS * CHUNK_ITEMS) {
+            std::vector<Slot>().swap(slots);
+            mask = 0;
+        } else {
+            std::fill(slots.begin(), slots.end(), Slot());
+        }
+    }
+
+    // one pass over the storage without sorting
+    const value_type* FindPrev(const KeyType &bound, bool fInclusive) const {
+        const value_type *pPrev = nullptr;
+        for (uint32_t i = 0; i < count; i++) {
+            const value_type &item = At(i);
+            bool fBelow = fInclusive ? !(bound < item.first) : item.first < bound;
+            if (fBelow && (pPrev == nullptr || pPrev->first < item.first))
+                pPrev = &item;
+        }
+        return pPrev;
+    }
+
+    template<typename Visitor>
+    void VisitOrdered(Visitor visitor) const {
+        std::vector<const value_type*> items;
+        items.reserve(count);
+        for (uint32_t i = 0; i < count; i++)
+            items.push_back(&At(i));
+        std::sort(items.begin(), items.end(), [](const value_type *a, const value_type *b) {
+            return a->first < b->first;
+        });
+        for (auto pItem : items) {
+            if (!visitor(*pItem))
+                break;
+        }
+    }
+
+    class RangeCursor {
+    public:
+        explicit RangeCursor(std::vector<const value_type*> &&itemsIn) : items(std::move(itemsIn)) {}
+
+        bool Valid() const { return pos < items.size(); }
+        const value_type& Item() const { return *items[pos]; }
+        void Next() { ++pos; }
+
+        // move to the first item not less than key, key must not be less than the begin of range
+        void Seek(const KeyType &key) {
+            pos = std::lower_bound(items.begin(), items.end(), key, [](const value_type *a, const KeyType &b) {
+                return a->first < b;
+            }) - items.begin();
+        }
+    private:
+        std::vector<const value_type*> items; // the items in range, sorted by key
+        size_t pos = 0;
+    };
+
+    /**
+     * the items in range are sorted on creation, the cost is one pass over the storage plus sorting the result
+     */
+    RangeCursor GetRangeCursor(const KeyType *pBegin, const KeyType *pEnd) const {
+        std::vector<const value_type*> items;
+        for (uint32_t i = 0; i < count; i++) {
+            const value_type &item = At(i);
+            if ((pBegin && item.first < *pBegin) || (pEnd && !(item.first < *pEnd)))
+                continue;
+            items.push_back(&item);
+        }
+        std::sort(items.begin(), items.end(), [](const value_type *a, const value_type *b) {
+            return a->first < b->first;
+        });
+        return RangeCursor(std::move(items));
+    }
+
+private:
+    struct Slot {
+        uint32_t hash  = 0; // low 32 bits of the key hash
+        uint32_t index = 0; // item number + 1, 0 is empty
+    };
+
+    struct Chunk {
+        typename std::aligned_storage<sizeof(value_type), alignof(value_type)>::type items[CHUNK_ITEMS];
+    };
+
+    value_type& At(uint32_t index) const {
+        return *reinterpret_cast<value_type*>(&chunks[index / CHUNK_ITEMS]->items[index % CHUNK_ITEMS]);
+    }
+
+    // the slot of the item, which must exist
+    Slot& FindSlot(uint32_t index) {
+        uint32_t pos = Hasher()(At(index).first) & mask;
+        while (slots[pos].index != index + 1)
+            pos = (pos + 1) & mask;
+        return slots[pos];
+    }
+
+    // shift the following slots of the probe sequence back into the removed one, instead of a tombstone
+    void RemoveSlot(uint32_t hole) {
+        for (uint32_t pos = (hole + 1) & mask; slots[pos].index != 0; pos = (pos + 1) & mask) {
+            uint32_t home = slots[pos].hash & mask;
+            if (((pos - home) & mask) >= ((pos - hole) & mask)) {
+                slots[hole] = slots[pos];
+                hole = pos;
+            }
+        }
+        slots[hole] = Slot();
+    }
+
+    void Reserve(size_t itemCount) {
+        size_t slotCount = MIN_SLOTS;
+        while (itemCount * 4 > slotCount * 3)
+            slotCount *= 2;
+        if (slotCount > slots.size())
+            Rehash(slotCount);
+    }
+
+    void Rehash(size_t slotCount) {
+        std::vector<Slot> newSlots(slotCount);
+        uint32_t newMask = slotCount - 1;
+        for (const Slot &slot : slots) {
+            if (slot.index == 0)
+                continue;
+            uint32_t pos = slot.hash & newMask;
+            while (newSlots[pos].index != 0)
+                pos = (pos + 1) & newMask;
+            newSlots[pos] = slot;
+        }
+        slots.swap(newSlots);
+        mask = newMask;
+    }
+
+private:
+    std::vector<std::unique_ptr<Chunk>> chunks;
+    std::vector<Slot> slots;
+    uint32_t mask  = 0;
+    uint32_t count = 0;
+};
+
+#endif  // PERSIST_DB_CACHE_STORAGE_H
@@ -8,35 +8,46 @@
 
 #include <leveldb/slice.h>
 #include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 
 #include "config/version.h"
 #include "commons/serialize.h"
+#include "commons/leb128.h"
+#include "commons/uint256.h"
+
+class CRegIDKey;
 
 typedef leveldb::Slice Slice;
 
-#define DEF_DB_NAME_ENUM(enumType, enumName, cacheSize) enumType,
-#define DEF_DB_NAME_ARRAY(enumType, enumName, cacheSize) enumName,
-#define DEF_CACHE_SIZE_ARRAY(enumType, enumName, cacheSize) cacheSize,
+#define DEF_DB_NAME_ENUM(enumType, enumName, ...) enumType,
+#define DEF_DB_NAME_ARRAY(enumType, enumName, ...) enumName,
+#define DEF_DB_TUNING_ARRAY(enumType, enumName, cacheShare, bloomBits, writeBuffer, compression, maxOpenFiles) \
+    { cacheShare, bloomBits, writeBuffer, compression, maxOpenFiles },
 
-//         DBNameType            DBName             DBCacheSize           description
-//         ----------           --------------    --------------     ----------------------------
+// CacheShare: percent of the -dbblockcache budget for a private block cache of the db, 0 to use the common one
+// BloomBits: bits per key of the bloom filter, 0 to disable it
+//
+//         DBNameType            DBName        CacheShare BloomBits WriteBuffer  Compress MaxOpenFiles  description
+//         ----------           -----------    ---------- --------- ------------ -------- ------------  -----------
 #define DB_NAME_LIST(DEFINE) \
-    DEFINE( SYSPARAM,           "params",         (50  << 10) )      /* system params */ \
-    DEFINE( ACCOUNT,            "accounts",       (50  << 20) )      /* accounts & account assets */ \
-    DEFINE( ASSET,              "assets",         (100 << 10) )     /* asset registry */ \
-    DEFINE( BLOCK,              "blocks",         (500 << 10) )     /* block & tx indexes */ \
-    DEFINE( CONTRACT,           "contracts",      (50  << 20) )      /* contract */ \
-    DEFINE( DELEGATE,           "delegates",      (100 << 10) )     /* delegates */ \
-    DEFINE( CDP,                "cdps",           (50  << 20) )      /* cdp */ \
-    DEFINE( CLOSEDCDP,          "closedcdps",     (1   << 20) )      /* closed cdp */ \
-    DEFINE( DEX,                "dexes",          (50  << 20) )      /* dex */ \
-    DEFINE( LOG,                "logs",           (100 << 10) )     /* log */ \
-    DEFINE( RECEIPT,            "receipts",       (100 << 10) )     /* tx receipt */ \
-    DEFINE( UTXO,               "utxo",           (50  << 20) )     /* tx receipt */ \
-    DEFINE( SYSGOVERN,          "governs",        (100 << 10) )           \
+    DEFINE( SYSPARAM,           "params",       0,       10,      (1  << 20),  false,   16 )  /* system params */ \
+    DEFINE( ACCOUNT,            "accounts",     20,      10,      (8  << 20),  false,   128)  /* accounts & account assets */ \
+    DEFINE( ASSET,              "assets",       0,       10,      (1  << 20),  false,   16 )  /* asset registry */ \
+    DEFINE( BLOCK,              "blocks",       5,       10,      (4  << 20),  false,   64 )  /* block & tx indexes */ \
+    DEFINE( CONTRACT,           "contracts",    20,      10,      (8  << 20),  false,   128)  /* contract */ \
+    DEFINE( DELEGATE,           "delegates",    0,       10,      (1  << 20),  false,   16 )  /* delegates */ \
+    DEFINE( CDP,                "cdps",         15,      10,      (8  << 20),  false,   64 )  /* cdp */ \
+    DEFINE( CLOSEDCDP,          "closedcdps",   0,       10,      (2  << 20),  true,    32 )  /* closed cdp */ \
+    DEFINE( DEX,                "dexes",        15,      10,      (8  << 20),  false,   64 )  /* dex */ \
+    DEFINE( LOG,                "logs",         0,       10,      (2  << 20),  true,    32 )  /* log */ \
+    DEFINE( RECEIPT,            "receipts",     0,       10,      (2  << 20),  true,    32 )  /* tx receipt */ \
+    DEFINE( UTXO,               "utxo",         10,      10,      (4  << 20),  false,   64 )  /* utxo */ \
+    DEFINE( SYSGOVERN,          "governs",      0,       10,      (1  << 20),  false,   16 )  \
     /*                                                                  */  \
     /* Add new Enum elements above, DB_NAME_COUNT Must be the last one */ \
-    DEFINE( DB_NAME_COUNT,        "",               0)                  /* enum count, must be the last one */
+    DEFINE( DB_NAME_COUNT,        "",           0,       0,       0,           false,   0  )  /* enum count, must be the last one */
 
 enum DBNameType {
     DB_NAME_LIST(DEF_DB_NAME_ENUM)
@@ -45,8 +56,13 @@ enum DBNameType {
 
 #define DB_NAME_NONE DB_NAME_COUNT
 
-static const int32_t DBCacheSize[DBNameType::DB_NAME_COUNT + 1] {
-    DB_NAME_LIST(DEF_CACHE_SIZE_ARRAY)
+// LevelDB options of one db
+struct CDBTuningProfile {
+    uint32_t block_cache_share;  // percent of the block cache budget, 0: the common block cache
+    uint32_t bloom_bits;         // bloom filter bits per key, 0: no bloom filter
+    uint32_t write_buffer_size;  // bytes, up to two write buffers may be held in memory simultaneously
+    bool     compression;        // snappy compression of the table blocks
+    int32_t  max_open_files;
 };
 
 static const std::string kDbNames[DBNameType::DB_NAME_COUNT + 1] {
@@ -58,6 +74,28 @@ inline const std::string& GetDbName(DBNameType dbNameType) {
     return kDbNames[dbNameType];
 }
 
+inline bool GetDbNameEnumByName(const std::string &dbName, DBNameType &dbNameType) {
+    for (int32_t i = 0; i < DBNameType::DB_NAME_COUNT; i++) {
+        if (kDbNames[i] == dbName) {
+            dbNameType = (DBNameType)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Tuning profile of the db, defaults are the DB_NAME_LIST columns and can be overridden by -dbtune
+ * before the dbs are opened.
+ */
+inline CDBTuningProfile& GetDbTuningProfile(DBNameType dbNameType) {
+    static CDBTuningProfile profiles[DBNameType::DB_NAME_COUNT + 1] {
+        DB_NAME_LIST(DEF_DB_TUNING_ARRAY)
+    };
+    assert(dbNameType >= 0 && dbNameType < DBNameType::DB_NAME_COUNT);
+    return profiles[dbNameType];
+}
+
 namespace dbk {
 
 
@@ -89,6 +127,7 @@ namespace dbk {
         DEFINE( FLAG,                 "flag",   BLOCK )         /* [prefix] --> $Flag = 1 | 0 */ \
         DEFINE( BEST_BLOCKHASH,       "bbkh",   BLOCK )         /* [prefix] --> $BestBlockHash */ \
         DEFINE( TXID_DISKINDEX,       "tidx",   BLOCK )         /* tidx{$txid} --> $DiskTxPos */ \
+        DEFINE( FLUSH_MARKER,         "fmkr",   BLOCK )         /* [prefix] --> $FlushSeq, written after all dbs flushed */ \
         /**** account db                                                                      */ \
         DEFINE( REGID_KEYID,          "rkey",   ACCOUNT )       /* rkey{$RegID} --> $KeyId */ \
         DEFINE( NICKID_KEYID,         "nkey",   ACCOUNT )       /* nkey{$NickID} --> $KeyId */ \
@@ -127,8 +166,15 @@ namespace dbk {
         DEFINE( TX_RECEIPT,           "txrc",   RECEIPT )       /* [prefix]{txid} --> {receipts} */ \
         /**** tx coinutxo db                                                                    */ \
         DEFINE( TX_UTXO,              "utxo",   UTXO )          /* [prefix]{txid} --> {receipts} */ \
+        /**** contract db                                                               */ \
+        DEFINE( CONTRACT_CODE_HASH,   "cchs",   CONTRACT )      /* [prefix]{$ContractRegId} --> hash of contract code */ \
+        /**** block db                                                                          */ \
+        DEFINE( FLUSH_BEGIN,          "fbgn",   BLOCK )         /* [prefix] --> $FlushSeq, written before any db flushed */ \
+        /**** contract db                                                               */ \
+        DEFINE( CONTRACT_CODE_HASH_FILLED, "cchf", CONTRACT )   /* [prefix] --> 1, the code hashes of all contracts are saved */ \
         /*                                                                             */ \
         /* Add new Enum elements above, PREFIX_COUNT Must be the last one              */ \
+        /* The enum values are written in the undo data, only append new elements      */ \
         DEFINE( PREFIX_COUNT,         "",       DB_NAME_NONE)   /* enum count, must be the last one */
 
 
@@ -180,14 +226,22 @@ namespace dbk {
         return EMPTY;
     };
 
+    // encoder of db keys, the keys of fixed size types (CKeyID, CRegID, uint256 ...) are encoded on the stack
+    typedef CInlineBufferWriter<64> CDbKeyWriter;
+
     template<typename KeyElement>
-    std::string GenDbKey(PrefixType keyPrefixType, const KeyElement &keyElement) {
-        CDataStream ssKeyTemp(SER_DISK, CLIENT_VERSION);
+    void EncodeDbKey(PrefixType keyPrefixType, const KeyElement &keyElement, CDbKeyWriter &keyWriter) {
         assert(keyPrefixType != EMPTY);
         const string &prefix = GetKeyPrefix(keyPrefixType);
-        ssKeyTemp.write(prefix.c_str(), prefix.size()); // write buffer only, exclude size prefix
-        ssKeyTemp << keyElement;
-        return std::string(ssKeyTemp.begin(), ssKeyTemp.end());
+        keyWriter.write(prefix.c_str(), prefix.size()); // write buffer only, exclude size prefix
+        keyWriter << keyElement;
+    }
+
+    template<typename KeyElement>
+    std::string GenDbKey(PrefixType keyPrefixType, const KeyElement &keyElement) {
+        CDbKeyWriter keyWriter(SER_DISK, CLIENT_VERSION);
+        EncodeDbKey(keyPrefixType, keyElement, keyWriter);
+        return keyWriter.str();
     }
 
     template<typename KeyElement>
@@ -198,9 +252,8 @@ namespace dbk {
             return false;
         }
 
-        CDataStream ssKeyTemp(slice.data(), slice.data() + slice.size(), SER_DISK, CLIENT_VERSION);
-        ssKeyTemp.ignore(prefix.size());
-        ssKeyTemp >> keyElement;
+        CBufferReader keyReader(slice.data() + prefix.size(), slice.data() + slice.size(), SER_DISK, CLIENT_VERSION);
+        keyReader >> keyElement;
 
         return true;
     }
@@ -237,11 +290,13 @@ namespace dbk {
             return key.size();
         }
 
-        void Serialize(CDataStream &s, int nType, int nVersion) const {
+        template<typename Stream>
+        void Serialize(Stream &s, int nType, int nVersion) const {
             s.write(key.data(), key.size());
         }
 
-        void Unserialize(CDataStream &s, int nType, int nVersion) {
+        template<typename Stream>
+        void Unserialize(Stream &s, int nType, int nVersion) {
             if (s.size() > MAX_KEY_SIZE) {
                 throw ios_base::failure("CDBTailKey::Unserialize size excceded max size");
             }
@@ -267,6 +322,50 @@ namespace dbk {
         }
 
     };
+
+    // CDbKeyOrder
+    // whether the order of KeyType::operator< is the order of the serialized db keys (IS_DB_ORDER), and whether no
+    // serialized key is a proper prefix of another one (IS_PREFIX_FREE), so that the key can be followed by others.
+    // e.g. a string is serialized with its length first, so it is not in db order
+    template<typename KeyType, typename Enable = void>
+    struct CDbKeyOrder {
+        static const bool IS_DB_ORDER    = false;
+        static const bool IS_PREFIX_FREE = false;
+    };
+
+    // the fixed size keys which are compared as their serialized bytes
+    struct CFixedDbKeyOrder {
+        static const bool IS_DB_ORDER    = true;
+        static const bool IS_PREFIX_FREE = true;
+    };
+
+    template<> struct CDbKeyOrder<uint8_t>: public CFixedDbKeyOrder {};
+    template<> struct CDbKeyOrder<uint256>: public CFixedDbKeyOrder {};
+    template<> struct CDbKeyOrder<CRegIDKey>: public CFixedDbKeyOrder {};
+
+    // big-endian in 7 bits groups, only the unsigned ints keep the order
+    template<typename I, typename UnsignedInt>
+    struct CDbKeyOrder<CFixedLeb128<I, UnsignedInt>, typename std::enable_if<std::is_unsigned<I>::value>::type>
+        : public CFixedDbKeyOrder {};
+
+    template<uint32_t __MAX_KEY_SIZE>
+    struct CDbKeyOrder<CDBTailKey<__MAX_KEY_SIZE>> {
+        static const bool IS_DB_ORDER    = true;
+        static const bool IS_PREFIX_FREE = false;
+    };
+
+    template<typename T0, typename T1>
+    struct CDbKeyOrder<std::pair<T0, T1>> {
+        static const bool IS_DB_ORDER    = CDbKeyOrder<T0>::IS_DB_ORDER && CDbKeyOrder<T0>::IS_PREFIX_FREE &&
+                                           CDbKeyOrder<T1>::IS_DB_ORDER;
+        static const bool IS_PREFIX_FREE = CDbKeyOrder<T0>::IS_PREFIX_FREE && CDbKeyOrder<T1>::IS_PREFIX_FREE;
+    };
+
+    template<typename T0>
+    struct CDbKeyOrder<std::tuple<T0>>: public CDbKeyOrder<T0> {};
+
+    template<typename T0, typename T1, typename... Ts>
+    struct CDbKeyOrder<std::tuple<T0, T1, Ts...>>: public CDbKeyOrder<std::pair<T0, std::tuple<T1, Ts...>>> {};
 }
 
 class SliceIterator {
@@ -0,0 +1,79 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "dbflusher.h"
+
+#include "commons/util/util.h"
+
+CDBFlusher::CDBFlusher(CDBAccess *pMarkerDbIn, uint32_t maxPending, ErrorHandler onErrorIn)
+    : pMarkerDb(pMarkerDbIn), onError(onErrorIn), tasks(std::max<uint32_t>(maxPending, 1)) {
+    assert(pMarkerDb != nullptr);
+    flushThread = std::thread(&CDBFlusher::FlushThread, this);
+}
+
+CDBFlusher::~CDBFlusher() {
+    WaitForFlushed();
+    stopped = true;
+    if (flushThread.joinable())
+        flushThread.join();
+}
+
+void CDBFlusher::Push(CDBFlushTask &&task) {
+    pendingCount++;
+    int64_t beginTime = GetTimeMicros();
+    tasks.Push(std::move(task));
+    int64_t elapsed = GetTimeMicros() - beginTime;
+    if (elapsed > 1000)
+        LogPrint(BCLog::LDB, "db flusher is busy, pushing task waited %.2fms, pending=%u\n", elapsed * 0.001,
+                 (uint32_t)pendingCount);
+}
+
+void CDBFlusher::WaitForFlushed() {
+    std::unique_lock<std::mutex> lock(mtx);
+    flushedCond.wait(lock, [this] { return pendingCount == 0; });
+}
+
+void CDBFlusher::FlushThread() {
+    RenameThread("coin-dbflush");
+
+    while (!stopped) {
+        CDBFlushTask task;
+        if (!tasks.Pop(&task))
+            continue;
+
+        WriteTask(task);
+
+        std::lock_guard<std::mutex> lock(mtx);
+        pendingCount--;
+        flushedCond.notify_all();
+    }
+}
+
+void CDBFlusher::WriteTask(const CDBFlushTask &task) {
+    if (failed) {
+        task.DropBatches();
+        return;
+    }
+
+    int64_t beginTime   = GetTimeMicros();
+    uint64_t totalBytes = 0;
+    try {
+        for (const auto &item : task.batches) {
+            WriteBatch(item.first, item.second);
+            totalBytes += item.second->GetDataSize();
+        }
+        // the commit marker, written only after every db of the task has been written.
+        pMarkerDb->WriteData(dbk::FLUSH_MARKER, task.flush_seq, true);
+    } catch (std::exception &e) {
+        failed = true;
+        task.DropBatches();
+        LogPrint(BCLog::ERROR, "write flush task failed! seq=%llu, error: %s\n", task.flush_seq, e.what());
+        if (onError)
+            onError(strprintf("write flush task failed, seq=%llu, error: %s", task.flush_seq, e.what()));
+        return;
+    }
+
+    LogPrint(BCLog::LDB, "async flushed: seq=%llu, dbs=%u, bytes=%llu, time=%.2fms\n", task.flush_seq,
+             task.batches.size(), totalBytes, (GetTimeMicros() - beginTime) * 0.001);
+}
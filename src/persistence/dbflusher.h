@@ -0,0 +1,79 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef PERSIST_DBFLUSHER_H
+#define PERSIST_DBFLUSHER_H
+
+#include "dbaccess.h"
+#include "commons/messagequeue.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A frozen snapshot of the caches, which is the detached flush batches of dbs
+struct CDBFlushTask {
+    uint64_t flush_seq = 0;
+    std::vector<std::pair<CDBAccess*, std::shared_ptr<CLevelDBBatch>>> batches;
+
+    // drop the batches not written yet from the pending batches of dbs
+    void DropBatches() const {
+        for (const auto &item : batches)
+            item.first->DropPendingBatch(item.second);
+    }
+};
+
+/**
+ * Write the flush tasks to dbs in a background thread, the tasks are written in push order.
+ * Until a task has been written, its batches are read as the pending overlay of dbs.
+ */
+class CDBFlusher {
+public:
+    typedef std::function<void(const std::string &)> ErrorHandler;
+
+    /**
+     * pMarkerDbIn: the db to write the flush marker after each task has been written.
+     * maxPending: max count of the tasks waiting in queue, pushing more will block the caller.
+     * onErrorIn: called in the flusher thread when a task failed to be written, e.g. to stop the node.
+     * Once a task has failed, it and all of the later tasks are dropped without writing.
+     */
+    CDBFlusher(CDBAccess *pMarkerDbIn, uint32_t maxPending, ErrorHandler onErrorIn = nullptr);
+    virtual ~CDBFlusher();
+
+    // push a task, blocked while the queue is full
+    void Push(CDBFlushTask &&task);
+
+    // wait until all of the pushed tasks have been written
+    void WaitForFlushed();
+
+    uint32_t GetPendingCount() const { return pendingCount; }
+
+    bool HasFailed() const { return failed; }
+
+protected:
+    // write a batch of the task to its db, overridden by the tests to inject write errors
+    virtual void WriteBatch(CDBAccess *pDbAccess, const std::shared_ptr<CLevelDBBatch> &pBatch) {
+        pDbAccess->WritePendingBatch(pBatch);
+    }
+
+private:
+    void FlushThread();
+    void WriteTask(const CDBFlushTask &task);
+
+private:
+    CDBAccess *pMarkerDb;
+    ErrorHandler onError;
+    MsgQueue<CDBFlushTask> tasks;
+    std::mutex mtx;
+    std::condition_variable flushedCond;
+    std::atomic<uint32_t> pendingCount{0}; // count of the tasks pushed but not written
+    std::atomic<bool> stopped{false};
+    std::atomic<bool> failed{false};
+    std::thread flushThread;
+};
+
+#endif  // PERSIST_DBFLUSHER_H
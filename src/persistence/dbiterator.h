@@ -96,8 +96,8 @@ private:
         }
 
         try {
-            CDataStream ssValue(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
-            ssValue >> *this->sp_value;
+            CBufferReader valueReader(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
+            valueReader >> *this->sp_value;
         } catch(std::exception &e) {
             throw runtime_error(strprintf("CDBAccessIterator::ProcessData db value error! %s", HexStr(slValue.ToString())));
         }
@@ -113,35 +113,39 @@ public:
     typedef CDBBaseIterator<CacheType> Base;
     typedef typename CacheType::KeyType KeyType;
     typedef typename CacheType::ValueType ValueType;
+    typedef typename CacheType::Storage::RangeCursor RangeCursor;
 private:
-    typename CacheType::Iterator map_it;
+    // every seek gets a new cursor of the layer, which is independent of the other iterators
+    RangeCursor cursor;
 public:
-    CCacheMapIterator(CacheType &dbCache) : Base(dbCache), map_it(dbCache.GetMapData().end()) {}
+    CCacheMapIterator(CacheType &dbCache) : Base(dbCache), cursor(dbCache.GetStorage().GetRangeCursor(nullptr, nullptr)) {}
 
     virtual bool First() {
-        map_it = this->db_cache.GetMapData().begin();
+        cursor = this->db_cache.GetStorage().GetRangeCursor(nullptr, nullptr);
         return ProcessData();
     }
 
     bool SeekUpper(const KeyType *pKey) {
         if (pKey == nullptr || db_util::IsEmpty(*pKey))
             return First();
-        map_it = this->db_cache.GetMapData().upper_bound(*pKey);
+        cursor = this->db_cache.GetStorage().GetRangeCursor(pKey, nullptr);
+        if (cursor.Valid() && !(*pKey < cursor.Item().first))
+            cursor.Next();
         return ProcessData();
     }
 
     bool Next() {
         assert(this->IsValid());
-        map_it++;
+        cursor.Next();
         return ProcessData();
     }
 
 private:
     inline bool ProcessData() {
         this->is_valid = false;
-        if (map_it == this->db_cache.GetMapData().end())  return false;
-        *this->sp_key = map_it->first;
-        *this->sp_value = map_it->second;
+        if (!cursor.Valid())  return false;
+        *this->sp_key = cursor.Item().first;
+        *this->sp_value = cursor.Item().second.value;
         this->is_valid = true;
         return true;
     }
@@ -308,6 +312,309 @@ protected:
     shared_ptr<IteratorImpl> sp_it_Impl;
 };
 
+/**
+ * Ordered iterator of the items in [begin, end] of a cache, merged lazily from all of the cache layers and db.
+ * The items are in the order of their db keys. When the storage of the layers is in db key order, or the order of
+ * KeyType::operator< is the db order (see dbk::CDbKeyOrder), every layer is positioned by its range cursor and only the
+ * visited items are serialized. Otherwise, e.g. a string key on the default storage, which is serialized with its
+ * length first, the items in range of every layer are sorted by their db keys once in First().
+ * db is positioned by Seek. The newer layer overrides the older ones and the erased items (empty values) are skipped,
+ * a db value is only decoded when it is not overridden by a cache layer.
+ * The caches must not be modified while iterating.
+ */
+template<typename CacheType>
+class CDBRangeIterator {
+public:
+    typedef typename CacheType::KeyType KeyType;
+    typedef typename CacheType::ValueType ValueType;
+    typedef typename CacheType::Storage::value_type CacheItem;
+
+private:
+    static const bool LAYER_SEEKABLE = CacheType::Storage::DB_KEY_ORDERED || dbk::CDbKeyOrder<KeyType>::IS_DB_ORDER;
+
+    // the items in range of a cache layer in the order of their db keys
+    class CLayerCursor {
+    public:
+        typedef pair<string, const CacheItem*> Item;
+        typedef typename CacheType::Storage::RangeCursor RangeCursor;
+
+        // the range cursor of a layer in db key order, from begin to the end db key (included)
+        CLayerCursor(const typename CacheType::Storage &storage, const KeyType *pBegin, const string *pEndDbKeyIn)
+            : p_range(make_shared<RangeCursor>(storage.GetRangeCursor(pBegin, nullptr))), p_end_db_key(pEndDbKeyIn) {
+            LoadRangeItem();
+        }
+
+        // the items in range of a layer, sorted by their db keys
+        explicit CLayerCursor(vector<Item> &&itemsIn) : items(std::move(itemsIn)) {}
+
+        bool Valid() const { return p_range ? range_valid : pos < items.size(); }
+        const string& DbKey() const { return p_range ? range_db_key : items[pos].first; }
+        const CacheItem& Get() const { return p_range ? p_range->Item() : *items[pos].second; }
+
+        void Next() {
+            if (p_range) {
+                p_range->Next();
+                LoadRangeItem();
+            } else {
+                ++pos;
+            }
+        }
+
+        // move to the first item of which the db key is not less than dbKey, the db key of key
+        void Seek(const KeyType &key, const string &dbKey) {
+            if (p_range) {
+                p_range->Seek(key);
+                LoadRangeItem();
+                return;
+            }
+            pos = std::lower_bound(items.begin(), items.end(), dbKey, [](const Item &a, const string &b) {
+                return a.first < b;
+            }) - items.begin();
+        }
+    private:
+        // only the db key of the current item is generated
+        void LoadRangeItem() {
+            range_valid = p_range->Valid();
+            if (range_valid) {
+                range_db_key = dbk::GenDbKey(CacheType::PREFIX_TYPE, p_range->Item().first);
+                range_valid  = p_end_db_key == nullptr || range_db_key <= *p_end_db_key;
+            }
+        }
+
+        shared_ptr<RangeCursor> p_range;
+        const string *p_end_db_key = nullptr;
+        string range_db_key;
+        bool range_valid = false;
+
+        vector<Item> items;
+        size_t pos = 0;
+    };
+
+public:
+    // nullptr of begin or end is unbounded, the end is included
+    CDBRangeIterator(CacheType &cache, const KeyType *pBeginIn = nullptr, const KeyType *pEndIn = nullptr)
+        : prefix(dbk::GetKeyPrefix(CacheType::PREFIX_TYPE)),
+          p_begin_key(pBeginIn ? make_shared<KeyType>(*pBeginIn) : nullptr),
+          begin_db_key(pBeginIn ? dbk::GenDbKey(CacheType::PREFIX_TYPE, *pBeginIn) : prefix),
+          end_db_key(pEndIn ? make_shared<string>(dbk::GenDbKey(CacheType::PREFIX_TYPE, *pEndIn)) : nullptr) {
+        CacheType *pCache = &cache;
+        for (; pCache != nullptr; pCache = pCache->GetBasePtr())
+            caches.push_back(pCache);
+
+        CDBAccess *pDbAccess = cache.GetDbAccessPtr();
+        assert(pDbAccess != nullptr);
+        p_db_it = pDbAccess->NewIterator();
+    }
+
+    bool First() {
+        cursors.clear();
+        for (auto pCache : caches)
+            cursors.push_back(MakeLayerCursor(*pCache));
+
+        p_db_it->Seek(begin_db_key);
+        CheckDbKey();
+        return FindCurrent();
+    }
+
+    // move to the first item of which the db key is not less than the db key of key
+    bool Seek(const KeyType &key) {
+        string dbKey = dbk::GenDbKey(CacheType::PREFIX_TYPE, key);
+        if (cursors.empty() || dbKey < begin_db_key)
+            First();
+        if (dbKey < begin_db_key)
+            return is_valid;
+
+        for (auto &cursor : cursors)
+            cursor.Seek(key, dbKey);
+        p_db_it->Seek(dbKey);
+        CheckDbKey();
+        return FindCurrent();
+    }
+
+    bool Next() {
+        assert(is_valid);
+        SkipCurrent();
+        return FindCurrent();
+    }
+
+    bool IsValid() const { return is_valid; }
+
+    // the count of the keys visited, the erased ones skipped included
+    uint32_t GetSteps() const { return steps; }
+
+    const KeyType& GetKey() const {
+        assert(is_valid);
+        return *p_key;
+    }
+
+    const ValueType& GetValue() const {
+        assert(is_valid);
+        return *p_value;
+    }
+
+private:
+    bool InRange(const leveldb::Slice &dbKey) const {
+        return dbKey.starts_with(prefix) && dbKey.compare(begin_db_key) >= 0 &&
+               (!end_db_key || dbKey.compare(*end_db_key) <= 0);
+    }
+
+    CLayerCursor MakeLayerCursor(const CacheType &cache) const {
+        if (LAYER_SEEKABLE)
+            return CLayerCursor(cache.GetStorage(), p_begin_key.get(), end_db_key.get());
+
+        vector<typename CLayerCursor::Item> items;
+        for (const auto &item : cache.GetStorage()) {
+            string dbKey = dbk::GenDbKey(CacheType::PREFIX_TYPE, item.first);
+            if (InRange(dbKey))
+                items.emplace_back(std::move(dbKey), &item);
+        }
+        std::sort(items.begin(), items.end(), [](const typename CLayerCursor::Item &a,
+                                                 const typename CLayerCursor::Item &b) {
+            return a.first < b.first;
+        });
+        return CLayerCursor(std::move(items));
+    }
+
+    void CheckDbKey() {
+        db_valid = p_db_it->Valid() && InRange(p_db_it->key());
+    }
+
+    void ParseDbItem() {
+        const leveldb::Slice &slKey = p_db_it->key();
+        if (!dbk::ParseDbKey(slKey, CacheType::PREFIX_TYPE, db_key))
+            throw runtime_error(strprintf("CDBRangeIterator db key error! key=%s", HexStr(slKey.ToString())));
+
+        const leveldb::Slice &slValue = p_db_it->value();
+        try {
+            CBufferReader valueReader(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
+            valueReader >> db_value;
+        } catch(std::exception &e) {
+            throw runtime_error(strprintf("CDBRangeIterator db value error! %s", HexStr(slValue.ToString())));
+        }
+    }
+
+    // find the least db key of all layers, the newest layer of the key wins
+    bool FindCurrent() {
+        while (true) {
+            const CLayerCursor *pCursor = nullptr;
+            for (const auto &cursor : cursors) {
+                if (cursor.Valid() && (pCursor == nullptr || cursor.DbKey() < pCursor->DbKey()))
+                    pCursor = &cursor;
+            }
+            p_key = nullptr;
+            p_value = nullptr;
+            if (db_valid && (pCursor == nullptr || p_db_it->key().compare(pCursor->DbKey()) < 0)) {
+                ParseDbItem();
+                cur_db_key = p_db_it->key().ToString();
+                p_key   = &db_key;
+                p_value = &db_value;
+            } else if (pCursor != nullptr) {
+                cur_db_key = pCursor->DbKey();
+                p_key   = &pCursor->Get().first;
+                p_value = &pCursor->Get().second.value;
+            }
+
+            is_valid = p_key != nullptr;
+            if (is_valid)
+                steps++;
+            if (!is_valid || !db_util::IsEmpty(*p_value))
+                return is_valid;
+            SkipCurrent(); // erased
+        }
+    }
+
+    // move all of the layers and db which are at the current key to the next key
+    void SkipCurrent() {
+        for (auto &cursor : cursors) {
+            if (cursor.Valid() && cursor.DbKey() == cur_db_key)
+                cursor.Next();
+        }
+        if (db_valid && p_db_it->key() == leveldb::Slice(cur_db_key)) {
+            p_db_it->Next();
+            CheckDbKey();
+        }
+    }
+
+private:
+    const string &prefix;
+    shared_ptr<KeyType> p_begin_key;
+    string begin_db_key;
+    shared_ptr<string> end_db_key;
+    vector<CacheType*> caches;        // from new to old
+    vector<CLayerCursor> cursors;     // cursors of caches
+    shared_ptr<leveldb::Iterator> p_db_it;
+    bool db_valid = false;
+    KeyType db_key;
+    ValueType db_value;
+    string cur_db_key;
+    const KeyType *p_key = nullptr;
+    const ValueType *p_value = nullptr;
+    bool is_valid = false;
+    uint32_t steps = 0;
+};
+
+/**
+ * Find the greatest key in [begin, upper) of a cache which is not erased, merged from all of the cache layers and db,
+ * upper itself is included if fIncludeUpper. Every layer and db are positioned before the bound, the greatest of them
+ * is checked by HaveData(), an erased one becomes the new bound, so the cost is proportional to the erased keys skipped.
+ * The count of the candidates checked is added to *pSteps if it is not nullptr.
+ * The layers are positioned by KeyType::operator<, so the order of KeyType must be the order of the db keys, as the
+ * keys of fixed size elements with a CDBTailKey at last.
+ */
+template<typename CacheType>
+bool FindPrevKey(CacheType &cache, const typename CacheType::KeyType &begin, const typename CacheType::KeyType &upper,
+                 bool fIncludeUpper, typename CacheType::KeyType &prevKey, uint32_t *pSteps = nullptr) {
+    typedef typename CacheType::KeyType KeyType;
+
+    CDBAccess *pDbAccess = cache.GetDbAccessPtr();
+    assert(pDbAccess != nullptr);
+    shared_ptr<leveldb::Iterator> pDbIt = pDbAccess->NewIterator();
+    const string &prefix = dbk::GetKeyPrefix(CacheType::PREFIX_TYPE);
+
+    KeyType bound = upper;
+    bool fIncludeBound = fIncludeUpper;
+    while (true) {
+        bool found = false;
+        KeyType candidate;
+        for (CacheType *pCache = &cache; pCache != nullptr; pCache = pCache->GetBasePtr()) {
+            auto pItem = pCache->GetStorage().FindPrev(bound, fIncludeBound);
+            if (pItem != nullptr && !(pItem->first < begin) && (!found || candidate < pItem->first)) {
+                candidate = pItem->first;
+                found = true;
+            }
+        }
+
+        string boundDbKey = dbk::GenDbKey(CacheType::PREFIX_TYPE, bound);
+        pDbIt->Seek(boundDbKey);
+        if (!pDbIt->Valid())
+            pDbIt->SeekToLast();
+        else if (!fIncludeBound || pDbIt->key() != leveldb::Slice(boundDbKey))
+            pDbIt->Prev();
+        if (pDbIt->Valid() && pDbIt->key().starts_with(prefix)) {
+            KeyType dbKey;
+            if (!dbk::ParseDbKey(pDbIt->key(), CacheType::PREFIX_TYPE, dbKey))
+                throw runtime_error(strprintf("FindPrevKey db key error! key=%s", HexStr(pDbIt->key().ToString())));
+            if (!(dbKey < begin) && (!found || candidate < dbKey)) {
+                candidate = dbKey;
+                found = true;
+            }
+        }
+
+        if (!found)
+            return false;
+
+        if (pSteps != nullptr)
+            (*pSteps)++;
+        if (cache.HaveData(candidate)) {
+            prevKey = candidate;
+            return true;
+        }
+        // erased
+        bound = candidate;
+        fIncludeBound = false;
+    }
+}
+
 struct CommonPrefixMatcher {
     // empty prefix, will match all keys
     template<typename KeyType>
@@ -7,6 +7,7 @@
 #include "entities/account.h"
 #include "entities/asset.h"
 #include "main.h"
+#include "persistence/dbiterator.h"
 #include <optional>
 #include <functional>
 
@@ -66,168 +67,30 @@ shared_ptr<string> DEX_DB::MakeLastPos(const DEXBlockOrdersCache::KeyType &lastK
 ///////////////////////////////////////////////////////////////////////////////
 // class CDEXOrdersGetter
 
-class CDexOrderIt {
-public:
-    DEXBlockOrdersCache::KeyType key;
-    DEXBlockOrdersCache::ValueType value;
-    bool is_valid;
-protected:
-    DEXBlockOrdersCache &db_cache;
-    CFixedUInt32 begin_height;
-    CFixedUInt32 end_height;
-public:
-    CDexOrderIt(DEXBlockOrdersCache &dbCache, const CFixedUInt32 &beginHeight, const CFixedUInt32 &endHeight)
-        : key(),
-          value(),
-          is_valid(false),
-          db_cache(dbCache),
-          begin_height(beginHeight),
-          end_height(endHeight){}
-};
-
-class CDBDexOrderIt: public CDexOrderIt {
-private:
-    shared_ptr<leveldb::Iterator> p_db_it;
-    string last_pos_key;
-    string prefix;
-public:
-    using CDexOrderIt::CDexOrderIt;
-
-    bool First(DEXBlockOrdersCache::KeyType lastPosKey) {
-        p_db_it = db_cache.GetDbAccessPtr()->NewIterator();
-        prefix = dbk::GetKeyPrefix(DEXBlockOrdersCache::PREFIX_TYPE);
-        last_pos_key = dbk::GenDbKey(DEXBlockOrdersCache::PREFIX_TYPE, lastPosKey);
-        p_db_it->Seek(last_pos_key);
-        if (p_db_it->Valid() && p_db_it->key() == last_pos_key) {
-            p_db_it->Next();
-        }
-        return Parse();
-    }
-
-    bool First() {
-        return First(make_tuple(begin_height, 0, uint256()));
-    }
-
-    bool Next() {
-        p_db_it->Next();
-        return Parse();
-    }
-
-    bool IsValid() {return is_valid;}
-private:
-    inline bool Parse() {
-        is_valid = false;
-        if (!p_db_it->Valid() || !p_db_it->key().starts_with(prefix)) return false;
-
-        const leveldb::Slice &slKey = p_db_it->key();
-        const leveldb::Slice &slValue = p_db_it->value();
-        if (!ParseDbKey(slKey, DEXBlockOrdersCache::PREFIX_TYPE, key)) {
-            throw runtime_error(strprintf("CDBDexOrderIt::Parse db key error! key=%s", HexStr(slKey.ToString())));
-        }
-
-        const CFixedUInt32 &curHeight = std::get<0>(key);
-        if ( curHeight < begin_height || curHeight > end_height)
-            return false;
-
-        try {
-            CDataStream ssValue(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
-            ssValue >> value;
-        } catch(std::exception &e) {
-            throw runtime_error(strprintf("CDBDexOrderIt::Parse db value error! %s", HexStr(slValue.ToString())));
-        }
-        is_valid = true;
-        return true;
-    }
-};
-
-class CMapDexOrderIt: public CDexOrderIt {
-private:
-    DEXBlockOrdersCache::Iterator map_it;
-public:
-    using CDexOrderIt::CDexOrderIt;
-
-    bool First(DEXBlockOrdersCache::KeyType lastPosKey) {
-        map_it = db_cache.GetMapData().upper_bound(lastPosKey);
-        return Parse();
-    }
-
-    bool First() {
-        return First(make_tuple(begin_height, 0, uint256()));
-    }
-
-    bool Next() {
-        map_it++;
-        return Parse();
-    }
-
-    bool IsValid() {return is_valid;}
-private:
-    inline bool Parse() {
-        is_valid = false;
-        if (map_it == db_cache.GetMapData().end())  return false;
-        key = map_it->first;
-        const CFixedUInt32 &curHeight = std::get<0>(key);
-        if ( curHeight < begin_height || curHeight > end_height)
-            return false;
-        value = map_it->second;
-        return true;
-    }
-};
+// the greatest order id, the last one of the block orders of a height and generate type
+static const uint256 MAX_ORDER_ID = uint256S(string(64, 'f'));
 
 bool CDEXOrdersGetter::Execute(uint32_t beginHeightIn, uint32_t endHeightIn, uint32_t maxCount, const DEXBlockOrdersCache::KeyType &lastKey) {
 
     assert(orders.size() == 0 && "Can only execute 1 times");
-    CFixedUInt32 beginHeight(beginHeightIn);
-    CFixedUInt32 endHeight(endHeightIn);
-    CMapDexOrderIt mapIt(db_cache, beginHeight, endHeight);
-    CDBDexOrderIt dbIt(db_cache, beginHeight, endHeight);
+    DEXBlockOrdersCache::KeyType beginKey(CFixedUInt32(beginHeightIn), 0, uint256());
+    DEXBlockOrdersCache::KeyType endKey(CFixedUInt32(endHeightIn), UINT8_MAX, MAX_ORDER_ID);
+    CDBRangeIterator<DEXBlockOrdersCache> dbIt(db_cache, &beginKey, &endKey);
 
     if (!db_util::IsEmpty(lastKey)) {
-        mapIt.First(lastKey);
-        dbIt.First(lastKey);
+        // continue after the last key
+        if (dbIt.Seek(lastKey) && dbIt.GetKey() == lastKey)
+            dbIt.Next();
     } else {
-        mapIt.First();
         dbIt.First();
     }
-    //auto mapIt = mapRangePair.first;
-    while(mapIt.IsValid() || dbIt.IsValid()) {
-        bool isMapData = true, isSameKey = false;
-        if (mapIt.IsValid() && dbIt.IsValid()) {
-            if (dbIt.key < mapIt.key) {
-                isMapData = false;
-            } else if (dbIt.key > mapIt.key) { // dbIt.key >= mapIt.key
-                isMapData = true;
-            } else {// dbIt.key == mapIt.key
-                isMapData = true;
-                isSameKey = true;
-            }
-        } else if (mapIt.IsValid()) {
-            isMapData = true;
-        } else { // dbIt.IsValid())
-            isMapData = false;
-        }
 
-        shared_ptr<DEX_DB::BlockOrdersItem> pItem = nullptr;
-        if (isMapData) {
-            if (!mapIt.value.IsEmpty()) {
-                pItem = make_shared<DEX_DB::BlockOrdersItem>(mapIt.key, mapIt.value);
-            } // else ignore
-            mapIt.Next();
-            if (isSameKey) {
-                assert(dbIt.IsValid());
-                dbIt.Next();
-            }
-        } else { // use db
-            pItem = make_shared<DEX_DB::BlockOrdersItem>(dbIt.key, dbIt.value);
-            dbIt.Next();
-        }
-        if (pItem != nullptr) {
-            if (maxCount != 0 && orders.size() >= maxCount) {
-                has_more = true;
-                break;
-            }
-            orders.push_back(*pItem);
+    for (; dbIt.IsValid(); dbIt.Next()) {
+        if (maxCount != 0 && orders.size() >= maxCount) {
+            has_more = true;
+            break;
         }
+        orders.push_back(make_pair(dbIt.GetKey(), dbIt.GetValue()));
     }
     if (!orders.empty()) {
         begin_height = DEX_DB::GetHeight(orders.front().first);
@@ -244,130 +107,14 @@ void CDEXOrdersGetter::ToJson(Object &obj) {
 ///////////////////////////////////////////////////////////////////////////////
 // class CDEXSysOrdersGetter
 
-//CDBDexSysOrderIt
-class CDBDexSysOrderIt {
-public:
-    DEXBlockOrdersCache::KeyType key;
-    DEXBlockOrdersCache::ValueType value;
-private:
-    shared_ptr<leveldb::Iterator> p_db_it;
-    CFixedUInt32 height;
-    bool is_valid;
-    string prefix;
-public:
-    CDBDexSysOrderIt(CDBAccess &dbAccess, const CFixedUInt32 &heightIn)
-        : key(), value(), height(heightIn), is_valid(false) {
-
-        p_db_it = dbAccess.NewIterator();
-        prefix = dbk::GenDbKey(DEXBlockOrdersCache::PREFIX_TYPE, make_pair(height, (uint8_t)SYSTEM_GEN_ORDER));
-    }
-
-    bool First() {
-        p_db_it->Seek(prefix);
-        return Parse();
-    }
-
-    bool Next() {
-        p_db_it->Next();
-        return Parse();
-    }
-
-    bool IsValid() {return is_valid;}
-private:
-    inline bool Parse() {
-        is_valid = false;
-        if (!p_db_it->Valid() || !p_db_it->key().starts_with(prefix)) return false;
-
-        const leveldb::Slice &slKey = p_db_it->key();
-        const leveldb::Slice &slValue = p_db_it->value();
-        if (!ParseDbKey(slKey, DEXBlockOrdersCache::PREFIX_TYPE, key)) {
-            throw runtime_error(strprintf("CDBDexSysOrderIt::Parse db key error! key=%s", HexStr(slKey.ToString())));
-        }
-        assert(std::get<0>(key) == height || DEX_DB::GetGenerateType(key) == (uint8_t)SYSTEM_GEN_ORDER);
-
-        try {
-            CDataStream ssValue(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
-            ssValue >> value;
-        } catch(std::exception &e) {
-            throw runtime_error(strprintf("CDBDexSysOrderIt::Parse db value error! %s", HexStr(slValue.ToString())));
-        }
-        is_valid = true;
-        return true;
-    }
-};
-
-class CMapDexSysOrderIt {
-public:
-    DEXBlockOrdersCache::KeyType key;
-    DEXBlockOrdersCache::ValueType value;
-private:
-    DEXBlockOrdersCache::Map &data_map;
-    DEXBlockOrdersCache::Iterator map_it;
-    CFixedUInt32 height;
-    bool is_valid;
-public:
-    CMapDexSysOrderIt(DEXBlockOrdersCache &dbCache, const CFixedUInt32 &heightIn)
-        : key(), value(), data_map(dbCache.GetMapData()), map_it(data_map.end()), height(heightIn), is_valid(false) {}
-
-    bool First() {
-        map_it = data_map.upper_bound(make_tuple(height, (uint8_t)SYSTEM_GEN_ORDER, uint256()));
-        return Parse();
-    }
-    bool Next() {
-        map_it++;
-        return Parse();
-    }
-
-    bool IsValid() {return is_valid;}
-private:
-    inline bool Parse() {
-        is_valid = false;
-        if (map_it == data_map.end())  return false;
-        key = map_it->first;
-        if (std::get<0>(key) != height || DEX_DB::GetGenerateType(key) != SYSTEM_GEN_ORDER)
-            return false;
-        value = map_it->second;
-        return true;
-    }
-};
-
 bool CDEXSysOrdersGetter::Execute(uint32_t heightIn) {
 
     CFixedUInt32 height(heightIn);
-    CMapDexSysOrderIt mapIt(db_cache, height);
-    CDBDexSysOrderIt dbIt(db_access, height);
-    mapIt.First();
-    dbIt.First();
-    //auto mapIt = mapRangePair.first;
-    while(mapIt.IsValid() || dbIt.IsValid()) {
-        bool isMapData = true, isSameKey = false;
-        if (mapIt.IsValid() && dbIt.IsValid()) {
-            if (dbIt.key < mapIt.key) {
-                isMapData = false;
-            } else if (dbIt.key > mapIt.key) { // dbIt.key >= mapIt.key
-                isMapData = true;
-            } else {// dbIt.key == mapIt.key
-                isMapData = true;
-                isSameKey = true;
-            }
-        } else if (mapIt.IsValid()) {
-            isMapData = true;
-        } else { // dbIt.IsValid())
-            isMapData = false;
-        }
-
-        if (isMapData) {
-            if (!mapIt.value.IsEmpty()) {
-                orders.push_back(make_pair(mapIt.key, mapIt.value));
-            } // else ignore
-            mapIt.Next();
-            if (isSameKey) {
-                dbIt.Next();
-            }
-        } else { // use db
-            orders.push_back(make_pair(dbIt.key, dbIt.value));
-            dbIt.Next();
-        }
+    DEXBlockOrdersCache::KeyType beginKey(height, (uint8_t)SYSTEM_GEN_ORDER, uint256());
+    DEXBlockOrdersCache::KeyType endKey(height, (uint8_t)SYSTEM_GEN_ORDER, MAX_ORDER_ID);
+    CDBRangeIterator<DEXBlockOrdersCache> dbIt(db_cache, &beginKey, &endKey);
+    for (dbIt.First(); dbIt.IsValid(); dbIt.Next()) {
+        orders.push_back(make_pair(dbIt.GetKey(), dbIt.GetValue()));
     }
 
     return true;
@@ -152,6 +152,15 @@ public:
         operator_trade_pair_cache.SetDbOpLogMap(pDbOpLogMapIn);
     }
 
+    void SetReadTracker(CDBReadTracker *pReadTrackerIn) {
+        activeOrderCache.SetReadTracker(pReadTrackerIn);
+        blockOrdersCache.SetReadTracker(pReadTrackerIn);
+        operator_detail_cache.SetReadTracker(pReadTrackerIn);
+        operator_owner_map_cache.SetReadTracker(pReadTrackerIn);
+        operator_last_id_cache.SetReadTracker(pReadTrackerIn);
+        operator_trade_pair_cache.SetReadTracker(pReadTrackerIn);
+    }
+
     void RegisterUndoFunc(UndoDataFuncMap &undoDataFuncMap) {
         activeOrderCache.RegisterUndoFunc(undoDataFuncMap);
         blockOrdersCache.RegisterUndoFunc(undoDataFuncMap);
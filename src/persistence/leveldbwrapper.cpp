@@ -6,12 +6,14 @@
 #include "leveldbwrapper.h"
 
 #include "commons/util/util.h"
+#include "config/const.h"
 
 #include <leveldb/cache.h>
 #include <leveldb/env.h>
 #include <leveldb/filter_policy.h>
 #include <memenv.h>
 #include <boost/filesystem.hpp>
+#include <mutex>
 #include "commons/json/json_spirit_value.h"
 
 void ThrowError(const leveldb::Status &status) {
@@ -40,23 +42,214 @@ std::string CDBOpLogMap::ToString() const {
     return str;
 }
 
-static leveldb::Options GetOptions(size_t nCacheSize) {
-    leveldb::Options options;
-    options.block_cache       = leveldb::NewLRUCache(nCacheSize / 2);
+CLevelDBOverlayIterator::CLevelDBOverlayIterator(leveldb::Iterator *pDbItIn,
+                                                 const vector<std::shared_ptr<CLevelDBBatch>> &layersIn)
+    : pDbIt(pDbItIn), layers(layersIn) {
+    assert(pDbIt != nullptr);
+    for (const auto &pLayer : layers) {
+        assert(pLayer->GetRecords() != nullptr);
+        cursors.push_back(pLayer->GetRecords()->end());
+    }
+}
+
+CLevelDBOverlayIterator::~CLevelDBOverlayIterator() {
+    delete pDbIt;
+    pDbIt = nullptr;
+}
+
+void CLevelDBOverlayIterator::SeekToFirst() {
+    pDbIt->SeekToFirst();
+    for (size_t i = 0; i < layers.size(); i++)
+        cursors[i] = layers[i]->GetRecords()->begin();
+    backward = false;
+    FindCurrent();
+}
+
+void CLevelDBOverlayIterator::SeekToLast() {
+    pDbIt->SeekToLast();
+    for (size_t i = 0; i < layers.size(); i++) {
+        const auto *pRecords = layers[i]->GetRecords();
+        cursors[i] = pRecords->empty() ? pRecords->end() : std::prev(pRecords->end());
+    }
+    backward = true;
+    FindCurrentBackward();
+}
+
+void CLevelDBOverlayIterator::Seek(const leveldb::Slice &target) {
+    pDbIt->Seek(target);
+    for (size_t i = 0; i < layers.size(); i++)
+        cursors[i] = layers[i]->GetRecords()->lower_bound(target.ToString());
+    backward = false;
+    FindCurrent();
+}
+
+void CLevelDBOverlayIterator::Next() {
+    assert(valid);
+    if (backward) {
+        // the db and layers are before the current key, move them to the current key first
+        const string curKey = key().ToString();
+        Seek(curKey);
+        if (!valid || key() != leveldb::Slice(curKey))
+            return;
+    }
+    SkipCurrentKey();
+    FindCurrent();
+}
+
+void CLevelDBOverlayIterator::Prev() {
+    assert(valid);
+    PositionBefore(key().ToString());
+    backward = true;
+    FindCurrentBackward();
+}
+
+leveldb::Slice CLevelDBOverlayIterator::key() const {
+    assert(valid);
+    if (current < 0)
+        return pDbIt->key();
+    return leveldb::Slice(cursors[current]->first);
+}
+
+leveldb::Slice CLevelDBOverlayIterator::value() const {
+    assert(valid);
+    if (current < 0)
+        return pDbIt->value();
+    return leveldb::Slice(*cursors[current]->second);
+}
+
+// point current to the smallest key of db and layers, the newest layer wins if same key,
+// the erased keys are skipped
+void CLevelDBOverlayIterator::FindCurrent() {
+    while (true) {
+        valid   = pDbIt->Valid();
+        current = -1;
+        for (int32_t i = 0; i < (int32_t)layers.size(); i++) {
+            if (cursors[i] == layers[i]->GetRecords()->end())
+                continue;
+            if (!valid || leveldb::Slice(cursors[i]->first).compare(key()) <= 0) {
+                valid   = true;
+                current = i;
+            }
+        }
+        if (!valid || current < 0 || cursors[current]->second)
+            return;
+        // the key has been erased in the newest layer
+        SkipCurrentKey();
+    }
+}
+
+// point current to the greatest key of db and layers, the newest layer wins if same key,
+// the erased keys are skipped
+void CLevelDBOverlayIterator::FindCurrentBackward() {
+    while (true) {
+        valid   = pDbIt->Valid();
+        current = -1;
+        for (int32_t i = 0; i < (int32_t)layers.size(); i++) {
+            if (cursors[i] == layers[i]->GetRecords()->end())
+                continue;
+            if (!valid || leveldb::Slice(cursors[i]->first).compare(key()) >= 0) {
+                valid   = true;
+                current = i;
+            }
+        }
+        if (!valid || current < 0 || cursors[current]->second)
+            return;
+        // the key has been erased in the newest layer
+        PositionBefore(key().ToString());
+    }
+}
+
+// move db and layers to their greatest keys less than target, end() of a layer is none
+void CLevelDBOverlayIterator::PositionBefore(const string &target) {
+    pDbIt->Seek(target);
+    if (pDbIt->Valid())
+        pDbIt->Prev();
+    else
+        pDbIt->SeekToLast();
+    for (size_t i = 0; i < layers.size(); i++) {
+        const auto *pRecords = layers[i]->GetRecords();
+        auto it = pRecords->lower_bound(target);
+        cursors[i] = (it == pRecords->begin()) ? pRecords->end() : std::prev(it);
+    }
+}
+
+void CLevelDBOverlayIterator::SkipCurrentKey() {
+    const string curKey = key().ToString();
+    if (pDbIt->Valid() && pDbIt->key() == leveldb::Slice(curKey))
+        pDbIt->Next();
+    for (size_t i = 0; i < layers.size(); i++) {
+        if (cursors[i] != layers[i]->GetRecords()->end() && cursors[i]->first == curKey)
+            cursors[i]++;
+    }
+}
+
+static size_t nDbBlockCacheBudget = DEFAULT_DB_BLOCK_CACHE << 20;
+static std::mutex dbBlockCacheMutex;
+static std::weak_ptr<leveldb::Cache> pCommonBlockCache;
+
+void SetDbBlockCacheBudget(size_t nBytes) {
+    std::lock_guard<std::mutex> lock(dbBlockCacheMutex);
+    nDbBlockCacheBudget = nBytes;
+}
+
+size_t GetDbBlockCacheBudget() {
+    std::lock_guard<std::mutex> lock(dbBlockCacheMutex);
+    return nDbBlockCacheBudget;
+}
+
+size_t GetDbBlockCacheSize(uint32_t sharePercent) {
+    std::lock_guard<std::mutex> lock(dbBlockCacheMutex);
+    if (sharePercent > 0)
+        return nDbBlockCacheBudget / 100 * std::min<uint32_t>(sharePercent, 100);
+
+    // the common cache gets the rest of budget, but no less than 10%
+    uint32_t privateShares = 0;
+    for (int32_t i = 0; i < DBNameType::DB_NAME_COUNT; i++)
+        privateShares += GetDbTuningProfile((DBNameType)i).block_cache_share;
+    return nDbBlockCacheBudget / 100 * std::max<int32_t>(10, 100 - (int32_t)privateShares);
+}
+
+std::shared_ptr<leveldb::Cache> GetDbBlockCache(uint32_t sharePercent) {
+    size_t nCacheSize = GetDbBlockCacheSize(sharePercent);
+    if (sharePercent > 0)
+        return std::shared_ptr<leveldb::Cache>(leveldb::NewLRUCache(nCacheSize));
+
+    std::lock_guard<std::mutex> lock(dbBlockCacheMutex);
+    std::shared_ptr<leveldb::Cache> pCache = pCommonBlockCache.lock();
+    if (!pCache) {
+        pCache.reset(leveldb::NewLRUCache(nCacheSize));
+        pCommonBlockCache = pCache;
+    }
+    return pCache;
+}
+
+CLevelDBWrapper::CLevelDBWrapper(const boost::filesystem::path &path, size_t nCacheSize, bool fMemory, bool fWipe) {
+    pBlockCache.reset(leveldb::NewLRUCache(nCacheSize / 2));
+    options.block_cache       = pBlockCache.get();
     options.write_buffer_size = nCacheSize / 4;  // up to two write buffers may be held in memory simultaneously
     options.filter_policy     = leveldb::NewBloomFilterPolicy(10);
     options.compression       = leveldb::kNoCompression;
     options.max_open_files    = 64;
-    return options;
+    Open(path, fMemory, fWipe);
 }
 
-CLevelDBWrapper::CLevelDBWrapper(const boost::filesystem::path &path, size_t nCacheSize, bool fMemory, bool fWipe) {
+CLevelDBWrapper::CLevelDBWrapper(const boost::filesystem::path &path, const CDBTuningProfile &profile, bool fMemory,
+                                 bool fWipe) {
+    pBlockCache               = GetDbBlockCache(profile.block_cache_share);
+    options.block_cache       = pBlockCache.get();
+    options.write_buffer_size = profile.write_buffer_size;
+    options.filter_policy     = profile.bloom_bits > 0 ? leveldb::NewBloomFilterPolicy(profile.bloom_bits) : nullptr;
+    options.compression       = profile.compression ? leveldb::kSnappyCompression : leveldb::kNoCompression;
+    options.max_open_files    = profile.max_open_files;
+    Open(path, fMemory, fWipe);
+}
+
+void CLevelDBWrapper::Open(const boost::filesystem::path &path, bool fMemory, bool fWipe) {
     penv                         = nullptr;
     readoptions.verify_checksums = true;
     iteroptions.verify_checksums = true;
     iteroptions.fill_cache       = false;
     syncoptions.sync             = true;
-    options                      = GetOptions(nCacheSize);
     options.create_if_missing    = true;
     if (fMemory) {
         penv        = leveldb::NewMemEnv(leveldb::Env::Default());
@@ -79,8 +272,8 @@ CLevelDBWrapper::~CLevelDBWrapper() {
     pdb = nullptr;
     delete options.filter_policy;
     options.filter_policy = nullptr;
-    delete options.block_cache;
     options.block_cache = nullptr;
+    pBlockCache.reset();
     delete penv;
     options.env = nullptr;
 }
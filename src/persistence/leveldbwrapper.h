@@ -16,14 +16,20 @@
 #include <leveldb/db.h>
 #include <leveldb/write_batch.h>
 
+#include <memory>
+#include <optional>
+
 using namespace json_spirit;
 
 class CDbOpLog {
 private:
     string key;
     string value;
+    bool layerErase = false;  // in memory only, never serialized
 public:
     CDbOpLog() {}
+    // from the serialized key and value
+    CDbOpLog(string &&keyIn, string &&valueIn) : key(std::move(keyIn)), value(std::move(valueIn)) {}
 
     // for key-value
     template<typename K, typename V>
@@ -63,6 +69,18 @@ public:
         ssValue >> valueOut;
     }
 
+    /**
+     * Op log without value, the undo of which erases the key from the cache layer, so that the value is read from
+     * the base caches again. It is only built in memory, e.g. by the mempool rescan: the flag is not serialized, so
+     * the op logs read from the undo files are always undone by their values.
+     */
+    void SetLayerErase(const string &keyIn) {
+        key = keyIn;
+        value.clear();
+        layerErase = true;
+    }
+    bool IsLayerErase() const { return layerErase; }
+
     const string& GetKey() const { return key; }
     const string& GetValue() const { return value; }
 
@@ -87,6 +105,7 @@ typedef vector<CDbOpLog> CDbOpLogs;
 class CDBOpLogMap {
 public:
     map<string, CDbOpLogs>& GetMap() { return mapDbOpLogs; }
+    const map<string, CDbOpLogs>& GetMap() const { return mapDbOpLogs; }
 
     const CDbOpLogs* GetDbOpLogsPtr(dbk::PrefixType prefixType) const {
         assert(prefixType != dbk::EMPTY);
@@ -126,11 +145,20 @@ void ThrowError(const leveldb::Status &status);
 // Batch of changes queued to be written to a CLevelDBWrapper
 class CLevelDBBatch {
     friend class CLevelDBWrapper;
+public:
+    // key -> serialized value, nullopt means the key is erased
+    typedef std::map<std::string, std::optional<std::string>> RecordMap;
 
 private:
     leveldb::WriteBatch batch;
+    uint32_t count    = 0; // count of put and delete ops
+    uint64_t dataSize = 0; // total size of keys and values
+    // sorted records of the ops, only kept for the batch which must be readable before it is written
+    std::unique_ptr<RecordMap> pRecords = nullptr;
 
 public:
+    CLevelDBBatch(bool fRecord = false) : pRecords(fRecord ? std::make_unique<RecordMap>() : nullptr) {}
+
     template<typename V>
     void Write(const std::string &key, const V& value) {
     	leveldb::Slice slKey(key);
@@ -139,14 +167,77 @@ public:
         ssValue << value;
         leveldb::Slice slValue(&ssValue[0], ssValue.size());
         batch.Put(slKey, slValue);
+        count++;
+        dataSize += slKey.size() + slValue.size();
+        if (pRecords)
+            (*pRecords)[key] = slValue.ToString();
     }
 
     void Erase(const std::string &key) {
         batch.Delete(key);
+        count++;
+        dataSize += key.size();
+        if (pRecords)
+            (*pRecords)[key] = std::nullopt;
+    }
+
+    void Clear() {
+        batch.Clear();
+        count    = 0;
+        dataSize = 0;
+        if (pRecords)
+            pRecords->clear();
     }
 
+    const RecordMap* GetRecords() const { return pRecords.get(); }
+
+    bool IsEmpty() const { return count == 0; }
+    uint32_t GetCount() const { return count; }
+    uint64_t GetDataSize() const { return dataSize; }
  };
 
+// Iterator of db overlaid by the records of batches which have not been written yet.
+// Every Prev() seeks db and the layers again, the backward iteration is slower than the forward one.
+class CLevelDBOverlayIterator : public leveldb::Iterator {
+public:
+    // the layers are ordered from old to new, the newer layer overrides the older one and the db
+    CLevelDBOverlayIterator(leveldb::Iterator *pDbItIn, const vector<std::shared_ptr<CLevelDBBatch>> &layersIn);
+    ~CLevelDBOverlayIterator();
+
+    bool Valid() const override { return valid; }
+    void SeekToFirst() override;
+    void SeekToLast() override;
+    void Seek(const leveldb::Slice &target) override;
+    void Next() override;
+    void Prev() override;
+    leveldb::Slice key() const override;
+    leveldb::Slice value() const override;
+    leveldb::Status status() const override { return pDbIt->status(); }
+
+private:
+    void FindCurrent();
+    void FindCurrentBackward();
+    void PositionBefore(const string &target);
+    void SkipCurrentKey();
+
+    leveldb::Iterator *pDbIt;
+    vector<std::shared_ptr<CLevelDBBatch>> layers;
+    vector<CLevelDBBatch::RecordMap::const_iterator> cursors;
+    bool valid     = false;
+    bool backward  = false; // db and layers are positioned before the current key
+    int32_t current = -1; // index of the current layer, -1 is db
+};
+
+/**
+ * Block caches of the dbs, carved from one budget (-dbblockcache).
+ * A db with a block cache share gets a private LRU cache of the share of budget, all other dbs use one common
+ * LRU cache of the rest of budget. The budget must be set before any db is opened.
+ */
+void SetDbBlockCacheBudget(size_t nBytes);
+size_t GetDbBlockCacheBudget();
+std::shared_ptr<leveldb::Cache> GetDbBlockCache(uint32_t sharePercent);
+size_t GetDbBlockCacheSize(uint32_t sharePercent);
+
 class CLevelDBWrapper {
 private:
     // custom environment this database is using (may be NULL in case of default environment)
@@ -167,19 +258,30 @@ private:
     // options used when sync writing to the database
     leveldb::WriteOptions syncoptions;
 
+    // block cache of options, may be shared with other databases
+    std::shared_ptr<leveldb::Cache> pBlockCache;
+
     // the database itself
     leveldb::DB *pdb;
 
+    void Open(const boost::filesystem::path &path, bool fMemory, bool fWipe);
+
+    // value buffer of the reads in this thread, its capacity is reused by the next read
+    static string& GetReadBuffer() {
+        static thread_local string readBuffer;
+        return readBuffer;
+    }
+
 public:
     CLevelDBWrapper(const boost::filesystem::path &path, size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+    CLevelDBWrapper(const boost::filesystem::path &path, const CDBTuningProfile &profile, bool fMemory = false,
+                    bool fWipe = false);
     ~CLevelDBWrapper();
 
     template<typename V>
-    bool Read(std::string key, V &value) {
-    	leveldb::Slice slKey(key);
-
-        string strValue;
-        leveldb::Status status = pdb->Get(readoptions, slKey, &strValue);
+    bool Read(const leveldb::Slice &key, V &value) {
+        string &strValue = GetReadBuffer();
+        leveldb::Status status = pdb->Get(readoptions, key, &strValue);
         if (!status.ok()) {
             if (status.IsNotFound())
                 return false;
@@ -187,8 +289,8 @@ public:
             ThrowError(status);
         }
         try {
-            CDataStream ssValue(strValue.data(), strValue.data() + strValue.size(), SER_DISK, CLIENT_VERSION);
-            ssValue >> value;
+            CBufferReader valueReader(strValue.data(), strValue.data() + strValue.size(), SER_DISK, CLIENT_VERSION);
+            valueReader >> value;
         } catch(std::exception &e) {
             return false;
         }
@@ -202,10 +304,8 @@ public:
         return WriteBatch(batch, fSync);
     }
 
-    bool Exists(const std::string &key) {
-    	leveldb::Slice slKey(key);
-        string strValue;
-        leveldb::Status status = pdb->Get(readoptions, slKey, &strValue);
+    bool Exists(const leveldb::Slice &key) {
+        leveldb::Status status = pdb->Get(readoptions, key, &GetReadBuffer());
         if (!status.ok()) {
             if (status.IsNotFound())
                 return false;
@@ -238,6 +338,19 @@ public:
         return pdb->NewIterator(iteroptions);
     }
     int64_t GetDbCount();
+
+    // value of a leveldb property, e.g. "leveldb.stats"
+    bool GetProperty(const string &name, string &value) const {
+        return pdb->GetProperty(name, &value);
+    }
+
+    // approximate file system space used by keys in [begin, end), the data in memtable is not counted
+    uint64_t GetApproximateSize(const string &begin, const string &end) const {
+        leveldb::Range range(begin, end);
+        uint64_t size = 0;
+        pdb->GetApproximateSizes(&range, 1, &size);
+        return size;
+    }
    // Object ToJsonObj();
 };
 
@@ -52,6 +52,12 @@ public:
         secondsCache.SetDbOpLogMap(pDbOpLogMapIn);
     }
 
+    void SetReadTracker(CDBReadTracker *pReadTrackerIn) {
+        governersCache.SetReadTracker(pReadTrackerIn);
+        proposalsCache.SetReadTracker(pReadTrackerIn);
+        secondsCache.SetReadTracker(pReadTrackerIn);
+    }
+
 
     bool CheckIsGoverner(const CRegID &candidateRegId) {
         if (!governersCache.HaveData()) {
@@ -116,6 +116,15 @@ public:
 
     }
 
+    void SetReadTracker(CDBReadTracker *pReadTrackerIn) {
+        sysParamCache.SetReadTracker(pReadTrackerIn);
+        minerFeeCache.SetReadTracker(pReadTrackerIn);
+        cdpParamCache.SetReadTracker(pReadTrackerIn);
+        cdpInterestParamChangesCache.SetReadTracker(pReadTrackerIn);
+        currentBpCountCache.SetReadTracker(pReadTrackerIn);
+        newBpCountCache.SetReadTracker(pReadTrackerIn);
+    }
+
     void RegisterUndoFunc(UndoDataFuncMap &undoDataFuncMap) {
         sysParamCache.RegisterUndoFunc(undoDataFuncMap);
         minerFeeCache.RegisterUndoFunc(undoDataFuncMap);
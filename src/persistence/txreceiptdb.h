@@ -35,6 +35,8 @@ public:
 
     void SetDbOpLogMap(CDBOpLogMap *pDbOpLogMapIn) { txReceiptCache.SetDbOpLogMap(pDbOpLogMapIn); }
 
+    void SetReadTracker(CDBReadTracker *pReadTrackerIn) { txReceiptCache.SetReadTracker(pReadTrackerIn); }
+
     void RegisterUndoFunc(UndoDataFuncMap &undoDataFuncMap) {
         txReceiptCache.RegisterUndoFunc(undoDataFuncMap);
     }
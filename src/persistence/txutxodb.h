@@ -36,6 +36,8 @@ public:
 
     void SetDbOpLogMap(CDBOpLogMap *pDbOpLogMapIn) { txUtxoCache.SetDbOpLogMap(pDbOpLogMapIn); }
 
+    void SetReadTracker(CDBReadTracker *pReadTrackerIn) { txUtxoCache.SetReadTracker(pReadTrackerIn); }
+
     void RegisterUndoFunc(UndoDataFuncMap &undoDataFuncMap) {
         txUtxoCache.RegisterUndoFunc(undoDataFuncMap);
     }
@@ -222,6 +222,7 @@ extern Value jsontobinwasm(const json_spirit::Array& params, bool fHelp);
 extern Value bintojsonwasm(const json_spirit::Array& params, bool fHelp);
 extern Value getcodewasm(const json_spirit::Array& params, bool fHelp);
 extern Value getabiwasm(const json_spirit::Array& params, bool fHelp);
+extern Value getwasmcachestats(const json_spirit::Array& params, bool fHelp);
 extern Value gettxtrace(const json_spirit::Array& params, bool fHelp);
 extern Value abidefjsontobinwasm(const json_spirit::Array& params, bool fHelp);
 
@@ -236,5 +237,10 @@ extern Value getminminerfee(const Array& params, bool fHelp) ;
 
 // debug
 Value dumpdb(const Array& params, bool fHelp);
+Value getdbcachestats(const Array& params, bool fHelp);
+Value getleveldbstats(const Array& params, bool fHelp);
+Value getsigcachestats(const Array& params, bool fHelp);
+Value getblockimportstats(const Array& params, bool fHelp);
+Value getmempoolrescanstats(const Array& params, bool fHelp);
 
 #endif /* RPC_API_H_ */
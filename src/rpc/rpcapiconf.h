@@ -155,6 +155,7 @@ static const CRPCCommand vRPCCommands[] =
     { "bintojsonwasm",                  &bintojsonwasm,                     true,       false,      true    },
     { "getcodewasm",                    &getcodewasm,                       true,       false,      true    },
     { "getabiwasm",                     &getabiwasm,                        true,       false,      true    },
+    { "getwasmcachestats",              &getwasmcachestats,                 true,       false,      true    },
     { "gettxtrace",                     &gettxtrace,                        true,       false,      true    },
     { "abidefjsontobinwasm",            &abidefjsontobinwasm,               true,       false,      true    },
     /* for test code */
@@ -171,6 +172,11 @@ static const CRPCCommand vRPCCommands[] =
 
     /* debug */
     { "dumpdb",                         &dumpdb,                            true,       true,       true    },
+    { "getdbcachestats",                &getdbcachestats,                   true,       false,      false   },
+    { "getleveldbstats",                &getleveldbstats,                   true,       false,      false   },
+    { "getsigcachestats",               &getsigcachestats,                  true,       false,      false   },
+    { "getblockimportstats",            &getblockimportstats,               true,       false,      false   },
+    { "getmempoolrescanstats",          &getmempoolrescanstats,             true,       false,      false   },
 };
 
 #endif //RPC_APICONF_H_
\ No newline at end of file
@@ -454,8 +454,9 @@ void static CommonTxSender() {
         boost::this_thread::interruption_point();
 
         if (generationQueue.get()->Pop(&tx)) {
+            bool fAccepted = ::PreAcceptToMemoryPool(mempool, state, (CBaseTx*)&tx);
             LOCK(cs_main);
-            if (!::AcceptToMemoryPool(mempool, state, (CBaseTx*)&tx, true)) {
+            if (!fAccepted || !::AcceptToMemoryPool(mempool, state, (CBaseTx*)&tx, true, false, true)) {
                 LogPrint(BCLog::ERROR, "CommonTxSender, accept to mempool failed: %s\n", state.GetRejectReason());
                 throw boost::thread_interrupted();
             }
@@ -596,8 +597,9 @@ void static ContractTxGenerator() {
         boost::this_thread::interruption_point();
 
         if (generationContractQueue.get()->Pop(&tx)) {
+            bool fAccepted = ::PreAcceptToMemoryPool(mempool, state, (CBaseTx*)&tx);
             LOCK(cs_main);
-            if (!::AcceptToMemoryPool(mempool, state, (CBaseTx*)&tx, true)) {
+            if (!fAccepted || !::AcceptToMemoryPool(mempool, state, (CBaseTx*)&tx, true, false, true)) {
                 LogPrint(BCLog::ERROR, "ContractTxGenerator, accept to mempool failed: %s\n", state.GetRejectReason());
                 throw boost::thread_interrupted();
             }
@@ -6,6 +6,7 @@
 #include "commons/base58.h"
 #include "init.h"
 #include "main.h"
+#include "blockimport.h"
 #include "net.h"
 #include "netbase.h"
 #include "miner/pbftmanager.h"
@@ -226,6 +227,7 @@ Value verifymessage(const Array& params, bool fHelp) {
     DEFINE( CONTRACT_DATA,        pContractCache,  contractDataCache) \
     DEFINE( CONTRACT_ACCOUNT,     pContractCache,  contractAccountCache) \
     DEFINE( CONTRACT_TRACES,      pContractCache,  contractTracesCache) \
+    DEFINE( CONTRACT_CODE_HASH,   pContractCache,  contractCodeHashCache) \
     /**** delegate db                                                                      */ \
     DEFINE( VOTE,                 pDelegateCache,  voteRegIdCache) \
     DEFINE( LAST_VOTE_HEIGHT,     pDelegateCache,  last_vote_height_cache) \
@@ -257,10 +259,10 @@ Value verifymessage(const Array& params, bool fHelp) {
     DEFINE( TX_UTXO,              pUtxoCache,   txUtxoCache)
 
 
-template<int32_t PREFIX_TYPE, typename KeyType, typename ValueType>
-string DbCacheToString(CCompositeKVCache<PREFIX_TYPE, KeyType, ValueType> &cache) {
+template<int32_t PREFIX_TYPE, typename KeyType, typename ValueType, template<typename, typename> class StorageType>
+string DbCacheToString(CCompositeKVCache<PREFIX_TYPE, KeyType, ValueType, StorageType> &cache) {
     string str;
-    CDBIterator< CCompositeKVCache<PREFIX_TYPE, KeyType, ValueType> > it(cache);
+    CDBIterator< CCompositeKVCache<PREFIX_TYPE, KeyType, ValueType, StorageType> > it(cache);
     for(it.First(); it.IsValid(); it.Next()) {
         str += strprintf("%s={%s},\n", db_util::ToString(it.GetKey()), db_util::ToString(it.GetValue()));
     }
@@ -355,3 +357,256 @@ Value dumpdb(const Array& params, bool fHelp) {
 
     return Object();
 }
+
+template<typename CacheType>
+static Object DbCacheStatsToJson(dbk::PrefixType prefixType, const CacheType &cache) {
+    Object obj;
+    obj.push_back(Pair("prefix",    dbk::GetKeyPrefix(prefixType)));
+    obj.push_back(Pair("memo",      dbk::GetKeyPrefixMemo(prefixType)));
+    obj.push_back(Pair("db",        GetDbName(dbk::GetDbNameEnumByPrefix(prefixType))));
+    obj.push_back(Pair("items",     (uint64_t)cache.GetCacheItemCount()));
+    obj.push_back(Pair("size",      (uint64_t)cache.GetCacheSize()));
+    return obj;
+}
+
+// a cache may be listed by more than one prefix, count it once
+#define DB_CACHE_STATS(prefixType, db, cache) \
+    if (countedCaches.insert(&pCdMan->db->cache).second) { \
+        totalSize += pCdMan->db->cache.GetCacheSize(); \
+        prefixArray.push_back(DbCacheStatsToJson(dbk::prefixType, pCdMan->db->cache)); \
+    }
+
+Value getdbcachestats(const Array& params, bool fHelp) {
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+            "getdbcachestats\n"
+            "\nget the memory used by the chain state caches of every db key prefix\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"cache_limit\": n,     (numeric) the -dbcache limit in bytes, the caches are flushed when exceeded\n"
+            "  \"total_size\": n,      (numeric) serialized size in bytes of all the cached data\n"
+            "  \"prefixes\": [        (array) cached items and serialized size of every key prefix\n"
+            "    { \"prefix\": \"xxx\", \"memo\": \"xxx\", \"db\": \"xxx\", \"items\": n, \"size\": n }, ...\n"
+            "  ]\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getdbcachestats", "") + "\nAs json rpc\n" + HelpExampleRpc("getdbcachestats", "")
+        );
+
+    uint64_t totalSize = 0;
+    Array prefixArray;
+    set<const void*> countedCaches;
+    {
+        LOCK(cs_main);
+        DBK_PREFIX_CACHE_LIST(DB_CACHE_STATS);
+    }
+
+    Object obj;
+    obj.push_back(Pair("cache_limit",   (int64_t)SysCfg().GetCacheSize()));
+    obj.push_back(Pair("total_size",    totalSize));
+    obj.push_back(Pair("prefixes",      prefixArray));
+    return obj;
+}
+
+static Object LevelDbStatsToJson(const CDBAccess &dbAccess) {
+    DBNameType dbNameType = dbAccess.GetDbNameType();
+    const CDBTuningProfile &profile = GetDbTuningProfile(dbNameType);
+    Object profileObj;
+    profileObj.push_back(Pair("block_cache_share",  (uint64_t)profile.block_cache_share));
+    profileObj.push_back(Pair("block_cache_size",   (uint64_t)GetDbBlockCacheSize(profile.block_cache_share)));
+    profileObj.push_back(Pair("bloom_bits",         (uint64_t)profile.bloom_bits));
+    profileObj.push_back(Pair("write_buffer_size",  (uint64_t)profile.write_buffer_size));
+    profileObj.push_back(Pair("compression",        profile.compression));
+    profileObj.push_back(Pair("max_open_files",     profile.max_open_files));
+
+    Array prefixArray;
+    for (int32_t i = dbk::EMPTY + 1; i < dbk::PREFIX_COUNT; i++) {
+        dbk::PrefixType prefixType = (dbk::PrefixType)i;
+        if (dbk::GetDbNameEnumByPrefix(prefixType) != dbNameType)
+            continue;
+        Object prefixObj;
+        prefixObj.push_back(Pair("prefix",  dbk::GetKeyPrefix(prefixType)));
+        prefixObj.push_back(Pair("memo",    dbk::GetKeyPrefixMemo(prefixType)));
+        prefixObj.push_back(Pair("approximate_size", dbAccess.GetApproximateSize(prefixType)));
+        prefixArray.push_back(prefixObj);
+    }
+
+    CDBFlushStats flushStats = dbAccess.GetFlushStats();
+    Object flushObj;
+    flushObj.push_back(Pair("flush_count",      flushStats.flush_count));
+    flushObj.push_back(Pair("total_bytes",      flushStats.total_bytes));
+    flushObj.push_back(Pair("total_time_us",    flushStats.total_time_us));
+
+    string stats;
+    if (!dbAccess.GetProperty("leveldb.stats", stats))
+        stats = "";
+
+    Object obj;
+    obj.push_back(Pair("db",                GetDbName(dbNameType)));
+    obj.push_back(Pair("profile",           profileObj));
+    obj.push_back(Pair("approximate_size",  dbAccess.GetApproximateSize()));
+    obj.push_back(Pair("prefixes",          prefixArray));
+    obj.push_back(Pair("flush",             flushObj));
+    obj.push_back(Pair("leveldb_stats",     stats));
+    return obj;
+}
+
+Value getleveldbstats(const Array& params, bool fHelp) {
+    if (fHelp || params.size() > 1)
+        throw runtime_error(
+            "getleveldbstats [\"db_name\"]\n"
+            "\nget the LevelDB tuning profile, approximate disk sizes and \"leveldb.stats\" of the chain state dbs\n"
+            "\nArguments:\n"
+            "1.\"db_name\":  (string, optional) only get the stats of this db, e.g. \"accounts\"\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"block_cache_budget\": n,   (numeric) the -dbblockcache budget in bytes\n"
+            "  \"dbs\": [                   (array)\n"
+            "    {\n"
+            "      \"db\": \"xxx\",\n"
+            "      \"profile\": { \"block_cache_share\": n, \"block_cache_size\": n, \"bloom_bits\": n,\n"
+            "                   \"write_buffer_size\": n, \"compression\": true|false, \"max_open_files\": n },\n"
+            "      \"approximate_size\": n,  (numeric) approximate disk size in bytes, the memtable is not counted\n"
+            "      \"prefixes\": [ { \"prefix\": \"xxx\", \"memo\": \"xxx\", \"approximate_size\": n }, ... ],\n"
+            "      \"flush\": { \"flush_count\": n, \"total_bytes\": n, \"total_time_us\": n },\n"
+            "      \"leveldb_stats\": \"xxx\"  (string) the compaction stats of every level\n"
+            "    }, ...\n"
+            "  ]\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getleveldbstats", "\"accounts\"") + "\nAs json rpc\n"
+            + HelpExampleRpc("getleveldbstats", "\"accounts\"")
+        );
+
+    DBNameType dbNameType = DBNameType::DB_NAME_NONE;
+    if (params.size() > 0 && !GetDbNameEnumByName(params[0].get_str(), dbNameType))
+        throw JSONRPCError(RPC_INVALID_PARAMS, strprintf("unknown db name: %s", params[0].get_str()));
+
+    Array dbArray;
+    {
+        LOCK(cs_main);
+        for (const CDBAccess *pDbAccess : pCdMan->GetDbAccessList()) {
+            if (dbNameType == DBNameType::DB_NAME_NONE || pDbAccess->GetDbNameType() == dbNameType)
+                dbArray.push_back(LevelDbStatsToJson(*pDbAccess));
+        }
+    }
+
+    Object obj;
+    obj.push_back(Pair("block_cache_budget",    (uint64_t)GetDbBlockCacheBudget()));
+    obj.push_back(Pair("dbs",                   dbArray));
+    return obj;
+}
+
+Value getsigcachestats(const Array& params, bool fHelp) {
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+            "getsigcachestats\n"
+            "\nget the usage and the hit rate of the valid signature cache\n"
+            "\nArguments:\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"entries\": n,      (numeric) the count of the cached signatures\n"
+            "  \"bytes\": n,        (numeric) the memory of the allocated cache tables in bytes\n"
+            "  \"max_bytes\": n,    (numeric) the -sigcachemaxmb budget in bytes\n"
+            "  \"hits\": n,         (numeric) the count of the lookups found in the cache\n"
+            "  \"misses\": n,       (numeric) the count of the lookups not found in the cache\n"
+            "  \"inserts\": n,      (numeric) the count of the signatures added to the cache\n"
+            "  \"evictions\": n     (numeric) the count of the signatures evicted from the full cache\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getsigcachestats", "") + "\nAs json rpc\n"
+            + HelpExampleRpc("getsigcachestats", "")
+        );
+
+    CSigCacheStats stats = signatureCache.GetStats();
+
+    Object obj;
+    obj.push_back(Pair("entries",               stats.entries));
+    obj.push_back(Pair("bytes",                 stats.bytes));
+    obj.push_back(Pair("max_bytes",             stats.maxBytes));
+    obj.push_back(Pair("hits",                  stats.hits));
+    obj.push_back(Pair("misses",                stats.misses));
+    obj.push_back(Pair("inserts",               stats.inserts));
+    obj.push_back(Pair("evictions",             stats.evictions));
+    return obj;
+}
+
+static Object ToStageObject(const CBlockImportStageStats &stats) {
+    uint64_t count  = stats.count;
+    uint64_t micros = stats.micros;
+    Object obj;
+    obj.push_back(Pair("count",                 count));
+    obj.push_back(Pair("failures",              (uint64_t)stats.failures));
+    obj.push_back(Pair("time_ms",               micros / 1000));
+    obj.push_back(Pair("blocks_per_sec",        micros > 0 ? count * 1000000.0 / micros : 0.0));
+    return obj;
+}
+
+Value getblockimportstats(const Array& params, bool fHelp) {
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+            "getblockimportstats\n"
+            "\nget the throughput of the stages of the block import pipeline\n"
+            "\nArguments:\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"decode\": {...},         (object) the stage decoding the blocks read from the block files\n"
+            "  \"check\": {...},          (object) the stage checking the blocks without the chain state\n"
+            "  \"connect\": {             (object) the stage connecting the blocks in order\n"
+            "    \"count\": n,            (numeric) the count of the blocks passed the stage\n"
+            "    \"failures\": n,         (numeric) the count of the blocks failed in the stage\n"
+            "    \"time_ms\": n,          (numeric) the total time spent in the stage\n"
+            "    \"blocks_per_sec\": n    (numeric) the blocks passed per second of the stage time\n"
+            "  },\n"
+            "  \"queued\": n,             (numeric) the count of the blocks in the pipelines now\n"
+            "  \"queue_full_waits\": n,   (numeric) the count of the blocks waiting for a full queue to be submitted\n"
+            "  \"queue_full_drops\": n    (numeric) the count of the received blocks dropped since the queue was full\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getblockimportstats", "") + "\nAs json rpc\n"
+            + HelpExampleRpc("getblockimportstats", "")
+        );
+
+    CBlockImportStats &stats = GetBlockImportStats();
+
+    Object obj;
+    obj.push_back(Pair("decode",                ToStageObject(stats.decode)));
+    obj.push_back(Pair("check",                 ToStageObject(stats.check)));
+    obj.push_back(Pair("connect",               ToStageObject(stats.connect)));
+    obj.push_back(Pair("queued",                (uint64_t)stats.queued));
+    obj.push_back(Pair("queue_full_waits",      (uint64_t)stats.queueFullWaits));
+    obj.push_back(Pair("queue_full_drops",      (uint64_t)stats.queueFullDrops));
+    return obj;
+}
+
+Value getmempoolrescanstats(const Array& params, bool fHelp) {
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+            "getmempoolrescanstats\n"
+            "\nget the stats of re-validating the mempool transactions after the tip has changed\n"
+            "\nArguments:\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"full_rescans\": n,          (numeric) the count of the rescans executing all of the transactions\n"
+            "  \"incremental_rescans\": n,   (numeric) the count of the rescans executing the affected transactions only\n"
+            "  \"executed_txs\": n,          (numeric) the count of the transactions executed again\n"
+            "  \"skipped_txs\": n,           (numeric) the count of the transactions kept without execution\n"
+            "  \"removed_txs\": n,           (numeric) the count of the transactions removed for being invalid\n"
+            "  \"time_ms\": n                (numeric) the total time spent in the rescans\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getmempoolrescanstats", "") + "\nAs json rpc\n"
+            + HelpExampleRpc("getmempoolrescanstats", "")
+        );
+
+    CTxMemPoolRescanStats stats = mempool.GetRescanStats();
+
+    Object obj;
+    obj.push_back(Pair("full_rescans",          stats.fullRescans));
+    obj.push_back(Pair("incremental_rescans",   stats.incrementalRescans));
+    obj.push_back(Pair("executed_txs",          stats.executedTxs));
+    obj.push_back(Pair("skipped_txs",           stats.skippedTxs));
+    obj.push_back(Pair("removed_txs",           stats.removedTxs));
+    obj.push_back(Pair("time_ms",               stats.totalTimeUs / 1000));
+    return obj;
+}
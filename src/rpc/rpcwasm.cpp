@@ -460,6 +460,24 @@ Value getcodewasm( const Array &params, bool fHelp ) {
 
 }
 
+Value getwasmcachestats( const Array &params, bool fHelp ) {
+
+    RESPONSE_RPC_HELP( fHelp || params.size() != 0 , wasm::rpc::get_wasm_cache_stats_rpc_help_message)
+
+    wasm::wasm_cache_stats stats = wasm::wasm_interface::get_cache_stats();
+
+    json_spirit::Object object_return;
+    object_return.push_back(Pair("hits",             stats.hits));
+    object_return.push_back(Pair("misses",           stats.misses));
+    object_return.push_back(Pair("evictions",        stats.evictions));
+    object_return.push_back(Pair("instantiation_ms", stats.instantiation_us / 1000));
+    object_return.push_back(Pair("cached_modules",   stats.cached_modules));
+    object_return.push_back(Pair("cached_bytes",     stats.cached_bytes));
+    object_return.push_back(Pair("max_bytes",        stats.max_bytes));
+    return object_return;
+
+}
+
 Value getabiwasm( const Array &params, bool fHelp ) {
 
     RESPONSE_RPC_HELP( fHelp || params.size() != 1 , wasm::rpc::get_abi_wasm_rpc_help_message)
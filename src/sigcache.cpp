@@ -6,45 +6,236 @@
 
 #include "sigcache.h"
 
-void CSignatureCache::ComputeEntry(uint256& entry, const uint256& sigHash,
-                                   const std::vector<unsigned char>& vchSig,
-                                   const CPubKey& pubKey) {
-    CSHA256()
-        .Write(sigHash.begin(), 32)
-        .Write(&pubKey[0], pubKey.size())
-        .Write(&vchSig[0], vchSig.size())
-        .Finalize(entry.begin());
+#include "config/const.h"
+#include "crypto/siphash.h"
+
+#include <limits>
+
+// count of the lock striped shards
+static const uint32_t SIG_CACHE_SHARDS = 16;
+
+////////////////////////////////////////////////////////////////////////////////
+// class CSignatureCache::CShard
+
+/**
+ * Open addressing table with linear probing, the null entry marks an empty slot. The size of the table is a power
+ * of 2 and at most 3/4 of it is used, the erased entries are removed by backward shifting without tombstones.
+ */
+class CSignatureCache::CShard {
+public:
+    std::mutex mtx;
+    uint64_t inserts   = 0;
+    uint64_t evictions = 0;
+
+    CShard(uint64_t seed) : randState(seed | 1) {}
+
+    void SetMaxBytes(uint64_t nBytes) {
+        std::vector<CEntry>().swap(table);
+        count    = 0;
+        maxBytes = nBytes;
+    }
+
+    uint64_t GetBytes() const { return table.size() * sizeof(CEntry); }
+    uint64_t GetCount() const { return count; }
+
+    bool Contains(const CEntry &entry) const {
+        if (table.empty())
+            return false;
+
+        for (size_t i = entry.h1 & mask; !table[i].IsNull(); i = (i + 1) & mask) {
+            if (table[i] == entry)
+                return true;
+        }
+        return false;
+    }
+
+    void Insert(const CEntry &entry) {
+        if (table.empty() && !Allocate())
+            return;
+
+        size_t i = entry.h1 & mask;
+        for (; !table[i].IsNull(); i = (i + 1) & mask) {
+            if (table[i] == entry)
+                return;
+        }
+
+        if (count >= maxCount) {
+            EvictRandom();
+            // the slot found above may have been shifted into, find it again
+            for (i = entry.h1 & mask; !table[i].IsNull(); i = (i + 1) & mask) {}
+        }
+
+        table[i] = entry;
+        count++;
+        inserts++;
+    }
+
+private:
+    // allocate the largest table within the budget on first use
+    bool Allocate() {
+        size_t size = 1;
+        while (size * 2 * sizeof(CEntry) <= maxBytes)
+            size *= 2;
+        if (size * sizeof(CEntry) > maxBytes || size < 4)
+            return false;
+
+        table.assign(size, CEntry());
+        mask     = size - 1;
+        maxCount = size / 4 * 3;
+        return true;
+    }
+
+    void EvictRandom() {
+        // xorshift64, no need to be secure since the entries are salted
+        randState ^= randState << 13;
+        randState ^= randState >> 7;
+        randState ^= randState << 17;
+
+        size_t i = randState & mask;
+        while (table[i].IsNull())
+            i = (i + 1) & mask;
+        Erase(i);
+        evictions++;
+    }
+
+    void Erase(size_t i) {
+        count--;
+        size_t j = i;
+        while (true) {
+            table[i] = CEntry();
+            while (true) {
+                j = (j + 1) & mask;
+                if (table[j].IsNull())
+                    return;
+
+                // the entry at j can stay if its home slot is cyclically in (i, j]
+                size_t home = table[j].h1 & mask;
+                if (i <= j ? (i < home && home <= j) : (i < home || home <= j))
+                    continue;
+                break;
+            }
+            table[i] = table[j];
+            i = j;
+        }
+    }
+
+private:
+    std::vector<CEntry> table;
+    size_t mask       = 0;
+    size_t count      = 0;
+    size_t maxCount   = 0;
+    uint64_t maxBytes = 0;
+    uint64_t randState;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// class CSignatureCache
+
+CSignatureCache::CSignatureCache() {
+    GetRandBytes((unsigned char *)salt, sizeof(salt));
+    for (uint32_t i = 0; i < SIG_CACHE_SHARDS; i++) {
+        shards.emplace_back(new CShard(GetRand(std::numeric_limits<uint64_t>::max())));
+    }
+    SetMaxSize(DEFAULT_MAX_SIG_CACHE_SIZE << 20);
+}
+
+CSignatureCache::~CSignatureCache() {}
+
+void CSignatureCache::SetMaxSize(uint64_t nBytes) {
+    maxBytes = nBytes;
+    for (auto &pShard : shards) {
+        std::lock_guard<std::mutex> lock(pShard->mtx);
+        pShard->SetMaxBytes(nBytes / shards.size());
+    }
+}
+
+uint64_t CSignatureCache::GetBytesOfEntries(uint64_t count) {
+    // at most 3/4 of a table is used
+    return (count / 3 * 4 + SIG_CACHE_SHARDS) * sizeof(CEntry);
+}
+
+CSignatureCache::CEntry CSignatureCache::ComputeEntry(const uint256& sigHash, const std::vector<unsigned char>& vchSig,
+                                                      const CPubKey& pubKey) const {
+    CEntry entry;
+    entry.h1 = CSipHasher(salt[0], salt[1])
+                   .Write(sigHash.begin(), sigHash.size())
+                   .Write(pubKey.begin(), pubKey.size())
+                   .Write(vchSig.data(), vchSig.size())
+                   .Finalize();
+    entry.h2 = CSipHasher(salt[2], salt[3])
+                   .Write(sigHash.begin(), sigHash.size())
+                   .Write(pubKey.begin(), pubKey.size())
+                   .Write(vchSig.data(), vchSig.size())
+                   .Finalize();
+    if (entry.IsNull())
+        entry.h2 = 1;  // the null entry marks the empty slots
+    return entry;
 }
 
 bool CSignatureCache::Get(const uint256& sigHash, const std::vector<unsigned char>& vchSig,
                           const CPubKey& pubKey) {
-    uint256 entry;
-    ComputeEntry(entry, sigHash, vchSig, pubKey);
-    std::unique_lock<std::mutex> lock(mtx);
-    return setValid.count(entry);
+    return Get(ComputeEntry(sigHash, vchSig, pubKey));
 }
 
 void CSignatureCache::Set(const uint256& sigHash, const std::vector<unsigned char>& vchSig,
                           const CPubKey& pubKey) {
-    static int64_t nMaxCacheSize = SysCfg().GetArg("-maxsigcachesize", 50000);
-    if (nMaxCacheSize <= 0) return;
-
-    uint256 entry;
-    ComputeEntry(entry, sigHash, vchSig, pubKey);
-
-    std::unique_lock<std::mutex> lock(mtx);
-
-    while (static_cast<int64_t>(setValid.size()) > nMaxCacheSize) {
-        // Evict a random entry. Random because that helps
-        // foil would-be DoS attackers who might try to pre-generate
-        // and re-use a set of valid signatures just-slightly-greater
-        // than our cache size.
-        UnorderedHashSet::size_type s       = GetRand(setValid.bucket_count());
-        UnorderedHashSet::local_iterator it = setValid.begin(s);
-        if (it != setValid.end(s)) {
-            setValid.erase(*it);
+    Set(ComputeEntry(sigHash, vchSig, pubKey));
+}
+
+bool CSignatureCache::Get(const CEntry &entry) {
+    CShard &shard = GetShard(entry);
+    bool found;
+    {
+        std::lock_guard<std::mutex> lock(shard.mtx);
+        found = shard.Contains(entry);
+    }
+    (found ? hits : misses)++;
+    return found;
+}
+
+void CSignatureCache::Set(const CEntry &entry) {
+    CShard &shard = GetShard(entry);
+    std::lock_guard<std::mutex> lock(shard.mtx);
+    shard.Insert(entry);
+}
+
+void CSignatureCache::GetBatch(const std::vector<CEntry> &entries, std::vector<bool> &results) {
+    results.assign(entries.size(), false);
+
+    // group the entries by shard
+    std::vector<std::vector<uint32_t>> shardEntries(shards.size());
+    for (uint32_t i = 0; i < entries.size(); i++) {
+        shardEntries[entries[i].h2 % shards.size()].push_back(i);
+    }
+
+    uint64_t found = 0;
+    for (uint32_t s = 0; s < shards.size(); s++) {
+        if (shardEntries[s].empty())
+            continue;
+
+        std::lock_guard<std::mutex> lock(shards[s]->mtx);
+        for (uint32_t i : shardEntries[s]) {
+            if (shards[s]->Contains(entries[i])) {
+                results[i] = true;
+                found++;
+            }
         }
     }
+    hits += found;
+    misses += entries.size() - found;
+}
 
-    setValid.insert(entry);
+CSigCacheStats CSignatureCache::GetStats() {
+    CSigCacheStats stats;
+    stats.hits     = hits;
+    stats.misses   = misses;
+    stats.maxBytes = maxBytes;
+    for (auto &pShard : shards) {
+        std::lock_guard<std::mutex> lock(pShard->mtx);
+        stats.inserts   += pShard->inserts;
+        stats.evictions += pShard->evictions;
+        stats.entries   += pShard->GetCount();
+        stats.bytes     += pShard->GetBytes();
+    }
+    return stats;
 }
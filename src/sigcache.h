@@ -7,38 +7,83 @@
 #ifndef COIN_SIGCACHE_H
 #define COIN_SIGCACHE_H
 
+#include <atomic>
 #include <mutex>
 #include <vector>
 
 #include "config/chainparams.h"
-#include "crypto/sha256.h"
 #include "entities/key.h"
 #include "commons/random.h"
 #include "commons/uint256.h"
 #include "commons/util/util.h"
 
+struct CSigCacheStats {
+    uint64_t hits      = 0;
+    uint64_t misses    = 0;
+    uint64_t inserts   = 0;
+    uint64_t evictions = 0;
+    uint64_t entries   = 0;  // count of the cached signatures
+    uint64_t bytes     = 0;  // memory of the allocated tables
+    uint64_t maxBytes  = 0;
+};
+
 /**
  * Valid signature cache, to avoid doing expensive ECDSA signature checking
  * twice for every transaction (once when accepted into memory pool, and
  * again when accepted into the block chain)
+ *
+ * The cache is split into lock striped shards, every shard is an open addressing table of fixed size bounded
+ * by the memory budget. When a shard is full, a random entry is evicted to foil would-be DoS attackers who
+ * might try to pre-generate and re-use a set of valid signatures just-slightly-greater than the cache size.
  */
 class CSignatureCache {
-private:
-    //! Entries are SHA256(signature hash || public key || signature):
-    UnorderedHashSet setValid;
-    std::mutex mtx;
+public:
+    //! Entries are 128 bits of salted SipHash-2-4 of (signature hash || public key || signature)
+    struct CEntry {
+        uint64_t h1 = 0;
+        uint64_t h2 = 0;
+
+        bool IsNull() const { return h1 == 0 && h2 == 0; }
+        bool operator==(const CEntry &other) const { return h1 == other.h1 && h2 == other.h2; }
+    };
 
 public:
-    CSignatureCache() {}
-    ~CSignatureCache() {}
+    CSignatureCache();
+    ~CSignatureCache();
+
+    // set the memory budget in bytes, 0 disables the cache. The cached entries are dropped
+    void SetMaxSize(uint64_t nBytes);
+
+    // the memory budget of the tables holding count entries
+    static uint64_t GetBytesOfEntries(uint64_t count);
+
+    CEntry ComputeEntry(const uint256& sigHash, const std::vector<unsigned char>& vchSig,
+                        const CPubKey& pubKey) const;
+
     bool Get(const uint256& sigHash, const std::vector<unsigned char>& vchSig,
              const CPubKey& pubKey);
     void Set(const uint256& sigHash, const std::vector<unsigned char>& vchSig,
              const CPubKey& pubKey);
 
+    bool Get(const CEntry &entry);
+    void Set(const CEntry &entry);
+
+    // look up the entries with every shard locked once, results[i] is the result of entries[i]
+    void GetBatch(const std::vector<CEntry> &entries, std::vector<bool> &results);
+
+    CSigCacheStats GetStats();
+
+private:
+    class CShard;
+
+    CShard &GetShard(const CEntry &entry) { return *shards[entry.h2 % shards.size()]; }
+
 private:
-    void ComputeEntry(uint256& entry, const uint256& sigHash,
-                      const std::vector<unsigned char>& vchSig, const CPubKey& pubKey);
+    uint64_t salt[4];  // SipHash keys of h1 and h2
+    std::vector<std::unique_ptr<CShard>> shards;
+    std::atomic<uint64_t> hits{0};
+    std::atomic<uint64_t> misses{0};
+    std::atomic<uint64_t> maxBytes{0};
 };
 
-#endif  // COIN_SIGCACHE_H
\ No newline at end of file
+#endif  // COIN_SIGCACHE_H
@@ -0,0 +1,76 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "sigverify.h"
+
+#include "main.h"
+#include "persistence/accountdb.h"
+#include "tx/tx.h"
+
+// the min count of signatures in a block to be verified by the workers
+static const size_t MIN_PRE_VERIFY_SIGNATURES = 8;
+
+std::unique_ptr<CBlockSigPreVerifier> CBlockSigPreVerifier::Verify(const std::vector<std::shared_ptr<CBaseTx>> &vptx,
+                                                                   CAccountDBCache &accountCache) {
+    return Verify(vptx, accountCache, GetSigVerifyPool());
+}
+
+std::unique_ptr<CBlockSigPreVerifier> CBlockSigPreVerifier::Verify(const std::vector<std::shared_ptr<CBaseTx>> &vptx,
+                                                                   CAccountDBCache &accountCache, CWorkerPool *pPool) {
+    if (pPool == nullptr || vptx.size() < MIN_PRE_VERIFY_SIGNATURES)
+        return nullptr;
+
+    std::unique_ptr<CBlockSigPreVerifier> pVerifier(new CBlockSigPreVerifier());
+    pVerifier->txItems.assign(vptx.size(), -1);
+    std::vector<CSigVerifyItem> items;
+    for (size_t i = 0; i < vptx.size(); i++) {
+        const CBaseTx &tx = *vptx[i];
+        if (tx.signature.empty())
+            continue;
+
+        // the signer is the tx uid in common, the txs signed by someone else are left to CheckTx()
+        CPubKey pubKey;
+        if (tx.txUid.is<CPubKey>()) {
+            pubKey = tx.txUid.get<CPubKey>();
+        } else {
+            CAccount account;
+            if (!accountCache.GetAccount(tx.txUid, account))
+                continue;
+            pubKey = account.owner_pubkey;
+        }
+        if (!pubKey.IsValid())
+            continue;
+
+        pVerifier->txItems[i] = items.size();
+        items.emplace_back(tx.GetHash(), tx.signature, pubKey);
+    }
+    if (items.size() < MIN_PRE_VERIFY_SIGNATURES)
+        return nullptr;
+
+    // the signatures verified before, e.g. on being accepted to mempool, are looked up in signatureCache in one batch
+    ::VerifySignatureBatch(items, &pVerifier->results, pPool);
+    return pVerifier;
+}
+
+bool CBlockSigPreVerifier::IsValid(uint32_t index) const {
+    if (index >= txItems.size() || txItems[index] < 0)
+        return true;
+
+    return results[txItems[index]];
+}
+
+CWorkerPool *GetSigVerifyPool() {
+    static std::unique_ptr<CWorkerPool> pPool = []() -> std::unique_ptr<CWorkerPool> {
+        int64_t nThreads = SysCfg().GetArg("-par", DEFAULT_SIG_VERIFY_THREADS);
+        if (nThreads <= 0)
+            nThreads = std::thread::hardware_concurrency();
+        nThreads = std::min<int64_t>(nThreads, MAX_SIG_VERIFY_THREADS);
+
+        // the calling thread verifies too, so the pool has one thread less
+        if (nThreads <= 1)
+            return nullptr;
+        return std::unique_ptr<CWorkerPool>(new CWorkerPool(nThreads - 1, "sigverify"));
+    }();
+    return pPool.get();
+}
@@ -0,0 +1,49 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef COIN_SIGVERIFY_H
+#define COIN_SIGVERIFY_H
+
+#include "commons/uint256.h"
+#include "commons/workerpool.h"
+#include "entities/key.h"
+
+#include <memory>
+#include <vector>
+
+class CBaseTx;
+class CAccountDBCache;
+
+/**
+ * Verify the tx signatures of a block up front by CPubKey::VerifyBatch() in the signature verification workers and
+ * the calling thread, before the txs are checked in order by CheckBlock(). The (sighash, pubkey, signature) of every
+ * signed tx is extracted, and the valid signatures are added to signatureCache, so the signature checks in CheckTx()
+ * become cache hits. The results are only advisory, CheckTx() is still the one to accept or reject a tx.
+ */
+class CBlockSigPreVerifier {
+public:
+    /**
+     * Verify the signatures of the txs, the calling thread must not be one of the workers of pPool.
+     * Return nullptr if there are no workers or too few signatures to be worth it.
+     */
+    static std::unique_ptr<CBlockSigPreVerifier> Verify(const std::vector<std::shared_ptr<CBaseTx>> &vptx,
+                                                        CAccountDBCache &accountCache);
+    static std::unique_ptr<CBlockSigPreVerifier> Verify(const std::vector<std::shared_ptr<CBaseTx>> &vptx,
+                                                        CAccountDBCache &accountCache, CWorkerPool *pPool);
+
+    // return false if the signature of the tx at index is invalid for the pubkey of the tx uid
+    bool IsValid(uint32_t index) const;
+
+private:
+    CBlockSigPreVerifier() {}
+
+private:
+    std::vector<int32_t> txItems;  // tx index -> index of results, -1 if the tx has no signature to verify
+    std::vector<bool> results;
+};
+
+// the signature verification workers, which execute the txs in parallel too, nullptr if -par=1
+CWorkerPool *GetSigVerifyPool();
+
+#endif  // COIN_SIGVERIFY_H
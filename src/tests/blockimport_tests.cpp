@@ -0,0 +1,67 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockimport.h"
+#include "main.h"
+
+#include <vector>
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+
+static const uint32_t TEST_IMPORT_BLOCKS = 200;
+
+BOOST_AUTO_TEST_SUITE(blockimport_tests)
+
+BOOST_AUTO_TEST_CASE(blockimport_reject_test)
+{
+    // the blocks failed to be decoded are not submitted, the ones failed to be checked are not connected,
+    // the queue is drained by Flush()
+    CBlockImportStats &stats = GetBlockImportStats();
+    uint64_t decodeFailures  = stats.decode.failures;
+    uint64_t checkFailures   = stats.check.failures;
+    uint64_t connected       = stats.connect.count + stats.connect.failures;
+
+    CBlockImportPipeline pipeline(4);
+    for (uint32_t i = 0; i < TEST_IMPORT_BLOCKS; i++) {
+        BOOST_CHECK(!pipeline.SubmitRaw(vector<char>(1 + i % 8, (char)i), nullptr));
+        pipeline.Submit(CBlock(), nullptr);  // without the reward tx
+    }
+    pipeline.Flush();
+
+    BOOST_CHECK(stats.decode.failures - decodeFailures == TEST_IMPORT_BLOCKS);
+    BOOST_CHECK(stats.check.failures - checkFailures == TEST_IMPORT_BLOCKS);
+    BOOST_CHECK(stats.connect.count + stats.connect.failures == connected);
+    BOOST_CHECK(pipeline.GetConnectedCount() == 0);
+    BOOST_CHECK(!pipeline.HasError());
+}
+
+BOOST_AUTO_TEST_CASE(blockimport_try_submit_test)
+{
+    // a try submit never waits for the queue, every block is either queued or dropped
+    CBlockImportStats &stats = GetBlockImportStats();
+    uint64_t checkFailures   = stats.check.failures;
+    uint64_t waits           = stats.queueFullWaits;
+    uint64_t drops           = stats.queueFullDrops;
+
+    uint32_t submitted = 0;
+    {
+        CBlockImportPipeline pipeline(1);
+        for (uint32_t i = 0; i < TEST_IMPORT_BLOCKS; i++) {
+            if (pipeline.TrySubmit(CBlock(), nullptr))
+                submitted++;
+        }
+        pipeline.Flush();
+        BOOST_CHECK(pipeline.TrySubmit(CBlock(), nullptr));  // the queue has room after Flush()
+        submitted++;
+    }  // the submitted blocks are done on destruction
+
+    BOOST_CHECK(submitted > 0);
+    BOOST_CHECK(stats.queueFullWaits == waits);
+    BOOST_CHECK(stats.queueFullDrops - drops == TEST_IMPORT_BLOCKS + 1 - submitted);
+    BOOST_CHECK(stats.check.failures - checkFailures == submitted);
+    BOOST_CHECK(stats.queued == 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -8,7 +8,11 @@
 #include <vector>
 #include <map>
 #include <boost/test/unit_test.hpp>
+#include "persistence/blockundo.h"
+#include "persistence/cachewrapper.h"
 #include "persistence/dbaccess.h"
+#include "persistence/dbflusher.h"
+#include "persistence/dbiterator.h"
 
 using namespace std;
 
@@ -60,6 +64,266 @@ BOOST_AUTO_TEST_CASE(dbaccess_test)
 
 }
 
+BOOST_AUTO_TEST_CASE(dbaccess_flush_batch_test)
+{
+    bool isWipe = true;
+    shared_ptr<CDBAccess> pDBAccess = make_shared<CDBAccess>(
+        db_dir, DBNameType::ACCOUNT, false, isWipe);
+    map<string, string> mapRegIds;
+    mapRegIds["regid-1"] = "keyid-1";
+    mapRegIds["regid-2"] = "keyid-2";
+    map<string, string> mapNickIds;
+    mapNickIds["nickid-1"] = "keyid-1";
+
+    pDBAccess->BeginFlushBatch();
+    BOOST_CHECK(pDBAccess->IsInFlushBatch());
+    pDBAccess->BatchWrite<string, string>(dbk::REGID_KEYID, mapRegIds);
+    pDBAccess->BatchWrite<string, string>(dbk::NICKID_KEYID, mapNickIds);
+    // not written before commit
+    string value1;
+    BOOST_CHECK(!pDBAccess->GetData(dbk::REGID_KEYID, string("regid-1"), value1));
+    BOOST_CHECK(pDBAccess->GetFlushStats().flush_count == 0);
+
+    BOOST_CHECK(pDBAccess->CommitFlushBatch());
+    BOOST_CHECK(!pDBAccess->IsInFlushBatch());
+    BOOST_CHECK(pDBAccess->GetData(dbk::REGID_KEYID, string("regid-1"), value1));
+    BOOST_CHECK( value1 == "keyid-1" );
+    string value2;
+    BOOST_CHECK(pDBAccess->GetData(dbk::NICKID_KEYID, string("nickid-1"), value2));
+    BOOST_CHECK( value2 == "keyid-1" );
+
+    const CDBFlushStats &stats = pDBAccess->GetFlushStats();
+    BOOST_CHECK(stats.flush_count == 1);
+    BOOST_CHECK(stats.last_op_count == 3);
+    BOOST_CHECK(stats.last_bytes > 0 && stats.total_bytes == stats.last_bytes);
+
+    // empty batch will not be written
+    pDBAccess->BeginFlushBatch();
+    BOOST_CHECK(!pDBAccess->HasFlushData());
+    BOOST_CHECK(pDBAccess->CommitFlushBatch());
+    BOOST_CHECK(pDBAccess->GetFlushStats().flush_count == 1);
+
+    // aborted batch is not written, and a new batch can be began
+    map<string, string> mapAborted;
+    mapAborted["regid-3"] = "keyid-3";
+    pDBAccess->BeginFlushBatch();
+    pDBAccess->BatchWrite<string, string>(dbk::REGID_KEYID, mapAborted);
+    BOOST_CHECK(pDBAccess->HasFlushData());
+    pDBAccess->AbortFlushBatch();
+    BOOST_CHECK(!pDBAccess->IsInFlushBatch());
+    string value3;
+    BOOST_CHECK(!pDBAccess->GetData(dbk::REGID_KEYID, string("regid-3"), value3));
+    pDBAccess->BeginFlushBatch();
+    BOOST_CHECK(pDBAccess->CommitFlushBatch());
+    BOOST_CHECK(pDBAccess->GetFlushStats().flush_count == 1);
+}
+
+BOOST_AUTO_TEST_CASE(dbaccess_pending_batch_test)
+{
+    bool isWipe = true;
+    shared_ptr<CDBAccess> pDBAccess = make_shared<CDBAccess>(
+        db_dir, DBNameType::ACCOUNT, false, isWipe);
+    const dbk::PrefixType prefix = dbk::REGID_KEYID;
+    map<string, string> mapData;
+    mapData["regid-1"] = "keyid-1";
+    mapData["regid-3"] = "keyid-3";
+    pDBAccess->BatchWrite<string, string>(prefix, mapData);
+
+    map<string, string> mapPending;
+    mapPending["regid-1"] = "";         // erase
+    mapPending["regid-2"] = "keyid-2";
+    mapPending["regid-3"] = "keyid-3.1";
+    pDBAccess->BeginFlushBatch(true);
+    pDBAccess->BatchWrite<string, string>(prefix, mapPending);
+    auto pBatch = pDBAccess->DetachFlushBatch();
+    BOOST_CHECK(pBatch != nullptr && pDBAccess->GetPendingBatchCount() == 1);
+
+    // the pending data is readable before written
+    string value;
+    BOOST_CHECK(!pDBAccess->GetData(prefix, string("regid-1"), value));
+    BOOST_CHECK(pDBAccess->GetData(prefix, string("regid-2"), value) && value == "keyid-2");
+    BOOST_CHECK(pDBAccess->GetData(prefix, string("regid-3"), value) && value == "keyid-3.1");
+
+    map<string, string> elements;
+    set<string> expiredKeys;
+    BOOST_CHECK(pDBAccess->GetAllElements(prefix, expiredKeys, elements));
+    BOOST_CHECK(elements.size() == 2 && elements["regid-2"] == "keyid-2" && elements["regid-3"] == "keyid-3.1");
+
+    // backward over the pending data, the erased key is skipped
+    shared_ptr<leveldb::Iterator> pIt = pDBAccess->NewIterator();
+    vector<string> keys;
+    for (pIt->SeekToLast(); pIt->Valid(); pIt->Prev()) {
+        string key;
+        BOOST_CHECK(dbk::ParseDbKey(pIt->key(), prefix, key));
+        keys.push_back(key);
+    }
+    BOOST_CHECK(keys == vector<string>({"regid-3", "regid-2"}));
+    pIt->Seek(dbk::GenDbKey(prefix, string("regid-3")));
+    pIt->Prev();
+    BOOST_CHECK(pIt->Valid() && pIt->key() == dbk::GenDbKey(prefix, string("regid-2")));
+    pIt->Next();
+    BOOST_CHECK(pIt->Valid() && pIt->key() == dbk::GenDbKey(prefix, string("regid-3")));
+
+    BOOST_CHECK(pDBAccess->WritePendingBatch(pBatch));
+    BOOST_CHECK(pDBAccess->GetPendingBatchCount() == 0);
+    BOOST_CHECK(!pDBAccess->GetData(prefix, string("regid-1"), value));
+    BOOST_CHECK(pDBAccess->GetData(prefix, string("regid-3"), value) && value == "keyid-3.1");
+}
+
+// the flusher which fails to write any batch after the first one
+class CFailingDBFlusher : public CDBFlusher {
+public:
+    std::atomic<uint32_t> written{0};
+    std::atomic<uint32_t> errors{0};
+
+    CFailingDBFlusher(CDBAccess *pMarkerDb) : CDBFlusher(pMarkerDb, 4, [this](const string &) { errors++; }) {}
+    // the tasks must be done before the overridden WriteBatch() is destroyed
+    ~CFailingDBFlusher() { WaitForFlushed(); }
+
+protected:
+    void WriteBatch(CDBAccess *pDbAccess, const std::shared_ptr<CLevelDBBatch> &pBatch) override {
+        if (written > 0)
+            throw leveldb_error("injected write error");
+        CDBFlusher::WriteBatch(pDbAccess, pBatch);
+        written++;
+    }
+};
+
+static CDBFlushTask MakeFlushTask(CDBAccess *pDbAccess, uint64_t seq, const string &key) {
+    map<string, string> mapData;
+    mapData[key] = "keyid";
+    pDbAccess->BeginFlushBatch(true);
+    pDbAccess->BatchWrite<string, string>(dbk::REGID_KEYID, mapData);
+
+    CDBFlushTask task;
+    task.flush_seq = seq;
+    task.batches.emplace_back(pDbAccess, pDbAccess->DetachFlushBatch());
+    return task;
+}
+
+BOOST_AUTO_TEST_CASE(dbaccess_flusher_failure_test)
+{
+    CDBAccess accountDb(db_dir, DBNameType::ACCOUNT, false, true);
+    CDBAccess blockDb(db_dir, DBNameType::BLOCK, false, true);
+    CFailingDBFlusher flusher(&blockDb);
+
+    flusher.Push(MakeFlushTask(&accountDb, 1, "regid-1"));
+    flusher.WaitForFlushed();
+    flusher.Push(MakeFlushTask(&accountDb, 2, "regid-2"));  // failed
+    flusher.Push(MakeFlushTask(&accountDb, 3, "regid-3"));  // dropped
+    flusher.WaitForFlushed();
+
+    BOOST_CHECK(flusher.HasFailed());
+    BOOST_CHECK(flusher.errors == 1);
+    BOOST_CHECK(accountDb.GetPendingBatchCount() == 0);
+
+    string value;
+    uint64_t flushSeq = 0;
+    BOOST_CHECK(accountDb.GetData(dbk::REGID_KEYID, string("regid-1"), value));
+    BOOST_CHECK(!accountDb.GetData(dbk::REGID_KEYID, string("regid-2"), value));
+    BOOST_CHECK(!accountDb.GetData(dbk::REGID_KEYID, string("regid-3"), value));
+    BOOST_CHECK(blockDb.GetData(dbk::FLUSH_MARKER, flushSeq) && flushSeq == 1);
+
+    // the direct write does not wait for the dropped batches
+    map<string, string> mapData;
+    mapData["regid-4"] = "keyid";
+    accountDb.BatchWrite<string, string>(dbk::REGID_KEYID, mapData);
+    BOOST_CHECK(accountDb.GetData(dbk::REGID_KEYID, string("regid-4"), value));
+}
+
+BOOST_AUTO_TEST_CASE(dbaccess_key_encoding_test)
+{
+    // keys encoded on the stack or spilled to the heap are same as the keys of CDataStream
+    for (uint32_t len : {0, 8, 58, 59, 60, 200}) {
+        string key(len, 'k');
+        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+        ssKey.write("rkey", 4);
+        ssKey << key;
+        BOOST_CHECK(dbk::GenDbKey(dbk::REGID_KEYID, key) == ssKey.str());
+
+        string parsedKey;
+        BOOST_CHECK(dbk::ParseDbKey(ssKey.str(), dbk::REGID_KEYID, parsedKey) && parsedKey == key);
+    }
+
+    string value;
+    const char truncated[] = "\x03" "ab"; // size 3 with 2 bytes of data
+    CBufferReader reader(truncated, truncated + 3, SER_DISK, CLIENT_VERSION);
+    BOOST_CHECK_THROW(reader >> value, std::ios_base::failure);
+
+    shared_ptr<CDBAccess> pDBAccess = make_shared<CDBAccess>(
+        db_dir, DBNameType::ACCOUNT, false, true);
+    map<string, string> mapData;
+    mapData["regid-1"] = "keyid-1";
+    mapData[string(100, 'r')] = string(1000, 'k');
+    pDBAccess->BatchWrite<string, string>(dbk::REGID_KEYID, mapData);
+    BOOST_CHECK(pDBAccess->GetData(dbk::REGID_KEYID, string("regid-1"), value) && value == "keyid-1");
+    BOOST_CHECK(pDBAccess->GetData(dbk::REGID_KEYID, string(100, 'r'), value) && value == string(1000, 'k'));
+    BOOST_CHECK((pDBAccess->HaveData<string, string>(dbk::REGID_KEYID, string(100, 'r'))));
+    BOOST_CHECK((!pDBAccess->HaveData<string, string>(dbk::REGID_KEYID, string("regid-2"))));
+}
+
+BOOST_AUTO_TEST_CASE(dbaccess_tuning_profile_test)
+{
+    DBNameType dbNameType;
+    BOOST_CHECK(GetDbNameEnumByName("accounts", dbNameType) && dbNameType == DBNameType::ACCOUNT);
+    BOOST_CHECK(!GetDbNameEnumByName("unknown", dbNameType));
+
+    // dbs without a block cache share use the common block cache
+    BOOST_CHECK(GetDbTuningProfile(DBNameType::SYSPARAM).block_cache_share == 0);
+    BOOST_CHECK(GetDbBlockCache(0) == GetDbBlockCache(0));
+    BOOST_CHECK(GetDbBlockCache(20) != GetDbBlockCache(20));
+    BOOST_CHECK(GetDbBlockCacheSize(20) == GetDbBlockCacheBudget() / 100 * 20);
+
+    shared_ptr<CDBAccess> pDBAccess = make_shared<CDBAccess>(
+        db_dir, DBNameType::ACCOUNT, false, true);
+    const dbk::PrefixType prefix = dbk::REGID_KEYID;
+    map<string, string> mapData;
+    for (uint32_t i = 0; i < 1000; i++) {
+        mapData[strprintf("regid-%04u", i)] = string(100, 'k');
+    }
+    pDBAccess->BatchWrite<string, string>(prefix, mapData);
+
+    string stats;
+    BOOST_CHECK(pDBAccess->GetProperty("leveldb.stats", stats) && !stats.empty());
+    BOOST_CHECK(pDBAccess->GetApproximateSize(prefix) <= pDBAccess->GetApproximateSize());
+}
+
+BOOST_AUTO_TEST_CASE(dbaccess_block_undo_encoding_test)
+{
+    CBlockUndo blockUndo;
+    for (uint32_t i = 0; i < 3; i++) {
+        CTxUndo txUndo(uint256S(strprintf("%064x", i + 1)));
+        for (uint32_t j = 0; j < 5; j++) {
+            CDbOpLog opLog;
+            opLog.Set(strprintf("regid-%u-%u", i, j), string(j * 10, 'k'));
+            txUndo.dbOpLogMap.AddOpLog(dbk::REGID_KEYID, opLog);
+            txUndo.dbOpLogMap.AddOpLog(dbk::KEYID_ACCOUNT, opLog);
+        }
+        // the op logs of an unknown prefix are kept by the prefix string
+        CDbOpLog unknownLog;
+        unknownLog.Set(string("key"), string("value"));
+        txUndo.dbOpLogMap.GetMap()["zz-unknown"].push_back(unknownLog);
+        blockUndo.vtxundo.push_back(txUndo);
+    }
+
+    CDataStream ssCompact(SER_DISK, CLIENT_VERSION);
+    blockUndo.Encode(ssCompact);
+    CDataStream ssLegacy(SER_DISK, CLIENT_VERSION);
+    ssLegacy << blockUndo;
+    BOOST_CHECK(ssCompact.size() < ssLegacy.size());
+
+    // both of the compact and the legacy undo data are decoded to the same
+    CBlockUndo compactUndo, legacyUndo;
+    BOOST_CHECK(compactUndo.Decode(&ssCompact[0], &ssCompact[0] + ssCompact.size()));
+    BOOST_CHECK(legacyUndo.Decode(&ssLegacy[0], &ssLegacy[0] + ssLegacy.size()));
+    BOOST_CHECK(compactUndo.ToString() == blockUndo.ToString());
+    BOOST_CHECK(legacyUndo.ToString() == blockUndo.ToString());
+
+    // truncated data is rejected
+    CBlockUndo truncatedUndo;
+    BOOST_CHECK(!truncatedUndo.Decode(&ssCompact[0], &ssCompact[0] + ssCompact.size() - 1));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 
@@ -181,4 +445,799 @@ BOOST_AUTO_TEST_CASE(dbcache_cache_size_test)
     BOOST_CHECK(!pDBCache2->IsCalcSize() && pDBCache2->GetCacheSize() == 0);
 }
 
+BOOST_AUTO_TEST_CASE(dbcache_cache_size_update_test)
+{
+    const bool isWipe = true;
+    const dbk::PrefixType prefix = dbk::REGID_KEYID;
+    shared_ptr<CDBAccess> pDBAccess = make_shared<CDBAccess>(
+        db_dir, DBNameType::ACCOUNT, false, isWipe);
+
+    auto pDBCache = make_shared< CCompositeKVCache<prefix, string, string> >(pDBAccess.get());
+    pDBCache->SetData("regid-1", "keyid-1");
+    pDBCache->SetData("regid-1", "keyid-1-longer-value");
+    BOOST_CHECK(pDBCache->GetCacheSize() == GetCacheSerializeSize(*pDBCache));
+    pDBCache->EraseData("regid-1");
+    BOOST_CHECK(pDBCache->GetCacheSize() == GetCacheSerializeSize(*pDBCache));
+
+    // the data flushed from the upper cache is counted
+    auto pDBCache2 = make_shared< CCompositeKVCache<prefix, string, string> >(pDBCache.get());
+    pDBCache2->SetData("regid-1", "keyid-1");
+    pDBCache2->SetData("regid-2", "keyid-2");
+    pDBCache2->Flush();
+    BOOST_CHECK(pDBCache->GetCacheItemCount() == 2);
+    BOOST_CHECK(pDBCache->GetCacheSize() == GetCacheSerializeSize(*pDBCache));
+    pDBCache->Flush();
+    BOOST_CHECK(pDBCache->GetCacheSize() == 0 && pDBCache->GetCacheItemCount() == 0);
+}
+
+BOOST_AUTO_TEST_CASE(dbcache_copy_on_write_test)
+{
+    const bool isWipe = true;
+    const dbk::PrefixType prefix = dbk::REGID_KEYID;
+    shared_ptr<CDBAccess> pDBAccess = make_shared<CDBAccess>(
+        db_dir, DBNameType::ACCOUNT, false, isWipe);
+
+    auto pDBCache1 = make_shared< CCompositeKVCache<prefix, string, string> >(pDBAccess.get());
+    pDBCache1->SetData("regid-1", "keyid-1");
+    pDBCache1->Flush();
+    auto pDBCache2 = make_shared< CCompositeKVCache<prefix, string, string> >(pDBCache1.get());
+    auto pDBCache3 = make_shared< CCompositeKVCache<prefix, string, string> >(pDBCache2.get());
+
+    // read hits are not copied to the upper caches
+    string value;
+    BOOST_CHECK(pDBCache3->GetData(string("regid-1"), value) && value == "keyid-1");
+    BOOST_CHECK(pDBCache3->HaveData(string("regid-1")));
+    BOOST_CHECK(pDBCache3->GetMapData().empty() && pDBCache2->GetMapData().empty());
+    BOOST_CHECK(pDBCache1->GetMapData().size() == 1);
+
+    // the value is copied to the writing cache only
+    pDBCache3->SetData("regid-1", "keyid-1.1");
+    BOOST_CHECK(pDBCache3->GetMapData().size() == 1 && pDBCache2->GetMapData().empty());
+    BOOST_CHECK(pDBCache2->GetData(string("regid-1"), value) && value == "keyid-1");
+    pDBCache3->Flush();
+    BOOST_CHECK(pDBCache2->GetData(string("regid-1"), value) && value == "keyid-1.1");
+    BOOST_CHECK(pDBCache1->GetData(string("regid-1"), value) && value == "keyid-1");
+
+    auto pSimpleCache1 = make_shared< CSimpleKVCache<dbk::NICKID_KEYID, string> >(pDBAccess.get());
+    pSimpleCache1->SetData("keyid-2");
+    pSimpleCache1->Flush();
+    auto pSimpleCache2 = make_shared< CSimpleKVCache<dbk::NICKID_KEYID, string> >(pSimpleCache1.get());
+    BOOST_CHECK(pSimpleCache2->GetData(value) && value == "keyid-2");
+    BOOST_CHECK(pSimpleCache2->GetCacheSize() == 0);
+    pSimpleCache2->EraseData();
+    BOOST_CHECK(!pSimpleCache2->HaveData() && pSimpleCache1->HaveData());
+}
+
+BOOST_AUTO_TEST_CASE(dbcache_simple_value_undo_test)
+{
+    const bool isWipe = true;
+    typedef CSimpleKVCache<dbk::NICKID_KEYID, string> SimpleCache;
+    shared_ptr<CDBAccess> pDBAccess = make_shared<CDBAccess>(
+        db_dir, DBNameType::ACCOUNT, false, isWipe);
+
+    auto pBaseCache = make_shared<SimpleCache>(pDBAccess.get());
+    pBaseCache->SetData("value-1");
+    pBaseCache->Flush();
+    auto pCache = make_shared<SimpleCache>(pBaseCache.get());
+    UndoDataFuncMap undoDataFuncMap;
+    pCache->RegisterUndoFunc(undoDataFuncMap);
+
+    // read then write, the old value logged is the value of the base
+    CDBOpLogMap dbOpLogMap;
+    pCache->SetDbOpLogMap(&dbOpLogMap);
+    string value;
+    BOOST_CHECK(pCache->GetData(value) && value == "value-1");
+    pCache->SetData("value-2");
+    BOOST_CHECK(pCache->GetData(value) && value == "value-2");
+    BOOST_CHECK(pBaseCache->GetData(value) && value == "value-1");
+    pCache->SetDbOpLogMap(nullptr);
+    BOOST_CHECK(UndoDbOpLogMap(undoDataFuncMap, dbOpLogMap));
+    BOOST_CHECK(pCache->GetData(value) && value == "value-1");
+
+    // write without read
+    CDBOpLogMap writeOpLogMap;
+    pCache->Clear();
+    pCache->SetDbOpLogMap(&writeOpLogMap);
+    pCache->SetData("value-3");
+    pCache->SetDbOpLogMap(nullptr);
+    BOOST_CHECK(UndoDbOpLogMap(undoDataFuncMap, writeOpLogMap));
+    pCache->Flush();
+    BOOST_CHECK(pBaseCache->GetData(value) && value == "value-1");
+}
+
+BOOST_AUTO_TEST_CASE(dbcache_read_tracker_test)
+{
+    const bool isWipe = true;
+    const dbk::PrefixType prefix = dbk::REGID_KEYID;
+    typedef CCompositeKVCache<prefix, string, string> StringCache;
+    shared_ptr<CDBAccess> pDBAccess = make_shared<CDBAccess>(
+        db_dir, DBNameType::ACCOUNT, false, isWipe);
+
+    auto pDBCache = make_shared<StringCache>(pDBAccess.get());
+    pDBCache->SetData("regid-1", "keyid-1");
+    pDBCache->SetData("regid-2", "keyid-2");
+    pDBCache->Flush();
+
+    // the same ops on a plain cache and a tracked cache over the same base
+    CDBOpLogMap serialLogs, trackedLogs;
+    std::mutex baseMutex;
+    CDBReadTracker tracker(baseMutex);
+    auto pSerialCache  = make_shared<StringCache>(pDBCache.get());
+    auto pTrackedCache = make_shared<StringCache>(pDBCache.get());
+    pSerialCache->SetDbOpLogMap(&serialLogs);
+    pTrackedCache->SetDbOpLogMap(&trackedLogs);
+    pTrackedCache->SetReadTracker(&tracker);
+    for (auto pCache : {pSerialCache, pTrackedCache}) {
+        string value;
+        BOOST_CHECK(pCache->GetData(string("regid-1"), value) && value == "keyid-1");
+        BOOST_CHECK(!pCache->HaveData(string("regid-4")));
+        pCache->SetData("regid-2", "keyid-2.1");
+        pCache->SetData("regid-3", "keyid-3");
+        pCache->EraseData("regid-1");
+        BOOST_CHECK(pCache->GetData(string("regid-2"), value) && value == "keyid-2.1");
+    }
+
+    // the written data and the undo logs are the same, the values read are not to be flushed
+    BOOST_CHECK(pTrackedCache->GetMapData() == pSerialCache->GetMapData());
+    CDataStream ssSerial(SER_DISK, CLIENT_VERSION), ssTracked(SER_DISK, CLIENT_VERSION);
+    ssSerial << serialLogs;
+    ssTracked << trackedLogs;
+    BOOST_CHECK(ssSerial.str() == ssTracked.str());
+
+    // all of the keys looked up in the base are recorded, including the missing ones
+    const auto &readKeys = tracker.GetReadKeys();
+    BOOST_CHECK(readKeys.size() == 1 && readKeys.count(dbk::GetKeyPrefix(prefix)));
+    const auto &keys = readKeys.at(dbk::GetKeyPrefix(prefix));
+    BOOST_CHECK(keys.size() == 4);
+    for (const string key : {"regid-1", "regid-2", "regid-3", "regid-4"}) {
+        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+        ssKey << key;
+        BOOST_CHECK(keys.count(ssKey.str()));
+    }
+    BOOST_CHECK(!tracker.IsUnsafe());
+
+    pTrackedCache->Flush();
+    string value;
+    BOOST_CHECK(!pDBCache->GetData(string("regid-1"), value));
+    BOOST_CHECK(pDBCache->GetData(string("regid-3"), value) && value == "keyid-3");
+
+    // the range reads can not be tracked by key
+    map<string, string> elements;
+    pTrackedCache->GetAllElements(elements);
+    BOOST_CHECK(tracker.IsUnsafe());
+
+    CDBReadTracker simpleTracker(baseMutex);
+    auto pSimpleCache1 = make_shared< CSimpleKVCache<dbk::NICKID_KEYID, string> >(pDBAccess.get());
+    auto pSimpleCache2 = make_shared< CSimpleKVCache<dbk::NICKID_KEYID, string> >(pSimpleCache1.get());
+    pSimpleCache2->SetReadTracker(&simpleTracker);
+    pSimpleCache2->GetData(value);
+    BOOST_CHECK(simpleTracker.IsUnsafe());
+}
+
+BOOST_AUTO_TEST_CASE(dbcache_savepoint_rollback_test)
+{
+    const bool isWipe = true;
+    const dbk::PrefixType prefix = dbk::REGID_KEYID;
+    typedef CCompositeKVCache<prefix, string, string> StringCache;
+    shared_ptr<CDBAccess> pDBAccess = make_shared<CDBAccess>(
+        db_dir, DBNameType::ACCOUNT, false, isWipe);
+
+    auto pDBCache = make_shared<StringCache>(pDBAccess.get());
+    pDBCache->SetData("regid-1", "keyid-1");
+    pDBCache->SetData("regid-2", "keyid-2");
+    pDBCache->Flush();
+
+    auto pCache = make_shared<StringCache>(pDBCache.get());
+    pCache->SetData("regid-1", "keyid-1.1");
+    UndoDataFuncMap undoDataFuncMap;
+    pCache->RegisterUndoFunc(undoDataFuncMap);
+
+    // the writes after the savepoint are undone in place, including the ones to the same key
+    CDBOpLogMap savepointLogs;
+    pCache->SetDbOpLogMap(&savepointLogs);
+    pCache->SetData("regid-1", "keyid-1.2");
+    pCache->SetData("regid-1", "keyid-1.3");
+    pCache->EraseData("regid-2");
+    pCache->SetData("regid-3", "keyid-3");
+    pCache->SetDbOpLogMap(nullptr);
+    BOOST_CHECK(UndoDbOpLogMap(undoDataFuncMap, savepointLogs));
+
+    string value;
+    BOOST_CHECK(pCache->GetData(string("regid-1"), value) && value == "keyid-1.1");
+    BOOST_CHECK(pCache->GetData(string("regid-2"), value) && value == "keyid-2");
+    BOOST_CHECK(!pCache->HaveData(string("regid-3")));
+
+    pCache->Flush();
+    BOOST_CHECK(pDBCache->GetData(string("regid-1"), value) && value == "keyid-1.1");
+    BOOST_CHECK(pDBCache->GetData(string("regid-2"), value) && value == "keyid-2");
+    BOOST_CHECK(!pDBCache->HaveData(string("regid-3")));
+}
+
+BOOST_AUTO_TEST_CASE(dbcache_nested_savepoint_test)
+{
+    const bool isWipe = true;
+    BOOST_CHECK_NO_THROW(boost::filesystem::create_directories(db_dir / "account"));
+    BOOST_CHECK_NO_THROW(boost::filesystem::create_directories(db_dir / "contract"));
+    CDBAccess accountDb(db_dir / "account", DBNameType::ACCOUNT, false, isWipe);
+    CDBAccess contractDb(db_dir / "contract", DBNameType::CONTRACT, false, isWipe);
+    CAccountDBCache accountCache(&accountDb);
+    CContractDBCache contractCache(&contractDb);
+
+    CKey key;
+    key.MakeNewKey();
+    CAccount account(key.GetPubKey().GetKeyId(), CNickID(), key.GetPubKey());
+    BOOST_CHECK(account.OperateBalance(SYMB::WICC, BalanceOpType::ADD_FREE, 100));
+    BOOST_CHECK(accountCache.SetAccount(account.keyid, account));
+    const CRegID contractRegId(100, 1);
+    BOOST_CHECK(contractCache.SetContractData(contractRegId, "key-1", "value-1"));
+    BOOST_CHECK(accountCache.Flush() && contractCache.Flush());
+
+    CCacheWrapper cw;
+    cw.accountCache.SetBaseViewPtr(&accountCache);
+    cw.contractCache.SetBaseViewPtr(&contractCache);
+    auto addBalance = [&](uint64_t amount) {
+        CAccount acct;
+        BOOST_CHECK(cw.accountCache.GetAccount(account.keyid, acct));
+        BOOST_CHECK(acct.OperateBalance(SYMB::WICC, BalanceOpType::ADD_FREE, amount));
+        BOOST_CHECK(cw.accountCache.SetAccount(acct.keyid, acct));
+    };
+    auto checkState = [&](uint64_t balance, const vector<pair<string, string>> &contractData) {
+        CAccount acct;
+        BOOST_CHECK(cw.accountCache.GetAccount(account.keyid, acct));
+        BOOST_CHECK(acct.GetToken(SYMB::WICC).free_amount == balance);
+        for (const auto &item : contractData) {
+            string value;
+            bool found = cw.contractCache.GetContractData(contractRegId, item.first, value);
+            BOOST_CHECK(found == !item.second.empty() && value == item.second);
+        }
+    };
+
+    // the writes before the savepoints are never undone
+    BOOST_CHECK(cw.contractCache.SetContractData(contractRegId, "key-1", "value-1.1"));
+
+    cw.SetSavepoint();
+    addBalance(10);
+    BOOST_CHECK(cw.contractCache.SetContractData(contractRegId, "key-2", "value-2"));
+    BOOST_CHECK(cw.contractCache.EraseContractData(contractRegId, "key-1"));
+    {
+        // a released savepoint keeps its writes
+        cw.SetSavepoint();
+        addBalance(5);
+        BOOST_CHECK(cw.contractCache.SetContractData(contractRegId, "key-3", "value-3"));
+        BOOST_CHECK(cw.contractCache.SetContractData(contractRegId, "key-2", "value-2.1"));
+        cw.ReleaseSavepoint();
+        checkState(115, {{"key-1", ""}, {"key-2", "value-2.1"}, {"key-3", "value-3"}});
+
+        // a savepoint not committed rolls back its writes, including the ones of the keys of the outer savepoint
+        CCacheSavepoint savepoint(cw);
+        addBalance(1000);
+        BOOST_CHECK(cw.contractCache.SetContractData(contractRegId, "key-1", "value-1.x"));
+        BOOST_CHECK(cw.contractCache.EraseContractData(contractRegId, "key-2"));
+        checkState(1115, {{"key-1", "value-1.x"}, {"key-2", ""}, {"key-3", "value-3"}});
+    }
+    checkState(115, {{"key-1", ""}, {"key-2", "value-2.1"}, {"key-3", "value-3"}});
+
+    // the writes of the released inner savepoint are rolled back with the outer one
+    BOOST_CHECK(cw.RollbackToSavepoint());
+    checkState(100, {{"key-1", "value-1.1"}, {"key-2", ""}, {"key-3", ""}});
+
+    {
+        CCacheSavepoint savepoint(cw);
+        addBalance(1);
+        {
+            CCacheSavepoint innerSavepoint(cw);
+            BOOST_CHECK(cw.contractCache.SetContractData(contractRegId, "key-4", "value-4"));
+            innerSavepoint.Commit();
+        }
+        savepoint.Commit();
+    }
+    checkState(101, {{"key-1", "value-1.1"}, {"key-4", "value-4"}});
+
+    cw.Flush();
+    CAccount acct;
+    string value;
+    BOOST_CHECK(accountCache.GetAccount(account.keyid, acct) && acct.GetToken(SYMB::WICC).free_amount == 101);
+    BOOST_CHECK(contractCache.GetContractData(contractRegId, "key-1", value) && value == "value-1.1");
+    BOOST_CHECK(contractCache.GetContractData(contractRegId, "key-4", value) && value == "value-4");
+    BOOST_CHECK(!contractCache.GetContractData(contractRegId, "key-2", value));
+}
+
+BOOST_AUTO_TEST_CASE(dbcache_savepoint_failed_tx_test)
+{
+    const bool isWipe = true;
+    BOOST_CHECK_NO_THROW(boost::filesystem::create_directories(db_dir / "dex"));
+    BOOST_CHECK_NO_THROW(boost::filesystem::create_directories(db_dir / "contract"));
+    CDBAccess dexDb(db_dir / "dex", DBNameType::DEX, false, isWipe);
+    CDBAccess contractDb(db_dir / "contract", DBNameType::CONTRACT, false, isWipe);
+    CDexDBCache dexCache(&dexDb);
+    CContractDBCache contractCache(&contractDb);
+
+    DexID dexId = 0;
+    BOOST_CHECK(dexCache.IncDexID(dexId) && dexId == 1);
+    const CRegID contractRegId(100, 1);
+    BOOST_CHECK(contractCache.SetContractData(contractRegId, "key-1", "value-1"));
+    BOOST_CHECK(dexCache.Flush() && contractCache.Flush());
+
+    CCacheWrapper cw;
+    cw.dexCache.SetBaseViewPtr(&dexCache);
+    cw.contractCache.SetBaseViewPtr(&contractCache);
+    // the tx reads and writes the last dex id of a simple cache and writes the contract data of a composite cache
+    auto executeTx = [&](const string &value, bool fSuccess) {
+        CCacheSavepoint savepoint(cw);
+        DexID id = 0;
+        BOOST_CHECK(cw.dexCache.IncDexID(id));
+        BOOST_CHECK(cw.contractCache.SetContractData(contractRegId, "key-1", value));
+        BOOST_CHECK(cw.contractCache.SetContractData(contractRegId, "key-2", value));
+        if (fSuccess)
+            savepoint.Commit();
+        return id;
+    };
+    auto checkState = [&](DexID lastId, const string &value1, const string &value2) {
+        string value;
+        BOOST_CHECK(cw.contractCache.GetContractData(contractRegId, "key-1", value) && value == value1);
+        BOOST_CHECK(cw.contractCache.GetContractData(contractRegId, "key-2", value) == !value2.empty() &&
+                    value == value2);
+        // the next id of a failed tx is the one after the last id
+        BOOST_CHECK(executeTx("value-x", false) == lastId + 1);
+    };
+
+    // the first write of cw to the last dex id is rolled back to the value of the base cache
+    BOOST_CHECK(executeTx("value-1.1", false) == 2);
+    checkState(1, "value-1", "");
+
+    BOOST_CHECK(executeTx("value-1.2", true) == 2);
+    checkState(2, "value-1.2", "value-1.2");
+
+    BOOST_CHECK(executeTx("value-1.3", false) == 3);
+    checkState(2, "value-1.2", "value-1.2");
+
+    cw.Flush();
+    string value;
+    BOOST_CHECK(dexCache.IncDexID(dexId) && dexId == 3);
+    BOOST_CHECK(contractCache.GetContractData(contractRegId, "key-1", value) && value == "value-1.2");
+    BOOST_CHECK(contractCache.GetContractData(contractRegId, "key-2", value) && value == "value-1.2");
+}
+
+BOOST_AUTO_TEST_CASE(dbcache_layer_erase_test)
+{
+    const bool isWipe = true;
+    const dbk::PrefixType prefix = dbk::REGID_KEYID;
+    typedef CCompositeKVCache<prefix, string, string> StringCache;
+    typedef CCompositeKVCache<prefix, string, string, CFlatHashCacheStorage> HashCache;
+    shared_ptr<CDBAccess> pDBAccess = make_shared<CDBAccess>(
+        db_dir, DBNameType::ACCOUNT, false, isWipe);
+
+    auto pDBCache = make_shared<StringCache>(pDBAccess.get());
+    pDBCache->SetData("regid-1", "keyid-1");
+    pDBCache->SetData("regid-2", "keyid-2");
+    pDBCache->Flush();
+
+    auto pMapCache = make_shared<StringCache>(pDBCache.get());
+    auto pBaseHashCache = make_shared<HashCache>(pDBAccess.get());
+    auto pHashCache = make_shared<HashCache>(pBaseHashCache.get());
+    for (uint32_t i = 0; i < 100; i++) {
+        pMapCache->SetData(strprintf("regid-x%02u", i), "keyid-x");
+        pHashCache->SetData(strprintf("regid-x%02u", i), "keyid-x");
+    }
+    pMapCache->SetData("regid-1", "keyid-1.1");
+    pMapCache->EraseData("regid-2");
+    pHashCache->SetData("regid-1", "keyid-1.1");
+    pHashCache->EraseData("regid-2");
+
+    // the keys are dropped from the layer and read from the base caches again, instead of being set to a value
+    CDBOpLogMap eraseLogs;
+    CDbOpLogs &dbOpLogs = eraseLogs.GetMap()[dbk::GetKeyPrefix(prefix)];
+    for (const string key : {"regid-1", "regid-2", "regid-x07"}) {
+        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+        ssKey << key;
+        dbOpLogs.emplace_back();
+        dbOpLogs.back().SetLayerErase(ssKey.str());
+    }
+
+    // the flag is not written to the undo files, the op logs read from them always have values
+    CDataStream ssLogs(SER_DISK, CLIENT_VERSION);
+    ssLogs << eraseLogs;
+    CDBOpLogMap readLogs;
+    ssLogs >> readLogs;
+    const CDbOpLogs *pReadLogs = readLogs.GetDbOpLogsPtr(prefix);
+    BOOST_REQUIRE(pReadLogs != nullptr && pReadLogs->size() == dbOpLogs.size());
+    for (size_t i = 0; i < dbOpLogs.size(); i++) {
+        BOOST_CHECK(dbOpLogs[i].IsLayerErase() && !(*pReadLogs)[i].IsLayerErase());
+        BOOST_CHECK((*pReadLogs)[i].GetKey() == dbOpLogs[i].GetKey() && (*pReadLogs)[i].GetValue().empty());
+    }
+    BOOST_CHECK(!CDbOpLog(string(dbOpLogs[0].GetKey()), string()).IsLayerErase());
+
+    UndoDataFuncMap mapUndoFuncs, hashUndoFuncs;
+    pMapCache->RegisterUndoFunc(mapUndoFuncs);
+    pHashCache->RegisterUndoFunc(hashUndoFuncs);
+    BOOST_CHECK(UndoDbOpLogMap(mapUndoFuncs, eraseLogs));
+    BOOST_CHECK(UndoDbOpLogMap(hashUndoFuncs, eraseLogs));
+
+    string value;
+    BOOST_CHECK(pMapCache->GetData(string("regid-1"), value) && value == "keyid-1");
+    BOOST_CHECK(pMapCache->GetData(string("regid-2"), value) && value == "keyid-2");
+    BOOST_CHECK(!pMapCache->HaveData(string("regid-x07")));
+    BOOST_CHECK(pMapCache->HaveData(string("regid-x08")));
+    BOOST_CHECK(pMapCache->GetCacheItemCount() == 99);
+
+    BOOST_CHECK(pHashCache->GetData(string("regid-1"), value) && value == "keyid-1");
+    BOOST_CHECK(pHashCache->GetData(string("regid-2"), value) && value == "keyid-2");
+    BOOST_CHECK(!pHashCache->HaveData(string("regid-x07")));
+    for (uint32_t i = 0; i < 100; i++) {
+        BOOST_CHECK(i == 7 || pHashCache->HaveData(strprintf("regid-x%02u", i)));
+    }
+    BOOST_CHECK(pHashCache->GetCacheItemCount() == 99);
+}
+
+BOOST_AUTO_TEST_CASE(dbcache_flat_hash_storage_test)
+{
+    const bool isWipe = true;
+    const dbk::PrefixType prefix = dbk::REGID_KEYID;
+    shared_ptr<CDBAccess> pDBAccess = make_shared<CDBAccess>(
+        db_dir, DBNameType::ACCOUNT, false, isWipe);
+    typedef CCompositeKVCache<prefix, string, string, CFlatHashCacheStorage> HashCache;
+
+    auto pDBCache1 = make_shared<HashCache>(pDBAccess.get());
+    auto pDBCache2 = make_shared<HashCache>(pDBCache1.get());
+    for (uint32_t i = 0; i < 1000; i++) {
+        pDBCache2->SetData(strprintf("regid-%04u", i), strprintf("keyid-%04u", i));
+    }
+    pDBCache2->SetData("regid-0007", "keyid-0007.1");
+    pDBCache2->EraseData("regid-0005");
+    string value;
+    BOOST_CHECK(pDBCache2->GetData(string("regid-0999"), value) && value == "keyid-0999");
+    BOOST_CHECK(pDBCache2->GetData(string("regid-0007"), value) && value == "keyid-0007.1");
+    BOOST_CHECK(!pDBCache2->HaveData(string("regid-0005")));
+    pDBCache2->Flush();
+    pDBCache1->Flush();
+
+    map<string, string> elements;
+    BOOST_CHECK(pDBCache1->GetAllElements(elements) && elements.size() == 999);
+    set<string> keys;
+    BOOST_CHECK(pDBCache1->GetTopNElements(3, keys));
+    BOOST_CHECK(keys == set<string>({"regid-0000", "regid-0001", "regid-0002"}));
+
+    // ordered views of a cached layer
+    auto pDBCache3 = make_shared<HashCache>(pDBCache1.get());
+    pDBCache3->SetData("regid-a", "keyid-a");
+    pDBCache3->EraseData("regid-0000");
+    BOOST_CHECK(pDBCache3->GetData(string("regid-0001"), value) && value == "keyid-0001");
+    BOOST_CHECK(pDBCache3->GetMapData().begin()->first == "regid-0000");
+    map<string, string> lowElements;
+    BOOST_CHECK(pDBCache3->GetAllElements(string("regid-0099x"), lowElements));
+    BOOST_CHECK(lowElements.size() == 98 && !lowElements.count("regid-0000"));
+    keys.clear();
+    BOOST_CHECK(pDBCache3->GetTopNElements(2, keys));
+    BOOST_CHECK(keys == set<string>({"regid-0001", "regid-0002"}));
+
+    // the ordered views and iterators of a layer do not depend on each other
+    auto snapshot = pDBCache3->GetMapData();
+    pDBCache3->SetData("regid-b", "keyid-b");
+    BOOST_CHECK(snapshot.size() == 2 && pDBCache3->GetMapData().size() == 3);
+    CCacheMapIterator<HashCache> it1(*pDBCache3), it2(*pDBCache3);
+    BOOST_CHECK(it1.First() && it1.GetKey() == "regid-0000");
+    BOOST_CHECK(it2.SeekUpper(&it1.GetKey()) && it2.GetKey() == "regid-a");
+    BOOST_CHECK(pDBCache3->GetMapData().size() == 3);
+    BOOST_CHECK(it1.Next() && it1.GetKey() == "regid-a");
+    BOOST_CHECK(it2.Next() && it2.GetKey() == "regid-b" && !it2.Next());
+    BOOST_CHECK(snapshot.begin()->first == "regid-0000" && snapshot.rbegin()->first == "regid-a");
+}
+
+// swap the values of two keys in every tx layer over a block layer, as the txs of a block do
+template<typename CacheType, typename MakeValueFunc>
+static map<typename CacheType::KeyType, typename CacheType::ValueType> SwapCacheValues(CDBAccess *pDBAccess,
+        const vector<typename CacheType::KeyType> &keys, MakeValueFunc makeValue) {
+    CacheType dbCache(pDBAccess);
+    for (uint32_t i = 0; i < keys.size(); i++) {
+        dbCache.SetData(keys[i], makeValue(i));
+    }
+    dbCache.Flush();
+
+    CacheType blockCache(&dbCache);
+    for (uint32_t i = 0; i < 2 * keys.size(); i++) {
+        CacheType txCache(&blockCache);
+        const auto &from = keys[(i * 7919) % keys.size()];
+        const auto &to   = keys[(i * 104729 + 1) % keys.size()];
+        typename CacheType::ValueType fromValue, toValue;
+        BOOST_CHECK(txCache.GetData(from, fromValue) && txCache.GetData(to, toValue));
+        txCache.SetData(from, toValue);
+        txCache.SetData(to, fromValue);
+        txCache.Flush();
+    }
+
+    map<typename CacheType::KeyType, typename CacheType::ValueType> elements;
+    BOOST_CHECK(blockCache.GetAllElements(elements) && elements.size() == keys.size());
+    return elements;
+}
+
+BOOST_AUTO_TEST_CASE(dbcache_flat_hash_equivalence_test)
+{
+    // the accountCache and contractCache workloads leave the same data by both storages
+    vector<CKeyID> keyIds;
+    vector<CRegIDKey> regIds;
+    for (uint32_t i = 0; i < 200; i++) {
+        keyIds.push_back(CKeyID(Hash160(strprintf("keyid-%u", i))));
+        regIds.push_back(CRegIDKey(CRegID(100000 + i / 100, i % 100)));
+    }
+
+    auto makeAccount = [&](uint32_t i) {
+        CAccount account(keyIds[i]);
+        account.regid = regIds[i].regid;
+        account.OperateBalance(SYMB::WICC, BalanceOpType::ADD_FREE, 10000 + i);
+        return account;
+    };
+    CDBAccess accountMapDb(db_dir / "account_map", DBNameType::ACCOUNT, true, true);
+    CDBAccess accountHashDb(db_dir / "account_hash", DBNameType::ACCOUNT, true, true);
+    auto mapAccounts = SwapCacheValues<CCompositeKVCache<dbk::KEYID_ACCOUNT, CKeyID, CAccount>>(
+        &accountMapDb, keyIds, makeAccount);
+    auto hashAccounts = SwapCacheValues<CCompositeKVCache<dbk::KEYID_ACCOUNT, CKeyID, CAccount, CFlatHashCacheStorage>>(
+        &accountHashDb, keyIds, makeAccount);
+    BOOST_CHECK(mapAccounts.size() == hashAccounts.size());
+    for (const auto &item : mapAccounts) {
+        BOOST_CHECK(hashAccounts[item.first].ToString() == item.second.ToString());
+    }
+
+    auto makeContract = [](uint32_t i) {
+        return CUniversalContract(string(512 + i % 512, 'c'), strprintf("contract-%u", i));
+    };
+    CDBAccess contractMapDb(db_dir / "contract_map", DBNameType::CONTRACT, true, true);
+    CDBAccess contractHashDb(db_dir / "contract_hash", DBNameType::CONTRACT, true, true);
+    auto mapContracts = SwapCacheValues<CCompositeKVCache<dbk::CONTRACT_DEF, CRegIDKey, CUniversalContract>>(
+        &contractMapDb, regIds, makeContract);
+    auto hashContracts = SwapCacheValues<
+        CCompositeKVCache<dbk::CONTRACT_DEF, CRegIDKey, CUniversalContract, CFlatHashCacheStorage>>(
+        &contractHashDb, regIds, makeContract);
+    BOOST_CHECK(mapContracts.size() == hashContracts.size());
+    for (const auto &item : mapContracts) {
+        BOOST_CHECK(hashContracts[item.first].code == item.second.code);
+        BOOST_CHECK(hashContracts[item.first].memo == item.second.memo);
+    }
+}
+
+template<typename CacheType>
+static void CheckRangeIterator(CDBAccess *pDBAccess) {
+    // db: 0..99 even, db cache: 0..99 multiple of 3, top: 50..59 and erased 0, 2, 60
+    CacheType dbCache(pDBAccess);
+    for (uint32_t i = 0; i < 100; i += 2) {
+        dbCache.SetData(strprintf("regid-%04u", i), strprintf("db-%u", i));
+    }
+    dbCache.Flush();
+    for (uint32_t i = 0; i < 100; i += 3) {
+        dbCache.SetData(strprintf("regid-%04u", i), strprintf("cache-%u", i));
+    }
+    CacheType topCache(&dbCache);
+    for (uint32_t i = 50; i < 60; i++) {
+        topCache.SetData(strprintf("regid-%04u", i), strprintf("top-%u", i));
+    }
+    topCache.EraseData(string("regid-0000"));
+    topCache.EraseData(string("regid-0002"));
+    topCache.EraseData(string("regid-0060"));
+
+    map<string, string> expected;
+    for (uint32_t i = 0; i < 100; i++) {
+        string key = strprintf("regid-%04u", i);
+        if (i == 0 || i == 2 || i == 60)
+            continue;
+        else if (i >= 50 && i < 60)
+            expected[key] = strprintf("top-%u", i);
+        else if (i % 3 == 0)
+            expected[key] = strprintf("cache-%u", i);
+        else if (i % 2 == 0)
+            expected[key] = strprintf("db-%u", i);
+    }
+
+    map<string, string> got;
+    CDBRangeIterator<CacheType> it(topCache);
+    for (it.First(); it.IsValid(); it.Next()) {
+        BOOST_CHECK(got.empty() || got.rbegin()->first < it.GetKey());
+        got[it.GetKey()] = it.GetValue();
+    }
+    BOOST_CHECK(got == expected);
+
+    // [begin, end]
+    string beginKey = "regid-0045", endKey = "regid-0062";
+    got.clear();
+    CDBRangeIterator<CacheType> rangeIt(topCache, &beginKey, &endKey);
+    for (rangeIt.First(); rangeIt.IsValid(); rangeIt.Next()) {
+        got[rangeIt.GetKey()] = rangeIt.GetValue();
+    }
+    map<string, string> expectedRange(expected.lower_bound(beginKey), expected.upper_bound(endKey));
+    BOOST_CHECK(got == expectedRange);
+
+    BOOST_CHECK(rangeIt.Seek(string("regid-0059")) && rangeIt.GetKey() == "regid-0059");
+    BOOST_CHECK(rangeIt.Next() && rangeIt.GetKey() == "regid-0062"); // 60 is erased and 61 does not exist
+    BOOST_CHECK(!rangeIt.Next());
+    BOOST_CHECK(rangeIt.Seek(string("regid-0001")) && rangeIt.GetKey() == "regid-0045");
+    BOOST_CHECK(!rangeIt.Seek(string("regid-0070")));
+
+    // backward
+    string prevKey;
+    string firstKey = "regid-0000", lastKey = "regid-0099";
+    BOOST_CHECK(FindPrevKey(topCache, firstKey, lastKey, true, prevKey) && prevKey == "regid-0099");
+    BOOST_CHECK(FindPrevKey(topCache, firstKey, string("regid-0061"), false, prevKey) && prevKey == "regid-0059");
+    BOOST_CHECK(FindPrevKey(topCache, firstKey, string("regid-0059"), true, prevKey) && prevKey == "regid-0059");
+    BOOST_CHECK(FindPrevKey(topCache, firstKey, string("regid-0004"), false, prevKey) && prevKey == "regid-0003");
+    BOOST_CHECK(!FindPrevKey(topCache, firstKey, string("regid-0003"), false, prevKey));
+    BOOST_CHECK(!FindPrevKey(topCache, string("regid-0045"), string("regid-0045"), false, prevKey));
+}
+
+BOOST_AUTO_TEST_CASE(dbcache_range_iterator_test)
+{
+    shared_ptr<CDBAccess> pDBAccess = make_shared<CDBAccess>(
+        db_dir, DBNameType::ACCOUNT, false, true);
+    CheckRangeIterator<CCompositeKVCache<dbk::REGID_KEYID, string, string>>(pDBAccess.get());
+
+    BOOST_CHECK_NO_THROW(boost::filesystem::create_directory(db_dir / "hash"));
+    shared_ptr<CDBAccess> pHashDBAccess = make_shared<CDBAccess>(
+        db_dir / "hash", DBNameType::ACCOUNT, false, true);
+    CheckRangeIterator<CCompositeKVCache<dbk::REGID_KEYID, string, string, CFlatHashCacheStorage>>(
+        pHashDBAccess.get());
+}
+
+template<typename StringCache>
+static void CheckRangeIteratorDbOrder(CDBAccess *pDBAccess) {
+    // a string key is serialized with its size first, so "b" is before "aa" in db
+    StringCache dbCache(pDBAccess);
+    for (const string key : {"aa", "b", "abc", "c"}) {
+        dbCache.SetData(key, "db-" + key);
+    }
+    dbCache.Flush();
+    for (const string key : {"ab", "d", "bcd"}) {
+        dbCache.SetData(key, "cache-" + key);
+    }
+    StringCache topCache(&dbCache);
+    topCache.SetData(string("b"), string("top-b"));
+    topCache.SetData(string("ac"), string("top-ac"));
+    topCache.EraseData(string("abc"));
+
+    vector<pair<string, string>> got;
+    CDBRangeIterator<StringCache> it(topCache);
+    for (it.First(); it.IsValid(); it.Next()) {
+        got.emplace_back(it.GetKey(), it.GetValue());
+    }
+    vector<pair<string, string>> expected = {{"b", "top-b"}, {"c", "db-c"}, {"d", "cache-d"},
+        {"aa", "db-aa"}, {"ab", "cache-ab"}, {"ac", "top-ac"}, {"bcd", "cache-bcd"}};
+    BOOST_CHECK(got == expected);
+
+    // the bounds are in db order and the end is included
+    string beginKey = "d", endKey = "ac";
+    got.clear();
+    CDBRangeIterator<StringCache> rangeIt(topCache, &beginKey, &endKey);
+    for (rangeIt.First(); rangeIt.IsValid(); rangeIt.Next()) {
+        got.emplace_back(rangeIt.GetKey(), rangeIt.GetValue());
+    }
+    vector<pair<string, string>> expectedRange(expected.begin() + 2, expected.begin() + 6);
+    BOOST_CHECK(got == expectedRange);
+    BOOST_CHECK(rangeIt.Seek(string("ab")) && rangeIt.GetKey() == "ab");
+    BOOST_CHECK(!rangeIt.Seek(string("aaa")));
+}
+
+BOOST_AUTO_TEST_CASE(dbcache_range_iterator_db_order_test)
+{
+    // the layers of the default storage are sorted by db keys, the ones of the db key storage are positioned
+    shared_ptr<CDBAccess> pDBAccess = make_shared<CDBAccess>(
+        db_dir, DBNameType::ACCOUNT, false, true);
+    CheckRangeIteratorDbOrder<CCompositeKVCache<dbk::REGID_KEYID, string, string>>(pDBAccess.get());
+
+    BOOST_CHECK_NO_THROW(boost::filesystem::create_directory(db_dir / "dbkey"));
+    shared_ptr<CDBAccess> pDbKeyDBAccess = make_shared<CDBAccess>(
+        db_dir / "dbkey", DBNameType::ACCOUNT, false, true);
+    CheckRangeIteratorDbOrder<CCompositeKVCache<dbk::REGID_KEYID, string, string, CDbKeyMapCacheStorage>>(
+        pDbKeyDBAccess.get());
+
+    // the keys of which operator< is the db order
+    BOOST_CHECK((dbk::CDbKeyOrder<DEXBlockOrdersCache::KeyType>::IS_DB_ORDER));
+    BOOST_CHECK((dbk::CDbKeyOrder<DBContractDataCache::KeyType>::IS_DB_ORDER));
+    BOOST_CHECK((!dbk::CDbKeyOrder<CdpRatioSortedCache::KeyType>::IS_DB_ORDER));
+    BOOST_CHECK((!dbk::CDbKeyOrder<pair<CDBContractKey, CRegIDKey>>::IS_DB_ORDER));
+    BOOST_CHECK((!dbk::CDbKeyOrder<CFixedLeb128<int64_t>>::IS_DB_ORDER));
+    BOOST_CHECK((CdpRatioSortedCache::Storage::DB_KEY_ORDERED));
+
+    // the coin pairs are ordered by bcoin and then scoin
+    CCdpCoinPair pairA("A", "Z"), pairB("B", "Y");
+    BOOST_CHECK(pairA < pairB && !(pairB < pairA));
+    BOOST_CHECK(!(pairA < pairA));
+}
+
+BOOST_AUTO_TEST_CASE(dbcache_contract_code_hash_fill_test)
+{
+    CDBAccess contractDb(db_dir, DBNameType::CONTRACT, false, true);
+    CContractDBCache contractCache(&contractDb);
+
+    // a contract saved before the code hashes, and one saved with its code hash
+    const CRegID oldRegId(100, 1), newRegId(100, 2);
+    const CUniversalContract oldContract(string("old code"), string("old"));
+    const CUniversalContract newContract(string("new code"), string("new"));
+    BOOST_CHECK(contractCache.contractCache.SetData(oldRegId, oldContract));
+    BOOST_CHECK(contractCache.SaveContract(newRegId, newContract));
+    BOOST_CHECK(contractCache.Flush());
+    BOOST_CHECK(!contractCache.contractCodeHashCache.HaveData(oldRegId));
+
+    uint32_t filledCount = 0;
+    BOOST_CHECK(contractCache.FillContractCodeHashes(filledCount) && filledCount == 1);
+    BOOST_CHECK(contractCache.Flush());
+    uint256 codeHash;
+    BOOST_CHECK(contractCache.contractCodeHashCache.GetData(oldRegId, codeHash));
+    BOOST_CHECK(codeHash == Hash(oldContract.code.begin(), oldContract.code.end()));
+    BOOST_CHECK(contractCache.GetContractCodeHash(newRegId, codeHash));
+    BOOST_CHECK(codeHash == Hash(newContract.code.begin(), newContract.code.end()));
+
+    // filled once for a db
+    CContractDBCache reopenedCache(&contractDb);
+    BOOST_CHECK(reopenedCache.contractCache.SetData(CRegID(100, 3), oldContract));
+    BOOST_CHECK(reopenedCache.FillContractCodeHashes(filledCount) && filledCount == 0);
+}
+
+BOOST_AUTO_TEST_CASE(dbcache_contract_data_key_steps_test)
+{
+    CDBAccess contractDb(db_dir, DBNameType::CONTRACT, false, true);
+    CContractDBCache dbCache(&contractDb);
+    const CRegID regId(100, 1);
+    for (const string key : {"a", "b", "c", "d", "e"}) {
+        BOOST_CHECK(dbCache.SetContractData(regId, key, "value-" + key));
+    }
+    BOOST_CHECK(dbCache.Flush());
+
+    // the keys erased in the top cache are visited and skipped
+    CContractDBCache topCache(&dbCache);
+    BOOST_CHECK(topCache.EraseContractData(regId, "b"));
+    BOOST_CHECK(topCache.EraseContractData(regId, "c"));
+    BOOST_CHECK(topCache.EraseContractData(regId, "d"));
+
+    string key;
+    uint32_t steps = 0;
+    BOOST_CHECK(topCache.GetNextContractDataKey(regId, "a", true, key, &steps) && key == "a" && steps == 1);
+    steps = 0;
+    BOOST_CHECK(topCache.GetNextContractDataKey(regId, "a", false, key, &steps) && key == "e" && steps == 5);
+    steps = 0;
+    BOOST_CHECK(!topCache.GetNextContractDataKey(regId, "e", false, key, &steps) && steps == 1);
+
+    const string upperKey = "e";
+    steps = 0;
+    BOOST_CHECK(topCache.GetPrevContractDataKey(regId, &upperKey, key, &steps) && key == "a" && steps == 4);
+    steps = 0;
+    BOOST_CHECK(topCache.GetPrevContractDataKey(regId, nullptr, key, &steps) && key == "e" && steps == 1);
+    const string firstKey = "a";
+    steps = 0;
+    BOOST_CHECK(!topCache.GetPrevContractDataKey(regId, &firstKey, key, &steps) && steps == 0);
+}
+
+BOOST_AUTO_TEST_CASE(dbcache_contract_data_handle_test)
+{
+    // the storage calls by a contract data handle leave the same data as the calls by contract regid
+    CDBAccess contractDb(db_dir, DBNameType::CONTRACT, false, true);
+    CContractDBCache dbCache(&contractDb);
+    const CRegID regId(100, 1);
+    const uint32_t keyCount = 100;
+    for (uint32_t i = 0; i < keyCount; i++) {
+        BOOST_CHECK(dbCache.SetContractData(regId, strprintf("table-%04u", i), "init"));
+    }
+    BOOST_CHECK(dbCache.Flush());
+
+    CContractDBCache perCallCache(&dbCache), handleCache(&dbCache);
+    CContractDataHandle storage(handleCache, regId);
+    for (uint32_t i = 0; i < 4 * keyCount; i++) {
+        string key = strprintf("table-%04u", (i * 7919) % keyCount), perCallValue, handleValue;
+        if (i % 4 == 0) {
+            BOOST_CHECK(perCallCache.SetContractData(regId, key, strprintf("value-%u", i)));
+            BOOST_CHECK(storage.Set(key, strprintf("value-%u", i)));
+        } else if (i % 7 == 0) {
+            BOOST_CHECK(perCallCache.EraseContractData(regId, key) == storage.Erase(key));
+        } else {
+            BOOST_CHECK(perCallCache.GetContractData(regId, key, perCallValue) == storage.Get(key, handleValue));
+            BOOST_CHECK(perCallValue == handleValue);
+        }
+    }
+
+    string perCallKey, handleKey;
+    for (uint32_t i = 0; i < keyCount; i++) {
+        string key = strprintf("table-%04u", i), perCallValue, handleValue;
+        BOOST_CHECK(perCallCache.GetContractData(regId, key, perCallValue) == storage.Get(key, handleValue));
+        BOOST_CHECK(perCallValue == handleValue);
+        BOOST_CHECK(perCallCache.GetNextContractDataKey(regId, key, false, perCallKey) ==
+                    storage.GetNextKey(key, false, handleKey));
+        BOOST_CHECK(perCallKey == handleKey);
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
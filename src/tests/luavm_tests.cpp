@@ -0,0 +1,89 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "main.h"
+#include "vm/luavm/luavm.h"
+#include "vm/luavm/lua/lua.hpp"
+
+#include <string>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+
+static const uint64_t TEST_FUEL_LIMIT = 1000000;
+static const uint32_t TEST_POOL_SIZE  = 4;
+
+// parse the address argument as a contract of startcontracttpstest, without the functions of mylib
+static const string TEST_CONTRACT_CODE =
+    "local chars = {}\n"
+    "for i = 1, #contract do\n"
+    "    chars[i] = string.char(contract[i])\n"
+    "end\n"
+    "local addr = table.concat(chars)\n"
+    "local counts = {}\n"
+    "for c in string.gmatch(addr, '%w') do\n"
+    "    counts[c] = (counts[c] or 0) + 1\n"
+    "end\n"
+    "gCheckAccount = #addr == 34\n";
+
+static const string TEST_CONTRACT_ARGUMENTS = "whmD4M8Q8qbEx6R5gULbcb5ZkedbcRDGY1";
+
+// run the contract as CLuaVM::Run() does, return the burned fuel
+static uint64_t RunTestContract(lua_State *L) {
+    BOOST_CHECK(lua_RearmBurner(L, nullptr, TEST_FUEL_LIMIT));
+
+    lua_newtable(L);
+    lua_pushnumber(L, -1);
+    lua_rawseti(L, -2, 0);
+    for (size_t i = 0; i < TEST_CONTRACT_ARGUMENTS.size(); i++) {
+        lua_pushinteger(L, (uint8_t)TEST_CONTRACT_ARGUMENTS[i]);
+        lua_rawseti(L, -2, i + 1);
+    }
+    lua_setglobal(L, "contract");
+
+    int luaStatus = luaL_loadbuffer(L, TEST_CONTRACT_CODE.c_str(), TEST_CONTRACT_CODE.size(), "line");
+    if (luaStatus == LUA_OK)
+        luaStatus = lua_pcallk(L, 0, 0, 0, 0, NULL, BURN_VER_STEP_V1);
+    BOOST_CHECK(luaStatus == LUA_OK);
+
+    BOOST_CHECK(lua_getglobal(L, "gCheckAccount") == LUA_TBOOLEAN && lua_toboolean(L, -1));
+    lua_pop(L, 1);
+    return lua_GetBurnedFuel(L);
+}
+
+BOOST_AUTO_TEST_SUITE(luavm_tests)
+
+BOOST_AUTO_TEST_CASE(luavm_state_pool_test)
+{
+    const int32_t burnVersion = MAJOR_VER_R2;
+
+    // the fuel of the libs is counted in the fuel limit
+    lua_State *L = CLuaStatePool::NewState(burnVersion);
+    BOOST_REQUIRE(L != nullptr);
+    BOOST_CHECK(lua_GetBurnedFuel(L) > 0);
+    BOOST_CHECK(!lua_RearmBurner(L, nullptr, lua_GetBurnedFuel(L) - 1));
+    uint64_t newStateFuel = RunTestContract(L);
+    lua_close(L);
+
+    // the first acquiring fills the pool in background
+    CLuaStatePool pool(TEST_POOL_SIZE);
+    BOOST_CHECK(pool.Acquire(burnVersion) == nullptr);
+
+    // a pooled state burns the same fuel as a new one, including the memory of the libs
+    uint32_t pooled = 0;
+    for (uint32_t i = 0; i < 100 && pooled < 2 * TEST_POOL_SIZE; i++) {
+        L = pool.Acquire(burnVersion);
+        if (L == nullptr) {
+            MilliSleep(10);
+            continue;
+        }
+        pooled++;
+        BOOST_CHECK_EQUAL(RunTestContract(L), newStateFuel);
+        pool.Release(L);
+    }
+    BOOST_CHECK(pooled > 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,158 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "main.h"
+#include "persistence/cachewrapper.h"
+#include "tx/cointransfertx.h"
+#include "tx/txmempool.h"
+
+#include <set>
+#include <string>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+
+static const int32_t TEST_HEIGHT    = 100;
+static const uint32_t TEST_SENDERS  = 2;
+static const uint64_t TEST_BALANCE  = 100 * COIN;
+static const uint64_t TEST_FEES     = 10000;
+
+// the chain of which the tip is at TEST_HEIGHT, the senders and the receiver are registered accounts
+struct FMempoolTests {
+    FMempoolTests() {
+        data_dir = boost::filesystem::path("/tmp/coind_unit_test") / "mempool_tests";
+        boost::filesystem::remove_all(data_dir);
+        BOOST_CHECK_NO_THROW(boost::filesystem::create_directories(data_dir));
+        CBaseParams::SoftSetArgCover("-datadir", data_dir.string());
+        BOOST_CHECK_NO_THROW(boost::filesystem::create_directories(GetDataDir() / "blocks"));
+
+        LOCK(cs_main);
+        pCdMan = new CCacheDBManager(true, false);
+        for (uint32_t i = 0; i <= TEST_SENDERS; i++) {
+            CKey key;
+            key.MakeNewKey();
+            CAccount account(key.GetPubKey().GetKeyId(), CNickID(), key.GetPubKey());
+            account.regid = CRegID(1, i + 1);
+            BOOST_CHECK(account.OperateBalance(SYMB::WICC, BalanceOpType::ADD_FREE, TEST_BALANCE));
+            BOOST_CHECK(pCdMan->pAccountCache->SaveAccount(account));
+            keys.push_back(key);
+        }
+
+        tip.height    = TEST_HEIGHT;
+        tip.nTime     = GetTime();
+        tip.nFuelRate = INIT_FUEL_RATES;
+        chainActive.SetTip(&tip);
+        mempool.SetMemPoolCache();
+    }
+
+    ~FMempoolTests() {
+        LOCK(cs_main);
+        mempool.Clear();
+        mempool.cw.reset();
+        chainActive.SetTip(nullptr);
+        delete pCdMan;
+        pCdMan = nullptr;
+        BOOST_CHECK_NO_THROW(boost::filesystem::remove_all(data_dir));
+    }
+
+    // a transfer of the sender to the receiver, signed by key
+    CBaseCoinTransferTx MakeTx(uint32_t sender, uint64_t amount, const CKey &key) {
+        CBaseCoinTransferTx tx(CRegID(1, sender + 1), CRegID(1, TEST_SENDERS + 1), TEST_HEIGHT, amount, TEST_FEES, "");
+        BOOST_CHECK(key.Sign(tx.GetHash(), tx.signature));
+        return tx;
+    }
+
+    bool Accept(CBaseCoinTransferTx &tx, bool fPreAccepted) {
+        LOCK(cs_main);
+        CValidationState state;
+        return AcceptToMemoryPool(mempool, state, &tx, false, false, fPreAccepted);
+    }
+
+    boost::filesystem::path data_dir;
+    vector<CKey> keys;
+    CBlockIndex tip;
+};
+
+// the priority of the tx in the mempool, with the fee per KB computed as the priority index of the mempool
+static TxPriority MakeTxPriority(const shared_ptr<CBaseTx> &pTx) {
+    CTxMemPoolEntry entry(pTx.get(), GetTime(), 1);
+    double feePerKb = double(std::get<1>(entry.GetFees())) / entry.GetTxSize() * 1000.0;
+    return TxPriority(entry.GetPriority(), feePerKb, entry.GetTransaction());
+}
+
+BOOST_AUTO_TEST_SUITE(mempool_tests)
+
+BOOST_AUTO_TEST_CASE(tx_priority_order_test)
+{
+    // the small tx has the higher priority, the big one pays more per KB
+    auto pSmallTx = make_shared<CBaseCoinTransferTx>(CRegID(1, 1), CRegID(1, 2), 1, 10000, 100000, "");
+    auto pBigTx   = make_shared<CBaseCoinTransferTx>(CRegID(1, 1), CRegID(1, 2), 1, 10000, 1000000, string(300, 'm'));
+    TxPriority smallTx = MakeTxPriority(pSmallTx), bigTx = MakeTxPriority(pBigTx);
+    BOOST_CHECK(smallTx.priority > bigTx.priority && smallTx.feePerKb < bigTx.feePerKb);
+
+    // the ordinary txs are ranked by fee, the price txs are above all of them
+    set<TxPriority> index = {smallTx, bigTx};
+    index.emplace(PRICE_MEDIAN_TRANSACTION_PRIORITY, 0, make_shared<CBaseCoinTransferTx>());
+    index.emplace(PRICE_FEED_TRANSACTION_PRIORITY, 0, make_shared<CBaseCoinTransferTx>(CRegID(1, 3), CRegID(1, 2), 1,
+                                                                                       10000, 10000, ""));
+    vector<double> priorities;
+    for (auto it = index.rbegin(); it != index.rend(); it++) {
+        priorities.push_back(it->priority);
+    }
+    BOOST_CHECK(priorities == vector<double>({PRICE_FEED_TRANSACTION_PRIORITY, PRICE_MEDIAN_TRANSACTION_PRIORITY,
+                                              bigTx.priority, smallTx.priority}));
+
+    // the same class and fee, the ties are broken by txid
+    auto pOtherTx = make_shared<CBaseCoinTransferTx>(CRegID(1, 4), CRegID(1, 2), 1, 10000, 100000, "");
+    TxPriority otherTx = MakeTxPriority(pOtherTx);
+    BOOST_CHECK(otherTx.feePerKb == smallTx.feePerKb);
+    BOOST_CHECK((smallTx < otherTx) != (otherTx < smallTx));
+    BOOST_CHECK(!(smallTx < smallTx));
+}
+
+BOOST_FIXTURE_TEST_CASE(tx_pre_accept_test, FMempoolTests)
+{
+    CValidationState state;
+
+    // a pre-accepted tx is accepted without the mempool checks again
+    CBaseCoinTransferTx tx = MakeTx(0, DUST_AMOUNT_THRESHOLD, keys[0]);
+    BOOST_CHECK(PreAcceptToMemoryPool(mempool, state, &tx));
+    BOOST_CHECK(Accept(tx, true));
+    BOOST_CHECK(mempool.Exists(tx.GetHash()));
+
+    // a duplicate pre-accepted before the first one is added is caught by the acceptance
+    CBaseCoinTransferTx dupTx = MakeTx(1, DUST_AMOUNT_THRESHOLD, keys[1]), sameTx = dupTx;
+    BOOST_CHECK(PreAcceptToMemoryPool(mempool, state, &dupTx));
+    BOOST_CHECK(PreAcceptToMemoryPool(mempool, state, &sameTx));
+    BOOST_CHECK(Accept(dupTx, true));
+    BOOST_CHECK(!Accept(sameTx, true));
+    BOOST_CHECK(!PreAcceptToMemoryPool(mempool, state, &sameTx));
+    BOOST_CHECK(mempool.Size() == 2);
+
+    // the regid of the sender is given to another owner, the cached pubkey of the regid is stale now
+    CKey newKey;
+    newKey.MakeNewKey();
+    {
+        LOCK2(cs_main, mempool.cs);
+        CAccount account(newKey.GetPubKey().GetKeyId(), CNickID(), newKey.GetPubKey());
+        account.regid = CRegID(1, 1);
+        BOOST_CHECK(account.OperateBalance(SYMB::WICC, BalanceOpType::ADD_FREE, TEST_BALANCE));
+        BOOST_CHECK(mempool.cw->accountCache.SaveAccount(account));
+    }
+
+    // the tx signed by the old owner passes the pre-verification by the stale pubkey, but CheckTx() rejects it
+    CBaseCoinTransferTx staleTx = MakeTx(0, DUST_AMOUNT_THRESHOLD + 1, keys[0]);
+    BOOST_CHECK(PreAcceptToMemoryPool(mempool, state, &staleTx));
+    BOOST_CHECK(!Accept(staleTx, true));
+    BOOST_CHECK(!mempool.Exists(staleTx.GetHash()));
+
+    // the tx of the new owner is accepted
+    CBaseCoinTransferTx newOwnerTx = MakeTx(0, DUST_AMOUNT_THRESHOLD + 2, newKey);
+    BOOST_CHECK(PreAcceptToMemoryPool(mempool, state, &newOwnerTx));
+    BOOST_CHECK(Accept(newOwnerTx, true));
+    BOOST_CHECK(mempool.Size() == 3);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
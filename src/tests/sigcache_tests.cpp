@@ -0,0 +1,91 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "sigcache.h"
+
+#include <vector>
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+
+typedef CSignatureCache::CEntry CEntry;
+
+static const uint64_t TEST_SHARDS      = 16;  // SIG_CACHE_SHARDS
+static const uint64_t TEST_SHARD_SLOTS = 16;  // the table size of a shard, 12 entries at most
+
+// an entry of shard 0 of which the home slot is home
+static CEntry MakeEntry(uint64_t home, uint64_t id) {
+    CEntry entry;
+    entry.h1 = (id << 8) | home;
+    entry.h2 = (id + 1) * TEST_SHARDS;
+    return entry;
+}
+
+// the count of the entries found in the cache
+static uint64_t CountFound(CSignatureCache &cache, const vector<CEntry> &entries) {
+    vector<bool> results;
+    cache.GetBatch(entries, results);
+    uint64_t found = 0;
+    for (size_t i = 0; i < entries.size(); i++) {
+        BOOST_CHECK(results[i] == cache.Get(entries[i]));
+        found += results[i];
+    }
+    return found;
+}
+
+BOOST_AUTO_TEST_SUITE(sigcache_tests)
+
+BOOST_AUTO_TEST_CASE(sigcache_evict_test)
+{
+    CSignatureCache cache;
+    cache.SetMaxSize(TEST_SHARDS * TEST_SHARD_SLOTS * sizeof(CEntry));
+
+    // clusters wrapping around the end of the table, every entry stays reachable after the backward shifts
+    vector<CEntry> entries;
+    for (uint64_t id = 0; id < 200; id++) {
+        uint64_t home = (TEST_SHARD_SLOTS - 3 + id % 5) % TEST_SHARD_SLOTS;
+        entries.push_back(MakeEntry(home, id));
+        cache.Set(entries.back());
+        cache.Set(entries.back());  // set twice, inserted once
+
+        CSigCacheStats stats = cache.GetStats();
+        BOOST_CHECK(stats.bytes == TEST_SHARD_SLOTS * sizeof(CEntry));
+        BOOST_CHECK(stats.inserts == id + 1);
+        BOOST_CHECK(stats.entries == min<uint64_t>(id + 1, TEST_SHARD_SLOTS / 4 * 3));
+        BOOST_CHECK(stats.evictions == stats.inserts - stats.entries);
+        BOOST_CHECK(cache.Get(entries.back()));
+        BOOST_CHECK(CountFound(cache, entries) == stats.entries);
+    }
+
+    // the budget is reset
+    cache.SetMaxSize(0);
+    BOOST_CHECK(CountFound(cache, entries) == 0);
+    cache.Set(entries[0]);
+    BOOST_CHECK(!cache.Get(entries[0]));
+    BOOST_CHECK(cache.GetStats().bytes == 0);
+}
+
+BOOST_AUTO_TEST_CASE(sigcache_entries_test)
+{
+    // the budget of the legacy -maxsigcachesize counts holds the entries
+    for (uint64_t count : {1000, 50000, 1000000}) {
+        CSignatureCache cache;
+        cache.SetMaxSize(CSignatureCache::GetBytesOfEntries(count));
+        vector<CEntry> entries;
+        for (uint64_t id = 0; id < count; id++) {
+            CEntry entry;
+            entry.h1 = id * 0x9E3779B97F4A7C15ULL + 1;
+            entry.h2 = id;
+            entries.push_back(entry);
+            cache.Set(entry);
+        }
+        CSigCacheStats stats = cache.GetStats();
+        BOOST_CHECK(stats.bytes <= CSignatureCache::GetBytesOfEntries(count));
+        BOOST_CHECK(stats.entries + stats.evictions == count);
+        BOOST_CHECK(stats.entries * 2 >= count);
+        BOOST_CHECK(CountFound(cache, entries) == stats.entries);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
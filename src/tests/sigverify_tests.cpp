@@ -0,0 +1,203 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "main.h"
+#include "commons/workerpool.h"
+#include "persistence/accountdb.h"
+#include "sigverify.h"
+#include "tx/cointransfertx.h"
+
+#include <atomic>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+
+static const uint32_t TEST_BLOCK_TXS = 16;
+
+// the txs of a block signed by their own keys, the signature of the tx at badIndex is made by another key
+static vector<shared_ptr<CBaseTx>> MakeSignedTxs(uint32_t badIndex) {
+    vector<shared_ptr<CBaseTx>> vptx;
+    for (uint32_t i = 0; i < TEST_BLOCK_TXS; i++) {
+        CKey key, otherKey;
+        key.MakeNewKey();
+        otherKey.MakeNewKey();
+        auto pTx = make_shared<CBaseCoinTransferTx>(key.GetPubKey(), CRegID(1, 1), 1, 10000 + i, 10000,
+                                                    "sigverify_tests");
+        BOOST_CHECK((i == badIndex ? otherKey : key).Sign(pTx->GetHash(), pTx->signature));
+        vptx.push_back(pTx);
+    }
+    return vptx;
+}
+
+BOOST_AUTO_TEST_SUITE(sigverify_tests)
+
+BOOST_AUTO_TEST_CASE(workerpool_test)
+{
+    // one thread runs the tasks in submit order, the queued tasks are run on destruction
+    vector<uint32_t> order;
+    {
+        CWorkerPool pool(1, "test");
+        BOOST_CHECK(pool.GetThreadCount() == 1);
+        for (uint32_t i = 0; i < 100; i++) {
+            pool.Submit([&order, i]() { order.push_back(i); });
+        }
+    }
+    BOOST_CHECK(order.size() == 100);
+    for (uint32_t i = 0; i < order.size(); i++) {
+        BOOST_CHECK(order[i] == i);
+    }
+
+    // tasks submitted by many threads at the same time
+    std::atomic<uint32_t> done{0};
+    {
+        CWorkerPool pool(4, "test");
+        vector<std::thread> submitters;
+        for (uint32_t i = 0; i < 4; i++) {
+            submitters.emplace_back([&]() {
+                for (uint32_t j = 0; j < 250; j++) {
+                    pool.Submit([&done]() { done++; });
+                }
+            });
+        }
+        for (auto &submitter : submitters) {
+            submitter.join();
+        }
+    }
+    BOOST_CHECK(done == 1000);
+}
+
+BOOST_AUTO_TEST_CASE(sig_pre_verifier_test)
+{
+    CAccountDBCache accountCache;
+    CWorkerPool pool(3, "test");
+
+    // no workers or too few signatures
+    auto vptx = MakeSignedTxs(TEST_BLOCK_TXS);
+    BOOST_CHECK(CBlockSigPreVerifier::Verify(vptx, accountCache, nullptr) == nullptr);
+    vector<shared_ptr<CBaseTx>> fewTxs(vptx.begin(), vptx.begin() + 4);
+    BOOST_CHECK(CBlockSigPreVerifier::Verify(fewTxs, accountCache, &pool) == nullptr);
+
+    // all of the signatures are valid and cached
+    auto pVerifier = CBlockSigPreVerifier::Verify(vptx, accountCache, &pool);
+    BOOST_REQUIRE(pVerifier != nullptr);
+    vector<CSignatureCache::CEntry> entries;
+    for (uint32_t i = 0; i < TEST_BLOCK_TXS; i++) {
+        BOOST_CHECK(pVerifier->IsValid(i));
+        entries.push_back(signatureCache.ComputeEntry(vptx[i]->GetHash(), vptx[i]->signature,
+                                                      vptx[i]->txUid.get<CPubKey>()));
+    }
+    BOOST_CHECK(pVerifier->IsValid(TEST_BLOCK_TXS));  // out of range
+    vector<bool> cached;
+    signatureCache.GetBatch(entries, cached);
+    BOOST_CHECK(cached == vector<bool>(TEST_BLOCK_TXS, true));
+
+    // a bad signature is found, and the rest are all verified
+    const uint32_t badIndex = 5;
+    auto badTxs = MakeSignedTxs(badIndex);
+    pVerifier = CBlockSigPreVerifier::Verify(badTxs, accountCache, &pool);
+    BOOST_REQUIRE(pVerifier != nullptr);
+    for (uint32_t i = 0; i < TEST_BLOCK_TXS; i++) {
+        BOOST_CHECK(pVerifier->IsValid(i) == (i != badIndex));
+    }
+    BOOST_CHECK(!::VerifySignature(badTxs[badIndex]->GetHash(), badTxs[badIndex]->signature,
+                                   badTxs[badIndex]->txUid.get<CPubKey>()));
+}
+
+BOOST_AUTO_TEST_CASE(pubkey_verify_batch_test)
+{
+    // signatures of the keys, the ones at the bad indexes are made by the next key
+    const uint32_t itemCount = 64;
+    const set<uint32_t> badIndexes = {0, 7, 8, 33, itemCount - 1};
+    vector<CKey> keys(itemCount + 1);
+    for (auto &key : keys) {
+        key.MakeNewKey();
+    }
+    vector<CSigVerifyItem> items;
+    for (uint32_t i = 0; i < itemCount; i++) {
+        uint256 hash = Hash(&i, &i + 1);
+        vector<uint8_t> signature;
+        BOOST_CHECK(keys[badIndexes.count(i) ? i + 1 : i].Sign(hash, signature));
+        items.emplace_back(hash, signature, keys[i].GetPubKey());
+    }
+    vector<CSigVerifyItem> validItems;
+    for (uint32_t i = 0; i < itemCount; i++) {
+        if (!badIndexes.count(i))
+            validItems.push_back(items[i]);
+    }
+
+    CWorkerPool pool(3, "test");
+    for (CWorkerPool *pPool : {(CWorkerPool *)nullptr, &pool}) {
+        // the mixed batch, every item has its own result
+        vector<bool> results;
+        BOOST_CHECK(!CPubKey::VerifyBatch(items.data(), items.size(), &results, pPool));
+        BOOST_REQUIRE(results.size() == itemCount);
+        for (uint32_t i = 0; i < itemCount; i++) {
+            BOOST_CHECK(results[i] == !badIndexes.count(i));
+        }
+        BOOST_CHECK(!CPubKey::VerifyBatch(items.data(), items.size(), nullptr, pPool));
+
+        BOOST_CHECK(CPubKey::VerifyBatch(validItems.data(), validItems.size(), &results, pPool));
+        BOOST_CHECK(results == vector<bool>(validItems.size(), true));
+        BOOST_CHECK(CPubKey::VerifyBatch(validItems.data(), validItems.size(), nullptr, pPool));
+
+        // too few items to use the workers, and the empty batch
+        BOOST_CHECK(!CPubKey::VerifyBatch(items.data(), 1, &results, pPool) && results == vector<bool>(1, false));
+        BOOST_CHECK(CPubKey::VerifyBatch(items.data() + 1, 2, &results, pPool) && results == vector<bool>(2, true));
+        BOOST_CHECK(CPubKey::VerifyBatch(items.data(), 0, &results, pPool) && results.empty());
+    }
+
+    // the results of ::VerifySignatureBatch() are the same when the valid ones are cached
+    vector<bool> results;
+    BOOST_CHECK(!::VerifySignatureBatch(items, &results, &pool));
+    vector<bool> cachedResults;
+    BOOST_CHECK(!::VerifySignatureBatch(items, &cachedResults, &pool));
+    BOOST_CHECK(results == cachedResults);
+    for (uint32_t i = 0; i < itemCount; i++) {
+        BOOST_CHECK(results[i] == !badIndexes.count(i));
+        BOOST_CHECK(signatureCache.Get(items[i].hash, items[i].signature, items[i].pubkey) == results[i]);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(parsed_pubkey_cache_test)
+{
+    // more signers than the slots of the cache, verified again and again in turn
+    const uint32_t keyCount = 600;
+    vector<CKey> keys(keyCount);
+    vector<vector<uint8_t>> signatures(keyCount);
+    const uint256 hash = Hash(&keyCount, &keyCount + 1);
+    for (uint32_t i = 0; i < keyCount; i++) {
+        keys[i].MakeNewKey();
+        BOOST_CHECK(keys[i].Sign(hash, signatures[i]));
+    }
+    for (uint32_t round = 0; round < 3; round++) {
+        for (uint32_t i = 0; i < keyCount; i++) {
+            const CPubKey pubKey = keys[i].GetPubKey();
+            BOOST_CHECK(pubKey.Verify(hash, signatures[i]));
+            BOOST_CHECK(!pubKey.Verify(hash, signatures[(i + 1) % keyCount]));
+        }
+    }
+
+    // a pubkey mapped to the slot of a cached one is not taken for it
+    const CPubKey pubKey = keys[0].GetPubKey();
+    BOOST_CHECK(pubKey.Verify(hash, signatures[0]));
+    vector<uint8_t> vchOther(pubKey.begin(), pubKey.end());
+    vchOther.back() ^= 1;
+    const CPubKey otherPubKey(vchOther);
+    BOOST_CHECK(!otherPubKey.Verify(hash, signatures[0]));
+    BOOST_CHECK(pubKey.Verify(hash, signatures[0]));
+
+    // an invalid pubkey is never cached
+    vector<uint8_t> vchInvalid(CPubKey::COMPRESSED_PUBLIC_KEY_SIZE, 0xff);  // x is out of the field
+    vchInvalid[0] = 0x02;
+    const CPubKey invalidPubKey(vchInvalid);
+    BOOST_CHECK(invalidPubKey.IsValid() && !invalidPubKey.IsFullyValid());
+    BOOST_CHECK(!invalidPubKey.Verify(hash, signatures[0]));
+    BOOST_CHECK(!invalidPubKey.Verify(hash, signatures[0]));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
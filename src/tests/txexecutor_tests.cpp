@@ -0,0 +1,133 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "main.h"
+#include "commons/workerpool.h"
+#include "persistence/accountdb.h"
+#include "persistence/blockundo.h"
+#include "persistence/cachewrapper.h"
+#include "tx/cointransfertx.h"
+#include "txexecutor.h"
+
+#include <string>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+
+static const int32_t TEST_HEIGHT       = 100;
+static const uint32_t TEST_ACCOUNTS    = 8;
+static const uint64_t TEST_BALANCE     = 100 * COIN;
+static const uint64_t TEST_FEES        = 10000;
+
+struct FTxExecutorTests {
+    FTxExecutorTests() {
+        db_dir = boost::filesystem::path("/tmp/coind_unit_test") / "txexecutor_tests";
+        boost::filesystem::remove_all(db_dir);
+        BOOST_CHECK_NO_THROW(boost::filesystem::create_directories(db_dir));
+    }
+    ~FTxExecutorTests() {
+        BOOST_CHECK_NO_THROW(boost::filesystem::remove_all(db_dir));
+    }
+
+    boost::filesystem::path db_dir;
+};
+
+// the result of connecting the txs of a block, as ConnectBlock() does
+struct CConnectResult {
+    bool parallel = false;
+    vector<CAccount> accounts;
+    string undo;  // serialized CBlockUndo
+};
+
+static CConnectResult ConnectTxs(CBlock &block, const CBlockIndex &index, CAccountDBCache &accountCache,
+                                 const vector<CKeyID> &keyIds, CWorkerPool *pPool) {
+    CConnectResult result;
+    CCacheWrapper cw;
+    cw.accountCache.SetBaseViewPtr(&accountCache);
+
+    CBlockUndo blockUndo;
+    auto pExecutor = CParallelTxExecutor::Execute(block, &index, cw, blockUndo, pPool, 2);
+    result.parallel = pExecutor != nullptr;
+    for (uint32_t i = 1; i < block.vptx.size(); i++) {
+        CValidationState state;
+        BOOST_CHECK(ExecuteBlockTx(pExecutor.get(), block, &index, i, cw, blockUndo, state));
+    }
+
+    for (const auto &keyId : keyIds) {
+        CAccount account;
+        BOOST_CHECK(cw.accountCache.GetAccount(keyId, account));
+        result.accounts.push_back(account);
+    }
+    CDataStream ssUndo(SER_DISK, CLIENT_VERSION);
+    ssUndo << blockUndo;
+    result.undo = ssUndo.str();
+    return result;
+}
+
+BOOST_FIXTURE_TEST_SUITE(txexecutor_tests, FTxExecutorTests)
+
+BOOST_AUTO_TEST_CASE(txexecutor_conflict_test)
+{
+    CDBAccess accountDb(db_dir, DBNameType::ACCOUNT, false, true);
+    CAccountDBCache accountCache(&accountDb);
+
+    // registered accounts 0..TEST_ACCOUNTS-1 with balance, and an account of which the regid is generated by its tx
+    vector<CKey> keys(TEST_ACCOUNTS + 1);
+    vector<CKeyID> keyIds;
+    vector<CRegID> regIds;
+    for (uint32_t i = 0; i < keys.size(); i++) {
+        keys[i].MakeNewKey();
+        CAccount account(keys[i].GetPubKey().GetKeyId(), CNickID(), keys[i].GetPubKey());
+        BOOST_CHECK(account.OperateBalance(SYMB::WICC, BalanceOpType::ADD_FREE, TEST_BALANCE));
+        if (i < TEST_ACCOUNTS) {
+            account.regid = CRegID(1, i + 1);
+            BOOST_CHECK(accountCache.SaveAccount(account));
+        } else {
+            BOOST_CHECK(accountCache.SetAccount(account.keyid, account));
+        }
+        keyIds.push_back(account.keyid);
+        regIds.push_back(account.regid);
+    }
+
+    CBlock block;
+    block.SetHeight(TEST_HEIGHT);
+    block.vptx.push_back(make_shared<CBaseCoinTransferTx>());  // in place of the reward tx
+    auto addTransfer = [&](const CUserID &from, uint32_t to, uint64_t amount) {
+        auto pTx = make_shared<CBaseCoinTransferTx>(from, regIds[to], TEST_HEIGHT, amount, TEST_FEES, "");
+        block.vptx.push_back(pTx);
+    };
+    addTransfer(regIds[0], 1, 1 * COIN);     // 1
+    addTransfer(regIds[0], 2, 2 * COIN);     // 2: the same sender as 1
+    addTransfer(regIds[1], 3, 3 * COIN);     // 3: reads account 1 written by 1
+    addTransfer(regIds[4], 5, 4 * COIN);     // 4: independent
+    addTransfer(regIds[6], 7, 5 * COIN);     // 5: independent
+    addTransfer(keys[TEST_ACCOUNTS].GetPubKey(), 4, 6 * COIN);  // 6: generates a regid, the receiver is the sender of 4
+    addTransfer(regIds[5], 0, 7 * COIN);     // 7: reads account 5 written by 4, and the sender of 1 and 2
+
+    CBlockIndex index;
+    index.height = TEST_HEIGHT;
+    index.nTime  = block.GetTime();
+
+    CWorkerPool pool(3, "test");
+    CConnectResult serial   = ConnectTxs(block, index, accountCache, keyIds, nullptr);
+    CConnectResult parallel = ConnectTxs(block, index, accountCache, keyIds, &pool);
+    BOOST_CHECK(!serial.parallel && parallel.parallel);
+
+    // the same state and undo logs
+    BOOST_REQUIRE(serial.accounts.size() == parallel.accounts.size());
+    for (uint32_t i = 0; i < serial.accounts.size(); i++) {
+        BOOST_CHECK(serial.accounts[i].ToString() == parallel.accounts[i].ToString());
+    }
+    BOOST_CHECK(serial.undo == parallel.undo);
+
+    // the balances are of all of the transfers
+    BOOST_CHECK(serial.accounts[0].GetToken(SYMB::WICC).free_amount ==
+                TEST_BALANCE - 3 * COIN - 2 * TEST_FEES + 7 * COIN);
+    BOOST_CHECK(serial.accounts[1].GetToken(SYMB::WICC).free_amount == TEST_BALANCE + 1 * COIN - 3 * COIN - TEST_FEES);
+    BOOST_CHECK(serial.accounts[5].GetToken(SYMB::WICC).free_amount == TEST_BALANCE + 4 * COIN - 7 * COIN - TEST_FEES);
+    BOOST_CHECK(serial.accounts[TEST_ACCOUNTS].regid == CRegID(TEST_HEIGHT, 6));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -9,11 +9,9 @@
 #include "main.h"
 
 /**################################ Base Coin (WICC) Transfer ########################################**/
-bool CBaseCoinTransferTx::CheckTx(CTxExecuteContext &context) {
-    IMPLEMENT_DEFINE_CW_STATE;
-    IMPLEMENT_CHECK_TX_REGID_OR_PUBKEY(txUid);
+bool CBaseCoinTransferTx::CheckTxStateless(CValidationState &state) {
     IMPLEMENT_CHECK_TX_REGID_OR_KEYID(toUid);
-    if (!CheckFee(context)) return false;
+    if (!CheckFeeStateless(state)) return false;
     IMPLEMENT_CHECK_TX_MEMO;
 
     if (coin_amount < DUST_AMOUNT_THRESHOLD)
@@ -24,6 +22,15 @@ bool CBaseCoinTransferTx::CheckTx(CTxExecuteContext &context) {
         return state.DoS(100, ERRORMSG("CBaseCoinTransferTx::CheckTx, public key is invalid"), REJECT_INVALID,
                          "bad-publickey");
 
+    return true;
+}
+
+bool CBaseCoinTransferTx::CheckTx(CTxExecuteContext &context) {
+    IMPLEMENT_DEFINE_CW_STATE;
+    IMPLEMENT_CHECK_TX_REGID_OR_PUBKEY(txUid);
+    if (!CheckTxStateless(state)) return false;
+    if (!CheckFee(context)) return false;
+
     CAccount srcAccount;
     if (!cw.accountCache.GetAccount(txUid, srcAccount))
         return state.DoS(100, ERRORMSG("CBaseCoinTransferTx::CheckTx, read account failed"), REJECT_INVALID,
@@ -100,12 +107,9 @@ Object CBaseCoinTransferTx::ToJson(const CAccountDBCache &accountCache) const {
     return result;
 }
 
-bool CCoinTransferTx::CheckTx(CTxExecuteContext &context) {
-    IMPLEMENT_DEFINE_CW_STATE;
-    IMPLEMENT_DISABLE_TX_PRE_STABLE_COIN_RELEASE;
+bool CCoinTransferTx::CheckTxStateless(CValidationState &state) {
     IMPLEMENT_CHECK_TX_MEMO;
-    IMPLEMENT_CHECK_TX_REGID_OR_PUBKEY(txUid);
-    if (!CheckFee(context)) return false;
+    if (!CheckFeeStateless(state)) return false;
 
     if (transfers.empty() || transfers.size() > MAX_TRANSFER_SIZE) {
         return state.DoS(100, ERRORMSG("CCoinTransferTx::CheckTx, transfers is empty or too large count=%d than %d",
@@ -115,11 +119,6 @@ bool CCoinTransferTx::CheckTx(CTxExecuteContext &context) {
 
     for (size_t i = 0; i < transfers.size(); i++) {
         IMPLEMENT_CHECK_TX_REGID_OR_KEYID(transfers[i].to_uid);
-        auto pSymbolErr = cw.assetCache.CheckTransferCoinSymbol(transfers[i].coin_symbol);
-        if (pSymbolErr) {
-            return state.DoS(100, ERRORMSG("CCoinTransferTx::CheckTx, transfers[%d], invalid coin_symbol=%s, %s",
-                i, transfers[i].coin_symbol, *pSymbolErr), REJECT_INVALID, "invalid-coin-symbol");
-        }
 
         if (transfers[i].coin_amount < DUST_AMOUNT_THRESHOLD)
             return state.DoS(100, ERRORMSG("CCoinTransferTx::CheckTx, transfers[%d], dust amount, %llu < %llu",
@@ -132,6 +131,28 @@ bool CCoinTransferTx::CheckTx(CTxExecuteContext &context) {
                          i, transfers[i].coin_symbol, transfers[i].coin_amount), REJECT_DUST, "invalid-coin-amount");
     }
 
+    if ((txUid.is<CPubKey>()) && !txUid.get<CPubKey>().IsFullyValid())
+        return state.DoS(100, ERRORMSG("CCoinTransferTx::CheckTx, public key is invalid"), REJECT_INVALID,
+                         "bad-publickey");
+
+    return true;
+}
+
+bool CCoinTransferTx::CheckTx(CTxExecuteContext &context) {
+    IMPLEMENT_DEFINE_CW_STATE;
+    IMPLEMENT_DISABLE_TX_PRE_STABLE_COIN_RELEASE;
+    IMPLEMENT_CHECK_TX_REGID_OR_PUBKEY(txUid);
+    if (!CheckTxStateless(state)) return false;
+    if (!CheckFee(context)) return false;
+
+    for (size_t i = 0; i < transfers.size(); i++) {
+        auto pSymbolErr = cw.assetCache.CheckTransferCoinSymbol(transfers[i].coin_symbol);
+        if (pSymbolErr) {
+            return state.DoS(100, ERRORMSG("CCoinTransferTx::CheckTx, transfers[%d], invalid coin_symbol=%s, %s",
+                i, transfers[i].coin_symbol, *pSymbolErr), REJECT_INVALID, "invalid-coin-symbol");
+        }
+    }
+
     uint64_t minFee;
     if (!GetTxMinFee(nTxType, context.height, fee_symbol, minFee)) { assert(false); /* has been check before */ }
 
@@ -140,10 +161,6 @@ bool CCoinTransferTx::CheckTx(CTxExecuteContext &context) {
                          context.height, fee_symbol, llFees), REJECT_INVALID, "bad-tx-fee-toosmall");
     }
 
-    if ((txUid.is<CPubKey>()) && !txUid.get<CPubKey>().IsFullyValid())
-        return state.DoS(100, ERRORMSG("CCoinTransferTx::CheckTx, public key is invalid"), REJECT_INVALID,
-                         "bad-publickey");
-
     CAccount srcAccount;
     if (!cw.accountCache.GetAccount(txUid, srcAccount))
         return state.DoS(100, ERRORMSG("CCoinTransferTx::CheckTx, read account failed"), REJECT_INVALID,
@@ -49,6 +49,7 @@ public:
 
     virtual bool CheckTx(CTxExecuteContext &context);
     virtual bool ExecuteTx(CTxExecuteContext &context);
+    virtual bool CheckTxStateless(CValidationState &state);
 };
 
 /**
@@ -96,6 +97,7 @@ public:
 
     virtual bool CheckTx(CTxExecuteContext &context);
     virtual bool ExecuteTx(CTxExecuteContext &context);
+    virtual bool CheckTxStateless(CValidationState &state);
 };
 
 #endif // TX_COIN_TRANSFER_H
\ No newline at end of file
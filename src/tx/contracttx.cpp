@@ -162,17 +162,24 @@ Object CLuaContractDeployTx::ToJson(const CAccountDBCache &accountCache) const {
 ///////////////////////////////////////////////////////////////////////////////
 // class CLuaContractInvokeTx
 
-bool CLuaContractInvokeTx::CheckTx(CTxExecuteContext &context) {
-    IMPLEMENT_DEFINE_CW_STATE;
+bool CLuaContractInvokeTx::CheckTxStateless(CValidationState &state) {
     IMPLEMENT_CHECK_TX_ARGUMENTS;
-    IMPLEMENT_CHECK_TX_REGID_OR_PUBKEY(txUid);
     IMPLEMENT_CHECK_TX_APPID(app_uid);
-    if (!CheckFee(context)) return false;
+    if (!CheckFeeStateless(state)) return false;
 
     if ((txUid.is<CPubKey>()) && !txUid.get<CPubKey>().IsFullyValid())
         return state.DoS(100, ERRORMSG("CLuaContractInvokeTx::CheckTx, public key is invalid"), REJECT_INVALID,
                          "bad-publickey");
 
+    return true;
+}
+
+bool CLuaContractInvokeTx::CheckTx(CTxExecuteContext &context) {
+    IMPLEMENT_DEFINE_CW_STATE;
+    IMPLEMENT_CHECK_TX_REGID_OR_PUBKEY(txUid);
+    if (!CheckTxStateless(state)) return false;
+    if (!CheckFee(context)) return false;
+
     CAccount srcAccount;
     if (!cw.accountCache.GetAccount(txUid, srcAccount))
         return state.DoS(100, ERRORMSG("CLuaContractInvokeTx::CheckTx, read account failed, tx_uid=%s",
@@ -78,6 +78,7 @@ public:
 
     virtual bool CheckTx(CTxExecuteContext &context);
     virtual bool ExecuteTx(CTxExecuteContext &context);
+    virtual bool CheckTxStateless(CValidationState &state);
 };
 
 /**#################### Universal Contract Deploy & Invoke Class Definitions ##############################**/
@@ -64,7 +64,8 @@ bool CMulsigTx::CheckTx(CTxExecuteContext &context) {
     CAccount account;
     set<CPubKey> pubKeys;
     uint256 sighash = GetHash();
-    uint8_t valid   = 0;
+    vector<CSigVerifyItem> sigItems;
+    vector<const CSignaturePair *> sigPairs;
     for (const auto &item : signaturePairs) {
         if (!cw.accountCache.GetAccount(item.regid, account))
             return state.DoS(100,
@@ -78,18 +79,25 @@ bool CMulsigTx::CheckTx(CTxExecuteContext &context) {
                     REJECT_INVALID, "bad-tx-sig-size");
             }
 
-            if (!::VerifySignature(sighash, item.signature, account.owner_pubkey)) {
-                return state.DoS(
-                    100, ERRORMSG("CMulsigTx::CheckTx, account: %s, VerifySignature failed", item.regid.ToString()),
-                    REJECT_INVALID, "bad-signscript-check");
-            } else {
-                ++valid;
-            }
+            sigItems.emplace_back(sighash, item.signature, account.owner_pubkey);
+            sigPairs.push_back(&item);
         }
 
         pubKeys.insert(account.owner_pubkey);
     }
 
+    // CheckTx() may run in the workers, so the signatures are verified in this thread
+    vector<bool> sigResults;
+    if (!::VerifySignatureBatch(sigItems, &sigResults)) {
+        for (size_t i = 0; i < sigResults.size(); i++) {
+            if (!sigResults[i])
+                return state.DoS(100, ERRORMSG("CMulsigTx::CheckTx, account: %s, VerifySignature failed",
+                                               sigPairs[i]->regid.ToString()),
+                                 REJECT_INVALID, "bad-signscript-check");
+        }
+    }
+    uint8_t valid = sigItems.size();
+
     if (pubKeys.size() != signaturePairs.size()) {
         return state.DoS(100, ERRORMSG("CMulsigTx::CheckTx, duplicated account"), REJECT_INVALID, "duplicated-account");
     }
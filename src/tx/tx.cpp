@@ -168,17 +168,23 @@ bool CBaseTx::CheckCoinRange(const TokenSymbol &symbol, const int64_t amount) co
     }
 }
 
-bool CBaseTx::CheckFee(CTxExecuteContext &context, function<bool(CTxExecuteContext&, uint64_t)> minFeeChecker) const {
+bool CBaseTx::CheckFeeStateless(CValidationState &state) const {
     // check fee value range
     if (!CheckBaseCoinRange(llFees))
-        return context.pState->DoS(100, ERRORMSG("%s, tx fee out of range", __FUNCTION__), REJECT_INVALID,
+        return state.DoS(100, ERRORMSG("%s, tx fee out of range", __FUNCTION__), REJECT_INVALID,
                          "bad-tx-fee-toolarge");
     // check fee symbol valid
     if (!kFeeSymbolSet.count(fee_symbol))
-        return context.pState->DoS(100,
+        return state.DoS(100,
                          ERRORMSG("%s, not support fee symbol=%s, only supports:%s", __FUNCTION__, fee_symbol,
                                   GetFeeSymbolSetStr()),
                          REJECT_INVALID, "bad-tx-fee-symbol");
+    return true;
+}
+
+bool CBaseTx::CheckFee(CTxExecuteContext &context, function<bool(CTxExecuteContext&, uint64_t)> minFeeChecker) const {
+    if (!CheckFeeStateless(*context.pState))
+        return false;
 
     uint64_t minFee;
     if (!GetTxMinFee(nTxType, context.height, fee_symbol, minFee))
@@ -162,6 +162,11 @@ public:
 
     virtual bool CheckTx(CTxExecuteContext &context)   = 0;
     virtual bool ExecuteTx(CTxExecuteContext &context) = 0;
+    /**
+     * The part of CheckTx() which needs no chain state or height, e.g. the sizes and the ranges of the fields.
+     * It is run by CheckTx() and by PreAcceptToMemoryPool() without cs_main.
+     */
+    virtual bool CheckTxStateless(CValidationState &state) { return true; }
 
     bool IsValidHeight(int32_t nCurHeight, int32_t nTxCacheHeight) const;
 
@@ -192,6 +197,8 @@ public:
     bool VerifySignature(CTxExecuteContext &context, const CPubKey &pubkey);
 
 protected:
+    // the fee range and symbol checks of CheckFee()
+    bool CheckFeeStateless(CValidationState &state) const;
     bool CheckTxFeeSufficient(const TokenSymbol &feeSymbol, const uint64_t llFees, const int32_t height) const;
     bool CheckSignatureSize(const vector<unsigned char> &signature) const;
     bool CheckCoinRange(const TokenSymbol &symbol, const int64_t amount) const;
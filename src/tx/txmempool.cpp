@@ -6,9 +6,14 @@
 #include "txmempool.h"
 #include "commons/uint256.h"
 #include "main.h"
+#include "persistence/blockundo.h"
 #include "persistence/txdb.h"
 #include "tx/tx.h"
 #include "miner/miner.h"
+#include "txexecutor.h"
+
+#include <algorithm>
+#include <unordered_set>
 
 using namespace std;
 
@@ -50,11 +55,16 @@ void CTxMemPool::Remove(CBaseTx *pBaseTx, list<std::shared_ptr<CBaseTx> > &remov
     uint256 txid = pBaseTx->GetHash();
     if (memPoolTxs.count(txid)) {
         removed.push_front(std::shared_ptr<CBaseTx>(memPoolTxs[txid].GetTransaction()));
-        memPoolTxs.erase(txid);
+        EraseTx(txid);
         EraseTransaction(txid);
     }
 }
 
+void CTxMemPool::RemoveConfirmed(const uint256 &txid) {
+    LOCK(cs);
+    EraseTx(txid);
+}
+
 bool CTxMemPool::AddUnchecked(const uint256 &txid, const CTxMemPoolEntry &entry, CValidationState &state) {
     // Add to memory pool without checking anything.
     // Used by main.cpp AcceptToMemoryPool(), which DOES
@@ -64,7 +74,9 @@ bool CTxMemPool::AddUnchecked(const uint256 &txid, const CTxMemPoolEntry &entry,
         if (!CheckTxInMemPool(txid, entry, state))
             return false;
 
-        memPoolTxs.insert(make_pair(txid, entry));
+        auto ret = memPoolTxs.insert(make_pair(txid, entry));
+        if (ret.second)
+            AddToPriorityIndex(txid, ret.first->second);
     }
     return true;
 }
@@ -79,8 +91,7 @@ void CTxMemPool::QueryHash(vector<uint256> &txids) {
     }
 }
 
-bool CTxMemPool::CheckTxInMemPool(const uint256 &txid, const CTxMemPoolEntry &memPoolEntry, CValidationState &state,
-                                  bool bExecute) {
+bool CTxMemPool::PreCheckTx(const uint256 &txid, const CTxMemPoolEntry &memPoolEntry, CValidationState &state) {
     // is it within valid height
     static int validHeight = SysCfg().GetTxCacheHeight();
     if (!memPoolEntry.GetTransaction()->IsValidHeight(chainActive.Height(), validHeight))
@@ -92,50 +103,260 @@ bool CTxMemPool::CheckTxInMemPool(const uint256 &txid, const CTxMemPoolEntry &me
         return state.Invalid(ERRORMSG("CheckTxInMemPool() : txid: %s has been confirmed", txid.GetHex()), REJECT_INVALID,
                              "tx-duplicate-confirmed");
 
+    return true;
+}
+
+bool CTxMemPool::CheckTxInMemPool(const uint256 &txid, const CTxMemPoolEntry &memPoolEntry, CValidationState &state,
+                                  bool bExecute) {
+    if (!PreCheckTx(txid, memPoolEntry, state))
+        return false;
+
+    if (!bExecute)
+        return true;
+
+    std::shared_ptr<CBaseTx> pBaseTx = memPoolEntry.GetTransaction();
     auto spCW = std::make_shared<CCacheWrapper>(cw.get());
 
-    if (bExecute) {
-        CBlockIndex *pTip =  chainActive.Tip();
-        uint32_t fuelRate  = GetElementForBurn(pTip);
-        uint32_t blockTime = pTip->GetBlockTime();
-        uint32_t prevBlockTime = pTip->pprev != nullptr ? pTip->pprev->GetBlockTime() : pTip->GetBlockTime();
-        CTxExecuteContext context(chainActive.Height(), 0, fuelRate, blockTime, prevBlockTime, spCW.get(), &state, transaction_status_type::validating);
-        if (!memPoolEntry.GetTransaction()->ExecuteTx(context)) {
-            pCdMan->pLogCache->SetExecuteFail(chainActive.Height(), memPoolEntry.GetTransaction()->GetHash(),
-                                              state.GetRejectCode(), state.GetRejectReason());
-            return false;
-        }
+    // record the keys the tx depends on for the incremental rescan
+    CTxMemPoolDeps deps;
+    CDBReadTracker tracker(readTrackerMutex);
+    CDBOpLogMap dbOpLogMap;
+    deps.tracked = IsParallelTxType(pBaseTx->nTxType);
+    if (deps.tracked)
+        spCW->SetReadTracker(&tracker);
+    spCW->SetDbOpLogMap(&dbOpLogMap);
+
+    CBlockIndex *pTip =  chainActive.Tip();
+    uint32_t fuelRate  = GetElementForBurn(pTip);
+    uint32_t blockTime = pTip->GetBlockTime();
+    uint32_t prevBlockTime = pTip->pprev != nullptr ? pTip->pprev->GetBlockTime() : pTip->GetBlockTime();
+    CTxExecuteContext context(chainActive.Height(), 0, fuelRate, blockTime, prevBlockTime, spCW.get(), &state, transaction_status_type::validating);
+    if (!pBaseTx->ExecuteTx(context)) {
+        pCdMan->pLogCache->SetExecuteFail(chainActive.Height(), pBaseTx->GetHash(), state.GetRejectCode(),
+                                          state.GetRejectReason());
+        return false;
     }
 
+    spCW->SetDbOpLogMap(nullptr);
     spCW->Flush();
 
+    deps.seq     = nextExecSeq++;
+    deps.tracked = deps.tracked && !tracker.IsUnsafe();
+    if (deps.tracked)
+        deps.readKeys = tracker.GetReadKeys();
+    for (const auto &item : dbOpLogMap.GetMap()) {
+        auto &keys = deps.writtenKeys[item.first];
+        for (const auto &dbOpLog : item.second)
+            keys.insert(dbOpLog.GetKey());
+    }
+    mapTxDeps[txid] = std::move(deps);
+
     return true;
 }
 
 void CTxMemPool::SetMemPoolCache() {
     cw.reset(new CCacheWrapper(pCdMan));
+    mapTxDeps.clear();
+    fTouchedKeysValid = false;
 }
 
 void CTxMemPool::ReScanMemPoolTx() {
-    cw.reset(new CCacheWrapper(pCdMan));
+    static bool fIncremental = SysCfg().GetBoolArg("-incrementalrescan", DEFAULT_INCREMENTAL_RESCAN);
+
+    LOCK(cs);
+    int64_t beginTime = GetTimeMicros();
+    if (fIncremental && CanReScanIncrementally() && ReScanIncrementally()) {
+        rescanStats.incrementalRescans++;
+    } else {
+        ReScanFully();
+        rescanStats.fullRescans++;
+    }
+    rescanStats.totalTimeUs += GetTimeMicros() - beginTime;
 
+    touchedKeys.clear();
+    touchedTipHash    = chainActive.Tip()->GetBlockHash();
+    fTouchedKeysValid = true;
+    rescanHeight      = chainActive.Height();
+}
+
+void CTxMemPool::AddConnectedBlock(const CBlockIndex *pIndex, const CBlockUndo &blockUndo) {
     LOCK(cs);
+    if (pIndex->pprev == nullptr || pIndex->pprev->GetBlockHash() != touchedTipHash)
+        fTouchedKeysValid = false;
+    touchedTipHash = pIndex->GetBlockHash();
+
+    // no tx depends on the keys written before it is executed
+    if (!fTouchedKeysValid || mapTxDeps.empty())
+        return;
+
+    for (const auto &txUndo : blockUndo.vtxundo) {
+        for (const auto &item : txUndo.dbOpLogMap.GetMap()) {
+            auto &keys = touchedKeys[item.first];
+            for (const auto &dbOpLog : item.second)
+                keys.insert(dbOpLog.GetKey());
+        }
+    }
+}
+
+CTxMemPoolRescanStats CTxMemPool::GetRescanStats() const {
+    LOCK(cs);
+    return rescanStats;
+}
+
+bool CTxMemPool::CanReScanIncrementally() const {
+    if (!fTouchedKeysValid || touchedTipHash != chainActive.Tip()->GetBlockHash())
+        return false;
+
+    // the fee rules depend on the fork version of the height
+    if (GetFeatureForkVersion(rescanHeight) != GetFeatureForkVersion(chainActive.Height()))
+        return false;
+
+    // the min fees are read from the global caches directly, which are not tracked
+    for (auto prefixType : {dbk::SYS_PARAM, dbk::MINER_FEE}) {
+        if (touchedKeys.count(dbk::GetKeyPrefix(prefixType)))
+            return false;
+    }
+    return true;
+}
+
+void CTxMemPool::ReScanFully() {
+    cw.reset(new CCacheWrapper(pCdMan));
+    mapTxDeps.clear();
+
     CValidationState state;
     for (map<uint256, CTxMemPoolEntry>::iterator iterTx = memPoolTxs.begin(); iterTx != memPoolTxs.end();) {
-        if (!CheckTxInMemPool(iterTx->first, iterTx->second, state, true)) {
-            uint256 txid = iterTx->first;
-            iterTx       = memPoolTxs.erase(iterTx++);
+        uint256 txid = iterTx->first;
+        RemoveFromPriorityIndex(txid);
+        if (!CheckTxInMemPool(txid, iterTx->second, state, true)) {
+            iterTx = memPoolTxs.erase(iterTx);
             EraseTransaction(txid);
+            rescanStats.removedTxs++;
             continue;
         }
+        // the run steps, thus the fuel, may have changed
+        AddToPriorityIndex(txid, iterTx->second);
+        rescanStats.executedTxs++;
         ++iterTx;
     }
 }
 
+static bool HasCommonKey(const map<string, set<string>> &keys, const map<string, set<string>> &otherKeys) {
+    for (const auto &item : keys) {
+        auto it = otherKeys.find(item.first);
+        if (it == otherKeys.end())
+            continue;
+
+        const auto &smaller = item.second.size() < it->second.size() ? item.second : it->second;
+        const auto &larger  = item.second.size() < it->second.size() ? it->second : item.second;
+        for (const auto &key : smaller) {
+            if (larger.count(key))
+                return true;
+        }
+    }
+    return false;
+}
+
+static void AddKeys(map<string, set<string>> &keys, const map<string, set<string>> &newKeys) {
+    for (const auto &item : newKeys)
+        keys[item.first].insert(item.second.begin(), item.second.end());
+}
+
+/**
+ * The txs affected by the new blocks are: the ones removed from the pool since the last rescan, the ones failed
+ * the checks without execution, the ones with reads not tracked by key, and the ones which read or wrote the keys
+ * written by the blocks or by the other affected txs. The writes of the affected txs are dropped from cw, so the
+ * keys are read from the new tip again, then the affected txs still in the pool are executed again. The other
+ * txs are kept as-is, none of the keys they depend on has changed. The values written by them depending on the
+ * height only, e.g. the tx cords of the dex orders, are kept from their last execution, which are only seen by
+ * the mempool.
+ */
+bool CTxMemPool::ReScanIncrementally() {
+    vector<pair<uint64_t, uint256>> txs;
+    txs.reserve(mapTxDeps.size());
+    for (const auto &item : mapTxDeps)
+        txs.emplace_back(item.second.seq, item.first);
+    std::sort(txs.begin(), txs.end());
+
+    CValidationState state;
+    std::unordered_set<uint256, CUint256Hasher> affected;
+    map<string, set<string>> dirtyKeys = touchedKeys;
+    for (const auto &item : txs) {
+        const CTxMemPoolDeps &deps = mapTxDeps[item.second];
+        auto iterTx                = memPoolTxs.find(item.second);
+        if (iterTx == memPoolTxs.end() || !deps.tracked || !PreCheckTx(item.second, iterTx->second, state)) {
+            affected.insert(item.second);
+            AddKeys(dirtyKeys, deps.writtenKeys);
+        }
+    }
+
+    // a tx becoming affected makes its written keys dirty, which may affect the txs checked before it
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (const auto &item : txs) {
+            if (affected.count(item.second))
+                continue;
+
+            const CTxMemPoolDeps &deps = mapTxDeps[item.second];
+            if (HasCommonKey(deps.readKeys, dirtyKeys) || HasCommonKey(deps.writtenKeys, dirtyKeys)) {
+                affected.insert(item.second);
+                AddKeys(dirtyKeys, deps.writtenKeys);
+                changed = true;
+            }
+        }
+    }
+
+    CDBOpLogMap eraseLogMap;
+    for (const auto &txid : affected) {
+        for (const auto &item : mapTxDeps[txid].writtenKeys) {
+            CDbOpLogs &dbOpLogs = eraseLogMap.GetMap()[item.first];
+            for (const auto &key : item.second) {
+                dbOpLogs.emplace_back();
+                dbOpLogs.back().SetLayerErase(key);
+            }
+        }
+    }
+    if (!UndoDbOpLogMap(cw->GetUndoDataFuncMap(), eraseLogMap))
+        return false;
+
+    // the price points are only written by the txs not tracked, all of which are executed again
+    cw->ppCache = CPricePointMemCache(pCdMan->pPpCache);
+
+    for (const auto &item : txs) {
+        const uint256 &txid = item.second;
+        if (!affected.count(txid)) {
+            rescanStats.skippedTxs++;
+            continue;
+        }
+
+        mapTxDeps.erase(txid);
+        auto iterTx = memPoolTxs.find(txid);
+        if (iterTx == memPoolTxs.end())
+            continue;
+
+        RemoveFromPriorityIndex(txid);
+        if (!CheckTxInMemPool(txid, iterTx->second, state, true)) {
+            memPoolTxs.erase(iterTx);
+            EraseTransaction(txid);
+            rescanStats.removedTxs++;
+            continue;
+        }
+        AddToPriorityIndex(txid, iterTx->second);
+        rescanStats.executedTxs++;
+    }
+
+    LogPrint(BCLog::DEBUG, "incremental mempool rescan: %u txs affected of %u\n", affected.size(), txs.size());
+    return true;
+}
+
 void CTxMemPool::Clear() {
     LOCK(cs);
 
     memPoolTxs.clear();
+    priorityIndex.clear();
+    mapPriorityIndex.clear();
+    mapTxDeps.clear();
+    fTouchedKeysValid = false;
     cw.reset(new CCacheWrapper(pCdMan));
 }
 
@@ -155,4 +376,42 @@ std::shared_ptr<CBaseTx> CTxMemPool::Lookup(const uint256 txid) const {
     if (i == memPoolTxs.end())
         return std::shared_ptr<CBaseTx>();
     return i->second.GetTransaction();
-}
\ No newline at end of file
+}
+
+const CTxMemPool::PriorityIndex &CTxMemPool::GetPriorityIndex(uint32_t fuelRate) {
+    AssertLockHeld(cs);
+    if (fuelRate != indexFuelRate) {
+        indexFuelRate = fuelRate;
+        priorityIndex.clear();
+        mapPriorityIndex.clear();
+        for (const auto &item : memPoolTxs)
+            AddToPriorityIndex(item.first, item.second);
+    }
+    return priorityIndex;
+}
+
+void CTxMemPool::AddToPriorityIndex(const uint256 &txid, const CTxMemPoolEntry &entry) {
+    std::shared_ptr<CBaseTx> pBaseTx = entry.GetTransaction();
+    if (pBaseTx->IsBlockRewardTx())
+        return;
+
+    // the fuel at the height the tx entered the pool, which only matters to the fee rules of the forks
+    uint64_t fee    = std::get<1>(entry.GetFees());
+    double feePerKb = double(fee - pBaseTx->GetFuel(entry.GetHeight(), indexFuelRate)) / entry.GetTxSize() * 1000.0;
+    auto ret        = priorityIndex.insert(TxPriority(entry.GetPriority(), feePerKb, pBaseTx));
+    if (ret.second)
+        mapPriorityIndex[txid] = ret.first;
+}
+
+void CTxMemPool::RemoveFromPriorityIndex(const uint256 &txid) {
+    auto it = mapPriorityIndex.find(txid);
+    if (it != mapPriorityIndex.end()) {
+        priorityIndex.erase(it->second);
+        mapPriorityIndex.erase(it);
+    }
+}
+
+void CTxMemPool::EraseTx(const uint256 &txid) {
+    RemoveFromPriorityIndex(txid);
+    memPoolTxs.erase(txid);
+}
@@ -10,15 +10,23 @@
 #include "entities/account.h"
 #include "persistence/cachewrapper.h"
 #include "sync.h"
+#include "tx/tx.h"
 
+#include <cmath>
 #include <list>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
 
 using namespace std;
 
 class CValidationState;
 class CBaseTx;
+class CBlockIndex;
+class CBlockUndo;
 class uint256;
 
 /*
@@ -49,6 +57,50 @@ public:
     inline uint32_t GetHeight() const { return height; }
 };
 
+struct TxPriority {
+    double priority;
+    double feePerKb;
+    std::shared_ptr<CBaseTx> baseTx;
+
+    TxPriority(const double priorityIn, const double feePerKbIn, const std::shared_ptr<CBaseTx> &baseTxIn)
+        : priority(priorityIn), feePerKb(feePerKbIn), baseTx(baseTxIn) {}
+
+    // the ordinary txs, of which the priority is not above TRANSACTION_PRIORITY_CEILING, are in one class and
+    // ranked by fee per KB, the price txs of fixed priorities are in classes above them
+    double GetPriorityClass() const {
+        return priority > TRANSACTION_PRIORITY_CEILING ? priority : 0;
+    }
+
+    // exact comparisons, the ties are broken by txid. A tolerance would not be transitive, which std::set requires
+    bool operator<(const TxPriority &other) const {
+        if (this->GetPriorityClass() != other.GetPriorityClass())
+            return this->GetPriorityClass() < other.GetPriorityClass();
+        if (this->feePerKb != other.feePerKb)
+            return this->feePerKb < other.feePerKb;
+        return this->baseTx->GetHash() < other.baseTx->GetHash();
+    }
+};
+
+/**
+ * The cache keys a pooled tx depends on, recorded when it is executed on the cache of the mempool.
+ * The keys are serialized the same as the keys of CDbOpLog, by prefix.
+ */
+struct CTxMemPoolDeps {
+    uint64_t seq = 0;      // order of the execution, the writes of the txs are in the mempool cache in this order
+    bool tracked = false;  // all of the reads of the tx are tracked by key, otherwise it is always executed again
+    map<string, set<string>> readKeys;
+    map<string, set<string>> writtenKeys;
+};
+
+struct CTxMemPoolRescanStats {
+    uint64_t fullRescans        = 0;
+    uint64_t incrementalRescans = 0;
+    uint64_t executedTxs        = 0;  // count of the txs executed again by the rescans
+    uint64_t skippedTxs         = 0;  // count of the txs kept without execution by the incremental rescans
+    uint64_t removedTxs         = 0;  // count of the txs removed for being invalid by the rescans
+    int64_t totalTimeUs         = 0;
+};
+
 /*
  * CTxMemPool stores valid-according-to-the-current-best-chain
  * transactions that may be included in the next block.
@@ -61,6 +113,9 @@ public:
  */
 class CTxMemPool {
 public:
+    // the txs ordered by priority, then by fee per KB after the fuel
+    typedef std::set<TxPriority> PriorityIndex;
+
     mutable CCriticalSection cs;
     map<uint256, CTxMemPoolEntry > memPoolTxs;
     std::shared_ptr<CCacheWrapper> cw;
@@ -72,19 +127,64 @@ public:
     void SetSanityCheck(bool fSanityCheckIn) { fSanityCheck = fSanityCheckIn; }
     bool AddUnchecked(const uint256 &txid, const CTxMemPoolEntry &entry, CValidationState &state);
     void Remove(CBaseTx *pBaseTx, list<std::shared_ptr<CBaseTx> > &removed, bool fRecursive = false);
+    // remove the tx confirmed in a block, the wallet keeps it
+    void RemoveConfirmed(const uint256 &txid);
     void QueryHash(vector<uint256> &txids);
     bool CheckTxInMemPool(const uint256 &txid, const CTxMemPoolEntry &entry, CValidationState &state,
                           bool bExecute = true);
     void SetMemPoolCache();
+    /**
+     * Re-validate the txs after the tip has changed. If only the blocks added by AddConnectedBlock() have been
+     * connected since the last rescan, only the txs depending on the keys written by the blocks are executed
+     * again, unless -incrementalrescan=0. Otherwise all of the txs are executed again on a new cache.
+     */
     void ReScanMemPoolTx();
+    // record the keys written by the block connected to the tip, with the undo logs of it
+    void AddConnectedBlock(const CBlockIndex *pIndex, const CBlockUndo &blockUndo);
+    CTxMemPoolRescanStats GetRescanStats() const;
     void Clear();
 
     uint64_t Size();
     bool Exists(const uint256 txid);
     std::shared_ptr<CBaseTx> Lookup(const uint256 txid) const;
 
+    /**
+     * The priority index maintained on adding and removing the txs, to be walked from the best tx by rbegin().
+     * The fees per KB are after the fuel at fuelRate, the index is rebuilt if fuelRate has changed.
+     * cs must be held while the index is used.
+     */
+    const PriorityIndex &GetPriorityIndex(uint32_t fuelRate);
+
+private:
+    void AddToPriorityIndex(const uint256 &txid, const CTxMemPoolEntry &entry);
+    void RemoveFromPriorityIndex(const uint256 &txid);
+    // erase the tx from memPoolTxs and the indexes
+    void EraseTx(const uint256 &txid);
+
+    // the checks of the tx which need no execution
+    bool PreCheckTx(const uint256 &txid, const CTxMemPoolEntry &entry, CValidationState &state);
+    bool CanReScanIncrementally() const;
+    void ReScanFully();
+    bool ReScanIncrementally();
+
 private:
     bool fSanityCheck; // Normally false, true if -checkmempool or -regtest
+
+    PriorityIndex priorityIndex;
+    std::unordered_map<uint256, PriorityIndex::iterator, CUint256Hasher> mapPriorityIndex;  // txid -> priorityIndex
+    uint32_t indexFuelRate = 0;  // the fuel rate of the fees per KB in priorityIndex
+
+    // the txs executed on cw, including the ones removed since the last rescan, the writes of which are still in cw
+    std::unordered_map<uint256, CTxMemPoolDeps, CUint256Hasher> mapTxDeps;
+    uint64_t nextExecSeq = 0;
+    std::mutex readTrackerMutex;  // the reads of cw are under cs already, the read tracker needs a mutex anyway
+
+    map<string, set<string>> touchedKeys;  // written by the blocks connected since the last rescan
+    uint256 touchedTipHash;                // the tip after the blocks of touchedKeys
+    bool fTouchedKeysValid = false;        // no other chain changes since the last rescan
+    int32_t rescanHeight   = 0;            // the height of the last rescan
+
+    CTxMemPoolRescanStats rescanStats;
 };
 
 
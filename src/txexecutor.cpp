@@ -0,0 +1,195 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "txexecutor.h"
+
+#include "main.h"
+#include "sigverify.h"
+#include "persistence/blockundo.h"
+#include "persistence/cachewrapper.h"
+#include "tx/tx.h"
+
+bool IsParallelTxType(TxType txType) {
+    switch (txType) {
+        case BCOIN_TRANSFER_TX:
+        case UCOIN_TRANSFER_TX:
+        case DEX_LIMIT_BUY_ORDER_TX:
+        case DEX_LIMIT_SELL_ORDER_TX:
+        case DEX_MARKET_BUY_ORDER_TX:
+        case DEX_MARKET_SELL_ORDER_TX:
+        case DEX_ORDER_TX:
+        case DEX_OPERATOR_ORDER_TX:
+            return true;
+        default:
+            return false;
+    }
+}
+
+struct CParallelTxExecutor::CSpecTx {
+    uint32_t index;
+    std::shared_ptr<CBaseTx> pTx;  // copy of the tx, the block tx is left intact until committed
+    std::unique_ptr<CCacheWrapper> pCw;
+    CDBReadTracker tracker;
+    CTxUndo txUndo;
+    CValidationState state;
+    bool executed = false;
+
+    CSpecTx(std::mutex &baseMutex): tracker(baseMutex) {}
+};
+
+std::unique_ptr<CParallelTxExecutor> CParallelTxExecutor::Execute(CBlock &block, const CBlockIndex *pIndex,
+                                                                  CCacheWrapper &cw, const CBlockUndo &blockUndo) {
+    return Execute(block, pIndex, cw, blockUndo, GetSigVerifyPool(),
+                   SysCfg().GetArg("-parallelexec", DEFAULT_PARALLEL_EXEC_MIN_TXS));
+}
+
+std::unique_ptr<CParallelTxExecutor> CParallelTxExecutor::Execute(CBlock &block, const CBlockIndex *pIndex,
+                                                                  CCacheWrapper &cw, const CBlockUndo &blockUndo,
+                                                                  CWorkerPool *pPool, int64_t minTxs) {
+    if (pPool == nullptr || minTxs <= 0 || block.vptx.size() <= (size_t)minTxs)
+        return nullptr;
+
+    std::vector<uint32_t> indexes;
+    for (uint32_t index = 1; index < block.vptx.size(); index++) {
+        if (IsParallelTxType(block.vptx[index]->nTxType))
+            indexes.push_back(index);
+    }
+    if (indexes.size() < (size_t)minTxs)
+        return nullptr;
+
+    int64_t nStart = GetTimeMicros();
+    std::unique_ptr<CParallelTxExecutor> pExecutor(new CParallelTxExecutor());
+    pExecutor->pBlock        = &block;
+    pExecutor->height        = pIndex->height;
+    pExecutor->blockTime     = pIndex->nTime;
+    pExecutor->prevBlockTime = pIndex->pprev != nullptr ? pIndex->pprev->GetBlockTime() : pIndex->GetBlockTime();
+    pExecutor->undoCount     = blockUndo.vtxundo.size();
+    pExecutor->txJobs.assign(block.vptx.size(), nullptr);
+    pExecutor->jobs.reserve(indexes.size());
+    for (uint32_t index : indexes) {
+        pExecutor->jobs.emplace_back(new CSpecTx(pExecutor->baseMutex));
+        CSpecTx &job = *pExecutor->jobs.back();
+        job.index    = index;
+        job.pTx      = block.vptx[index]->GetNewInstance();
+        job.pTx->nFuelRate = block.GetFuelRate();
+        job.pCw.reset(new CCacheWrapper(&cw));
+        job.pCw->SetReadTracker(&job.tracker);
+        job.txUndo.SetTxID(job.pTx->GetHash());
+        job.pCw->SetDbOpLogMap(&job.txUndo.dbOpLogMap);
+        pExecutor->txJobs[index] = &job;
+    }
+
+    // the calling thread runs the jobs too, then waits for the workers
+    uint32_t workerCount     = std::min<size_t>(pPool->GetThreadCount(), pExecutor->jobs.size() - 1);
+    pExecutor->activeWorkers = workerCount;
+    CParallelTxExecutor *pRaw = pExecutor.get();
+    for (uint32_t i = 0; i < workerCount; i++) {
+        pPool->Submit([pRaw]() { pRaw->RunJobs(true); });
+    }
+    pExecutor->RunJobs(false);
+    {
+        std::unique_lock<std::mutex> lock(pExecutor->mtx);
+        pExecutor->doneCond.wait(lock, [pRaw] { return pRaw->activeWorkers == 0; });
+    }
+
+    LogPrint(BCLog::DEBUG, "executed %u txs of block %d in parallel, %.2fms\n", pExecutor->jobs.size(),
+             pIndex->height, (GetTimeMicros() - nStart) * 0.001);
+    return pExecutor;
+}
+
+CParallelTxExecutor::CParallelTxExecutor() {}
+
+CParallelTxExecutor::~CParallelTxExecutor() {
+    LogPrint(BCLog::DEBUG, "parallel txs of block %d: committed=%u, executed again=%u\n", height, committedCount,
+             conflictedCount);
+}
+
+void CParallelTxExecutor::RunJobs(bool fWorker) {
+    while (true) {
+        size_t index = nextJob++;
+        if (index >= jobs.size())
+            break;
+
+        RunJob(*jobs[index]);
+    }
+
+    if (fWorker) {
+        std::lock_guard<std::mutex> lock(mtx);
+        activeWorkers--;
+        doneCond.notify_all();
+    }
+}
+
+void CParallelTxExecutor::RunJob(CSpecTx &job) {
+    try {
+        CTxExecuteContext context(height, job.index, pBlock->GetFuelRate(), blockTime, prevBlockTime, job.pCw.get(),
+                                  &job.state);
+        job.executed = job.pTx->ExecuteTx(context);
+    } catch (std::exception &e) {
+        // the tx is executed again in the serial way, which reports the error if any
+        job.executed = false;
+    }
+}
+
+void CParallelTxExecutor::AddWrittenKeys(CBlockUndo &blockUndo) {
+    for (; undoCount < blockUndo.vtxundo.size(); undoCount++) {
+        for (const auto &item : blockUndo.vtxundo[undoCount].dbOpLogMap.GetMap()) {
+            auto &keys = writtenKeys[item.first];
+            for (const auto &dbOpLog : item.second) {
+                keys.insert(dbOpLog.GetKey());
+            }
+        }
+    }
+}
+
+bool CParallelTxExecutor::IsConflicted(const std::map<std::string, std::set<std::string>> &readKeys) const {
+    for (const auto &item : readKeys) {
+        auto it = writtenKeys.find(item.first);
+        if (it == writtenKeys.end())
+            continue;
+
+        const auto &smaller = item.second.size() < it->second.size() ? item.second : it->second;
+        const auto &larger  = item.second.size() < it->second.size() ? it->second : item.second;
+        for (const auto &key : smaller) {
+            if (larger.count(key))
+                return true;
+        }
+    }
+    return false;
+}
+
+bool CParallelTxExecutor::Commit(uint32_t index, CBlockUndo &blockUndo) {
+    if (index >= txJobs.size() || txJobs[index] == nullptr)
+        return false;
+
+    // the txs before this one have been committed or executed, their writes are in blockUndo
+    AddWrittenKeys(blockUndo);
+
+    CSpecTx &job = *txJobs[index];
+    txJobs[index] = nullptr;
+    if (!job.executed || job.tracker.IsUnsafe() || IsConflicted(job.tracker.GetReadKeys())) {
+        conflictedCount++;
+        return false;
+    }
+
+    // the cache layer of the job is over cw, flush its writes to cw
+    job.pCw->SetDbOpLogMap(nullptr);
+    job.pCw->Flush();
+    blockUndo.vtxundo.push_back(std::move(job.txUndo));
+    pBlock->vptx[index]->nRunStep = job.pTx->nRunStep;
+    committedCount++;
+    return true;
+}
+
+bool ExecuteBlockTx(CParallelTxExecutor *pExecutor, CBlock &block, const CBlockIndex *pIndex, uint32_t index,
+                    CCacheWrapper &cw, CBlockUndo &blockUndo, CValidationState &state) {
+    if (pExecutor != nullptr && pExecutor->Commit(index, blockUndo))
+        return true;
+
+    CTxUndoOpLogger opLogger(cw, block.vptx[index]->GetHash(), blockUndo);
+
+    uint32_t prevBlockTime = pIndex->pprev != nullptr ? pIndex->pprev->GetBlockTime() : pIndex->GetBlockTime();
+    CTxExecuteContext context(pIndex->height, index, block.GetFuelRate(), pIndex->nTime, prevBlockTime, &cw, &state);
+    return block.vptx[index]->ExecuteTx(context);
+}
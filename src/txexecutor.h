@@ -0,0 +1,102 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef COIN_TXEXECUTOR_H
+#define COIN_TXEXECUTOR_H
+
+#include "config/txbase.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+class CBlock;
+class CBlockIndex;
+class CBlockUndo;
+class CCacheWrapper;
+class CValidationState;
+class CWorkerPool;
+
+// the tx types which only use the key-value caches by key in ExecuteTx(), the reads of which can be tracked
+bool IsParallelTxType(TxType txType);
+
+/**
+ * Optimistic parallel execution of the txs of a block in ConnectBlock().
+ * The txs which only touch the key-value caches by key (coin transfers and dex orders) are executed in the
+ * signature verification workers at first, every one on a copy of the tx and a cache layer of its own over the
+ * block cache, which records the keys read from the block cache. Then the txs are committed in block order: the
+ * result of a tx is flushed to the block cache as-is if none of the keys it read has been written by the txs
+ * before it, otherwise the tx is executed again in the serial way. The keys written by a tx are taken from its
+ * undo log, so the state and the undo logs are the same as the serial execution.
+ */
+class CParallelTxExecutor {
+public:
+    /**
+     * Execute the eligible txs of the block in the workers and wait for them, cw must not be changed meanwhile.
+     * blockUndo holds the undo logs of the block so far, the writes of them are visible to the execution.
+     * Return nullptr if there are no workers or too few eligible txs to be worth it.
+     */
+    static std::unique_ptr<CParallelTxExecutor> Execute(CBlock &block, const CBlockIndex *pIndex,
+                                                        CCacheWrapper &cw, const CBlockUndo &blockUndo);
+    static std::unique_ptr<CParallelTxExecutor> Execute(CBlock &block, const CBlockIndex *pIndex,
+                                                        CCacheWrapper &cw, const CBlockUndo &blockUndo,
+                                                        CWorkerPool *pPool, int64_t minTxs);
+
+    ~CParallelTxExecutor();
+
+    /**
+     * Commit the result of the tx at index to cw and blockUndo. Must be called in block order after the txs before
+     * it have been committed or executed on cw, with their undo logs appended to blockUndo.
+     * Return false if the tx has no valid result, it must be executed on cw in the serial way then.
+     */
+    bool Commit(uint32_t index, CBlockUndo &blockUndo);
+
+private:
+    struct CSpecTx;
+
+    CParallelTxExecutor();
+
+    void RunJobs(bool fWorker);
+    void RunJob(CSpecTx &job);
+    void AddWrittenKeys(CBlockUndo &blockUndo);
+    bool IsConflicted(const std::map<std::string, std::set<std::string>> &readKeys) const;
+
+private:
+    CBlock *pBlock = nullptr;
+    int32_t height = 0;
+    uint32_t blockTime = 0;
+    uint32_t prevBlockTime = 0;
+
+    std::vector<std::unique_ptr<CSpecTx>> jobs;
+    std::vector<CSpecTx *> txJobs;  // tx index -> job, nullptr if the tx is not executed in parallel
+    std::atomic<size_t> nextJob{0};
+
+    std::mutex baseMutex;  // serializes the reads of the block cache by the jobs
+
+    std::mutex mtx;
+    std::condition_variable doneCond;
+    uint32_t activeWorkers = 0;
+
+    // prefix -> serialized keys written by the txs of the block so far
+    std::map<std::string, std::set<std::string>> writtenKeys;
+    size_t undoCount = 0;  // count of the tx undo logs of blockUndo added to writtenKeys
+
+    uint32_t committedCount = 0;
+    uint32_t conflictedCount = 0;
+};
+
+/**
+ * Execute the tx at index of the block on cw in ConnectBlock(), the result of pExecutor is committed if valid,
+ * otherwise the tx is executed in the serial way. The undo log of the tx is appended to blockUndo.
+ * pExecutor may be nullptr. Return false if the tx failed to execute, the error is in state.
+ */
+bool ExecuteBlockTx(CParallelTxExecutor *pExecutor, CBlock &block, const CBlockIndex *pIndex, uint32_t index,
+                    CCacheWrapper &cw, CBlockUndo &blockUndo, CValidationState &state);
+
+#endif  // COIN_TXEXECUTOR_H
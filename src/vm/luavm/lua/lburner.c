@@ -156,6 +156,15 @@ LUA_API int lua_StartBurner(lua_State *L, void* pContext, unsigned long long fue
     return 1;
 }
 
+LUA_API int lua_RearmBurner(lua_State *L, void* pContext, unsigned long long fuelLimit) {
+    if (!IsBurnerRuning(L) || lua_GetBurnedFuel(L) > fuelLimit) {
+        return 0;
+    }
+    L->burnerState.pContext         = pContext;
+    L->burnerState.fuelLimit        = fuelLimit;
+    return 1;
+}
+
 lua_burner_state *lua_GetBurnerState(lua_State *L) {
     if (IsBurnerStarted(L)) {
         return &L->burnerState;
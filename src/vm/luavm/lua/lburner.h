@@ -39,6 +39,13 @@ typedef struct lua_burner_state lua_burner_state;
  */
 int lua_StartBurner(lua_State *L, void* pContext, unsigned long long  fuelLimit, int version);
 
+/**
+ * re-arm the running burner of a pre-initialised state for a contract call, the fuel burned by the
+ * initialisation is kept and counted in the new fuel limit
+ * return 0 if the burner is not running or the burned fuel is over the fuel limit, otherwise is re-armed ok.
+ */
+LUA_API int lua_RearmBurner(lua_State *L, void* pContext, unsigned long long fuelLimit);
+
 lua_burner_state* lua_GetBurnerState(lua_State *L);
 
 /**
@@ -11,7 +11,9 @@
 #include <string.h>
 
 #include <openssl/des.h>
+#include <climits>
 #include <vector>
+#include "commons/workerpool.h"
 #include "crypto/hash.h"
 #include "entities/key.h"
 #include "main.h"
@@ -239,36 +241,136 @@ static std::string GetLuaError(lua_State *L, int status, std::string prefix) {
     return ret;
 }
 
+CLuaStatePool::CLuaStatePool(uint32_t sizeIn) : size(sizeIn), pWorker(new CWorkerPool(1, "luastate")) {}
+
+CLuaStatePool::~CLuaStatePool() {
+    pWorker.reset();  // the queued tasks are drained before
+    for (auto pState : states)
+        lua_close(pState);
+}
+
+lua_State *CLuaStatePool::NewState(int32_t burnVersion) {
+    lua_State *L = luaL_newstate();
+    if (L == nullptr) {
+        LogPrint(BCLog::LUAVM, "CLuaStatePool::NewState luaL_newstate() failed\n");
+        return nullptr;
+    }
+
+    // the context and the fuel limit of the contract call are set by lua_RearmBurner()
+    if (!lua_StartBurner(L, nullptr, ULLONG_MAX, burnVersion)) {
+        LogPrint(BCLog::LUAVM, "CLuaStatePool::NewState lua_StartBurner() failed\n");
+        lua_close(L);
+        return nullptr;
+    }
+
+    vm_openlibs(L);
+
+    if (!InitLuaLibsEx(L)) {
+        LogPrint(BCLog::LUAVM, "InitLuaLibsEx error\n");
+        lua_close(L);
+        return nullptr;
+    }
+
+    // the mylib module is left on the stack as the contract call has always found it
+    luaL_requiref(L, "mylib", luaopen_mylib, 1);
+    return L;
+}
+
+lua_State *CLuaStatePool::Acquire(int32_t burnVersion) {
+    std::lock_guard<std::mutex> lock(mtx);
+    lua_State *L = nullptr;
+    if (burnVersion != version) {
+        // the states of another burn version are dropped, e.g. on the fork height
+        for (auto pState : states)
+            Release(pState);
+        states.clear();
+        version = burnVersion;
+    } else if (!states.empty()) {
+        L = states.front();
+        states.pop_front();
+    }
+
+    if (!filling && states.size() < size) {
+        filling = true;
+        pWorker->Submit([this]() { Fill(); });
+    }
+    return L;
+}
+
+void CLuaStatePool::Release(lua_State *L) {
+    pWorker->Submit([L]() { lua_close(L); });
+}
+
+void CLuaStatePool::Fill() {
+    while (true) {
+        int32_t burnVersion;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (states.size() >= size) {
+                filling = false;
+                return;
+            }
+            burnVersion = version;
+        }
+
+        lua_State *L = NewState(burnVersion);
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (L == nullptr) {
+                filling = false;
+                return;
+            }
+            if (burnVersion == version) {
+                states.push_back(L);
+                continue;
+            }
+        }
+        lua_close(L);  // the burn version has been changed during the building
+    }
+}
+
+CLuaStatePool *GetLuaStatePool() {
+    static std::unique_ptr<CLuaStatePool> pPool = []() -> std::unique_ptr<CLuaStatePool> {
+        int64_t nSize = SysCfg().GetArg("-luastatepool", DEFAULT_LUA_STATE_POOL_SIZE);
+        if (nSize <= 0)
+            return nullptr;
+        return std::unique_ptr<CLuaStatePool>(new CLuaStatePool(std::min<int64_t>(nSize, MAX_LUA_STATE_POOL_SIZE)));
+    }();
+    return pPool.get();
+}
+
 tuple<uint64_t, string> CLuaVM::Run(uint64_t fuelLimit, CLuaVMRunEnv *pVmRunEnv) {
     if (NULL == pVmRunEnv) {
         return std::make_tuple(-1, string("pVmRunEnv == NULL"));
     }
 
-    // 1.创建Lua运行环境
-    std::unique_ptr<lua_State, decltype(&lua_close)> lua_state_ptr(luaL_newstate(), &lua_close);
+    // 1. get a pre-initialised lua state of the burn version, or build a new one if none is ready
+    int32_t burnVersion   = pVmRunEnv->GetBurnVersion();
+    CLuaStatePool *pPool  = GetLuaStatePool();
+    lua_State *pNewState  = pPool ? pPool->Acquire(burnVersion) : nullptr;
+    if (pNewState == nullptr)
+        pNewState = CLuaStatePool::NewState(burnVersion);
+
+    // the used state is closed in background by the pool
+    auto closeState = [pPool](lua_State *L) {
+        if (pPool)
+            pPool->Release(L);
+        else
+            lua_close(L);
+    };
+    std::unique_ptr<lua_State, decltype(closeState)> lua_state_ptr(pNewState, closeState);
     if (!lua_state_ptr) {
-        LogPrint(BCLog::LUAVM, "CLuaVM::Run luaL_newstate() failed\n");
-        return std::make_tuple(-1, string("CLuaVM::Run luaL_newstate() failed\n"));
+        LogPrint(BCLog::LUAVM, "CLuaVM::Run new lua state failed\n");
+        return std::make_tuple(-1, string("CLuaVM::Run new lua state failed\n"));
     }
     lua_State *lua_state = lua_state_ptr.get();
 
-    //TODO: should get burner version from the block height
-    if (!lua_StartBurner(lua_state, pVmRunEnv, fuelLimit, pVmRunEnv->GetBurnVersion())) {
-        LogPrint(BCLog::LUAVM, "CLuaVM::Run lua_StartBurner() failed\n");
-        return std::make_tuple(-1, string("CLuaVM::Run lua_StartBurner() failed\n"));
-    }
-
-    //打开需要的库
-    vm_openlibs(lua_state);
-
-    if (!InitLuaLibsEx(lua_state)) {
-        LogPrint(BCLog::LUAVM, "InitLuaLibsEx error\n");
-        return std::make_tuple(-1, string("InitLuaLibsEx error\n"));
+    // 2. arm the burner with the fuel limit of the call, the fuel burned by opening the libs is counted in
+    if (!lua_RearmBurner(lua_state, pVmRunEnv, fuelLimit)) {
+        ReportBurnState(lua_state, pVmRunEnv);
+        return std::make_tuple(-1, string("CLuaVM::Run burned-out\n"));
     }
 
-    // 3.注册自定义模块
-    luaL_requiref(lua_state, "mylib", luaopen_mylib, 1);
-
     // 4.往lua脚本传递合约内容
     lua_newtable(lua_state);  //新建一个表,压入栈顶
     lua_pushnumber(lua_state, -1);
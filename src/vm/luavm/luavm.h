@@ -9,13 +9,17 @@
 #include "main.h"
 
 #include <cstdio>
+#include <deque>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
 using namespace std;
 
+struct lua_State;
 class CLuaVMRunEnv;
+class CWorkerPool;
 
 class CLuaVM {
 public:
@@ -31,4 +35,37 @@ private:
     std::string arguments;
 };
 
+/**
+ * Pool of pre-initialised lua states of the current burn version (-luastatepool).
+ * A state is built by NewState() in the pool worker as CLuaVM::Run() builds a new one, so the memory of the libs is
+ * burned the same. Every state runs one contract call only and is closed by the pool worker afterwards: a state reused
+ * by another call would burn less memory fuel than a new one.
+ */
+class CLuaStatePool {
+public:
+    CLuaStatePool(uint32_t sizeIn);
+    ~CLuaStatePool();
+
+    // a pre-initialised state of the burn version, nullptr if none is ready, the pool is refilled in background
+    lua_State *Acquire(int32_t burnVersion);
+    // close the used state in background
+    void Release(lua_State *L);
+
+    // a new state with the libs opened under the burner of the burn version, nullptr if failed
+    static lua_State *NewState(int32_t burnVersion);
+
+private:
+    void Fill();
+
+    const uint32_t size;
+    std::mutex mtx;
+    int32_t version = 0;  // burn version of the states
+    std::deque<lua_State *> states;
+    bool filling = false;
+    std::unique_ptr<CWorkerPool> pWorker;
+};
+
+// the lua state pool, nullptr if -luastatepool=0
+CLuaStatePool *GetLuaStatePool();
+
 #endif  // LUA_VM_H
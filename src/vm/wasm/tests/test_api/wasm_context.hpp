@@ -190,6 +190,46 @@ class wasm_context : public wasm_context_interface {
         bool get_data  ( const uint64_t& contract, const string& k, string &v ) { return cache.GetContractData(contract, k, v); }
         bool erase_data( const uint64_t& contract, const string& k ) { return cache.EraseContractData(contract, k); }
 
+        // the erased keys are removed from the database, so one key is visited at most
+        bool next_data_key( const uint64_t& contract, const string& k, bool inclusive, string& next,
+                            uint32_t& steps ) {
+            string prefix((const char *)&contract, sizeof(uint64_t));
+            auto   iter = inclusive ? cache.database.lower_bound(prefix + k) : cache.database.upper_bound(prefix + k);
+            steps = (iter == cache.database.end()) ? 0 : 1;
+            if (iter == cache.database.end() || iter->first.compare(0, prefix.size(), prefix) != 0) return false;
+            next = iter->first.substr(prefix.size());
+            return true;
+        }
+
+        bool prev_data_key( const uint64_t& contract, const string* pk, string& prev, uint32_t& steps ) {
+            steps = 0;
+            string prefix((const char *)&contract, sizeof(uint64_t));
+            auto   iter = pk ? cache.database.lower_bound(prefix + *pk) : cache.database.end();
+            if (!pk) {
+                uint64_t next_contract = contract + 1;
+                if (next_contract != 0)
+                    iter = cache.database.lower_bound(string((const char *)&next_contract, sizeof(uint64_t)));
+            }
+            if (iter == cache.database.begin()) return false;
+            --iter;
+            steps = 1;
+            if (iter->first.compare(0, prefix.size(), prefix) != 0) return false;
+            prev = iter->first.substr(prefix.size());
+            return true;
+        }
+
+        int32_t add_db_iterator( const uint64_t& contract, const string& k ) {
+            db_iterators.emplace_back(contract, k);
+            return db_iterators.size() - 1;
+        }
+
+        bool get_db_iterator( int32_t iterator, uint64_t& contract, string& k ) {
+            if (iterator < 0 || iterator >= (int32_t)db_iterators.size()) return false;
+            contract = db_iterators[iterator].first;
+            k        = db_iterators[iterator].second;
+            return true;
+        }
+
         std::vector<uint64_t>    get_active_producers() { return std::vector<uint64_t>(); }
         vm::wasm_allocator*      get_wasm_allocator()   { return &wasm_alloc; }
         // bool                     is_memory_in_wasm_allocator( const char* p ) { 
@@ -203,6 +243,7 @@ class wasm_context : public wasm_context_interface {
         std::chrono::milliseconds get_max_transaction_duration(){ return std::chrono::milliseconds(wasm::max_wasm_execute_time_infinite); }
 
         void update_storage_usage(const uint64_t& account, const int64_t& size_in_bytes){};
+        void charge_fuel(const uint64_t& fuel){};
         bool contracts_console() { return true; } //should be set by console
         void console_append( const string& val ) {
             _pending_console_output << val;
@@ -225,6 +266,7 @@ class wasm_context : public wasm_context_interface {
         wasm::wasm_interface wasmif;
         vm::wasm_allocator   wasm_alloc;
         uint64_t             _receiver;
+        vector<pair<uint64_t, string>> db_iterators;
         //std::chrono::milliseconds ;
 
     private:
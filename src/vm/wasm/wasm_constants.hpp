@@ -29,6 +29,10 @@ namespace wasm {
 
     const static uint64_t store_fuel_fee_per_byte       = 100;
     const static uint64_t notice_fuel_fee_per_recipient = 10000;
+    const static uint64_t db_iterate_fuel_per_step      = 1000;
+
+    const static int32_t  db_iterator_none = -1;
+    const static int32_t  db_iterator_end  = -2;
 
 
     namespace wasm_constraints {
@@ -112,6 +112,16 @@ namespace wasm {
         return code;
     }
 
+    bool wasm_context::get_code_hash(const uint64_t& account, uint256& code_hash) {
+
+        static const uint256 empty_code_hash = Hash((uint8_t*)nullptr, (uint8_t*)nullptr);
+
+        CAccount contract_account;
+        return database.accountCache.GetAccount(CNickID(account), contract_account)
+               && database.contractCache.GetContractCodeHash(contract_account.regid, code_hash)
+               && code_hash != empty_code_hash;
+    }
+
     // std::string wasm_context::get_abi(uint64_t account) {
     //     CUniversalContract contract;
     //     CAccount contract_account ;
@@ -174,9 +184,10 @@ namespace wasm {
                 (*native)(*this);
             } else {
 
-                vector <uint8_t> code = get_code(_receiver);
-                if (code.size() > 0) {
-                    wasmif.execute(code, this);
+                // the code is only read to instantiate the module if it is not cached
+                uint256 code_hash;
+                if (get_code_hash(_receiver, code_hash)) {
+                    wasmif.execute(code_hash, [this]() { return get_code(_receiver); }, this);
                 }
             }
         }  catch (wasm_chain::exception &e) {
@@ -281,6 +292,45 @@ namespace wasm {
         return active_producers;
     }
 
+    CContractDataHandle& wasm_context::get_storage(const uint64_t& contract) {
+
+        auto it = contract_storages.find(contract);
+        if (it != contract_storages.end())
+            return it->second;
+
+        CAccount   contract_account;
+        wasm::name contract_name = wasm::name(contract);
+        CHAIN_ASSERT( database.accountCache.GetAccount(nick_name(contract), contract_account),
+                      account_access_exception,
+                      "contract '%s' does not exist",
+                      contract_name.to_string().c_str())
+
+        return contract_storages.emplace(contract, CContractDataHandle(database.contractCache, contract_account.regid))
+                                .first->second;
+    }
+
+    int32_t wasm_context::add_db_iterator(const uint64_t& contract, const string& k) {
+
+        auto it = db_iterator_indexes.find(std::make_pair(contract, k));
+        if (it != db_iterator_indexes.end())
+            return it->second;
+
+        int32_t iterator = db_iterators.size();
+        db_iterators.emplace_back(contract, k);
+        db_iterator_indexes.emplace(db_iterators.back(), iterator);
+        return iterator;
+    }
+
+    bool wasm_context::get_db_iterator(int32_t iterator, uint64_t& contract, string& k) {
+
+        if (iterator < 0 || iterator >= (int32_t)db_iterators.size())
+            return false;
+
+        contract = db_iterators[iterator].first;
+        k        = db_iterators[iterator].second;
+        return true;
+    }
+
     void wasm_context::update_storage_usage(const uint64_t& account, const int64_t& size_in_bytes){
 
         int64_t disk_usage    = size_in_bytes * store_fuel_fee_per_byte;
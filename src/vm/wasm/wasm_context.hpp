@@ -43,6 +43,7 @@ namespace wasm {
         void                  execute_one(inline_transaction_trace &trace);
         bool                  has_permission_from_inline_transaction(const permission &p);
         std::vector <uint8_t> get_code(const uint64_t& account);
+        bool                  get_code_hash(const uint64_t& account, uint256& code_hash);
 // Console methods:
     public:
         void                      reset_console();
@@ -71,38 +72,34 @@ namespace wasm {
         void        exit      () { wasmif.exit(); }
 
         bool set_data( const uint64_t& contract, const string& k, const string& v ) {
-            CAccount   contract_account;
-            wasm::name contract_name = wasm::name(contract);
-            CHAIN_ASSERT( database.accountCache.GetAccount(nick_name(contract), contract_account),
-                          account_access_exception,
-                          "contract '%s' does not exist",
-                          contract_name.to_string().c_str())
-
-            return database.contractCache.SetContractData(contract_account.regid, k, v);
+            return get_storage(contract).Set(k, v);
         }
 
         bool get_data( const uint64_t& contract, const string& k, string &v ) {
-            CAccount   contract_account;
-            wasm::name contract_name = wasm::name(contract);
-            CHAIN_ASSERT( database.accountCache.GetAccount(nick_name(contract), contract_account),
-                          account_access_exception,
-                          "contract '%s' does not exist",
-                          contract_name.to_string().c_str())
-
-            return database.contractCache.GetContractData(contract_account.regid, k, v);
+            return get_storage(contract).Get(k, v);
         }
 
         bool erase_data( const uint64_t& contract, const string& k ) {
-            CAccount   contract_account;
-            wasm::name contract_name = wasm::name(contract);
-            CHAIN_ASSERT( database.accountCache.GetAccount(nick_name(contract), contract_account),
-                          account_access_exception,
-                          "contract '%s' does not exist",
-                          contract_name.to_string().c_str())
-
-            return database.contractCache.EraseContractData(contract_account.regid, k);
+            return get_storage(contract).Erase(k);
         }
 
+        bool next_data_key( const uint64_t& contract, const string& k, bool inclusive, string& next,
+                            uint32_t& steps ) {
+            steps = 0;
+            return get_storage(contract).GetNextKey(k, inclusive, next, &steps);
+        }
+
+        bool prev_data_key( const uint64_t& contract, const string* pk, string& prev, uint32_t& steps ) {
+            steps = 0;
+            return get_storage(contract).GetPrevKey(pk, prev, &steps);
+        }
+
+        // the data handle of contract, the contract account is resolved by the first access in the context
+        CContractDataHandle& get_storage( const uint64_t& contract );
+
+        int32_t add_db_iterator( const uint64_t& contract, const string& k );
+        bool    get_db_iterator( int32_t iterator, uint64_t& contract, string& k );
+
         std::vector<uint64_t> get_active_producers();
 
         bool contracts_console() {
@@ -119,6 +116,7 @@ namespace wasm {
         }
         std::chrono::milliseconds get_max_transaction_duration() { return control_trx.get_max_transaction_duration(); }
         void                      update_storage_usage( const uint64_t& account, const int64_t& size_in_bytes);
+        void                      charge_fuel( const uint64_t& fuel ) { control_trx.run_cost += fuel; }
         void                      pause_billing_timer ()  { control_trx.pause_billing_timer();  };
         void                      resume_billing_timer()  { control_trx.resume_billing_timer(); };
 
@@ -137,5 +135,11 @@ namespace wasm {
 
     private:
         std::ostringstream         _pending_console_output;
+
+        map<uint64_t, CContractDataHandle>     contract_storages;
+
+        // the keys of the db iterators, an iterator is the index of its key
+        vector<pair<uint64_t, string>>          db_iterators;
+        map<pair<uint64_t, string>, int32_t>    db_iterator_indexes;
     };
 }
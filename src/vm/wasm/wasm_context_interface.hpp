@@ -42,6 +42,15 @@ namespace wasm {
         virtual bool set_data  ( const uint64_t& contract, const string& k, const string& v ) = 0;//{ return 0; }
         virtual bool get_data  ( const uint64_t& contract, const string& k, string &v       ) = 0;//{ return 0; }
         virtual bool erase_data( const uint64_t& contract, const string& k                  ) = 0;//{ return 0; }
+        // the least key of contract not less than k, or greater than k if !inclusive,
+        // steps is the count of the keys visited, the erased ones skipped included
+        virtual bool next_data_key( const uint64_t& contract, const string& k, bool inclusive, string& next,
+                                    uint32_t& steps ) = 0;
+        // the greatest key of contract less than *pk, the last key if pk is nullptr
+        virtual bool prev_data_key( const uint64_t& contract, const string* pk, string& prev, uint32_t& steps ) = 0;
+        // the iterators of the keys got by the db iterating functions, valid in the context
+        virtual int32_t add_db_iterator( const uint64_t& contract, const string& k ) = 0;
+        virtual bool    get_db_iterator( int32_t iterator, uint64_t& contract, string& k ) = 0;
 
         virtual std::vector<uint64_t> get_active_producers() = 0;//{ return std::vector<uint64_t>(); }
         virtual vm::wasm_allocator*   get_wasm_allocator()   = 0;//{ return nullptr;                 }
@@ -52,6 +61,7 @@ namespace wasm {
         // }
         virtual std::chrono::milliseconds get_max_transaction_duration() = 0;//{ return std::chrono::milliseconds(max_wasm_execute_time_infinite); }
         virtual void update_storage_usage(const uint64_t& account, const int64_t& size_in_bytes) = 0;//{}
+        virtual void charge_fuel(const uint64_t& fuel) = 0;//{}
         virtual bool contracts_console() = 0;//{ return true; }
         virtual void console_append   ( const string& val ) = 0;//{}
 
@@ -15,9 +15,20 @@
 #include "wasm/exception/exceptions.hpp"
 
 #include "crypto/hash.h"
+#include "config/configuration.h"
+#include "config/const.h"
+#include "commons/util/util.h"
+#include "commons/serialize.h"
+#include <boost/thread.hpp>
 #include <openssl/ripemd.h>
 #include <openssl/sha.h>
 
+#include <algorithm>
+#include <list>
+#include <mutex>
+#include <tuple>
+#include <unordered_map>
+
 using namespace eosio;
 using namespace eosio::vm;
 
@@ -36,9 +47,57 @@ namespace wasm {
     using code_version_t     = uint256;
     using backend_validate_t = backend<wasm::wasm_context_interface, vm::interpreter>;
     using rhf_t              = eosio::vm::registered_host_functions<wasm_context_interface>;
+    // code hash, contract account, count of calls
+    using hot_contract_t     = std::tuple<code_version_t, uint64_t, uint64_t>;
+
+    static const uint32_t hot_contracts_file_version = 1;
+    static const size_t   max_hot_contracts          = 4096;
+
+    /**
+     * The instantiated modules by code hash, bounded by the total code size of the modules (-wasmcachesize),
+     * the least recently used ones are evicted. The compiled code of a module is about the size of the wasm code.
+     */
+    class wasm_instantiation_cache {
+    public:
+        std::shared_ptr<wasm_instantiated_module_interface> get(const code_version_t& code_id, uint64_t account,
+                                                                const std::function<vector<uint8_t>()>& load_code);
+        // instantiate the module of code if it is not cached, without holding the cache while instantiating
+        bool warm(const code_version_t& code_id, const vector<uint8_t>& code);
+        wasm_cache_stats get_stats();
+        void clear();
+
+        // the called contracts, the most called first
+        vector<hot_contract_t> get_hot_contracts(size_t count);
+        // add the calls of the contracts saved by the last run
+        void add_hot_contracts(const vector<hot_contract_t>& contracts);
 
-    std::optional<std::map <code_version_t, std::shared_ptr<wasm_instantiated_module_interface>>>& get_wasm_instantiation_cache(){
-        static std::optional<std::map <code_version_t, std::shared_ptr<wasm_instantiated_module_interface>>> wasm_instantiation_cache;
+    private:
+        struct cache_entry {
+            std::shared_ptr<wasm_instantiated_module_interface> module;
+            size_t                                              size;
+            std::list<code_version_t>::iterator                 lru_it;
+        };
+
+        struct hot_entry {
+            uint64_t account = 0;
+            uint64_t calls   = 0;
+        };
+
+        void init_max_bytes();
+        void insert(const code_version_t& code_id, const std::shared_ptr<wasm_instantiated_module_interface>& module,
+                    size_t size);
+        void add_calls(const code_version_t& code_id, uint64_t account, uint64_t calls);
+
+        std::mutex                                                       mtx;
+        std::list<code_version_t>                                        lru;  // the most recently used first
+        std::unordered_map<code_version_t, cache_entry, CUint256Hasher>  entries;
+        std::unordered_map<code_version_t, hot_entry, CUint256Hasher>    hot;  // calls of the modules, even evicted
+        wasm_cache_stats                                                 stats;
+        bool                                                             max_bytes_inited = false;
+    };
+
+    wasm_instantiation_cache& get_wasm_instantiation_cache(){
+        static wasm_instantiation_cache wasm_instantiation_cache;
         return wasm_instantiation_cache;
     }
 
@@ -55,30 +114,139 @@ namespace wasm {
         get_runtime_interface()->immediately_exit_currently_running_module();
     }
 
-    std::shared_ptr <wasm_instantiated_module_interface> get_instantiated_backend(const vector <uint8_t> &code) {
+    void wasm_instantiation_cache::init_max_bytes() {
+        if (!max_bytes_inited) {
+            max_bytes_inited = true;
+            stats.max_bytes  = std::max<int64_t>(0, SysCfg().GetArg("-wasmcachesize", DEFAULT_WASM_CACHE_SIZE)) << 20;
+        }
+    }
 
-        try {
-            if(!get_wasm_instantiation_cache().has_value()){
-                 get_wasm_instantiation_cache() = std::map <code_version_t, std::shared_ptr<wasm_instantiated_module_interface>>{};
-            }
+    void wasm_instantiation_cache::insert(const code_version_t& code_id,
+                                          const std::shared_ptr<wasm_instantiated_module_interface>& module,
+                                          size_t size) {
+        lru.push_front(code_id);
+        entries[code_id] = cache_entry{module, size, lru.begin()};
+        stats.cached_bytes += size;
+
+        // the module just instantiated is kept even if it exceeds the limit alone
+        while (stats.cached_bytes > stats.max_bytes && lru.size() > 1) {
+            auto evict_it = entries.find(lru.back());
+            stats.cached_bytes -= evict_it->second.size;
+            entries.erase(evict_it);
+            lru.pop_back();
+            stats.evictions++;
+        }
+        stats.cached_modules = entries.size();
+    }
+
+    void wasm_instantiation_cache::add_calls(const code_version_t& code_id, uint64_t account, uint64_t calls) {
+        auto it = hot.find(code_id);
+        if (it == hot.end()) {
+            if (hot.size() >= max_hot_contracts)
+                return;
+            it = hot.emplace(code_id, hot_entry()).first;
+        }
+        it->second.account = account;
+        it->second.calls += calls;
+    }
+
+    std::shared_ptr<wasm_instantiated_module_interface> wasm_instantiation_cache::get(
+            const code_version_t& code_id, uint64_t account, const std::function<vector<uint8_t>()>& load_code) {
+
+        std::lock_guard<std::mutex> lock(mtx);
+        init_max_bytes();
+        add_calls(code_id, account, 1);
+
+        auto it = entries.find(code_id);
+        if (it != entries.end()) {
+            stats.hits++;
+            lru.splice(lru.begin(), lru, it->second.lru_it);
+            return it->second.module;
+        }
+
+        stats.misses++;
+        int64_t start = GetTimeMicros();
+        vector<uint8_t> code = load_code();
+        auto module = get_runtime_interface()->instantiate_module((const char*)code.data(), code.size());
+        stats.instantiation_us += GetTimeMicros() - start;
+
+        insert(code_id, module, code.size());
+        return module;
+    }
+
+    bool wasm_instantiation_cache::warm(const code_version_t& code_id, const vector<uint8_t>& code) {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            init_max_bytes();
+            if (entries.count(code_id))
+                return false;
+        }
+
+        auto module = get_runtime_interface()->instantiate_module((const char*)code.data(), code.size());
 
-            auto code_id = Hash(code.begin(), code.end());
-            auto it = get_wasm_instantiation_cache()->find(code_id);
-            if (it == get_wasm_instantiation_cache()->end()) {
-                get_wasm_instantiation_cache().value()[code_id] = get_runtime_interface()->instantiate_module((const char*)code.data(), code.size());
-                return get_wasm_instantiation_cache().value()[code_id];
+        std::lock_guard<std::mutex> lock(mtx);
+        // instantiated by an execution meanwhile
+        if (entries.count(code_id))
+            return false;
+
+        // the warmed modules are less recently used than the executed ones, not to evict them
+        if (stats.cached_bytes + code.size() > stats.max_bytes && !entries.empty())
+            return false;
+
+        insert(code_id, module, code.size());
+        lru.splice(lru.end(), lru, entries[code_id].lru_it);
+        return true;
+    }
+
+    wasm_cache_stats wasm_instantiation_cache::get_stats() {
+        std::lock_guard<std::mutex> lock(mtx);
+        return stats;
+    }
+
+    void wasm_instantiation_cache::clear() {
+        std::lock_guard<std::mutex> lock(mtx);
+        entries.clear();
+        lru.clear();
+        stats.cached_bytes   = 0;
+        stats.cached_modules = 0;
+    }
+
+    vector<hot_contract_t> wasm_instantiation_cache::get_hot_contracts(size_t count) {
+        vector<hot_contract_t> contracts;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            contracts.reserve(hot.size());
+            for (const auto& item : hot) {
+                contracts.emplace_back(item.first, item.second.account, item.second.calls);
             }
-            return it->second;
-        } catch (...) {
-            throw;
         }
 
+        std::sort(contracts.begin(), contracts.end(), [](const hot_contract_t& a, const hot_contract_t& b) {
+            return std::get<2>(a) > std::get<2>(b);
+        });
+        if (contracts.size() > count)
+            contracts.resize(count);
+        return contracts;
+    }
+
+    void wasm_instantiation_cache::add_hot_contracts(const vector<hot_contract_t>& contracts) {
+        std::lock_guard<std::mutex> lock(mtx);
+        for (const auto& contract : contracts) {
+            add_calls(std::get<0>(contract), std::get<1>(contract), std::get<2>(contract));
+        }
     }
 
     void wasm_interface::execute(const vector <uint8_t> &code, wasm_context_interface *pWasmContext) {
 
+        execute(Hash(code.begin(), code.end()), [&code]() { return code; }, pWasmContext);
+
+    }
+
+    void wasm_interface::execute(const uint256& code_hash, const std::function<vector <uint8_t>()>& load_code,
+                                 wasm_context_interface *pWasmContext) {
+
         pWasmContext->pause_billing_timer();
-        auto pInstantiated_module = get_instantiated_backend(code);
+        auto pInstantiated_module = get_wasm_instantiation_cache().get(code_hash, pWasmContext->receiver(), load_code);
         pWasmContext->resume_billing_timer();
 
         //system_clock::time_point start = system_clock::now();
@@ -89,6 +257,10 @@ namespace wasm {
 
     }
 
+    wasm_cache_stats wasm_interface::get_cache_stats() {
+        return get_wasm_instantiation_cache().get_stats();
+    }
+
     void wasm_interface::validate(const vector <uint8_t> &code) {
 
         try {
@@ -106,12 +278,16 @@ namespace wasm {
 
     void wasm_interface::initialize(vm_type vm) {
 
-        if (vm == wasm::vm_type::eos_vm)
-            get_runtime_interface() = std::make_shared<wasm::wasm_vm_runtime<vm::interpreter>>();
-        else if (vm == wasm::vm_type::eos_vm_jit)
-            get_runtime_interface() = std::make_shared<wasm::wasm_vm_runtime<vm::jit>>();
-        else
-            get_runtime_interface() = std::make_shared<wasm::wasm_vm_runtime<vm::interpreter>>();
+        // only the first call takes effect, the cached modules refer to the runtime
+        static std::once_flag runtime_inited;
+        std::call_once(runtime_inited, [vm]() {
+            if (vm == wasm::vm_type::eos_vm)
+                get_runtime_interface() = std::make_shared<wasm::wasm_vm_runtime<vm::interpreter>>();
+            else if (vm == wasm::vm_type::eos_vm_jit)
+                get_runtime_interface() = std::make_shared<wasm::wasm_vm_runtime<vm::jit>>();
+            else
+                get_runtime_interface() = std::make_shared<wasm::wasm_vm_runtime<vm::interpreter>>();
+        });
 
     }
 
@@ -131,6 +307,27 @@ namespace wasm {
                               key    = string((const char *) prefix.data(), prefix.size()) + key;
         }
 
+        template<typename T>
+        static bool HasPrefix( T t, const string &key ) {
+            std::vector<char> prefix = wasm::pack(t);
+            return key.compare(0, prefix.size(), prefix.data(), prefix.size()) == 0;
+        }
+
+        // the key with prefix of the iterator, which must be got by the contract
+        string get_db_iterator_key( const uint64_t& contract, int32_t iterator ) {
+            uint64_t iterator_contract = 0;
+            string   k;
+            CHAIN_ASSERT( pWasmContext->get_db_iterator(iterator, iterator_contract, k) && iterator_contract == contract,
+                          wasm_chain::wasm_assert_exception,
+                          "invalid db iterator %d", iterator)
+            return k;
+        }
+
+        // charge every key visited by a db iterating function, the erased ones skipped included, one step at least
+        void charge_db_iterate_fuel( uint32_t steps ) {
+            pWasmContext->charge_fuel(db_iterate_fuel_per_step * std::max<uint64_t>(steps, 1));
+        }
+
         //system
         void abort() {
             CHAIN_ASSERT( false, wasm_chain::abort_called, "abort() called" )
@@ -350,6 +547,87 @@ namespace wasm {
             return 1;
         }
 
+        //database iterators, in the order of the keys of receiver, an iterator is the handle of the key it points to,
+        //so it stays valid after the data is modified. db_iterator_none is returned if there is no such key
+        int32_t db_lowerbound( const void *key, uint32_t key_len ) {
+
+            CHECK_WASM_IN_MEMORY(key,     key_len)
+            CHECK_WASM_DATA_SIZE(key_len, "key"  )
+
+            string k        = string((const char *) key, key_len);
+            auto   contract = pWasmContext->receiver();
+            AddPrefix(contract, k);
+            CHAIN_ASSERT( k.size() <= MAX_CONTRACT_KEY_SIZE,
+                          wasm_chain::wasm_api_data_size_exceeds_exception,
+                          "key size must be <= %ld, but get %ld",
+                          MAX_CONTRACT_KEY_SIZE, k.size() )
+
+            string   next;
+            uint32_t steps = 0;
+            bool     found = pWasmContext->next_data_key(contract, k, true, next, steps);
+            charge_db_iterate_fuel(steps);
+            if (!found || !HasPrefix(contract, next))
+                return db_iterator_end;
+            return pWasmContext->add_db_iterator(contract, next);
+        }
+
+        int32_t db_end() {
+            return db_iterator_end;
+        }
+
+        int32_t db_next( int32_t iterator ) {
+
+            CHAIN_ASSERT( iterator != db_iterator_end,
+                          wasm_chain::wasm_assert_exception,
+                          "db_next can not be called with the end iterator")
+
+            auto   contract = pWasmContext->receiver();
+            string k        = get_db_iterator_key(contract, iterator);
+
+            string   next;
+            uint32_t steps = 0;
+            bool     found = pWasmContext->next_data_key(contract, k, false, next, steps);
+            charge_db_iterate_fuel(steps);
+            if (!found || !HasPrefix(contract, next))
+                return db_iterator_end;
+            return pWasmContext->add_db_iterator(contract, next);
+        }
+
+        int32_t db_previous( int32_t iterator ) {
+
+            auto   contract = pWasmContext->receiver();
+            string k;
+            if (iterator != db_iterator_end)
+                k = get_db_iterator_key(contract, iterator);
+
+            // the previous of the end iterator is the last key of receiver
+            string   prev;
+            uint32_t steps = 0;
+            bool     found = pWasmContext->prev_data_key(contract, (iterator == db_iterator_end) ? nullptr : &k,
+                                                         prev, steps);
+            charge_db_iterate_fuel(steps);
+            if (!found || !HasPrefix(contract, prev))
+                return db_iterator_none;
+            return pWasmContext->add_db_iterator(contract, prev);
+        }
+
+        // copy the key of iterator, without the prefix of receiver, return the size of the key
+        int32_t db_get_key( int32_t iterator, void *key, uint32_t key_len ) {
+
+            auto   contract = pWasmContext->receiver();
+            string k        = get_db_iterator_key(contract, iterator).substr(sizeof(contract));
+
+            auto size = k.size();
+            if (key_len == 0) return size;
+
+            CHECK_WASM_IN_MEMORY(key,     key_len)
+            CHECK_WASM_DATA_SIZE(key_len, "key"  )
+
+            auto key_size = key_len > size ? size : key_len;
+            std::memcpy(key, k.data(), key_size);
+            return key_size;
+        }
+
 
         //memory
         void *memcpy( void *dest, const void *src, int len ) {
@@ -908,6 +1186,11 @@ namespace wasm {
     REGISTER_WASM_VM_INTRINSIC(wasm_host_methods, env, db_remove, db_remove)
     REGISTER_WASM_VM_INTRINSIC(wasm_host_methods, env, db_get,    db_get)
     REGISTER_WASM_VM_INTRINSIC(wasm_host_methods, env, db_update, db_update)
+    REGISTER_WASM_VM_INTRINSIC(wasm_host_methods, env, db_lowerbound, db_lowerbound)
+    REGISTER_WASM_VM_INTRINSIC(wasm_host_methods, env, db_end,        db_end)
+    REGISTER_WASM_VM_INTRINSIC(wasm_host_methods, env, db_next,       db_next)
+    REGISTER_WASM_VM_INTRINSIC(wasm_host_methods, env, db_previous,   db_previous)
+    REGISTER_WASM_VM_INTRINSIC(wasm_host_methods, env, db_get_key,    db_get_key)
 
     REGISTER_WASM_VM_INTRINSIC(wasm_host_methods, env, memcpy,  memcpy)
     REGISTER_WASM_VM_INTRINSIC(wasm_host_methods, env, memmove, memmove)
@@ -989,5 +1272,115 @@ namespace wasm {
 
 extern  void wasm_code_cache_free() {
      //free heap before shut down
-     wasm::get_wasm_instantiation_cache().reset();
+     wasm::get_wasm_instantiation_cache().clear();
+}
+
+static boost::filesystem::path GetWasmHotContractsPath() { return GetDataDir() / "wasmhot.dat"; }
+
+extern bool wasm_code_cache_dump() {
+
+    vector<wasm::hot_contract_t> contracts =
+        wasm::get_wasm_instantiation_cache().get_hot_contracts(wasm::max_hot_contracts);
+
+    // serialize the contracts, checksum data up to that point, then append csum
+    CDataStream ssHot(SER_DISK, CLIENT_VERSION);
+    ssHot << wasm::hot_contracts_file_version;
+    ssHot << contracts;
+    uint256 hash = Hash(ssHot.begin(), ssHot.end());
+    ssHot << hash;
+
+    boost::filesystem::path path    = GetWasmHotContractsPath();
+    boost::filesystem::path pathTmp = path.string() + ".new";
+    FILE* file                      = fopen(pathTmp.string().c_str(), "wb");
+    CAutoFile fileout               = CAutoFile(file, SER_DISK, CLIENT_VERSION);
+    if (!fileout)
+        return ERRORMSG("%s : Failed to open file %s", __func__, pathTmp.string());
+
+    try {
+        fileout << ssHot;
+    } catch (std::exception& e) {
+        return ERRORMSG("%s : Serialize or I/O error - %s", __func__, e.what());
+    }
+    FileCommit(fileout);
+    fileout.fclose();
+
+    if (!RenameOver(pathTmp, path))
+        return ERRORMSG("%s : Rename-into-place failed", __func__);
+
+    LogPrint(BCLog::INFO, "Saved %d hot wasm contracts\n", contracts.size());
+    return true;
+}
+
+static bool ReadWasmHotContracts(vector<wasm::hot_contract_t>& contracts) {
+
+    boost::filesystem::path path = GetWasmHotContractsPath();
+    FILE* file                   = fopen(path.string().c_str(), "rb");
+    CAutoFile filein             = CAutoFile(file, SER_DISK, CLIENT_VERSION);
+    if (!filein)
+        return false;
+
+    int64_t dataSize = (int64_t)boost::filesystem::file_size(path) - (int64_t)sizeof(uint256);
+    if (dataSize < 0)
+        return ERRORMSG("%s : Invalid file size of %s", __func__, path.string());
+
+    vector<uint8_t> vchData(dataSize);
+    uint256 hashIn;
+    try {
+        filein.read((char*)vchData.data(), dataSize);
+        filein >> hashIn;
+    } catch (std::exception& e) {
+        return ERRORMSG("%s : Deserialize or I/O error - %s", __func__, e.what());
+    }
+    filein.fclose();
+
+    CDataStream ssHot(vchData, SER_DISK, CLIENT_VERSION);
+    if (hashIn != Hash(ssHot.begin(), ssHot.end()))
+        return ERRORMSG("%s : Checksum mismatch, data corrupted", __func__);
+
+    try {
+        uint32_t version;
+        ssHot >> version;
+        if (version != wasm::hot_contracts_file_version)
+            return ERRORMSG("%s : Unknown version %u", __func__, version);
+
+        ssHot >> contracts;
+    } catch (std::exception& e) {
+        return ERRORMSG("%s : Deserialize or I/O error - %s", __func__, e.what());
+    }
+    return true;
+}
+
+extern void wasm_code_cache_warm_up(uint32_t count,
+                                    const std::function<bool(uint64_t, uint256&, vector<uint8_t>&)>& loadCode) {
+
+    vector<wasm::hot_contract_t> contracts;
+    if (!ReadWasmHotContracts(contracts))
+        return;
+
+    auto& cache = wasm::get_wasm_instantiation_cache();
+    cache.add_hot_contracts(contracts);
+
+    // the same vm as the wasm contexts
+    wasm::wasm_interface().initialize(wasm::vm_type::eos_vm_jit);
+
+    int64_t start   = GetTimeMillis();
+    uint32_t warmed = 0;
+    for (const auto& contract : cache.get_hot_contracts(count)) {
+        boost::this_thread::interruption_point();
+
+        // skip the contract if its code has changed
+        uint256 codeHash;
+        vector<uint8_t> code;
+        if (!loadCode(std::get<1>(contract), codeHash, code) || codeHash != std::get<0>(contract))
+            continue;
+
+        try {
+            if (cache.warm(codeHash, code))
+                warmed++;
+        } catch (...) {
+            LogPrint(BCLog::ERROR, "Failed to instantiate wasm contract %s\n", codeHash.GetHex());
+        }
+    }
+    LogPrint(BCLog::INFO, "Warmed up %u of %u hot wasm contracts (%dms)\n", warmed, contracts.size(),
+             GetTimeMillis() - start);
 }
@@ -2,10 +2,16 @@
 
 #include <vector>
 #include <map>
+#include <functional>
+#include "commons/uint256.h"
 #include "wasm/wasm_context_interface.hpp"
 #include "wasm/wasm_runtime.hpp"
 
 void wasm_code_cache_free();
+// save the most called contracts, to be warmed up by the next run
+bool wasm_code_cache_dump();
+// instantiate the most called contracts of the last run, loadCode gets the code hash and code of a contract account
+void wasm_code_cache_warm_up(uint32_t count, const std::function<bool(uint64_t, uint256&, vector<uint8_t>&)>& loadCode);
 
 namespace wasm {
 
@@ -14,6 +20,16 @@ namespace wasm {
         eos_vm_jit
     };
 
+    struct wasm_cache_stats {
+        uint64_t hits             = 0;
+        uint64_t misses           = 0;
+        uint64_t evictions        = 0;
+        uint64_t instantiation_us = 0;  // total time of instantiating the missed modules
+        uint64_t cached_modules   = 0;
+        uint64_t cached_bytes     = 0;  // total code size of the cached modules
+        uint64_t max_bytes        = 0;
+    };
+
     class wasm_interface {
 
     public:
@@ -24,6 +40,10 @@ namespace wasm {
     public:
         void initialize(vm_type vm);
         void execute(const vector <uint8_t>& code, wasm_context_interface *pWasmContext);
+        // execute the module of code_hash, load_code is only called to instantiate the module if it is not cached
+        void execute(const uint256& code_hash, const std::function<vector <uint8_t>()>& load_code,
+                     wasm_context_interface *pWasmContext);
+        static wasm_cache_stats get_cache_stats();
         void validate(const vector <uint8_t>& code);
         void exit();
 
@@ -98,6 +98,22 @@ namespace wasm { namespace rpc{
         > curl --user myusername -d '{"jsonrpc": "1.0", "id":"curltest", "method":"getabiwasm", "params":["tokenbank999"]}' -H 'Content-Type: application/json;' http://127.0.0.1:8332
     )=====";
 
+    const char *get_wasm_cache_stats_rpc_help_message = R"=====(
+        getwasmcachestats
+        Result:
+        "hits":               (numeric) the count of the executions with a cached module
+        "misses":             (numeric) the count of the executions instantiating the module
+        "evictions":          (numeric) the count of the modules evicted
+        "instantiation_ms":   (numeric) the total time of instantiating the modules
+        "cached_modules":     (numeric) the count of the cached modules
+        "cached_bytes":       (numeric) the total code size of the cached modules
+        "max_bytes":          (numeric) the max total code size of the cached modules
+        Examples:
+        > ./coind getwasmcachestats
+        As json rpc call 
+        > curl --user myusername -d '{"jsonrpc": "1.0", "id":"curltest", "method":"getwasmcachestats", "params":[]}' -H 'Content-Type: application/json;' http://127.0.0.1:8332
+    )=====";
+
     const char *get_tx_trace_rpc_help_message = R"=====(
         gettxtrace "trxid" 
         1."txid": (string, required)  The hash of transaction
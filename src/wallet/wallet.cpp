@@ -209,14 +209,19 @@ void CWallet::ResendWalletTransactions() {
 
 //// Call after CreateTransaction unless you want to abort
 std::tuple<bool, string> CWallet::CommitTx(CBaseTx *pTx) {
+    CValidationState state;
+    if (!::PreAcceptToMemoryPool(mempool, state, pTx)) {
+        LogPrint(BCLog::INFO, "CommitTx() : invalid transaction %s\n", state.GetRejectReason());
+        return std::make_tuple(false, state.GetRejectReason());
+    }
+
     LOCK2(cs_main, cs_wallet);
     LogPrint(BCLog::INFO, "CommitTx() : %s\n", pTx->ToString(*pCdMan->pAccountCache));
 
     string ret;
 
     {
-        CValidationState state;
-        if (!::AcceptToMemoryPool(mempool, state, pTx, true)) {
+        if (!::AcceptToMemoryPool(mempool, state, pTx, true, false, true)) {
             // This must not fail. The transaction has already been signed and recorded.
             LogPrint(BCLog::INFO, "CommitTx() : invalid transaction %s\n", state.GetRejectReason());
             return std::make_tuple(false, state.GetRejectReason());